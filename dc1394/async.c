@@ -0,0 +1,221 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Asynchronous capture
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* for CPU_SET and pthread_attr_setaffinity_np() */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "internal.h"
+#include "capture.h"
+#include "async.h"
+#include "log.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/* how often the capture thread checks whether it must stop, when no
+   frames come [microseconds] */
+#define ASYNC_WAKEUP_US 100000
+
+struct __dc1394async_t {
+    dc1394camera_t * camera;
+    dc1394async_callback_t callback;
+    void * user_data;
+
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t released;         /* a kept frame was released */
+    int kept;                        /* frames kept by the callback */
+    int quit;
+    dc1394error_t error;             /* what stopped the capture thread */
+#endif
+};
+
+#ifdef HAVE_PTHREAD
+static void *
+capture_thread (void * arg)
+{
+    dc1394async_t * a = arg;
+    dc1394video_frame_t * frame;
+    dc1394error_t err;
+    int quit, wait = 0;
+
+    while (1) {
+        pthread_mutex_lock (&a->mutex);
+        quit = a->quit;
+        pthread_mutex_unlock (&a->mutex);
+        if (quit)
+            break;
+
+        /* waits a while at most, to see quit; without timeouts, the thread
+           stops with the next frame */
+        if (!wait) {
+            err = dc1394_capture_dequeue_timeout (a->camera, ASYNC_WAKEUP_US, &frame);
+            if (err == DC1394_FUNCTION_NOT_SUPPORTED) {
+                wait = 1;
+                continue;
+            }
+        }
+        else
+            err = dc1394_capture_dequeue (a->camera, DC1394_CAPTURE_POLICY_WAIT, &frame);
+        if (err != DC1394_SUCCESS) {
+            dc1394_log_error ("Async: could not dequeue a frame");
+            pthread_mutex_lock (&a->mutex);
+            a->error = err;
+            pthread_mutex_unlock (&a->mutex);
+            break;
+        }
+        if (!frame)
+            continue;
+
+        if (a->callback (a, frame, a->user_data)) {
+            pthread_mutex_lock (&a->mutex);
+            a->kept++;
+            pthread_mutex_unlock (&a->mutex);
+        }
+        else if (dc1394_capture_enqueue (a->camera, frame) != DC1394_SUCCESS)
+            dc1394_log_warning ("Async: could not give back a frame");
+    }
+    return NULL;
+}
+#endif
+
+dc1394async_t *
+dc1394_async_new(dc1394camera_t *camera, dc1394async_callback_t callback, void *user_data, int cpu, int priority)
+{
+#ifdef HAVE_PTHREAD
+    dc1394async_t * a;
+    pthread_attr_t attr;
+    int err;
+
+    if (!camera || !callback)
+        return NULL;
+
+    a = calloc (1, sizeof (dc1394async_t));
+    if (!a)
+        return NULL;
+    a->camera = camera;
+    a->callback = callback;
+    a->user_data = user_data;
+    a->error = DC1394_SUCCESS;
+
+    pthread_attr_init (&attr);
+    if (cpu != DC1394_ASYNC_CPU_ANY) {
+#ifdef HAVE_PTHREAD_ATTR_SETAFFINITY_NP
+        cpu_set_t cpus;
+        err = -1;
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_ZERO (&cpus);
+            CPU_SET (cpu, &cpus);
+            err = pthread_attr_setaffinity_np (&attr, sizeof cpus, &cpus);
+        }
+#else
+        err = -1;
+#endif
+        if (err != 0) {
+            dc1394_log_error ("Async: could not pin the capture thread to CPU %d", cpu);
+            goto error;
+        }
+    }
+    if (priority > 0) {
+        struct sched_param param;
+        memset (&param, 0, sizeof param);
+        param.sched_priority = priority;
+        if (pthread_attr_setinheritsched (&attr, PTHREAD_EXPLICIT_SCHED) != 0 ||
+                pthread_attr_setschedpolicy (&attr, SCHED_FIFO) != 0 ||
+                pthread_attr_setschedparam (&attr, &param) != 0) {
+            dc1394_log_error ("Async: invalid SCHED_FIFO priority %d", priority);
+            goto error;
+        }
+    }
+
+    pthread_mutex_init (&a->mutex, NULL);
+    pthread_cond_init (&a->released, NULL);
+    err = pthread_create (&a->thread, &attr, capture_thread, a);
+    if (err != 0) {
+        dc1394_log_error ("Async: could not start the capture thread: %s", strerror (err));
+        pthread_cond_destroy (&a->released);
+        pthread_mutex_destroy (&a->mutex);
+        goto error;
+    }
+    pthread_attr_destroy (&attr);
+    return a;
+
+ error:
+    pthread_attr_destroy (&attr);
+    free (a);
+    return NULL;
+#else
+    dc1394_log_error ("Async: asynchronous capture needs pthreads");
+    return NULL;
+#endif
+}
+
+dc1394error_t
+dc1394_async_release(dc1394async_t *a, dc1394video_frame_t *frame)
+{
+    dc1394error_t err;
+
+    if (!a || !frame)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    err = dc1394_capture_enqueue (a->camera, frame);
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock (&a->mutex);
+    a->kept--;
+    pthread_cond_broadcast (&a->released);
+    pthread_mutex_unlock (&a->mutex);
+#endif
+    return err;
+}
+
+dc1394error_t
+dc1394_async_free(dc1394async_t *a)
+{
+#ifdef HAVE_PTHREAD
+    dc1394error_t err;
+
+    if (!a)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    pthread_mutex_lock (&a->mutex);
+    a->quit = 1;
+    pthread_mutex_unlock (&a->mutex);
+    pthread_join (a->thread, NULL);
+
+    pthread_mutex_lock (&a->mutex);
+    while (a->kept > 0)
+        pthread_cond_wait (&a->released, &a->mutex);
+    err = a->error;
+    pthread_mutex_unlock (&a->mutex);
+
+    pthread_cond_destroy (&a->released);
+    pthread_mutex_destroy (&a->mutex);
+    free (a);
+    return err;
+#else
+    return DC1394_FUNCTION_NOT_SUPPORTED;
+#endif
+}
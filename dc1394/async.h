@@ -0,0 +1,95 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Asynchronous capture
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <dc1394/log.h>
+#include <dc1394/camera.h>
+#include <dc1394/video.h>
+
+#ifndef __DC1394_ASYNC_H__
+#define __DC1394_ASYNC_H__
+
+/*! \file dc1394/async.h
+    \brief Asynchronous capture
+
+    An asynchronous capture dequeues the frames of a camera from a thread of
+    its own and calls a function with each of them, so that the application
+    does not need a thread per camera blocked in dc1394_capture_dequeue().
+    The frames go back to the ring buffer when the function returns, unless
+    it keeps them: they are then given back with dc1394_async_release().
+    The function can also add holders to a frame with
+    dc1394_capture_frame_ref(), which then goes back with the last of them.
+    Frames go back to the camera in capture order: those that come after a
+    kept frame wait for it, so the frames should be kept for less time than
+    it takes the camera to fill the ring buffer. Requires pthreads.
+*/
+
+/**
+ * Do not pin the capture thread to a CPU
+ */
+#define DC1394_ASYNC_CPU_ANY         -1
+
+/**
+ * An asynchronous capture
+ */
+typedef struct __dc1394async_t dc1394async_t;
+
+/**
+ * Called from the capture thread with each frame, in capture order. Returns DC1394_FALSE to give the frame back to
+ * the ring buffer, or DC1394_TRUE to keep it until dc1394_async_release(). The camera captures into the frames that
+ * are not kept: the function should return before the ring buffer fills up.
+ */
+typedef dc1394bool_t (*dc1394async_callback_t)(dc1394async_t *async, dc1394video_frame_t *frame, void *user_data);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************
+     Asynchronous Capture Functions
+ ***************************************************************************/
+
+/**
+ * Starts calling callback with the frames of camera, whose capture must already be set up with
+ * dc1394_capture_setup(). The capture thread runs on the given CPU, or on any with DC1394_ASYNC_CPU_ANY. With a
+ * priority above 0 it is scheduled with SCHED_FIFO at that priority, which usually needs privileges. Returns NULL on
+ * failure.
+ */
+dc1394async_t *
+dc1394_async_new(dc1394camera_t *camera, dc1394async_callback_t callback, void *user_data, int cpu, int priority);
+
+/**
+ * Gives back to the ring buffer a frame kept by the callback. Can be called from any thread.
+ */
+dc1394error_t
+dc1394_async_release(dc1394async_t *async, dc1394video_frame_t *frame);
+
+/**
+ * Stops the capture thread, then waits for the frames kept to be released and frees the capture. Must not be called
+ * from the callback, and must be called before dc1394_capture_stop(). Returns the error that stopped the capture
+ * thread, if any.
+ */
+dc1394error_t
+dc1394_async_free(dc1394async_t *async);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -21,11 +21,18 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include "config.h"
 #include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "conversions.h"
+#include "conversion_plan.h"
+#include "simd.h"
+#include "threadpool.h"
 
 #define CLIP(in, out)\
    in = in < 0 ? 0 : in;\
@@ -87,6 +94,48 @@ ClearBorders_uint16(uint16_t * rgb, int sx, int sy, int w)
 
 }
 
+/* black out a rectangle of an image whose lines are rgbStep samples apart */
+static void
+clear_rect(uint8_t *rgb, int rgbStep, int x, int y, int w, int h)
+{
+    for (; h > 0; h--, y++)
+        memset(rgb + y * rgbStep + 3 * x, 0, 3 * w);
+}
+
+static void
+clear_rect_uint16(uint16_t *rgb, int rgbStep, int x, int y, int w, int h)
+{
+    for (; h > 0; h--, y++)
+        memset(rgb + y * rgbStep + 3 * x, 0, 3 * w * sizeof(uint16_t));
+}
+
+/* same as ClearBorders() with lines rgbStep samples apart */
+static void
+clear_borders(uint8_t *rgb, int rgbStep, int sx, int sy, int w)
+{
+    int h = sy < w ? sy : w;
+
+    clear_rect(rgb, rgbStep, 0, 0, sx, h);
+    clear_rect(rgb, rgbStep, 0, sy - h, sx, h);
+    if ((sy > 2 * w) && (sx >= w)) {
+        clear_rect(rgb, rgbStep, 0, w, w, sy - 2 * w);
+        clear_rect(rgb, rgbStep, sx - w, w, w, sy - 2 * w);
+    }
+}
+
+static void
+clear_borders_uint16(uint16_t *rgb, int rgbStep, int sx, int sy, int w)
+{
+    int h = sy < w ? sy : w;
+
+    clear_rect_uint16(rgb, rgbStep, 0, 0, sx, h);
+    clear_rect_uint16(rgb, rgbStep, 0, sy - h, sx, h);
+    if ((sy > 2 * w) && (sx >= w)) {
+        clear_rect_uint16(rgb, rgbStep, 0, w, w, sy - 2 * w);
+        clear_rect_uint16(rgb, rgbStep, sx - w, w, w, sy - 2 * w);
+    }
+}
+
 /**************************************************************
  *     Color conversion functions for cameras that can        *
  * output raw-Bayer pattern images, such as some Basler and   *
@@ -99,33 +148,23 @@ ClearBorders_uint16(uint16_t * rgb, int sx, int sy, int w)
 /* 8-bits versions */
 /* insprired by OpenCV's Bayer decoding */
 
-dc1394error_t
-dc1394_bayer_NearestNeighbor(const uint8_t *restrict bayer, uint8_t *restrict rgb, int sx, int sy, int tile)
+static dc1394error_t
+bayer_NearestNeighbor(const uint8_t *restrict bayer, int bayerStep, uint8_t *restrict rgb, int rgbStep,
+                        int sx, int sy, int tile)
 {
-    const int bayerStep = sx;
-    const int rgbStep = 3 * sx;
     int width = sx;
     int height = sy;
     int blue = tile == DC1394_COLOR_FILTER_BGGR
         || tile == DC1394_COLOR_FILTER_GBRG ? -1 : 1;
     int start_with_green = tile == DC1394_COLOR_FILTER_GBRG
         || tile == DC1394_COLOR_FILTER_GRBG;
-    int i, imax, iinc;
 
     if ((tile>DC1394_COLOR_FILTER_MAX)||(tile<DC1394_COLOR_FILTER_MIN))
       return DC1394_INVALID_COLOR_FILTER;
 
     /* add black border */
-    imax = sx * sy * 3;
-    for (i = sx * (sy - 1) * 3; i < imax; i++) {
-        rgb[i] = 0;
-    }
-    iinc = (sx - 1) * 3;
-    for (i = (sx - 1) * 3; i < imax; i += iinc) {
-        rgb[i++] = 0;
-        rgb[i++] = 0;
-        rgb[i++] = 0;
-    }
+    clear_rect (rgb, rgbStep, 0, sy - 1, sx, 1);
+    clear_rect (rgb, rgbStep, sx - 1, 0, 1, sy);
 
     rgb += 1;
     width -= 1;
@@ -183,14 +222,20 @@ dc1394_bayer_NearestNeighbor(const uint8_t *restrict bayer, uint8_t *restrict rg
     return DC1394_SUCCESS;
 }
 
-/* OpenCV's Bayer decoding */
 dc1394error_t
-dc1394_bayer_Bilinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int sx, int sy, int tile)
+dc1394_bayer_NearestNeighbor(const uint8_t *restrict bayer, uint8_t *restrict rgb, int sx, int sy, int tile)
+{
+    return bayer_NearestNeighbor(bayer, sx, rgb, 3 * sx, sx, sy, tile);
+}
+
+/* OpenCV's Bayer decoding */
+static dc1394error_t
+bayer_Bilinear(const uint8_t *restrict bayer, int bayerStep, uint8_t *restrict rgb, int rgbStep,
+                 int sx, int sy, int tile)
 {
-    const int bayerStep = sx;
-    const int rgbStep = 3 * sx;
     int width = sx;
     int height = sy;
+    const simd_dispatch_t * simd = simd_get_dispatch ();
     /*
        the two letters  of the OpenCV name are respectively
        the 4th and 3rd letters from the blinky name,
@@ -211,7 +256,7 @@ dc1394_bayer_Bilinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int
     if ((tile>DC1394_COLOR_FILTER_MAX)||(tile<DC1394_COLOR_FILTER_MIN))
         return DC1394_INVALID_COLOR_FILTER;
 
-    ClearBorders(rgb, sx, sy, 1);
+    clear_borders (rgb, rgbStep, sx, sy, 1);
     rgb += rgbStep + 3 + 1;
     height -= 2;
     width -= 2;
@@ -232,6 +277,13 @@ dc1394_bayer_Bilinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int
             rgb += 3;
         }
 
+        if (simd->bilinear) {
+            int n = simd->bilinear (bayer, rgb - 1, bayerStep,
+                    (bayerEnd - bayer) >> 1, blue);
+            bayer += 2 * n;
+            rgb += 6 * n;
+        }
+
         if (blue > 0) {
             for (; bayer <= bayerEnd - 2; bayer += 2, rgb += 6) {
                 t0 = (bayer[0] + bayer[2] + bayer[bayerStep * 2] +
@@ -292,16 +344,22 @@ dc1394_bayer_Bilinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int
     return DC1394_SUCCESS;
 }
 
+dc1394error_t
+dc1394_bayer_Bilinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int sx, int sy, int tile)
+{
+    return bayer_Bilinear(bayer, sx, rgb, 3 * sx, sx, sy, tile);
+}
+
 /* High-Quality Linear Interpolation For Demosaicing Of
    Bayer-Patterned Color Images, by Henrique S. Malvar, Li-wei He, and
    Ross Cutler, in ICASSP'04 */
-dc1394error_t
-dc1394_bayer_HQLinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int sx, int sy, int tile)
+static dc1394error_t
+bayer_HQLinear(const uint8_t *restrict bayer, int bayerStep, uint8_t *restrict rgb, int rgbStep,
+                 int sx, int sy, int tile)
 {
-    const int bayerStep = sx;
-    const int rgbStep = 3 * sx;
     int width = sx;
     int height = sy;
+    const simd_dispatch_t * simd = simd_get_dispatch ();
     int blue = tile == DC1394_COLOR_FILTER_BGGR
         || tile == DC1394_COLOR_FILTER_GBRG ? -1 : 1;
     int start_with_green = tile == DC1394_COLOR_FILTER_GBRG
@@ -310,7 +368,7 @@ dc1394_bayer_HQLinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int
     if ((tile>DC1394_COLOR_FILTER_MAX)||(tile<DC1394_COLOR_FILTER_MIN))
       return DC1394_INVALID_COLOR_FILTER;
 
-    ClearBorders(rgb, sx, sy, 2);
+    clear_borders (rgb, rgbStep, sx, sy, 2);
     rgb += 2 * rgbStep + 6 + 1;
     height -= 4;
     width -= 4;
@@ -354,6 +412,13 @@ dc1394_bayer_HQLinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int
             rgb += 3;
         }
 
+        if (simd->hqlinear) {
+            int n = simd->hqlinear (bayer, rgb - 1, bayerStep,
+                    (bayerEnd - bayer) >> 1, blue);
+            bayer += 2 * n;
+            rgb += 6 * n;
+        }
+
         if (blue > 0) {
             for (; bayer <= bayerEnd - 2; bayer += 2, rgb += 6) {
                 /* B at B */
@@ -492,6 +557,12 @@ dc1394_bayer_HQLinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int
 
 }
 
+dc1394error_t
+dc1394_bayer_HQLinear(const uint8_t *restrict bayer, uint8_t *restrict rgb, int sx, int sy, int tile)
+{
+    return bayer_HQLinear(bayer, sx, rgb, 3 * sx, sx, sy, tile);
+}
+
 /* coriander's Bayer decoding */
 /* Edge Sensing Interpolation II from http://www-ise.stanford.edu/~tingchen/ */
 /*   (Laroche,Claude A.  "Apparatus and method for adaptively
@@ -563,33 +634,23 @@ dc1394_bayer_Downsample(const uint8_t *restrict bayer, uint8_t *restrict rgb, in
 }
 
 /* this is the method used inside AVT cameras. See AVT docs. */
-dc1394error_t
-dc1394_bayer_Simple(const uint8_t *restrict bayer, uint8_t *restrict rgb, int sx, int sy, int tile)
+static dc1394error_t
+bayer_Simple(const uint8_t *restrict bayer, int bayerStep, uint8_t *restrict rgb, int rgbStep,
+               int sx, int sy, int tile)
 {
-    const int bayerStep = sx;
-    const int rgbStep = 3 * sx;
     int width = sx;
     int height = sy;
     int blue = tile == DC1394_COLOR_FILTER_BGGR
         || tile == DC1394_COLOR_FILTER_GBRG ? -1 : 1;
     int start_with_green = tile == DC1394_COLOR_FILTER_GBRG
         || tile == DC1394_COLOR_FILTER_GRBG;
-    int i, imax, iinc;
 
     if ((tile>DC1394_COLOR_FILTER_MAX)||(tile<DC1394_COLOR_FILTER_MIN))
       return DC1394_INVALID_COLOR_FILTER;
 
     /* add black border */
-    imax = sx * sy * 3;
-    for (i = sx * (sy - 1) * 3; i < imax; i++) {
-        rgb[i] = 0;
-    }
-    iinc = (sx - 1) * 3;
-    for (i = (sx - 1) * 3; i < imax; i += iinc) {
-        rgb[i++] = 0;
-        rgb[i++] = 0;
-        rgb[i++] = 0;
-    }
+    clear_rect (rgb, rgbStep, 0, sy - 1, sx, 1);
+    clear_rect (rgb, rgbStep, sx - 1, 0, 1, sy);
 
     rgb += 1;
     width -= 1;
@@ -647,36 +708,32 @@ dc1394_bayer_Simple(const uint8_t *restrict bayer, uint8_t *restrict rgb, int sx
 
 }
 
+dc1394error_t
+dc1394_bayer_Simple(const uint8_t *restrict bayer, uint8_t *restrict rgb, int sx, int sy, int tile)
+{
+    return bayer_Simple(bayer, sx, rgb, 3 * sx, sx, sy, tile);
+}
+
 /* 16-bits versions */
 
 /* insprired by OpenCV's Bayer decoding */
-dc1394error_t
-dc1394_bayer_NearestNeighbor_uint16(const uint16_t *restrict bayer, uint16_t *restrict rgb, int sx, int sy, int tile, int bits)
+static dc1394error_t
+bayer_NearestNeighbor_uint16(const uint16_t *restrict bayer, int bayerStep, uint16_t *restrict rgb, int rgbStep,
+                               int sx, int sy, int tile, int bits)
 {
-    const int bayerStep = sx;
-    const int rgbStep = 3 * sx;
     int width = sx;
     int height = sy;
     int blue = tile == DC1394_COLOR_FILTER_BGGR
         || tile == DC1394_COLOR_FILTER_GBRG ? -1 : 1;
     int start_with_green = tile == DC1394_COLOR_FILTER_GBRG
         || tile == DC1394_COLOR_FILTER_GRBG;
-    int i, iinc, imax;
 
     if ((tile>DC1394_COLOR_FILTER_MAX)||(tile<DC1394_COLOR_FILTER_MIN))
       return DC1394_INVALID_COLOR_FILTER;
 
     /* add black border */
-    imax = sx * sy * 3;
-    for (i = sx * (sy - 1) * 3; i < imax; i++) {
-        rgb[i] = 0;
-    }
-    iinc = (sx - 1) * 3;
-    for (i = (sx - 1) * 3; i < imax; i += iinc) {
-        rgb[i++] = 0;
-        rgb[i++] = 0;
-        rgb[i++] = 0;
-    }
+    clear_rect_uint16 (rgb, rgbStep, 0, sy - 1, sx, 1);
+    clear_rect_uint16 (rgb, rgbStep, sx - 1, 0, 1, sy);
 
     rgb += 1;
     height -= 1;
@@ -734,14 +791,20 @@ dc1394_bayer_NearestNeighbor_uint16(const uint16_t *restrict bayer, uint16_t *re
     return DC1394_SUCCESS;
 
 }
-/* OpenCV's Bayer decoding */
+
 dc1394error_t
-dc1394_bayer_Bilinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict rgb, int sx, int sy, int tile, int bits)
+dc1394_bayer_NearestNeighbor_uint16(const uint16_t *restrict bayer, uint16_t *restrict rgb, int sx, int sy, int tile, int bits)
+{
+    return bayer_NearestNeighbor_uint16(bayer, sx, rgb, 3 * sx, sx, sy, tile, bits);
+}
+/* OpenCV's Bayer decoding */
+static dc1394error_t
+bayer_Bilinear_uint16(const uint16_t *restrict bayer, int bayerStep, uint16_t *restrict rgb, int rgbStep,
+                        int sx, int sy, int tile, int bits)
 {
-    const int bayerStep = sx;
-    const int rgbStep = 3 * sx;
     int width = sx;
     int height = sy;
+    const simd_dispatch_t * simd = simd_get_dispatch ();
     int blue = tile == DC1394_COLOR_FILTER_BGGR
         || tile == DC1394_COLOR_FILTER_GBRG ? -1 : 1;
     int start_with_green = tile == DC1394_COLOR_FILTER_GBRG
@@ -750,6 +813,7 @@ dc1394_bayer_Bilinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict
     if ((tile>DC1394_COLOR_FILTER_MAX)||(tile<DC1394_COLOR_FILTER_MIN))
       return DC1394_INVALID_COLOR_FILTER;
 
+    clear_borders_uint16 (rgb, rgbStep, sx, sy, 1);
     rgb += rgbStep + 3 + 1;
     height -= 2;
     width -= 2;
@@ -770,6 +834,13 @@ dc1394_bayer_Bilinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict
             rgb += 3;
         }
 
+        if (simd->bilinear_uint16) {
+            int n = simd->bilinear_uint16 (bayer, rgb - 1, bayerStep,
+                    (bayerEnd - bayer) >> 1, blue, bits);
+            bayer += 2 * n;
+            rgb += 6 * n;
+        }
+
         if (blue > 0) {
             for (; bayer <= bayerEnd - 2; bayer += 2, rgb += 6) {
                 t0 = (bayer[0] + bayer[2] + bayer[bayerStep * 2] +
@@ -832,16 +903,22 @@ dc1394_bayer_Bilinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict
 
 }
 
+dc1394error_t
+dc1394_bayer_Bilinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict rgb, int sx, int sy, int tile, int bits)
+{
+    return bayer_Bilinear_uint16(bayer, sx, rgb, 3 * sx, sx, sy, tile, bits);
+}
+
 /* High-Quality Linear Interpolation For Demosaicing Of
    Bayer-Patterned Color Images, by Henrique S. Malvar, Li-wei He, and
    Ross Cutler, in ICASSP'04 */
-dc1394error_t
-dc1394_bayer_HQLinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict rgb, int sx, int sy, int tile, int bits)
+static dc1394error_t
+bayer_HQLinear_uint16(const uint16_t *restrict bayer, int bayerStep, uint16_t *restrict rgb, int rgbStep,
+                        int sx, int sy, int tile, int bits)
 {
-    const int bayerStep = sx;
-    const int rgbStep = 3 * sx;
     int width = sx;
     int height = sy;
+    const simd_dispatch_t * simd = simd_get_dispatch ();
     /*
        the two letters  of the OpenCV name are respectively
        the 4th and 3rd letters from the blinky name,
@@ -862,7 +939,7 @@ dc1394_bayer_HQLinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict
     if ((tile>DC1394_COLOR_FILTER_MAX)||(tile<DC1394_COLOR_FILTER_MIN))
       return DC1394_INVALID_COLOR_FILTER;
 
-    ClearBorders_uint16(rgb, sx, sy, 2);
+    clear_borders_uint16 (rgb, rgbStep, sx, sy, 2);
     rgb += 2 * rgbStep + 6 + 1;
     height -= 4;
     width -= 4;
@@ -906,6 +983,13 @@ dc1394_bayer_HQLinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict
             rgb += 3;
         }
 
+        if (simd->hqlinear_uint16) {
+            int n = simd->hqlinear_uint16 (bayer, rgb - 1, bayerStep,
+                    (bayerEnd - bayer) >> 1, blue, bits);
+            bayer += 2 * n;
+            rgb += 6 * n;
+        }
+
         if (blue > 0) {
             for (; bayer <= bayerEnd - 2; bayer += 2, rgb += 6) {
                 /* B at B */
@@ -1044,6 +1128,12 @@ dc1394_bayer_HQLinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict
     return DC1394_SUCCESS;
 }
 
+dc1394error_t
+dc1394_bayer_HQLinear_uint16(const uint16_t *restrict bayer, uint16_t *restrict rgb, int sx, int sy, int tile, int bits)
+{
+    return bayer_HQLinear_uint16(bayer, sx, rgb, 3 * sx, sx, sy, tile, bits);
+}
+
 /* coriander's Bayer decoding */
 dc1394error_t
 dc1394_bayer_EdgeSense_uint16(const uint16_t *restrict bayer, uint16_t *restrict rgb, int sx, int sy, int tile, int bits)
@@ -1335,7 +1425,7 @@ dc1394_bayer_VNG(const uint8_t *restrict bayer,
                  dc1394color_filter_t pattern)
 {
     const int height = sy, width = sx;
-    static const signed char *cp;
+    const signed char *cp;
     /* the following has the same type as the image */
     uint8_t (*brow[5])[3], *pix;          /* [FD] */
     int code[8][2][320], *ip, gval[8], gmin, gmax, sum[4];
@@ -1461,7 +1551,7 @@ dc1394_bayer_VNG_uint16(const uint16_t *restrict bayer,
                         dc1394color_filter_t pattern, int bits)
 {
     const int height = sy, width = sx;
-    static const signed char *cp;
+    const signed char *cp;
     /* the following has the same type as the image */
     uint16_t (*brow[5])[3], *pix;          /* [FD] */
     int code[8][2][320], *ip, gval[8], gmin, gmax, sum[4];
@@ -1584,7 +1674,6 @@ dc1394_bayer_VNG_uint16(const uint16_t *restrict bayer,
 
 
 /* AHD interpolation ported from dcraw to libdc1394 by Samuel Audet */
-static dc1394bool_t ahd_inited = DC1394_FALSE; /* WARNING: not multi-processor safe */
 
 #define CLIPOUT(x)        LIM(x,0,255)
 #define CLIPOUT16(x,bits) LIM(x,0,((1<<bits)-1))
@@ -1595,34 +1684,58 @@ static const double xyz_rgb[3][3] = {                        /* XYZ from RGB */
   { 0.019334, 0.119193, 0.950227 } };
 static const float d65_white[3] = { 0.950456, 1, 1.088754 };
 
-static void cam_to_cielab (uint16_t cam[3], float lab[3]) /* [SA] */
+/* read-only once cielab_init() has run */
+static float cielab_cbrt[0x10000], cielab_xyz_cam[3][4];
+
+static void cielab_init (void)
 {
-    int c, i, j;
-    float r, xyz[3];
-    static float cbrt[0x10000], xyz_cam[3][4];
+    int i, j;
+    float r;
 
-    if (cam == NULL) {
-        for (i=0; i < 0x10000; i++) {
-            r = i / 65535.0;
-            cbrt[i] = r > 0.008856 ? pow(r,1/3.0) : 7.787*r + 16/116.0;
-        }
-        for (i=0; i < 3; i++)
-            for (j=0; j < 3; j++)                           /* [SA] */
-                xyz_cam[i][j] = xyz_rgb[i][j] / d65_white[i]; /* [SA] */
-    } else {
-        xyz[0] = xyz[1] = xyz[2] = 0.5;
-        FORC3 { /* [SA] */
-            xyz[0] += xyz_cam[0][c] * cam[c];
-            xyz[1] += xyz_cam[1][c] * cam[c];
-            xyz[2] += xyz_cam[2][c] * cam[c];
-        }
-        xyz[0] = cbrt[CLIPOUT16((int) xyz[0],16)];        /* [SA] */
-        xyz[1] = cbrt[CLIPOUT16((int) xyz[1],16)];        /* [SA] */
-        xyz[2] = cbrt[CLIPOUT16((int) xyz[2],16)];        /* [SA] */
-        lab[0] = 116 * xyz[1] - 16;
-        lab[1] = 500 * (xyz[0] - xyz[1]);
-        lab[2] = 200 * (xyz[1] - xyz[2]);
+    for (i=0; i < 0x10000; i++) {
+        r = i / 65535.0;
+        cielab_cbrt[i] = r > 0.008856 ? pow(r,1/3.0) : 7.787*r + 16/116.0;
+    }
+    for (i=0; i < 3; i++)
+        for (j=0; j < 3; j++)                           /* [SA] */
+            cielab_xyz_cam[i][j] = xyz_rgb[i][j] / d65_white[i]; /* [SA] */
+}
+
+#ifdef HAVE_PTHREAD
+static pthread_once_t cielab_once = PTHREAD_ONCE_INIT;
+#else
+static dc1394bool_t cielab_inited = DC1394_FALSE;
+#endif
+
+static void ahd_init (void)
+{
+#ifdef HAVE_PTHREAD
+    pthread_once (&cielab_once, cielab_init);
+#else
+    if (cielab_inited==DC1394_FALSE) {
+        cielab_init ();
+        cielab_inited = DC1394_TRUE;
+    }
+#endif
+}
+
+static void cam_to_cielab (uint16_t cam[3], float lab[3]) /* [SA] */
+{
+    int c;
+    float xyz[3];
+
+    xyz[0] = xyz[1] = xyz[2] = 0.5;
+    FORC3 { /* [SA] */
+        xyz[0] += cielab_xyz_cam[0][c] * cam[c];
+        xyz[1] += cielab_xyz_cam[1][c] * cam[c];
+        xyz[2] += cielab_xyz_cam[2][c] * cam[c];
     }
+    xyz[0] = cielab_cbrt[CLIPOUT16((int) xyz[0],16)];        /* [SA] */
+    xyz[1] = cielab_cbrt[CLIPOUT16((int) xyz[1],16)];        /* [SA] */
+    xyz[2] = cielab_cbrt[CLIPOUT16((int) xyz[2],16)];        /* [SA] */
+    lab[0] = 116 * xyz[1] - 16;
+    lab[1] = 500 * (xyz[0] - xyz[1]);
+    lab[2] = 200 * (xyz[1] - xyz[2]);
 }
 
 /*
@@ -1630,13 +1743,34 @@ static void cam_to_cielab (uint16_t cam[3], float lab[3]) /* [SA] */
    the work of Keigo Hirakawa, Thomas Parks, and Paul Lee.
  */
 #define TS 256                /* Tile Size */
+#define AHD_TILE_BYTES (26*TS*TS)     /* rgb, lab and homo for one tile: 1664 kB */
 
-dc1394error_t
-dc1394_bayer_AHD(const uint8_t *restrict bayer,
-                 uint8_t *restrict dst, int sx, int sy,
-                 dc1394color_filter_t pattern)
+/*
+   A workspace holds one tile buffer per thread. Tiles only read the known
+   (raw) samples of the destination image and only write the other channels
+   of their own interior, so they can be processed in any order and in
+   parallel.
+ */
+struct __dc1394ahd_workspace_t {
+    threadpool_t * pool;
+    int num_buffers;
+    char ** buffers;
+};
+
+typedef struct {
+    void * dst;
+    int width, height;
+    uint32_t filters;
+    int bits;
+    int tiles_x, num_tiles;
+    char ** buffers;
+    int num_buffers;
+} ahd_job_t;
+
+static void
+ahd_tile_8bit (const ahd_job_t * job, int top, int left, char * buffer)
 {
-    int i, j, top, left, row, col, tr, tc, fc, c, d, val, hm[2];
+    int i, j, row, col, tr, tc, fc, c, d, val, hm[2];
     /* the following has the same type as the image */
     uint8_t (*pix)[3], (*rix)[3];      /* [SA] */
     uint16_t rix16[3];                 /* [SA] */
@@ -1645,35 +1779,361 @@ dc1394_bayer_AHD(const uint8_t *restrict bayer,
     float flab[3];                     /* [SA] */
     uint8_t (*rgb)[TS][TS][3];
     short (*lab)[TS][TS][3];
-    char (*homo)[TS][TS], *buffer;
+    char (*homo)[TS][TS];
+    uint8_t * dst = job->dst;
+    const uint32_t filters = job->filters;
+    const int height = job->height, width = job->width;
 
-    /* start - new code for libdc1394 */
-    uint32_t filters;
-    const int height = sy, width = sx;
-    int x, y;
+    rgb  = (uint8_t(*)[TS][TS][3]) buffer;                /* [SA] */
+    lab  = (short (*)[TS][TS][3])(buffer + 12*TS*TS);
+    homo = (char  (*)[TS][TS])   (buffer + 24*TS*TS);
+
+    memset (rgb, 0, 12*TS*TS);
+
+    /*  Interpolate green horizontally and vertically:                */
+    for (row = top < 2 ? 2:top; row < top+TS && row < height-2; row++) {
+        col = left + (FC(row,left) == 1);
+        if (col < 2) col += 2;
+        for (fc = FC(row,col); col < left+TS && col < width-2; col+=2) {
+            pix = (uint8_t (*)[3])dst + (row*width+col);          /* [SA] */
+            val = ((pix[-1][1] + pix[0][fc] + pix[1][1]) * 2
+                   - pix[-2][fc] - pix[2][fc]) >> 2;
+            rgb[0][row-top][col-left][1] = ULIM(val,pix[-1][1],pix[1][1]);
+            val = ((pix[-width][1] + pix[0][fc] + pix[width][1]) * 2
+                   - pix[-2*width][fc] - pix[2*width][fc]) >> 2;
+            rgb[1][row-top][col-left][1] = ULIM(val,pix[-width][1],pix[width][1]);
+        }
+    }
+    /*  Interpolate red and blue, and convert to CIELab:                */
+    for (d=0; d < 2; d++)
+        for (row=top+1; row < top+TS-1 && row < height-1; row++)
+            for (col=left+1; col < left+TS-1 && col < width-1; col++) {
+                pix = (uint8_t (*)[3])dst + (row*width+col);        /* [SA] */
+                rix = &rgb[d][row-top][col-left];
+                if ((c = 2 - FC(row,col)) == 1) {
+                    c = FC(row+1,col);
+                    val = pix[0][1] + (( pix[-1][2-c] + pix[1][2-c]
+                                         - rix[-1][1] - rix[1][1] ) >> 1);
+                    rix[0][2-c] = CLIPOUT(val);         /* [SA] */
+                    val = pix[0][1] + (( pix[-width][c] + pix[width][c]
+                                         - rix[-TS][1] - rix[TS][1] ) >> 1);
+                } else
+                    val = rix[0][1] + (( pix[-width-1][c] + pix[-width+1][c]
+                                         + pix[+width-1][c] + pix[+width+1][c]
+                                         - rix[-TS-1][1] - rix[-TS+1][1]
+                                         - rix[+TS-1][1] - rix[+TS+1][1] + 1) >> 2);
+                rix[0][c] = CLIPOUT(val);             /* [SA] */
+                c = FC(row,col);
+                rix[0][c] = pix[0][c];
+                rix16[0] = rix[0][0];                 /* [SA] */
+                rix16[1] = rix[0][1];                 /* [SA] */
+                rix16[2] = rix[0][2];                 /* [SA] */
+                cam_to_cielab (rix16, flab);          /* [SA] */
+                FORC3 lab[d][row-top][col-left][c] = 64*flab[c];
+            }
+    /*  Build homogeneity maps from the CIELab images:                */
+    memset (homo, 0, 2*TS*TS);
+    for (row=top+2; row < top+TS-2 && row < height; row++) {
+        tr = row-top;
+        for (col=left+2; col < left+TS-2 && col < width; col++) {
+            tc = col-left;
+            for (d=0; d < 2; d++)
+                for (i=0; i < 4; i++)
+                    ldiff[d][i] = ABS(lab[d][tr][tc][0]-lab[d][tr][tc+dir[i]][0]);
+            leps = MIN(MAX(ldiff[0][0],ldiff[0][1]),
+                       MAX(ldiff[1][2],ldiff[1][3]));
+            for (d=0; d < 2; d++)
+                for (i=0; i < 4; i++)
+                    if (i >> 1 == d || ldiff[d][i] <= leps)
+                        abdiff[d][i] = SQR(lab[d][tr][tc][1]-lab[d][tr][tc+dir[i]][1])
+                            + SQR(lab[d][tr][tc][2]-lab[d][tr][tc+dir[i]][2]);
+            abeps = MIN(MAX(abdiff[0][0],abdiff[0][1]),
+                        MAX(abdiff[1][2],abdiff[1][3]));
+            for (d=0; d < 2; d++)
+                for (i=0; i < 4; i++)
+                    if (ldiff[d][i] <= leps && abdiff[d][i] <= abeps)
+                        homo[d][tr][tc]++;
+        }
+    }
+    /*  Combine the most homogenous pixels for the final result.
+        The known channel is left untouched: it is what the neighbouring
+        tiles read and it would come out unchanged anyway.             */
+    for (row=top+3; row < top+TS-3 && row < height-3; row++) {
+        tr = row-top;
+        for (col=left+3; col < left+TS-3 && col < width-3; col++) {
+            tc = col-left;
+            fc = FC(row,col);
+            for (d=0; d < 2; d++)
+                for (hm[d]=0, i=tr-1; i <= tr+1; i++)
+                    for (j=tc-1; j <= tc+1; j++)
+                        hm[d] += homo[d][i][j];
+            FORC3 if (c != fc) {
+                if (hm[0] != hm[1])
+                    dst[(row*width+col)*3 + c] = CLIPOUT(rgb[hm[1] > hm[0]][tr][tc][c]); /* [SA] */
+                else
+                    dst[(row*width+col)*3 + c] =
+                        CLIPOUT((rgb[0][tr][tc][c] + rgb[1][tr][tc][c]) >> 1);      /* [SA] */
+            }
+        }
+    }
+}
+
+static void
+ahd_tile_16bit (const ahd_job_t * job, int top, int left, char * buffer)
+{
+    int i, j, row, col, tr, tc, fc, c, d, val, hm[2];
+    /* the following has the same type as the image */
+    uint16_t (*pix)[3], (*rix)[3];      /* [SA] */
+    static const int dir[4] = { -1, 1, -TS, TS };
+    unsigned ldiff[2][4], abdiff[2][4], leps, abeps;
+    float flab[3];
+    uint16_t (*rgb)[TS][TS][3];         /* [SA] */
+    short (*lab)[TS][TS][3];
+    char (*homo)[TS][TS];
+    uint16_t * dst = job->dst;
+    const uint32_t filters = job->filters;
+    const int height = job->height, width = job->width;
+    const int bits = job->bits;
+
+    rgb  = (uint16_t(*)[TS][TS][3]) buffer;               /* [SA] */
+    lab  = (short (*)[TS][TS][3])(buffer + 12*TS*TS);
+    homo = (char  (*)[TS][TS])   (buffer + 24*TS*TS);
 
-    if (ahd_inited==DC1394_FALSE) {
-        /* WARNING: this might not be multi-processor safe */
-        cam_to_cielab (NULL,NULL);
-        ahd_inited = DC1394_TRUE;
+    memset (rgb, 0, 12*TS*TS);
+
+    /*  Interpolate green horizontally and vertically:                */
+    for (row = top < 2 ? 2:top; row < top+TS && row < height-2; row++) {
+        col = left + (FC(row,left) == 1);
+        if (col < 2) col += 2;
+        for (fc = FC(row,col); col < left+TS && col < width-2; col+=2) {
+            pix = (uint16_t (*)[3])dst + (row*width+col);          /* [SA] */
+            val = ((pix[-1][1] + pix[0][fc] + pix[1][1]) * 2
+                   - pix[-2][fc] - pix[2][fc]) >> 2;
+            rgb[0][row-top][col-left][1] = ULIM(val,pix[-1][1],pix[1][1]);
+            val = ((pix[-width][1] + pix[0][fc] + pix[width][1]) * 2
+                   - pix[-2*width][fc] - pix[2*width][fc]) >> 2;
+            rgb[1][row-top][col-left][1] = ULIM(val,pix[-width][1],pix[width][1]);
+        }
+    }
+    /*  Interpolate red and blue, and convert to CIELab:                */
+    for (d=0; d < 2; d++)
+        for (row=top+1; row < top+TS-1 && row < height-1; row++)
+            for (col=left+1; col < left+TS-1 && col < width-1; col++) {
+                pix = (uint16_t (*)[3])dst + (row*width+col);        /* [SA] */
+                rix = &rgb[d][row-top][col-left];
+                if ((c = 2 - FC(row,col)) == 1) {
+                    c = FC(row+1,col);
+                    val = pix[0][1] + (( pix[-1][2-c] + pix[1][2-c]
+                                         - rix[-1][1] - rix[1][1] ) >> 1);
+                    rix[0][2-c] = CLIPOUT16(val, bits); /* [SA] */
+                    val = pix[0][1] + (( pix[-width][c] + pix[width][c]
+                                         - rix[-TS][1] - rix[TS][1] ) >> 1);
+                } else
+                    val = rix[0][1] + (( pix[-width-1][c] + pix[-width+1][c]
+                                         + pix[+width-1][c] + pix[+width+1][c]
+                                         - rix[-TS-1][1] - rix[-TS+1][1]
+                                         - rix[+TS-1][1] - rix[+TS+1][1] + 1) >> 2);
+                rix[0][c] = CLIPOUT16(val, bits);     /* [SA] */
+                c = FC(row,col);
+                rix[0][c] = pix[0][c];
+                cam_to_cielab (rix[0], flab);
+                FORC3 lab[d][row-top][col-left][c] = 64*flab[c];
+            }
+    /*  Build homogeneity maps from the CIELab images:                */
+    memset (homo, 0, 2*TS*TS);
+    for (row=top+2; row < top+TS-2 && row < height; row++) {
+        tr = row-top;
+        for (col=left+2; col < left+TS-2 && col < width; col++) {
+            tc = col-left;
+            for (d=0; d < 2; d++)
+                for (i=0; i < 4; i++)
+                    ldiff[d][i] = ABS(lab[d][tr][tc][0]-lab[d][tr][tc+dir[i]][0]);
+            leps = MIN(MAX(ldiff[0][0],ldiff[0][1]),
+                       MAX(ldiff[1][2],ldiff[1][3]));
+            for (d=0; d < 2; d++)
+                for (i=0; i < 4; i++)
+                    if (i >> 1 == d || ldiff[d][i] <= leps)
+                        abdiff[d][i] = SQR(lab[d][tr][tc][1]-lab[d][tr][tc+dir[i]][1])
+                            + SQR(lab[d][tr][tc][2]-lab[d][tr][tc+dir[i]][2]);
+            abeps = MIN(MAX(abdiff[0][0],abdiff[0][1]),
+                        MAX(abdiff[1][2],abdiff[1][3]));
+            for (d=0; d < 2; d++)
+                for (i=0; i < 4; i++)
+                    if (ldiff[d][i] <= leps && abdiff[d][i] <= abeps)
+                        homo[d][tr][tc]++;
+        }
+    }
+    /*  Combine the most homogenous pixels for the final result (see the
+        8-bit version about the known channel):                       */
+    for (row=top+3; row < top+TS-3 && row < height-3; row++) {
+        tr = row-top;
+        for (col=left+3; col < left+TS-3 && col < width-3; col++) {
+            tc = col-left;
+            fc = FC(row,col);
+            for (d=0; d < 2; d++)
+                for (hm[d]=0, i=tr-1; i <= tr+1; i++)
+                    for (j=tc-1; j <= tc+1; j++)
+                        hm[d] += homo[d][i][j];
+            FORC3 if (c != fc) {
+                if (hm[0] != hm[1])
+                    dst[(row*width+col)*3 + c] = CLIPOUT16(rgb[hm[1] > hm[0]][tr][tc][c], bits); /* [SA] */
+                else
+                    dst[(row*width+col)*3 + c] =
+                        CLIPOUT16((rgb[0][tr][tc][c] + rgb[1][tr][tc][c]) >> 1, bits); /* [SA] */
+            }
+        }
     }
+}
+
+/* runs the tiles index, index+num_buffers, ... with tile buffer 'index' */
+static void
+ahd_tiles_8bit (void * arg, int index)
+{
+    const ahd_job_t * job = arg;
+    int t;
+
+    for (t = index; t < job->num_tiles; t += job->num_buffers)
+        ahd_tile_8bit (job, (t / job->tiles_x) * (TS-6), (t % job->tiles_x) * (TS-6),
+                       job->buffers[index]);
+}
 
+static void
+ahd_tiles_16bit (void * arg, int index)
+{
+    const ahd_job_t * job = arg;
+    int t;
+
+    for (t = index; t < job->num_tiles; t += job->num_buffers)
+        ahd_tile_16bit (job, (t / job->tiles_x) * (TS-6), (t % job->tiles_x) * (TS-6),
+                        job->buffers[index]);
+}
+
+static dc1394error_t
+ahd_filters (dc1394color_filter_t pattern, uint32_t * filters)
+{
     switch(pattern) {
     case DC1394_COLOR_FILTER_BGGR:
-        filters = 0x16161616;
+        *filters = 0x16161616;
         break;
     case DC1394_COLOR_FILTER_GRBG:
-        filters = 0x61616161;
+        *filters = 0x61616161;
         break;
     case DC1394_COLOR_FILTER_RGGB:
-        filters = 0x94949494;
+        *filters = 0x94949494;
         break;
     case DC1394_COLOR_FILTER_GBRG:
-        filters = 0x49494949;
+        *filters = 0x49494949;
         break;
     default:
         return DC1394_INVALID_COLOR_FILTER;
     }
+    return DC1394_SUCCESS;
+}
+
+/*
+   Sets up the tile job. Without a workspace, the tiles are processed on the
+   calling thread with a tile buffer that belongs to that thread and is kept
+   from one call to the next.
+ */
+static dc1394error_t
+ahd_job_init (ahd_job_t * job, dc1394ahd_workspace_t * ws, char ** buffer,
+              void * dst, int sx, int sy)
+{
+    job->dst = dst;
+    job->width = sx;
+    job->height = sy;
+    job->tiles_x = (sx + TS-7) / (TS-6);
+    job->num_tiles = job->tiles_x * ((sy + TS-7) / (TS-6));
+    if (ws) {
+        job->buffers = ws->buffers;
+        job->num_buffers = ws->num_buffers;
+    }
+    else {
+        *buffer = threadpool_get_scratch (THREADPOOL_SCRATCH_AHD, AHD_TILE_BYTES);
+        if (*buffer == NULL)
+            return DC1394_MEMORY_ALLOCATION_FAILURE;
+        job->buffers = buffer;
+        job->num_buffers = 1;
+    }
+    if (job->num_buffers > job->num_tiles)
+        job->num_buffers = job->num_tiles;
+    return DC1394_SUCCESS;
+}
+
+dc1394ahd_workspace_t *
+dc1394_ahd_workspace_new(uint32_t num_threads)
+{
+    dc1394ahd_workspace_t * ws;
+    int i;
+
+    if (num_threads < 1)
+        return NULL;
+
+    ws = calloc (1, sizeof (dc1394ahd_workspace_t));
+    if (ws == NULL)
+        return NULL;
+    ws->buffers = calloc (num_threads, sizeof (char *));
+    if (ws->buffers == NULL)
+        goto fail;
+    for (i = 0; i < num_threads; i++) {
+        ws->buffers[i] = malloc (AHD_TILE_BYTES);
+        if (ws->buffers[i] == NULL)
+            goto fail;
+        ws->num_buffers++;
+    }
+    if (num_threads > 1) {
+        ws->pool = threadpool_new (num_threads);
+        if (ws->pool == NULL) {
+            // no threads: keep a single tile buffer
+            dc1394_log_warning ("AHD workspace: could not start %d threads, using one", num_threads);
+            while (ws->num_buffers > 1)
+                free (ws->buffers[--ws->num_buffers]);
+        }
+    }
+
+    ahd_init ();
+    return ws;
+
+ fail:
+    dc1394_ahd_workspace_free (ws);
+    return NULL;
+}
+
+void
+dc1394_ahd_workspace_free(dc1394ahd_workspace_t *ws)
+{
+    int i;
+
+    if (ws == NULL)
+        return;
+    threadpool_free (ws->pool);
+    if (ws->buffers) {
+        for (i = 0; i < ws->num_buffers; i++)
+            free (ws->buffers[i]);
+        free (ws->buffers);
+    }
+    free (ws);
+}
+
+dc1394error_t
+dc1394_bayer_AHD_workspace(dc1394ahd_workspace_t *ws, const uint8_t *restrict bayer,
+                           uint8_t *restrict dst, int sx, int sy,
+                           dc1394color_filter_t pattern)
+{
+    ahd_job_t job;
+    char * buffer;
+    dc1394error_t err;
+
+    /* start - new code for libdc1394 */
+    uint32_t filters;
+    const int height = sy, width = sx;
+    int x, y;
+
+    ahd_init ();
+
+    err = ahd_filters (pattern, &filters);
+    if (err != DC1394_SUCCESS)
+        return err;
 
     /* fill-in destination with known exact values */
     for (y = 0; y < height; y++) {
@@ -1708,155 +2168,52 @@ dc1394_bayer_AHD(const uint8_t *restrict bayer,
     }
     /* end - code from border_interpolate (int border) */
 
-
-    buffer = (char *) malloc (26*TS*TS);                /* 1664 kB */
-    /* merror (buffer, "ahd_interpolate()"); */
-    rgb  = (uint8_t(*)[TS][TS][3]) buffer;                /* [SA] */
-    lab  = (short (*)[TS][TS][3])(buffer + 12*TS*TS);
-    homo = (char  (*)[TS][TS])   (buffer + 24*TS*TS);
-
-    for (top=0; top < height; top += TS-6)
-        for (left=0; left < width; left += TS-6) {
-            memset (rgb, 0, 12*TS*TS);
-
-            /*  Interpolate green horizontally and vertically:                */
-            for (row = top < 2 ? 2:top; row < top+TS && row < height-2; row++) {
-                col = left + (FC(row,left) == 1);
-                if (col < 2) col += 2;
-                for (fc = FC(row,col); col < left+TS && col < width-2; col+=2) {
-                    pix = (uint8_t (*)[3])dst + (row*width+col);          /* [SA] */
-                    val = ((pix[-1][1] + pix[0][fc] + pix[1][1]) * 2
-                           - pix[-2][fc] - pix[2][fc]) >> 2;
-                    rgb[0][row-top][col-left][1] = ULIM(val,pix[-1][1],pix[1][1]);
-                    val = ((pix[-width][1] + pix[0][fc] + pix[width][1]) * 2
-                           - pix[-2*width][fc] - pix[2*width][fc]) >> 2;
-                    rgb[1][row-top][col-left][1] = ULIM(val,pix[-width][1],pix[width][1]);
-                }
-            }
-            /*  Interpolate red and blue, and convert to CIELab:                */
-            for (d=0; d < 2; d++)
-                for (row=top+1; row < top+TS-1 && row < height-1; row++)
-                    for (col=left+1; col < left+TS-1 && col < width-1; col++) {
-                        pix = (uint8_t (*)[3])dst + (row*width+col);        /* [SA] */
-                        rix = &rgb[d][row-top][col-left];
-                        if ((c = 2 - FC(row,col)) == 1) {
-                            c = FC(row+1,col);
-                            val = pix[0][1] + (( pix[-1][2-c] + pix[1][2-c]
-                                                 - rix[-1][1] - rix[1][1] ) >> 1);
-                            rix[0][2-c] = CLIPOUT(val);         /* [SA] */
-                            val = pix[0][1] + (( pix[-width][c] + pix[width][c]
-                                                 - rix[-TS][1] - rix[TS][1] ) >> 1);
-                        } else
-                            val = rix[0][1] + (( pix[-width-1][c] + pix[-width+1][c]
-                                                 + pix[+width-1][c] + pix[+width+1][c]
-                                                 - rix[-TS-1][1] - rix[-TS+1][1]
-                                                 - rix[+TS-1][1] - rix[+TS+1][1] + 1) >> 2);
-                        rix[0][c] = CLIPOUT(val);             /* [SA] */
-                        c = FC(row,col);
-                        rix[0][c] = pix[0][c];
-                        rix16[0] = rix[0][0];                 /* [SA] */
-                        rix16[1] = rix[0][1];                 /* [SA] */
-                        rix16[2] = rix[0][2];                 /* [SA] */
-                        cam_to_cielab (rix16, flab);          /* [SA] */
-                        FORC3 lab[d][row-top][col-left][c] = 64*flab[c];
-                    }
-            /*  Build homogeneity maps from the CIELab images:                */
-            memset (homo, 0, 2*TS*TS);
-            for (row=top+2; row < top+TS-2 && row < height; row++) {
-                tr = row-top;
-                for (col=left+2; col < left+TS-2 && col < width; col++) {
-                    tc = col-left;
-                    for (d=0; d < 2; d++)
-                        for (i=0; i < 4; i++)
-                            ldiff[d][i] = ABS(lab[d][tr][tc][0]-lab[d][tr][tc+dir[i]][0]);
-                    leps = MIN(MAX(ldiff[0][0],ldiff[0][1]),
-                               MAX(ldiff[1][2],ldiff[1][3]));
-                    for (d=0; d < 2; d++)
-                        for (i=0; i < 4; i++)
-                            if (i >> 1 == d || ldiff[d][i] <= leps)
-                                abdiff[d][i] = SQR(lab[d][tr][tc][1]-lab[d][tr][tc+dir[i]][1])
-                                    + SQR(lab[d][tr][tc][2]-lab[d][tr][tc+dir[i]][2]);
-                    abeps = MIN(MAX(abdiff[0][0],abdiff[0][1]),
-                                MAX(abdiff[1][2],abdiff[1][3]));
-                    for (d=0; d < 2; d++)
-                        for (i=0; i < 4; i++)
-                            if (ldiff[d][i] <= leps && abdiff[d][i] <= abeps)
-                                homo[d][tr][tc]++;
-                }
-            }
-            /*  Combine the most homogenous pixels for the final result:        */
-            for (row=top+3; row < top+TS-3 && row < height-3; row++) {
-                tr = row-top;
-                for (col=left+3; col < left+TS-3 && col < width-3; col++) {
-                    tc = col-left;
-                    for (d=0; d < 2; d++)
-                        for (hm[d]=0, i=tr-1; i <= tr+1; i++)
-                            for (j=tc-1; j <= tc+1; j++)
-                                hm[d] += homo[d][i][j];
-                    if (hm[0] != hm[1])
-                        FORC3 dst[(row*width+col)*3 + c] = CLIPOUT(rgb[hm[1] > hm[0]][tr][tc][c]); /* [SA] */
-                    else
-                        FORC3 dst[(row*width+col)*3 + c] =
-                            CLIPOUT((rgb[0][tr][tc][c] + rgb[1][tr][tc][c]) >> 1);      /* [SA] */
-                }
-            }
-        }
-    free (buffer);
+    err = ahd_job_init (&job, ws, &buffer, dst, sx, sy);
+    if (err != DC1394_SUCCESS)
+        return err;
+    job.filters = filters;
+    job.bits = 8;
+    threadpool_run (ws ? ws->pool : NULL, ahd_tiles_8bit, &job, job.num_buffers);
 
     return DC1394_SUCCESS;
 }
 
 dc1394error_t
-dc1394_bayer_AHD_uint16(const uint16_t *restrict bayer,
-                        uint16_t *restrict dst, int sx, int sy,
-                        dc1394color_filter_t pattern, int bits)
+dc1394_bayer_AHD(const uint8_t *restrict bayer,
+                 uint8_t *restrict dst, int sx, int sy,
+                 dc1394color_filter_t pattern)
 {
-    int i, j, top, left, row, col, tr, tc, fc, c, d, val, hm[2];
-    /* the following has the same type as the image */
-    uint16_t (*pix)[3], (*rix)[3];      /* [SA] */
-    static const int dir[4] = { -1, 1, -TS, TS };
-    unsigned ldiff[2][4], abdiff[2][4], leps, abeps;
-    float flab[3];
-    uint16_t (*rgb)[TS][TS][3];         /* [SA] */
-    short (*lab)[TS][TS][3];
-    char (*homo)[TS][TS], *buffer;
+    return dc1394_bayer_AHD_workspace (NULL, bayer, dst, sx, sy, pattern);
+}
+
+dc1394error_t
+dc1394_bayer_AHD_uint16_workspace(dc1394ahd_workspace_t *ws, const uint16_t *restrict bayer,
+                                  uint16_t *restrict dst, int sx, int sy,
+                                  dc1394color_filter_t pattern, int bits)
+{
+    ahd_job_t job;
+    char * buffer;
+    dc1394error_t err;
 
     /* start - new code for libdc1394 */
     uint32_t filters;
     const int height = sy, width = sx;
     int x, y;
 
-    if (ahd_inited==DC1394_FALSE) {
-        /* WARNING: this might not be multi-processor safe */
-        cam_to_cielab (NULL,NULL);
-        ahd_inited = DC1394_TRUE;
+    ahd_init ();
+
+    err = ahd_filters (pattern, &filters);
+    if (err != DC1394_SUCCESS)
+        return err;
+
+    /* fill-in destination with known exact values */
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            int channel = FC(y,x);
+            dst[(y*width+x)*3 + channel] = bayer[y*width+x];
+        }
     }
-
-    switch(pattern) {
-    case DC1394_COLOR_FILTER_BGGR:
-        filters = 0x16161616;
-        break;
-    case DC1394_COLOR_FILTER_GRBG:
-        filters = 0x61616161;
-        break;
-    case DC1394_COLOR_FILTER_RGGB:
-        filters = 0x94949494;
-        break;
-    case DC1394_COLOR_FILTER_GBRG:
-        filters = 0x49494949;
-        break;
-    default:
-        return DC1394_INVALID_COLOR_FILTER;
-    }
-
-    /* fill-in destination with known exact values */
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-            int channel = FC(y,x);
-            dst[(y*width+x)*3 + channel] = bayer[y*width+x];
-        }
-    }
-    /* end - new code for libdc1394 */
+    /* end - new code for libdc1394 */
 
     /* start - code from border_interpolate(int border) */
     {
@@ -1882,101 +2239,24 @@ dc1394_bayer_AHD_uint16(const uint16_t *restrict bayer,
     }
     /* end - code from border_interpolate(int border) */
 
-
-    buffer = (char *) malloc (26*TS*TS);                /* 1664 kB */
-    /* merror (buffer, "ahd_interpolate()"); */
-    rgb  = (uint16_t(*)[TS][TS][3]) buffer;               /* [SA] */
-    lab  = (short (*)[TS][TS][3])(buffer + 12*TS*TS);
-    homo = (char  (*)[TS][TS])   (buffer + 24*TS*TS);
-
-    for (top=0; top < height; top += TS-6)
-        for (left=0; left < width; left += TS-6) {
-            memset (rgb, 0, 12*TS*TS);
-
-            /*  Interpolate green horizontally and vertically:                */
-            for (row = top < 2 ? 2:top; row < top+TS && row < height-2; row++) {
-                col = left + (FC(row,left) == 1);
-                if (col < 2) col += 2;
-                for (fc = FC(row,col); col < left+TS && col < width-2; col+=2) {
-                    pix = (uint16_t (*)[3])dst + (row*width+col);          /* [SA] */
-                    val = ((pix[-1][1] + pix[0][fc] + pix[1][1]) * 2
-                           - pix[-2][fc] - pix[2][fc]) >> 2;
-                    rgb[0][row-top][col-left][1] = ULIM(val,pix[-1][1],pix[1][1]);
-                    val = ((pix[-width][1] + pix[0][fc] + pix[width][1]) * 2
-                           - pix[-2*width][fc] - pix[2*width][fc]) >> 2;
-                    rgb[1][row-top][col-left][1] = ULIM(val,pix[-width][1],pix[width][1]);
-                }
-            }
-            /*  Interpolate red and blue, and convert to CIELab:                */
-            for (d=0; d < 2; d++)
-                for (row=top+1; row < top+TS-1 && row < height-1; row++)
-                    for (col=left+1; col < left+TS-1 && col < width-1; col++) {
-                        pix = (uint16_t (*)[3])dst + (row*width+col);        /* [SA] */
-                        rix = &rgb[d][row-top][col-left];
-                        if ((c = 2 - FC(row,col)) == 1) {
-                            c = FC(row+1,col);
-                            val = pix[0][1] + (( pix[-1][2-c] + pix[1][2-c]
-                                                 - rix[-1][1] - rix[1][1] ) >> 1);
-                            rix[0][2-c] = CLIPOUT16(val, bits); /* [SA] */
-                            val = pix[0][1] + (( pix[-width][c] + pix[width][c]
-                                                 - rix[-TS][1] - rix[TS][1] ) >> 1);
-                        } else
-                            val = rix[0][1] + (( pix[-width-1][c] + pix[-width+1][c]
-                                                 + pix[+width-1][c] + pix[+width+1][c]
-                                                 - rix[-TS-1][1] - rix[-TS+1][1]
-                                                 - rix[+TS-1][1] - rix[+TS+1][1] + 1) >> 2);
-                        rix[0][c] = CLIPOUT16(val, bits);     /* [SA] */
-                        c = FC(row,col);
-                        rix[0][c] = pix[0][c];
-                        cam_to_cielab (rix[0], flab);
-                        FORC3 lab[d][row-top][col-left][c] = 64*flab[c];
-                    }
-            /*  Build homogeneity maps from the CIELab images:                */
-            memset (homo, 0, 2*TS*TS);
-            for (row=top+2; row < top+TS-2 && row < height; row++) {
-                tr = row-top;
-                for (col=left+2; col < left+TS-2 && col < width; col++) {
-                    tc = col-left;
-                    for (d=0; d < 2; d++)
-                        for (i=0; i < 4; i++)
-                            ldiff[d][i] = ABS(lab[d][tr][tc][0]-lab[d][tr][tc+dir[i]][0]);
-                    leps = MIN(MAX(ldiff[0][0],ldiff[0][1]),
-                               MAX(ldiff[1][2],ldiff[1][3]));
-                    for (d=0; d < 2; d++)
-                        for (i=0; i < 4; i++)
-                            if (i >> 1 == d || ldiff[d][i] <= leps)
-                                abdiff[d][i] = SQR(lab[d][tr][tc][1]-lab[d][tr][tc+dir[i]][1])
-                                    + SQR(lab[d][tr][tc][2]-lab[d][tr][tc+dir[i]][2]);
-                    abeps = MIN(MAX(abdiff[0][0],abdiff[0][1]),
-                                MAX(abdiff[1][2],abdiff[1][3]));
-                    for (d=0; d < 2; d++)
-                        for (i=0; i < 4; i++)
-                            if (ldiff[d][i] <= leps && abdiff[d][i] <= abeps)
-                                homo[d][tr][tc]++;
-                }
-            }
-            /*  Combine the most homogenous pixels for the final result:        */
-            for (row=top+3; row < top+TS-3 && row < height-3; row++) {
-                tr = row-top;
-                for (col=left+3; col < left+TS-3 && col < width-3; col++) {
-                    tc = col-left;
-                    for (d=0; d < 2; d++)
-                        for (hm[d]=0, i=tr-1; i <= tr+1; i++)
-                            for (j=tc-1; j <= tc+1; j++)
-                                hm[d] += homo[d][i][j];
-                    if (hm[0] != hm[1])
-                        FORC3 dst[(row*width+col)*3 + c] = CLIPOUT16(rgb[hm[1] > hm[0]][tr][tc][c], bits); /* [SA] */
-                    else
-                        FORC3 dst[(row*width+col)*3 + c] =
-                            CLIPOUT16((rgb[0][tr][tc][c] + rgb[1][tr][tc][c]) >> 1, bits); /* [SA] */
-                }
-            }
-        }
-    free (buffer);
+    err = ahd_job_init (&job, ws, &buffer, dst, sx, sy);
+    if (err != DC1394_SUCCESS)
+        return err;
+    job.filters = filters;
+    job.bits = bits;
+    threadpool_run (ws ? ws->pool : NULL, ahd_tiles_16bit, &job, job.num_buffers);
 
     return DC1394_SUCCESS;
 }
 
+dc1394error_t
+dc1394_bayer_AHD_uint16(const uint16_t *restrict bayer,
+                        uint16_t *restrict dst, int sx, int sy,
+                        dc1394color_filter_t pattern, int bits)
+{
+    return dc1394_bayer_AHD_uint16_workspace (NULL, bayer, dst, sx, sy, pattern, bits);
+}
+
 dc1394error_t
 dc1394_bayer_decoding_8bit(const uint8_t *restrict bayer, uint8_t *restrict rgb, uint32_t sx, uint32_t sy, dc1394color_filter_t tile, dc1394bayer_method_t method)
 {
@@ -2029,22 +2309,133 @@ dc1394_bayer_decoding_16bit(const uint16_t *restrict bayer, uint16_t *restrict r
 
 }
 
+/*
+  De-mosaicing between buffers with any line stride. Nearest neighbor, simple
+  (8-bit), bilinear and HQ linear work on the buffers directly; the other
+  methods decode from and to packed copies of the lines, kept in a buffer of
+  the calling thread.
+*/
+static dc1394error_t
+bayer_decoding_copy(const uint8_t *bayer, uint32_t bayer_stride, uint8_t *rgb, uint32_t rgb_stride,
+                    uint32_t sx, uint32_t sy, uint32_t bytes, dc1394color_filter_t tile,
+                    dc1394bayer_method_t method, uint32_t bits)
+{
+    const int downsample = method == DC1394_BAYER_METHOD_DOWNSAMPLE;
+    const size_t in_line = sx * bytes;
+    const size_t out_line = 3 * (downsample ? sx / 2 : sx) * bytes;
+    const uint32_t out_sy = downsample ? sy / 2 : sy;
+    const uint8_t *src = bayer;
+    uint8_t *in, *out;
+    uint32_t y;
+    dc1394error_t err;
+
+    in = threadpool_get_scratch(THREADPOOL_SCRATCH_STRIDE, in_line * sy + out_line * out_sy);
+    if (in == NULL)
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+    out = rgb_stride == out_line ? rgb : in + in_line * sy;
+
+    if (bayer_stride != in_line) {
+        for (y = 0; y < sy; y++)
+            memcpy(in + y * in_line, bayer + y * bayer_stride, in_line);
+        src = in;
+    }
+
+    if (bytes == 1)
+        err = dc1394_bayer_decoding_8bit(src, out, sx, sy, tile, method);
+    else
+        err = dc1394_bayer_decoding_16bit((const uint16_t*)src, (uint16_t*)out, sx, sy, tile, method, bits);
+
+    if ((err == DC1394_SUCCESS) && (out != rgb)) {
+        for (y = 0; y < out_sy; y++)
+            memcpy(rgb + y * rgb_stride, out + y * out_line, out_line);
+    }
+    return err;
+}
+
 dc1394error_t
-Adapt_buffer_bayer(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method)
+dc1394_bayer_decoding_8bit_stride(const uint8_t *restrict bayer, uint32_t bayer_stride,
+                                  uint8_t *restrict rgb, uint32_t rgb_stride, uint32_t sx, uint32_t sy,
+                                  dc1394color_filter_t tile, dc1394bayer_method_t method)
+{
+    const uint32_t out_line = 3 * (method == DC1394_BAYER_METHOD_DOWNSAMPLE ? sx / 2 : sx);
+
+    if (bayer_stride == 0)
+        bayer_stride = sx;
+    if (rgb_stride == 0)
+        rgb_stride = out_line;
+    if ((bayer_stride < sx) || (rgb_stride < out_line))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    if ((bayer_stride == sx) && (rgb_stride == out_line))
+        return dc1394_bayer_decoding_8bit(bayer, rgb, sx, sy, tile, method);
+
+    switch (method) {
+    case DC1394_BAYER_METHOD_NEAREST:
+        return bayer_NearestNeighbor(bayer, bayer_stride, rgb, rgb_stride, sx, sy, tile);
+    case DC1394_BAYER_METHOD_SIMPLE:
+        return bayer_Simple(bayer, bayer_stride, rgb, rgb_stride, sx, sy, tile);
+    case DC1394_BAYER_METHOD_BILINEAR:
+        return bayer_Bilinear(bayer, bayer_stride, rgb, rgb_stride, sx, sy, tile);
+    case DC1394_BAYER_METHOD_HQLINEAR:
+        return bayer_HQLinear(bayer, bayer_stride, rgb, rgb_stride, sx, sy, tile);
+    default:
+        return bayer_decoding_copy(bayer, bayer_stride, rgb, rgb_stride, sx, sy, 1, tile, method, 8);
+    }
+}
+
+dc1394error_t
+dc1394_bayer_decoding_16bit_stride(const uint16_t *restrict bayer, uint32_t bayer_stride,
+                                   uint16_t *restrict rgb, uint32_t rgb_stride, uint32_t sx, uint32_t sy,
+                                   dc1394color_filter_t tile, dc1394bayer_method_t method, uint32_t bits)
 {
-    uint32_t bpp;
+    const uint32_t out_line = 6 * (method == DC1394_BAYER_METHOD_DOWNSAMPLE ? sx / 2 : sx);
+
+    if (bayer_stride == 0)
+        bayer_stride = 2 * sx;
+    if (rgb_stride == 0)
+        rgb_stride = out_line;
+    if ((bayer_stride < 2 * sx) || (rgb_stride < out_line) || (bayer_stride & 1) || (rgb_stride & 1))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    if ((bayer_stride == 2 * sx) && (rgb_stride == out_line))
+        return dc1394_bayer_decoding_16bit(bayer, rgb, sx, sy, tile, method, bits);
+
+    switch (method) {
+    case DC1394_BAYER_METHOD_NEAREST:
+        return bayer_NearestNeighbor_uint16(bayer, bayer_stride / 2, rgb, rgb_stride / 2, sx, sy, tile, bits);
+    case DC1394_BAYER_METHOD_BILINEAR:
+        return bayer_Bilinear_uint16(bayer, bayer_stride / 2, rgb, rgb_stride / 2, sx, sy, tile, bits);
+    case DC1394_BAYER_METHOD_HQLINEAR:
+        return bayer_HQLinear_uint16(bayer, bayer_stride / 2, rgb, rgb_stride / 2, sx, sy, tile, bits);
+    default:
+        return bayer_decoding_copy((const uint8_t*)bayer, bayer_stride, (uint8_t*)rgb, rgb_stride,
+                                   sx, sy, 2, tile, method, bits);
+    }
+}
+
+/*
+  Same as Adapt_buffer_bayer() for the de-mosaicing of the width x height
+  rectangle at (left, top) of the input. The output lines are 'stride' bytes
+  apart, or packed if stride is 0. The padding bytes only follow full frames
+  with packed lines.
+*/
+dc1394error_t
+Adapt_buffer_bayer_rect(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method,
+                        uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint32_t stride)
+{
+    uint32_t bpp, line;
 
     // conversions will halve the buffer size if the method is DOWNSAMPLE:
-    out->size[0]=in->size[0];
-    out->size[1]=in->size[1];
+    out->size[0]=width;
+    out->size[1]=height;
     if (method == DC1394_BAYER_METHOD_DOWNSAMPLE) {
         out->size[0]/=2; // ODD SIZE CASES NOT TAKEN INTO ACCOUNT
         out->size[1]/=2;
     }
 
     // as a convention we divide the image position by two in the case of a DOWNSAMPLE:
-    out->position[0]=in->position[0];
-    out->position[1]=in->position[1];
+    out->position[0]=in->position[0]+left;
+    out->position[1]=in->position[1]+top;
     if (method == DC1394_BAYER_METHOD_DOWNSAMPLE) {
         out->position[0]/=2;
         out->position[1]/=2;
@@ -2069,18 +2460,26 @@ Adapt_buffer_bayer(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394baye
     else
         out->data_depth=8;
 
-    // don't know what to do with stride... >>>> TODO: STRIDE SHOULD BE TAKEN INTO ACCOUNT... <<<<
-    // out->stride=??
+    // lines are packed unless a larger stride was asked for:
+    dc1394_get_color_coding_bit_size(out->color_coding, &bpp);
+    line=(out->size[0]*bpp)/8;
+    if (stride==0)
+        stride=line;
+    if (stride<line)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    out->stride=stride;
 
     // the video mode should not change. Color coding and other stuff can be accessed in specific fields of this struct
     out->video_mode = in->video_mode;
 
-    // padding is kept:
-    out->padding_bytes = in->padding_bytes;
+    // padding is kept for full frames:
+    if ((left==0)&&(top==0)&&(width==in->size[0])&&(height==in->size[1])&&(stride==line))
+        out->padding_bytes = in->padding_bytes;
+    else
+        out->padding_bytes = 0;
 
-    // image bytes changes:    >>>> TODO: STRIDE SHOULD BE TAKEN INTO ACCOUNT... <<<<
-    dc1394_get_color_coding_bit_size(out->color_coding, &bpp);
-    out->image_bytes=(out->size[0]*out->size[1]*bpp)/8;
+    // image bytes changes: the last line is not followed by a stride's worth of bytes
+    out->image_bytes=out->size[1]>0 ? stride*(out->size[1]-1)+line : 0;
 
     // total is image_bytes + padding_bytes
     out->total_bytes = out->image_bytes + out->padding_bytes;
@@ -2091,6 +2490,8 @@ Adapt_buffer_bayer(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394baye
 
     // timestamp, frame_behind, id and camera are copied too:
     out->timestamp = in->timestamp;
+    out->iso_cycle = in->iso_cycle;
+    out->sequence = in->sequence;
     out->frames_behind = in->frames_behind;
     out->camera = in->camera;
     out->id = in->id;
@@ -2119,65 +2520,674 @@ Adapt_buffer_bayer(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394baye
 }
 
 dc1394error_t
-dc1394_debayer_frames(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method)
+Adapt_buffer_bayer(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method)
+{
+    return Adapt_buffer_bayer_rect(in, out, method, 0, 0, in->size[0], in->size[1], 0);
+}
+
+/**********************************************************************
+ *  Multi-threaded de-mosaicing of frames
+ **********************************************************************/
+
+/*
+  Rows of context that a band needs above and below itself so that the rows
+  it keeps are exactly those of a full-frame decoding. Bands always start on
+  an even row so that the filter tile is the same as for the full frame.
+*/
+static const uint32_t debayer_overlap[DC1394_BAYER_METHOD_NUM][2] = {
+    { 0, 2 },   /* NEAREST */
+    { 0, 2 },   /* SIMPLE */
+    { 2, 2 },   /* BILINEAR */
+    { 2, 2 },   /* HQLINEAR */
+    { 0, 0 },   /* DOWNSAMPLE: bands are decoded in place */
+    { 0, 0 },   /* EDGESENSE: never split */
+    { 4, 4 },   /* VNG: bilinear followed by a 5x5 window */
+    { 6, 6 },   /* AHD: 5x5 green, 3x3 chroma and 2 x 3x3 homogeneity */
+};
+
+#define DEBAYER_MAX_THREADS     64
+#define DEBAYER_MIN_BAND_HEIGHT 32  /* smaller bands are not worth a thread */
+
+static threadpool_t * debayer_pool = NULL;
+static uint32_t debayer_threads = 1;
+#ifdef HAVE_PTHREAD
+/* held for reading while the pool is in use, for writing while it changes */
+static pthread_rwlock_t debayer_lock = PTHREAD_RWLOCK_INITIALIZER;
+#endif
+
+typedef struct {
+    const uint8_t *bayer;
+    uint8_t *rgb;
+    uint32_t sx, sy;
+    dc1394color_filter_t tile;
+    dc1394bayer_method_t method;
+    uint32_t bytes;           /* bytes per sample: 1 or 2 */
+    uint32_t bits;
+    uint32_t in_stride;       /* bytes between the lines of the input and of the output */
+    uint32_t out_stride;
+    uint32_t band_height;
+    int num_bands;
+    dc1394error_t err[DEBAYER_MAX_THREADS];
+} debayer_job_t;
+
+static dc1394error_t
+debayer_buffer(const debayer_job_t *job, const uint8_t *bayer, uint8_t *rgb, uint32_t rgb_stride, uint32_t sy)
+{
+    if (job->bytes == 1)
+        return dc1394_bayer_decoding_8bit_stride(bayer, job->in_stride, rgb, rgb_stride,
+                                                 job->sx, sy, job->tile, job->method);
+    else
+        return dc1394_bayer_decoding_16bit_stride((const uint16_t*)bayer, job->in_stride, (uint16_t*)rgb,
+                                                  rgb_stride, job->sx, sy, job->tile, job->method, job->bits);
+}
+
+static void
+debayer_band(void *arg, int index)
+{
+    debayer_job_t *job = arg;
+    const size_t out_row = 3 * job->sx * job->bytes;
+    uint32_t y0 = index * job->band_height;
+    uint32_t y1 = index == job->num_bands - 1 ? job->sy : y0 + job->band_height;
+    uint32_t top, bottom;
+    uint8_t *scratch;
+
+    if (job->method == DC1394_BAYER_METHOD_DOWNSAMPLE) {
+        // the output rows of the bands don't overlap: decode in place
+        job->err[index] = debayer_buffer(job, job->bayer + y0 * job->in_stride,
+                                         job->rgb + (y0 / 2) * job->out_stride, job->out_stride, y1 - y0);
+        return;
+    }
+
+    // decode the band with its context rows in a per-thread buffer, then keep only the band
+    top = y0 > debayer_overlap[job->method][0] ? y0 - debayer_overlap[job->method][0] : 0;
+    bottom = y1 + debayer_overlap[job->method][1];
+    if (bottom > job->sy)
+        bottom = job->sy;
+
+    scratch = threadpool_get_scratch(THREADPOOL_SCRATCH_BAND, (bottom - top) * out_row);
+    if (scratch == NULL) {
+        job->err[index] = DC1394_MEMORY_ALLOCATION_FAILURE;
+        return;
+    }
+    job->err[index] = debayer_buffer(job, job->bayer + top * job->in_stride, scratch, out_row, bottom - top);
+    if (job->err[index] != DC1394_SUCCESS)
+        return;
+    if (job->out_stride == out_row)
+        memcpy(job->rgb + y0 * out_row, scratch + (y0 - top) * out_row, (y1 - y0) * out_row);
+    else
+        for (; y0 < y1; y0++)
+            memcpy(job->rgb + y0 * job->out_stride, scratch + (y0 - top) * out_row, out_row);
+}
+
+static dc1394error_t
+debayer_parallel(debayer_job_t *job)
+{
+    uint32_t threads;
+    dc1394error_t err = DC1394_SUCCESS;
+    int i;
+
+#ifdef HAVE_PTHREAD
+    pthread_rwlock_rdlock(&debayer_lock);
+#endif
+    threads = debayer_threads;
+    job->num_bands = threads;
+    if (job->sy / DEBAYER_MIN_BAND_HEIGHT < threads)
+        job->num_bands = job->sy / DEBAYER_MIN_BAND_HEIGHT;
+    if ((job->method == DC1394_BAYER_METHOD_EDGESENSE) ||
+        ((job->method == DC1394_BAYER_METHOD_DOWNSAMPLE) && (job->sx & 1)))
+        job->num_bands = 1;
+
+    if ((debayer_pool == NULL) || (job->num_bands <= 1)) {
+#ifdef HAVE_PTHREAD
+        pthread_rwlock_unlock(&debayer_lock);
+#endif
+        return debayer_buffer(job, job->bayer, job->rgb, job->out_stride, job->sy);
+    }
+
+    job->band_height = (job->sy / job->num_bands) & ~1;
+    threadpool_run(debayer_pool, debayer_band, job, job->num_bands);
+#ifdef HAVE_PTHREAD
+    pthread_rwlock_unlock(&debayer_lock);
+#endif
+
+    for (i = 0; i < job->num_bands; i++)
+        if (job->err[i] != DC1394_SUCCESS)
+            err = job->err[i];
+    return err;
+}
+
+dc1394error_t
+dc1394_debayer_set_num_threads(uint32_t num_threads)
+{
+    threadpool_t *pool = NULL;
+    dc1394error_t err = DC1394_SUCCESS;
+
+    if ((num_threads < 1) || (num_threads > DEBAYER_MAX_THREADS))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+#ifdef HAVE_PTHREAD
+    pthread_rwlock_wrlock(&debayer_lock);
+#else
+    if (num_threads > 1)
+        return DC1394_FUNCTION_NOT_SUPPORTED;
+#endif
+    if (num_threads != debayer_threads) {
+        if (num_threads > 1) {
+            pool = threadpool_new(num_threads);
+            if (pool == NULL)
+                err = DC1394_FAILURE;
+        }
+        if (err == DC1394_SUCCESS) {
+            threadpool_free(debayer_pool);
+            debayer_pool = pool;
+            debayer_threads = num_threads;
+        }
+    }
+#ifdef HAVE_PTHREAD
+    pthread_rwlock_unlock(&debayer_lock);
+#endif
+
+    return err;
+}
+
+dc1394error_t
+dc1394_debayer_get_num_threads(uint32_t *num_threads)
+{
+    *num_threads = debayer_threads;
+    return DC1394_SUCCESS;
+}
+
+/* the filter of a Bayer image whose first pixel is at (x, y) in an image with the given filter */
+static dc1394color_filter_t
+debayer_shift_filter(dc1394color_filter_t tile, uint32_t x, uint32_t y)
 {
+    // RGGB, GBRG, GRBG, BGGR: a column swaps RGGB<->GRBG and GBRG<->BGGR, a line RGGB<->GBRG and GRBG<->BGGR
+    if ((tile < DC1394_COLOR_FILTER_MIN) || (tile > DC1394_COLOR_FILTER_MAX))
+        return tile;
+    return DC1394_COLOR_FILTER_MIN + ((tile - DC1394_COLOR_FILTER_MIN) ^ ((x & 1) << 1) ^ (y & 1));
+}
+
+static dc1394error_t
+debayer_frames(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method,
+               uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint32_t stride)
+{
+    debayer_job_t job;
+    dc1394error_t err;
+
     if ((method<DC1394_BAYER_METHOD_MIN)||(method>DC1394_BAYER_METHOD_MAX))
         return DC1394_INVALID_BAYER_METHOD;
 
     switch (in->color_coding) {
     case DC1394_COLOR_CODING_RAW8:
     case DC1394_COLOR_CODING_MONO8:
-        
-        if(DC1394_SUCCESS != Adapt_buffer_bayer(in,out,method))
-            return DC1394_MEMORY_ALLOCATION_FAILURE;
-            
-        switch (method) {
-        case DC1394_BAYER_METHOD_NEAREST:
-            return dc1394_bayer_NearestNeighbor(in->image, out->image, in->size[0], in->size[1], in->color_filter);
-        case DC1394_BAYER_METHOD_SIMPLE:
-            return dc1394_bayer_Simple(in->image, out->image, in->size[0], in->size[1], in->color_filter);
-        case DC1394_BAYER_METHOD_BILINEAR:
-            return dc1394_bayer_Bilinear(in->image, out->image, in->size[0], in->size[1], in->color_filter);
-        case DC1394_BAYER_METHOD_HQLINEAR:
-            return dc1394_bayer_HQLinear(in->image, out->image, in->size[0], in->size[1], in->color_filter);
-        case DC1394_BAYER_METHOD_DOWNSAMPLE:
-            return dc1394_bayer_Downsample(in->image, out->image, in->size[0], in->size[1], in->color_filter);
-        case DC1394_BAYER_METHOD_EDGESENSE:
-            return dc1394_bayer_EdgeSense(in->image, out->image, in->size[0], in->size[1], in->color_filter);
-        case DC1394_BAYER_METHOD_VNG:
-            return dc1394_bayer_VNG(in->image, out->image, in->size[0], in->size[1], in->color_filter);
-        case DC1394_BAYER_METHOD_AHD:
-            return dc1394_bayer_AHD(in->image, out->image, in->size[0], in->size[1], in->color_filter);
-        }
+        job.bytes = 1;
         break;
     case DC1394_COLOR_CODING_MONO16:
     case DC1394_COLOR_CODING_RAW16:
-    
-        if(DC1394_SUCCESS != Adapt_buffer_bayer(in,out,method))
+        job.bytes = 2;
+        break;
+    default:
+        return DC1394_FUNCTION_NOT_SUPPORTED;
+    }
+
+    if ((width == 0) || (height == 0) || (left + width > in->size[0]) || (top + height > in->size[1]))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    err = Adapt_buffer_bayer_rect(in, out, method, left, top, width, height, stride);
+    if (err == DC1394_INVALID_ARGUMENT_VALUE)
+        return err;
+    if (err != DC1394_SUCCESS)
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+
+    job.in_stride = in->stride > in->size[0] * job.bytes ? in->stride : in->size[0] * job.bytes;
+    job.out_stride = out->stride;
+    job.bayer = in->image + top * job.in_stride + left * job.bytes;
+    job.rgb = out->image;
+    job.sx = width;
+    job.sy = height;
+    job.tile = debayer_shift_filter(in->color_filter, left, top);
+    job.method = method;
+    job.bits = in->data_depth;
+
+    return debayer_parallel(&job);
+}
+
+dc1394error_t
+dc1394_debayer_frames(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method)
+{
+    return debayer_frames(in, out, method, 0, 0, in->size[0], in->size[1], 0);
+}
+
+dc1394error_t
+dc1394_debayer_frames_rect(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method,
+                           uint32_t left, uint32_t top, uint32_t width, uint32_t height)
+{
+    return debayer_frames(in, out, method, left, top, width, height, out->stride);
+}
+
+/**********************************************************************
+ *  Fused de-mosaicing, white balance, color conversion and decimation
+ **********************************************************************/
+
+#define FUSED_STRIP_BYTES (128 * 1024)  /* decoded rows processed at once by a thread */
+#define FUSED_GAIN_BITS   12            /* fixed-point white balance gains */
+#define FUSED_GAIN_MAX    16.0f
+
+typedef struct {
+    debayer_job_t decode;           /* the de-mosaicing of the whole frame */
+    uint32_t scale;                 /* 2 for DOWNSAMPLE, else 1 */
+    uint32_t log2_decimation;
+    uint32_t gains[3];              /* red, green, blue */
+    dc1394color_coding_t color_coding;
+    uint32_t byte_order;
+    planar_layout_t layout;         /* of planar outputs */
+    uint8_t *out;
+    uint32_t width, height;         /* of the output */
+    uint32_t strip_rows;            /* input rows of a strip */
+    uint32_t num_rows;              /* input rows that make the output */
+    uint32_t num_strips;
+    int num_bands;
+    dc1394error_t err[DEBAYER_MAX_THREADS];
+} fused_job_t;
+
+/*
+  White balance and decimation of de-mosaiced rows into 8-bit RGB rows: each
+  output pixel is the average of a block of 1, 4 or 16 input pixels, times
+  the gain of its channel.
+*/
+static void
+fused_rgb8(const fused_job_t *job, const uint8_t *rgb, size_t rgb_stride, uint8_t *dst, size_t dst_stride,
+           uint32_t rows)
+{
+    const uint32_t d = 1 << job->log2_decimation;
+    const uint32_t shift = FUSED_GAIN_BITS + 2 * job->log2_decimation;
+    uint32_t x, y, i, j, c, sum;
+
+    for (y = 0; y < rows; y++) {
+        const uint8_t *src = rgb + y * d * rgb_stride;
+        uint8_t *out = dst + y * dst_stride;
+        for (x = 0; x < job->width; x++)
+            for (c = 0; c < 3; c++) {
+                sum = 0;
+                for (j = 0; j < d; j++)
+                    for (i = 0; i < d; i++)
+                        sum += src[j * rgb_stride + (x * d + i) * 3 + c];
+                sum = (sum * job->gains[c] + (1 << (shift - 1))) >> shift;
+                out[x * 3 + c] = sum > 255 ? 255 : sum;
+            }
+    }
+}
+
+static void
+fused_rgb8_uint16(const fused_job_t *job, const uint16_t *rgb, size_t rgb_stride, uint8_t *dst, size_t dst_stride,
+                  uint32_t rows)
+{
+    const uint32_t d = 1 << job->log2_decimation;
+    const uint32_t bits = job->decode.bits > 8 ? job->decode.bits : 8;
+    const uint32_t shift = FUSED_GAIN_BITS + 2 * job->log2_decimation + bits - 8;
+    uint32_t x, y, i, j, c;
+    uint64_t sum;
+
+    for (y = 0; y < rows; y++) {
+        const uint16_t *src = rgb + y * d * rgb_stride;
+        uint8_t *out = dst + y * dst_stride;
+        for (x = 0; x < job->width; x++)
+            for (c = 0; c < 3; c++) {
+                sum = 0;
+                for (j = 0; j < d; j++)
+                    for (i = 0; i < d; i++)
+                        sum += src[j * rgb_stride + (x * d + i) * 3 + c];
+                sum = (sum * job->gains[c] + (1 << (shift - 1))) >> shift;
+                out[x * 3 + c] = sum > 255 ? 255 : sum;
+            }
+    }
+}
+
+/* one strip: de-mosaicing of its rows with their context, then the rest of the stage while they are in the cache */
+static dc1394error_t
+fused_strip(fused_job_t *job, uint32_t strip)
+{
+    const debayer_job_t *dec = &job->decode;
+    const uint32_t block = job->scale << job->log2_decimation;   /* input rows per output row */
+    const size_t rgb_row = 3 * (dec->sx / job->scale) * dec->bytes;
+    uint32_t y0 = strip * job->strip_rows;
+    uint32_t y1 = y0 + job->strip_rows < job->num_rows ? y0 + job->strip_rows : job->num_rows;
+    uint32_t top, bottom, rows, out_y, i;
+    size_t rgb8_stride;
+    uint8_t *rgb, *rgb8;
+    dc1394error_t err;
+
+    if (dec->method == DC1394_BAYER_METHOD_DOWNSAMPLE) {
+        top = y0;
+        bottom = y1;
+    }
+    else if (job->num_strips == 1) {
+        top = 0;
+        bottom = dec->sy;
+    }
+    else {
+        top = y0 > debayer_overlap[dec->method][0] ? y0 - debayer_overlap[dec->method][0] : 0;
+        bottom = y1 + debayer_overlap[dec->method][1];
+        if (bottom > dec->sy)
+            bottom = dec->sy;
+    }
+
+    rgb = threadpool_get_scratch(THREADPOOL_SCRATCH_BAND, ((bottom - top) / job->scale) * rgb_row);
+    if (rgb == NULL)
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+    err = debayer_buffer(dec, dec->bayer + top * dec->in_stride, rgb, rgb_row, bottom - top);
+    if (err != DC1394_SUCCESS)
+        return err;
+    rgb += ((y0 - top) / job->scale) * rgb_row;
+
+    rows = (y1 - y0) / block;
+    out_y = y0 / block;
+
+    // white balance and decimation, straight into the output for RGB8
+    if (job->color_coding == DC1394_COLOR_CODING_RGB8) {
+        rgb8 = job->out + out_y * 3 * job->width;
+        rgb8_stride = 3 * job->width;
+    }
+    else {
+        rgb8_stride = 3 * job->width;
+        rgb8 = threadpool_get_scratch(THREADPOOL_SCRATCH_FUSED, rows * rgb8_stride);
+        if (rgb8 == NULL)
             return DC1394_MEMORY_ALLOCATION_FAILURE;
-            
-        switch (method) {
-        case DC1394_BAYER_METHOD_NEAREST:
-            return dc1394_bayer_NearestNeighbor_uint16((uint16_t*)in->image, (uint16_t*)out->image, in->size[0], in->size[1], in->color_filter, in->data_depth);
-        case DC1394_BAYER_METHOD_SIMPLE:
-            return dc1394_bayer_Simple_uint16((uint16_t*)in->image, (uint16_t*)out->image, in->size[0], in->size[1], in->color_filter, in->data_depth);
-        case DC1394_BAYER_METHOD_BILINEAR:
-            return dc1394_bayer_Bilinear_uint16((uint16_t*)in->image, (uint16_t*)out->image, in->size[0], in->size[1], in->color_filter, in->data_depth);
-        case DC1394_BAYER_METHOD_HQLINEAR:
-            return dc1394_bayer_HQLinear_uint16((uint16_t*)in->image, (uint16_t*)out->image, in->size[0], in->size[1], in->color_filter, in->data_depth);
-        case DC1394_BAYER_METHOD_DOWNSAMPLE:
-            return dc1394_bayer_Downsample_uint16((uint16_t*)in->image, (uint16_t*)out->image, in->size[0], in->size[1], in->color_filter, in->data_depth);
-        case DC1394_BAYER_METHOD_EDGESENSE:
-            return dc1394_bayer_EdgeSense_uint16((uint16_t*)in->image, (uint16_t*)out->image, in->size[0], in->size[1], in->color_filter, in->data_depth);
-        case DC1394_BAYER_METHOD_VNG:
-            return dc1394_bayer_VNG_uint16((uint16_t*)in->image, (uint16_t*)out->image, in->size[0], in->size[1], in->color_filter, in->data_depth);
-        case DC1394_BAYER_METHOD_AHD:
-            return dc1394_bayer_AHD_uint16((uint16_t*)in->image, (uint16_t*)out->image, in->size[0], in->size[1], in->color_filter, in->data_depth);
+    }
+    if (dec->bytes == 1)
+        fused_rgb8(job, rgb, rgb_row, rgb8, rgb8_stride, rows);
+    else
+        fused_rgb8_uint16(job, (const uint16_t *)rgb, rgb_row / 2, rgb8, rgb8_stride, rows);
+
+    // color conversion
+    switch (job->color_coding) {
+    case DC1394_COLOR_CODING_YUV422:
+        for (i = 0; i < rows; i++) {
+            err = dc1394_convert_to_YUV422(rgb8 + i * rgb8_stride, job->out + (out_y + i) * 2 * job->width,
+                                           job->width, 1, job->byte_order, DC1394_COLOR_CODING_RGB8, 8);
+            if (err != DC1394_SUCCESS)
+                return err;
         }
         break;
+    case DC1394_COLOR_CODING_I420:
+    case DC1394_COLOR_CODING_NV12:
+    case DC1394_COLOR_CODING_YV16:
+    case DC1394_COLOR_CODING_I422:
+        planar_convert(planar_get_line(DC1394_COLOR_CODING_RGB8), 24, rgb8, rgb8_stride, job->out, &job->layout,
+                       out_y, rows, 0, 8);
+        break;
     default:
-        return DC1394_FUNCTION_NOT_SUPPORTED;
+        break;
     }
 
     return DC1394_SUCCESS;
 }
+
+static void
+fused_band(void *arg, int index)
+{
+    fused_job_t *job = arg;
+    uint32_t first = (uint64_t)job->num_strips * index / job->num_bands;
+    uint32_t last = (uint64_t)job->num_strips * (index + 1) / job->num_bands;
+
+    job->err[index] = DC1394_SUCCESS;
+    for (; (first < last) && (job->err[index] == DC1394_SUCCESS); first++)
+        job->err[index] = fused_strip(job, first);
+}
+
+dc1394error_t
+Adapt_buffer_fused(dc1394video_frame_t *in, dc1394video_frame_t *out, uint32_t width, uint32_t height,
+                   uint32_t scale)
+{
+    planar_layout_t layout;
+
+    // the output size is set by the caller, the position is scaled like the image:
+    out->size[0]=width;
+    out->size[1]=height;
+    out->position[0]=in->position[0]/scale;
+    out->position[1]=in->position[1]/scale;
+
+    // the color coding and the YUV byte order have already been set: don't touch them.
+
+    // keep the color filter value in all cases.
+    out->color_filter=in->color_filter;
+
+    // the output is always made of 8-bit samples:
+    out->data_depth=8;
+
+    // lines are packed; for planar codings the stride is that of the Y plane:
+    switch (out->color_coding) {
+    case DC1394_COLOR_CODING_RGB8:
+        out->stride=3*width;
+        out->image_bytes=out->stride*height;
+        break;
+    case DC1394_COLOR_CODING_YUV422:
+        out->stride=2*width;
+        out->image_bytes=out->stride*height;
+        break;
+    default:
+        if (planar_get_layout(in->color_coding, out->color_coding, width, height, &layout)!=DC1394_SUCCESS)
+            return DC1394_FUNCTION_NOT_SUPPORTED;
+        out->stride=width;
+        out->image_bytes=layout.image_bytes;
+        break;
+    }
+
+    // the video mode should not change. Color coding and other stuff can be accessed in specific fields of this struct
+    out->video_mode = in->video_mode;
+
+    // the padding is not copied
+    out->padding_bytes = 0;
+    out->total_bytes = out->image_bytes;
+
+    // bytes-per-packet and packets_per_frame are internal data that can be kept as is.
+    out->packet_size  = in->packet_size;
+    out->packets_per_frame = in->packets_per_frame;
+
+    // timestamp, frame_behind, id and camera are copied too:
+    out->timestamp = in->timestamp;
+    out->iso_cycle = in->iso_cycle;
+    out->sequence = in->sequence;
+    out->frames_behind = in->frames_behind;
+    out->camera = in->camera;
+    out->id = in->id;
+
+    // verify memory allocation:
+    if (out->total_bytes>out->allocated_image_bytes) {
+        free(out->image);
+        out->image=(uint8_t*)malloc(out->total_bytes*sizeof(uint8_t));
+        if (out->image)
+            out->allocated_image_bytes = out->total_bytes*sizeof(uint8_t);
+        else
+            out->allocated_image_bytes = 0;
+    }
+
+    out->little_endian=0; // not used before 1.32 is out.
+    out->data_in_padding=0; // not used before 1.32 is out.
+
+    if(out->image)
+        return DC1394_SUCCESS;
+
+    return DC1394_MEMORY_ALLOCATION_FAILURE;
+}
+
+dc1394error_t
+dc1394_debayer_convert_frames(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method,
+                              const float *gains, uint32_t decimation)
+{
+    fused_job_t job;
+    uint32_t unit, strip_units, threads, c, i;
+    dc1394error_t err = DC1394_SUCCESS;
+
+    if ((method<DC1394_BAYER_METHOD_MIN)||(method>DC1394_BAYER_METHOD_MAX))
+        return DC1394_INVALID_BAYER_METHOD;
+
+    switch (in->color_coding) {
+    case DC1394_COLOR_CODING_RAW8:
+    case DC1394_COLOR_CODING_MONO8:
+        job.decode.bytes = 1;
+        break;
+    case DC1394_COLOR_CODING_MONO16:
+    case DC1394_COLOR_CODING_RAW16:
+        job.decode.bytes = 2;
+        break;
+    default:
+        return DC1394_FUNCTION_NOT_SUPPORTED;
+    }
+
+    switch (decimation) {
+    case 1:
+        job.log2_decimation = 0;
+        break;
+    case 2:
+        job.log2_decimation = 1;
+        break;
+    case 4:
+        job.log2_decimation = 2;
+        break;
+    default:
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    }
+
+    for (c = 0; c < 3; c++) {
+        if (gains == NULL)
+            job.gains[c] = 1 << FUSED_GAIN_BITS;
+        else if ((gains[c] >= 0.0f) && (gains[c] <= FUSED_GAIN_MAX))
+            job.gains[c] = (uint32_t)(gains[c] * (1 << FUSED_GAIN_BITS) + 0.5f);
+        else
+            return DC1394_INVALID_ARGUMENT_VALUE;
+    }
+
+    // output size: the YUV outputs share their chroma between pairs of pixels, which must not be split
+    job.scale = method == DC1394_BAYER_METHOD_DOWNSAMPLE ? 2 : 1;
+    job.width = (in->size[0] / job.scale) >> job.log2_decimation;
+    job.height = (in->size[1] / job.scale) >> job.log2_decimation;
+    unit = 1;
+    switch (out->color_coding) {
+    case DC1394_COLOR_CODING_RGB8:
+        break;
+    case DC1394_COLOR_CODING_YUV422:
+        job.width &= ~1;
+        break;
+    default:
+        if (planar_get_layout(in->color_coding, out->color_coding, job.width, job.height, &job.layout) == DC1394_INVALID_COLOR_CODING)
+            return DC1394_FUNCTION_NOT_SUPPORTED;
+        unit = job.layout.vsub;
+        job.width &= ~1;
+        job.height -= job.height % unit;
+        planar_get_layout(in->color_coding, out->color_coding, job.width, job.height, &job.layout);
+        break;
+    }
+    if ((job.width == 0) || (job.height == 0))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    err = Adapt_buffer_fused(in, out, job.width, job.height, job.scale);
+    if (err != DC1394_SUCCESS)
+        return err;
+
+    job.decode.in_stride = in->stride > in->size[0] * job.decode.bytes ? in->stride : in->size[0] * job.decode.bytes;
+    job.decode.bayer = in->image;
+    job.decode.sx = in->size[0];
+    job.decode.sy = in->size[1];
+    job.decode.tile = in->color_filter;
+    job.decode.method = method;
+    job.decode.bits = in->data_depth;
+    job.color_coding = out->color_coding;
+    job.byte_order = out->yuv_byte_order;
+    job.out = out->image;
+
+    // strips of whole output rows (pairs for 4:2:0) that start on even input rows and fit in the cache
+    unit *= job.scale << job.log2_decimation;
+    if (unit < 2)
+        unit = 2;
+    job.num_rows = (job.height * job.scale) << job.log2_decimation;
+    strip_units = FUSED_STRIP_BYTES / (unit * 3 * in->size[0] * job.decode.bytes);
+    if (method == DC1394_BAYER_METHOD_EDGESENSE)
+        strip_units = job.num_rows / unit;   // never split
+    if (strip_units < 1)
+        strip_units = 1;
+    job.strip_rows = strip_units * unit;
+    job.num_strips = (job.num_rows + job.strip_rows - 1) / job.strip_rows;
+
+#ifdef HAVE_PTHREAD
+    pthread_rwlock_rdlock(&debayer_lock);
+#endif
+    threads = debayer_pool != NULL ? debayer_threads : 1;
+    job.num_bands = job.num_strips < threads ? job.num_strips : threads;
+    threadpool_run(job.num_bands > 1 ? debayer_pool : NULL, fused_band, &job, job.num_bands);
+#ifdef HAVE_PTHREAD
+    pthread_rwlock_unlock(&debayer_lock);
+#endif
+
+    for (i = 0; i < (uint32_t)job.num_bands; i++)
+        if (job.err[i] != DC1394_SUCCESS)
+            err = job.err[i];
+    return err;
+}
+
+static dc1394error_t
+debayer_plan_run(dc1394conversion_plan_t *plan, const uint8_t *src)
+{
+    debayer_job_t *job = plan->job;
+
+    job->bayer = src;
+    return debayer_parallel(job);
+}
+
+dc1394conversion_plan_t *
+dc1394_debayer_plan_new(const dc1394video_frame_t *in, dc1394bayer_method_t method)
+{
+    dc1394conversion_plan_t *plan;
+    debayer_job_t *job;
+    uint32_t bytes, scale;
+
+    if ((method<DC1394_BAYER_METHOD_MIN)||(method>DC1394_BAYER_METHOD_MAX))
+        return NULL;
+
+    // EdgeSense was removed: every run would fail
+    if (method == DC1394_BAYER_METHOD_EDGESENSE)
+        return NULL;
+
+    switch (in->color_coding) {
+    case DC1394_COLOR_CODING_RAW8:
+    case DC1394_COLOR_CODING_MONO8:
+        bytes = 1;
+        break;
+    case DC1394_COLOR_CODING_MONO16:
+    case DC1394_COLOR_CODING_RAW16:
+        bytes = 2;
+        break;
+    default:
+        return NULL;
+    }
+
+    if ((in->size[0] == 0) || (in->size[1] == 0))
+        return NULL;
+
+    job = calloc(1, sizeof(debayer_job_t));
+    if (job == NULL)
+        return NULL;
+
+    scale = method == DC1394_BAYER_METHOD_DOWNSAMPLE ? 2 : 1;
+    plan = conversion_plan_new(in, bytes == 2 ? DC1394_COLOR_CODING_RGB16 : DC1394_COLOR_CODING_RGB8,
+                               in->size[0] / scale, in->size[1] / scale, bytes == 2 ? in->data_depth : 8);
+    if (plan == NULL) {
+        free(job);
+        return NULL;
+    }
+
+    job->in_stride = plan->stride;
+    job->out_stride = plan->frame.stride;
+    job->rgb = plan->frame.image;
+    job->sx = in->size[0];
+    job->sy = in->size[1];
+    job->tile = in->color_filter;
+    job->method = method;
+    job->bytes = bytes;
+    job->bits = in->data_depth;
+
+    plan->run = debayer_plan_run;
+    plan->scale = scale;
+    plan->job = job;
+    return plan;
+}
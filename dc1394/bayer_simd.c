@@ -0,0 +1,818 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * SIMD versions of the Bilinear and HQLinear Bayer decoders
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  The kernels below compute the very same integer expressions as the scalar
+  inner loops of bayer.c, so their output is bit-identical. Each pair of
+  output pixels (A at even, B at odd offset) is made of six values c0, c1, c2
+  and d0, d1, d2 that are laid out as RGB when blue > 0 and as BGR otherwise.
+
+  The loads never go past the last sample read by the scalar code for the
+  same pairs, and the stores only touch the pixels of those pairs.
+*/
+
+#include <string.h>
+#include "simd.h"
+#include "simd_store.h"
+
+#ifdef DC1394_SIMD_X86
+
+/**********************************************************************
+ *  SSE2                                                              *
+ **********************************************************************/
+
+/* even and odd samples of a row, zero-extended to 16 or 32 bits */
+#define EVEN8(v)   _mm_and_si128 (v, _mm_set1_epi16 (0xff))
+#define ODD8(v)    _mm_srli_epi16 (v, 8)
+#define EVEN16(v)  _mm_and_si128 (v, _mm_set1_epi32 (0xffff))
+#define ODD16(v)   _mm_srli_epi32 (v, 16)
+#define LOAD(p)    _mm_loadu_si128 ((const __m128i *) (p))
+
+/* store two 16-bit R,G,B,0 pixels as 12 bytes */
+static inline void
+store_rgb16_x2 (uint16_t *dst, __m128i p)
+{
+    uint32_t last;
+    __m128i x = _mm_or_si128 (
+        _mm_and_si128 (p, _mm_set_epi32 (0, 0, 0x0000ffff, 0xffffffff)),
+        _mm_and_si128 (_mm_srli_si128 (p, 2),
+                       _mm_set_epi32 (0, 0xffffffff, 0xffff0000, 0)));
+    _mm_storel_epi64 ((__m128i *) dst, x);
+    last = _mm_cvtsi128_si32 (_mm_srli_si128 (x, 8));
+    memcpy (dst + 4, &last, 4);
+}
+
+/* pack two vectors of 32-bit values in 0..65535 into 16-bit lanes */
+static inline __m128i
+pack_u32 (__m128i a, __m128i b)
+{
+    const __m128i bias = _mm_set1_epi32 (0x8000);
+    return _mm_xor_si128 (_mm_packs_epi32 (_mm_sub_epi32 (a, bias),
+                                           _mm_sub_epi32 (b, bias)),
+                          _mm_set1_epi16 ((short) 0x8000));
+}
+
+/*
+  Interleave four pairs of 16-bit pixels held in 32-bit lanes and store them
+  as 8 RGB pixels.
+*/
+static inline void
+emit_rgb16 (uint16_t *rgb, __m128i c0, __m128i c1, __m128i c2,
+            __m128i d0, __m128i d1, __m128i d2, int blue)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i r, g, b, rg, b0;
+
+    if (blue < 0) {
+        __m128i t;
+        t = c0; c0 = c2; c2 = t;
+        t = d0; d0 = d2; d2 = t;
+    }
+    r = pack_u32 (c0, d0);
+    g = pack_u32 (c1, d1);
+    b = pack_u32 (c2, d2);
+    r = _mm_unpacklo_epi16 (r, _mm_srli_si128 (r, 8));
+    g = _mm_unpacklo_epi16 (g, _mm_srli_si128 (g, 8));
+    b = _mm_unpacklo_epi16 (b, _mm_srli_si128 (b, 8));
+
+    rg = _mm_unpacklo_epi16 (r, g);
+    b0 = _mm_unpacklo_epi16 (b, zero);
+    store_rgb16_x2 (rgb,      _mm_unpacklo_epi32 (rg, b0));
+    store_rgb16_x2 (rgb + 6,  _mm_unpackhi_epi32 (rg, b0));
+    rg = _mm_unpackhi_epi16 (r, g);
+    b0 = _mm_unpackhi_epi16 (b, zero);
+    store_rgb16_x2 (rgb + 12, _mm_unpacklo_epi32 (rg, b0));
+    store_rgb16_x2 (rgb + 18, _mm_unpackhi_epi32 (rg, b0));
+}
+
+/* clip signed 32-bit lanes to 0..max */
+static inline __m128i
+clip_s32 (__m128i x, __m128i max)
+{
+    __m128i m;
+    x = _mm_and_si128 (x, _mm_cmpgt_epi32 (x, _mm_setzero_si128 ()));
+    m = _mm_cmpgt_epi32 (x, max);
+    return _mm_or_si128 (_mm_and_si128 (m, max), _mm_andnot_si128 (m, x));
+}
+
+static int
+bilinear_sse2 (const uint8_t *bayer, uint8_t *rgb, int bayerStep,
+               int pairs, int blue)
+{
+    const __m128i two = _mm_set1_epi16 (2);
+    int n;
+
+    for (n = 0; n + 8 <= pairs; n += 8, bayer += 16, rgb += 48) {
+        __m128i a = LOAD (bayer);
+        __m128i b = LOAD (bayer + 2);
+        __m128i c = LOAD (bayer + bayerStep);
+        __m128i d = LOAD (bayer + bayerStep + 2);
+        __m128i e = LOAD (bayer + 2 * bayerStep);
+        __m128i f = LOAD (bayer + 2 * bayerStep + 2);
+        __m128i c0, c1, c2, d0, d1, d2;
+
+        c0 = _mm_add_epi16 (_mm_add_epi16 (EVEN8 (a), EVEN8 (b)),
+                            _mm_add_epi16 (EVEN8 (e), EVEN8 (f)));
+        c0 = _mm_srli_epi16 (_mm_add_epi16 (c0, two), 2);
+        c1 = _mm_add_epi16 (_mm_add_epi16 (ODD8 (a), EVEN8 (c)),
+                            _mm_add_epi16 (EVEN8 (d), ODD8 (e)));
+        c1 = _mm_srli_epi16 (_mm_add_epi16 (c1, two), 2);
+        c2 = ODD8 (c);
+        d0 = _mm_avg_epu16 (EVEN8 (b), EVEN8 (f));
+        d1 = EVEN8 (d);
+        d2 = _mm_avg_epu16 (ODD8 (c), ODD8 (d));
+
+        emit_rgb8 (rgb, c0, c1, c2, d0, d1, d2, blue);
+    }
+    return n;
+}
+
+static int
+bilinear_uint16_sse2 (const uint16_t *bayer, uint16_t *rgb, int bayerStep,
+                      int pairs, int blue, int bits)
+{
+    const __m128i one = _mm_set1_epi32 (1);
+    const __m128i two = _mm_set1_epi32 (2);
+    int n;
+
+    for (n = 0; n + 4 <= pairs; n += 4, bayer += 8, rgb += 24) {
+        __m128i a = LOAD (bayer);
+        __m128i b = LOAD (bayer + 2);
+        __m128i c = LOAD (bayer + bayerStep);
+        __m128i d = LOAD (bayer + bayerStep + 2);
+        __m128i e = LOAD (bayer + 2 * bayerStep);
+        __m128i f = LOAD (bayer + 2 * bayerStep + 2);
+        __m128i c0, c1, c2, d0, d1, d2;
+
+        c0 = _mm_add_epi32 (_mm_add_epi32 (EVEN16 (a), EVEN16 (b)),
+                            _mm_add_epi32 (EVEN16 (e), EVEN16 (f)));
+        c0 = _mm_srli_epi32 (_mm_add_epi32 (c0, two), 2);
+        c1 = _mm_add_epi32 (_mm_add_epi32 (ODD16 (a), EVEN16 (c)),
+                            _mm_add_epi32 (EVEN16 (d), ODD16 (e)));
+        c1 = _mm_srli_epi32 (_mm_add_epi32 (c1, two), 2);
+        c2 = ODD16 (c);
+        d0 = _mm_add_epi32 (EVEN16 (b), EVEN16 (f));
+        d0 = _mm_srli_epi32 (_mm_add_epi32 (d0, one), 1);
+        d1 = EVEN16 (d);
+        d2 = _mm_add_epi32 (ODD16 (c), ODD16 (d));
+        d2 = _mm_srli_epi32 (_mm_add_epi32 (d2, one), 1);
+
+        emit_rgb16 (rgb, c0, c1, c2, d0, d1, d2, blue);
+    }
+    return n;
+}
+
+static int
+hqlinear_sse2 (const uint8_t *bayer, uint8_t *rgb, int bayerStep,
+               int pairs, int blue)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i max = _mm_set1_epi16 (255);
+    const __m128i one = _mm_set1_epi16 (1);
+    const __m128i four = _mm_set1_epi16 (4);
+    const uint8_t *r0 = bayer;
+    const uint8_t *r1 = bayer + bayerStep;
+    const uint8_t *r2 = bayer + 2 * bayerStep;
+    const uint8_t *r3 = bayer + 3 * bayerStep;
+    const uint8_t *r4 = bayer + 4 * bayerStep;
+    int n;
+
+    for (n = 0; n + 8 <= pairs; n += 8, r0 += 16, r1 += 16, r2 += 16,
+             r3 += 16, r4 += 16, rgb += 48) {
+        __m128i v;
+        __m128i r0_2, r0_3, r1_1, r1_2, r1_3, r1_4, r2_0, r2_1, r2_2, r2_3;
+        __m128i r2_4, r2_5, r3_1, r3_2, r3_3, r3_4, r4_2, r4_3;
+        __m128i cross, side, t0, t1, c0, c1, c2, d0, d1, d2;
+
+        v = LOAD (r0 + 2); r0_2 = EVEN8 (v); r0_3 = ODD8 (v);
+        v = LOAD (r1 + 1); r1_1 = EVEN8 (v); r1_2 = ODD8 (v);
+        v = LOAD (r1 + 3); r1_3 = EVEN8 (v); r1_4 = ODD8 (v);
+        v = LOAD (r2);     r2_0 = EVEN8 (v); r2_1 = ODD8 (v);
+        v = LOAD (r2 + 2); r2_2 = EVEN8 (v); r2_3 = ODD8 (v);
+        v = LOAD (r2 + 4); r2_4 = EVEN8 (v); r2_5 = ODD8 (v);
+        v = LOAD (r3 + 1); r3_1 = EVEN8 (v); r3_2 = ODD8 (v);
+        v = LOAD (r3 + 3); r3_3 = EVEN8 (v); r3_4 = ODD8 (v);
+        v = LOAD (r4 + 2); r4_2 = EVEN8 (v); r4_3 = ODD8 (v);
+
+        /* first pixel: R or B site */
+        c2 = r2_2;
+        cross = _mm_add_epi16 (_mm_add_epi16 (r0_2, r2_0),
+                               _mm_add_epi16 (r2_4, r4_2));
+        t0 = _mm_slli_epi16 (_mm_add_epi16 (_mm_add_epi16 (r1_1, r1_3),
+                                            _mm_add_epi16 (r3_1, r3_3)), 1);
+        v = _mm_add_epi16 (_mm_add_epi16 (cross, cross), cross);
+        t0 = _mm_sub_epi16 (t0, _mm_srli_epi16 (_mm_add_epi16 (v, one), 1));
+        v = _mm_add_epi16 (c2, _mm_add_epi16 (c2, c2));
+        t0 = _mm_add_epi16 (t0, _mm_add_epi16 (v, v));
+        t1 = _mm_slli_epi16 (_mm_add_epi16 (_mm_add_epi16 (r1_2, r2_1),
+                                            _mm_add_epi16 (r2_3, r3_2)), 1);
+        t1 = _mm_sub_epi16 (t1, cross);
+        t1 = _mm_add_epi16 (t1, _mm_slli_epi16 (c2, 2));
+        t0 = _mm_srai_epi16 (_mm_add_epi16 (t0, four), 3);
+        c0 = _mm_min_epi16 (_mm_max_epi16 (t0, zero), max);
+        t1 = _mm_srai_epi16 (_mm_add_epi16 (t1, four), 3);
+        c1 = _mm_min_epi16 (_mm_max_epi16 (t1, zero), max);
+
+        /* second pixel: green site */
+        d1 = r2_3;
+        side = _mm_add_epi16 (_mm_add_epi16 (r1_2, r1_4),
+                              _mm_add_epi16 (r3_2, r3_4));
+        v = _mm_add_epi16 (_mm_slli_epi16 (d1, 2), d1);
+        t0 = _mm_add_epi16 (v, _mm_slli_epi16 (_mm_add_epi16 (r1_3, r3_3), 2));
+        t0 = _mm_sub_epi16 (t0, _mm_add_epi16 (_mm_add_epi16 (r0_3, r4_3), side));
+        t0 = _mm_add_epi16 (t0, _mm_avg_epu16 (r2_1, r2_5));
+        t1 = _mm_add_epi16 (v, _mm_slli_epi16 (_mm_add_epi16 (r2_2, r2_4), 2));
+        t1 = _mm_sub_epi16 (t1, _mm_add_epi16 (_mm_add_epi16 (r2_1, r2_5), side));
+        t1 = _mm_add_epi16 (t1, _mm_avg_epu16 (r0_3, r4_3));
+        t0 = _mm_srai_epi16 (_mm_add_epi16 (t0, four), 3);
+        d0 = _mm_min_epi16 (_mm_max_epi16 (t0, zero), max);
+        t1 = _mm_srai_epi16 (_mm_add_epi16 (t1, four), 3);
+        d2 = _mm_min_epi16 (_mm_max_epi16 (t1, zero), max);
+
+        emit_rgb8 (rgb, c0, c1, c2, d0, d1, d2, blue);
+    }
+    return n;
+}
+
+static int
+hqlinear_uint16_sse2 (const uint16_t *bayer, uint16_t *rgb, int bayerStep,
+                      int pairs, int blue, int bits)
+{
+    const __m128i max = _mm_set1_epi32 ((1 << bits) - 1);
+    const __m128i one = _mm_set1_epi32 (1);
+    const __m128i four = _mm_set1_epi32 (4);
+    const uint16_t *r0 = bayer;
+    const uint16_t *r1 = bayer + bayerStep;
+    const uint16_t *r2 = bayer + 2 * bayerStep;
+    const uint16_t *r3 = bayer + 3 * bayerStep;
+    const uint16_t *r4 = bayer + 4 * bayerStep;
+    int n;
+
+    for (n = 0; n + 4 <= pairs; n += 4, r0 += 8, r1 += 8, r2 += 8,
+             r3 += 8, r4 += 8, rgb += 24) {
+        __m128i v;
+        __m128i r0_2, r0_3, r1_1, r1_2, r1_3, r1_4, r2_0, r2_1, r2_2, r2_3;
+        __m128i r2_4, r2_5, r3_1, r3_2, r3_3, r3_4, r4_2, r4_3;
+        __m128i cross, side, t0, t1, c0, c1, c2, d0, d1, d2;
+
+        v = LOAD (r0 + 2); r0_2 = EVEN16 (v); r0_3 = ODD16 (v);
+        v = LOAD (r1 + 1); r1_1 = EVEN16 (v); r1_2 = ODD16 (v);
+        v = LOAD (r1 + 3); r1_3 = EVEN16 (v); r1_4 = ODD16 (v);
+        v = LOAD (r2);     r2_0 = EVEN16 (v); r2_1 = ODD16 (v);
+        v = LOAD (r2 + 2); r2_2 = EVEN16 (v); r2_3 = ODD16 (v);
+        v = LOAD (r2 + 4); r2_4 = EVEN16 (v); r2_5 = ODD16 (v);
+        v = LOAD (r3 + 1); r3_1 = EVEN16 (v); r3_2 = ODD16 (v);
+        v = LOAD (r3 + 3); r3_3 = EVEN16 (v); r3_4 = ODD16 (v);
+        v = LOAD (r4 + 2); r4_2 = EVEN16 (v); r4_3 = ODD16 (v);
+
+        /* first pixel: R or B site */
+        c2 = r2_2;
+        cross = _mm_add_epi32 (_mm_add_epi32 (r0_2, r2_0),
+                               _mm_add_epi32 (r2_4, r4_2));
+        t0 = _mm_slli_epi32 (_mm_add_epi32 (_mm_add_epi32 (r1_1, r1_3),
+                                            _mm_add_epi32 (r3_1, r3_3)), 1);
+        v = _mm_add_epi32 (_mm_add_epi32 (cross, cross), cross);
+        t0 = _mm_sub_epi32 (t0, _mm_srli_epi32 (_mm_add_epi32 (v, one), 1));
+        v = _mm_add_epi32 (c2, _mm_add_epi32 (c2, c2));
+        t0 = _mm_add_epi32 (t0, _mm_add_epi32 (v, v));
+        t1 = _mm_slli_epi32 (_mm_add_epi32 (_mm_add_epi32 (r1_2, r2_1),
+                                            _mm_add_epi32 (r2_3, r3_2)), 1);
+        t1 = _mm_sub_epi32 (t1, cross);
+        t1 = _mm_add_epi32 (t1, _mm_slli_epi32 (c2, 2));
+        c0 = clip_s32 (_mm_srai_epi32 (_mm_add_epi32 (t0, four), 3), max);
+        c1 = clip_s32 (_mm_srai_epi32 (_mm_add_epi32 (t1, four), 3), max);
+
+        /* second pixel: green site */
+        d1 = r2_3;
+        side = _mm_add_epi32 (_mm_add_epi32 (r1_2, r1_4),
+                              _mm_add_epi32 (r3_2, r3_4));
+        v = _mm_add_epi32 (_mm_slli_epi32 (d1, 2), d1);
+        t0 = _mm_add_epi32 (v, _mm_slli_epi32 (_mm_add_epi32 (r1_3, r3_3), 2));
+        t0 = _mm_sub_epi32 (t0, _mm_add_epi32 (_mm_add_epi32 (r0_3, r4_3), side));
+        t0 = _mm_add_epi32 (t0, _mm_srli_epi32 (
+                               _mm_add_epi32 (_mm_add_epi32 (r2_1, r2_5), one), 1));
+        t1 = _mm_add_epi32 (v, _mm_slli_epi32 (_mm_add_epi32 (r2_2, r2_4), 2));
+        t1 = _mm_sub_epi32 (t1, _mm_add_epi32 (_mm_add_epi32 (r2_1, r2_5), side));
+        t1 = _mm_add_epi32 (t1, _mm_srli_epi32 (
+                               _mm_add_epi32 (_mm_add_epi32 (r0_3, r4_3), one), 1));
+        d0 = clip_s32 (_mm_srai_epi32 (_mm_add_epi32 (t0, four), 3), max);
+        d2 = clip_s32 (_mm_srai_epi32 (_mm_add_epi32 (t1, four), 3), max);
+
+        emit_rgb16 (rgb, c0, c1, c2, d0, d1, d2, blue);
+    }
+    return n;
+}
+
+const simd_dispatch_t simd_sse2 = {
+    "sse2",
+    bilinear_sse2,
+    bilinear_uint16_sse2,
+    hqlinear_sse2,
+    hqlinear_uint16_sse2,
+    yuv422_rgb8_sse2,
+    NULL,
+    NULL,
+    yuv422_planar_sse2,
+};
+
+/**********************************************************************
+ *  AVX2                                                              *
+ **********************************************************************/
+
+/*
+  The AVX2 kernels do the arithmetic on 256-bit registers. Even/odd splitting
+  and all the operations are lane-local, so the low 128 bits always hold the
+  first half of the pairs and the high 128 bits the second half, which are
+  then stored with the SSE2 helpers.
+*/
+
+#define AVX2 __attribute__ ((target ("avx2")))
+
+#define EVEN8_256(v)   _mm256_and_si256 (v, _mm256_set1_epi16 (0xff))
+#define ODD8_256(v)    _mm256_srli_epi16 (v, 8)
+#define EVEN16_256(v)  _mm256_and_si256 (v, _mm256_set1_epi32 (0xffff))
+#define ODD16_256(v)   _mm256_srli_epi32 (v, 16)
+#define LOAD256(p)     _mm256_loadu_si256 ((const __m256i *) (p))
+#define LO(v)          _mm256_castsi256_si128 (v)
+#define HI(v)          _mm256_extracti128_si256 (v, 1)
+
+static inline AVX2 __m256i
+clip_s32_256 (__m256i x, __m256i max)
+{
+    return _mm256_min_epi32 (_mm256_max_epi32 (x, _mm256_setzero_si256 ()), max);
+}
+
+static AVX2 int
+bilinear_avx2 (const uint8_t *bayer, uint8_t *rgb, int bayerStep,
+               int pairs, int blue)
+{
+    const __m256i two = _mm256_set1_epi16 (2);
+    int n;
+
+    for (n = 0; n + 16 <= pairs; n += 16, bayer += 32, rgb += 96) {
+        __m256i a = LOAD256 (bayer);
+        __m256i b = LOAD256 (bayer + 2);
+        __m256i c = LOAD256 (bayer + bayerStep);
+        __m256i d = LOAD256 (bayer + bayerStep + 2);
+        __m256i e = LOAD256 (bayer + 2 * bayerStep);
+        __m256i f = LOAD256 (bayer + 2 * bayerStep + 2);
+        __m256i c0, c1, c2, d0, d1, d2;
+
+        c0 = _mm256_add_epi16 (_mm256_add_epi16 (EVEN8_256 (a), EVEN8_256 (b)),
+                               _mm256_add_epi16 (EVEN8_256 (e), EVEN8_256 (f)));
+        c0 = _mm256_srli_epi16 (_mm256_add_epi16 (c0, two), 2);
+        c1 = _mm256_add_epi16 (_mm256_add_epi16 (ODD8_256 (a), EVEN8_256 (c)),
+                               _mm256_add_epi16 (EVEN8_256 (d), ODD8_256 (e)));
+        c1 = _mm256_srli_epi16 (_mm256_add_epi16 (c1, two), 2);
+        c2 = ODD8_256 (c);
+        d0 = _mm256_avg_epu16 (EVEN8_256 (b), EVEN8_256 (f));
+        d1 = EVEN8_256 (d);
+        d2 = _mm256_avg_epu16 (ODD8_256 (c), ODD8_256 (d));
+
+        emit_rgb8 (rgb, LO (c0), LO (c1), LO (c2), LO (d0), LO (d1), LO (d2), blue);
+        emit_rgb8 (rgb + 48, HI (c0), HI (c1), HI (c2), HI (d0), HI (d1), HI (d2), blue);
+    }
+    return n;
+}
+
+static AVX2 int
+bilinear_uint16_avx2 (const uint16_t *bayer, uint16_t *rgb, int bayerStep,
+                      int pairs, int blue, int bits)
+{
+    const __m256i one = _mm256_set1_epi32 (1);
+    const __m256i two = _mm256_set1_epi32 (2);
+    int n;
+
+    for (n = 0; n + 8 <= pairs; n += 8, bayer += 16, rgb += 48) {
+        __m256i a = LOAD256 (bayer);
+        __m256i b = LOAD256 (bayer + 2);
+        __m256i c = LOAD256 (bayer + bayerStep);
+        __m256i d = LOAD256 (bayer + bayerStep + 2);
+        __m256i e = LOAD256 (bayer + 2 * bayerStep);
+        __m256i f = LOAD256 (bayer + 2 * bayerStep + 2);
+        __m256i c0, c1, c2, d0, d1, d2;
+
+        c0 = _mm256_add_epi32 (_mm256_add_epi32 (EVEN16_256 (a), EVEN16_256 (b)),
+                               _mm256_add_epi32 (EVEN16_256 (e), EVEN16_256 (f)));
+        c0 = _mm256_srli_epi32 (_mm256_add_epi32 (c0, two), 2);
+        c1 = _mm256_add_epi32 (_mm256_add_epi32 (ODD16_256 (a), EVEN16_256 (c)),
+                               _mm256_add_epi32 (EVEN16_256 (d), ODD16_256 (e)));
+        c1 = _mm256_srli_epi32 (_mm256_add_epi32 (c1, two), 2);
+        c2 = ODD16_256 (c);
+        d0 = _mm256_add_epi32 (EVEN16_256 (b), EVEN16_256 (f));
+        d0 = _mm256_srli_epi32 (_mm256_add_epi32 (d0, one), 1);
+        d1 = EVEN16_256 (d);
+        d2 = _mm256_add_epi32 (ODD16_256 (c), ODD16_256 (d));
+        d2 = _mm256_srli_epi32 (_mm256_add_epi32 (d2, one), 1);
+
+        emit_rgb16 (rgb, LO (c0), LO (c1), LO (c2), LO (d0), LO (d1), LO (d2), blue);
+        emit_rgb16 (rgb + 24, HI (c0), HI (c1), HI (c2), HI (d0), HI (d1), HI (d2), blue);
+    }
+    return n;
+}
+
+static AVX2 int
+hqlinear_avx2 (const uint8_t *bayer, uint8_t *rgb, int bayerStep,
+               int pairs, int blue)
+{
+    const __m256i zero = _mm256_setzero_si256 ();
+    const __m256i max = _mm256_set1_epi16 (255);
+    const __m256i one = _mm256_set1_epi16 (1);
+    const __m256i four = _mm256_set1_epi16 (4);
+    const uint8_t *r0 = bayer;
+    const uint8_t *r1 = bayer + bayerStep;
+    const uint8_t *r2 = bayer + 2 * bayerStep;
+    const uint8_t *r3 = bayer + 3 * bayerStep;
+    const uint8_t *r4 = bayer + 4 * bayerStep;
+    int n;
+
+    for (n = 0; n + 16 <= pairs; n += 16, r0 += 32, r1 += 32, r2 += 32,
+             r3 += 32, r4 += 32, rgb += 96) {
+        __m256i v;
+        __m256i r0_2, r0_3, r1_1, r1_2, r1_3, r1_4, r2_0, r2_1, r2_2, r2_3;
+        __m256i r2_4, r2_5, r3_1, r3_2, r3_3, r3_4, r4_2, r4_3;
+        __m256i cross, side, t0, t1, c0, c1, c2, d0, d1, d2;
+
+        v = LOAD256 (r0 + 2); r0_2 = EVEN8_256 (v); r0_3 = ODD8_256 (v);
+        v = LOAD256 (r1 + 1); r1_1 = EVEN8_256 (v); r1_2 = ODD8_256 (v);
+        v = LOAD256 (r1 + 3); r1_3 = EVEN8_256 (v); r1_4 = ODD8_256 (v);
+        v = LOAD256 (r2);     r2_0 = EVEN8_256 (v); r2_1 = ODD8_256 (v);
+        v = LOAD256 (r2 + 2); r2_2 = EVEN8_256 (v); r2_3 = ODD8_256 (v);
+        v = LOAD256 (r2 + 4); r2_4 = EVEN8_256 (v); r2_5 = ODD8_256 (v);
+        v = LOAD256 (r3 + 1); r3_1 = EVEN8_256 (v); r3_2 = ODD8_256 (v);
+        v = LOAD256 (r3 + 3); r3_3 = EVEN8_256 (v); r3_4 = ODD8_256 (v);
+        v = LOAD256 (r4 + 2); r4_2 = EVEN8_256 (v); r4_3 = ODD8_256 (v);
+
+        /* first pixel: R or B site */
+        c2 = r2_2;
+        cross = _mm256_add_epi16 (_mm256_add_epi16 (r0_2, r2_0),
+                                  _mm256_add_epi16 (r2_4, r4_2));
+        t0 = _mm256_slli_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (r1_1, r1_3),
+                                                  _mm256_add_epi16 (r3_1, r3_3)), 1);
+        v = _mm256_add_epi16 (_mm256_add_epi16 (cross, cross), cross);
+        t0 = _mm256_sub_epi16 (t0, _mm256_srli_epi16 (_mm256_add_epi16 (v, one), 1));
+        v = _mm256_add_epi16 (c2, _mm256_add_epi16 (c2, c2));
+        t0 = _mm256_add_epi16 (t0, _mm256_add_epi16 (v, v));
+        t1 = _mm256_slli_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (r1_2, r2_1),
+                                                  _mm256_add_epi16 (r2_3, r3_2)), 1);
+        t1 = _mm256_sub_epi16 (t1, cross);
+        t1 = _mm256_add_epi16 (t1, _mm256_slli_epi16 (c2, 2));
+        t0 = _mm256_srai_epi16 (_mm256_add_epi16 (t0, four), 3);
+        c0 = _mm256_min_epi16 (_mm256_max_epi16 (t0, zero), max);
+        t1 = _mm256_srai_epi16 (_mm256_add_epi16 (t1, four), 3);
+        c1 = _mm256_min_epi16 (_mm256_max_epi16 (t1, zero), max);
+
+        /* second pixel: green site */
+        d1 = r2_3;
+        side = _mm256_add_epi16 (_mm256_add_epi16 (r1_2, r1_4),
+                                 _mm256_add_epi16 (r3_2, r3_4));
+        v = _mm256_add_epi16 (_mm256_slli_epi16 (d1, 2), d1);
+        t0 = _mm256_add_epi16 (v, _mm256_slli_epi16 (_mm256_add_epi16 (r1_3, r3_3), 2));
+        t0 = _mm256_sub_epi16 (t0, _mm256_add_epi16 (_mm256_add_epi16 (r0_3, r4_3), side));
+        t0 = _mm256_add_epi16 (t0, _mm256_avg_epu16 (r2_1, r2_5));
+        t1 = _mm256_add_epi16 (v, _mm256_slli_epi16 (_mm256_add_epi16 (r2_2, r2_4), 2));
+        t1 = _mm256_sub_epi16 (t1, _mm256_add_epi16 (_mm256_add_epi16 (r2_1, r2_5), side));
+        t1 = _mm256_add_epi16 (t1, _mm256_avg_epu16 (r0_3, r4_3));
+        t0 = _mm256_srai_epi16 (_mm256_add_epi16 (t0, four), 3);
+        d0 = _mm256_min_epi16 (_mm256_max_epi16 (t0, zero), max);
+        t1 = _mm256_srai_epi16 (_mm256_add_epi16 (t1, four), 3);
+        d2 = _mm256_min_epi16 (_mm256_max_epi16 (t1, zero), max);
+
+        emit_rgb8 (rgb, LO (c0), LO (c1), LO (c2), LO (d0), LO (d1), LO (d2), blue);
+        emit_rgb8 (rgb + 48, HI (c0), HI (c1), HI (c2), HI (d0), HI (d1), HI (d2), blue);
+    }
+    return n;
+}
+
+static AVX2 int
+hqlinear_uint16_avx2 (const uint16_t *bayer, uint16_t *rgb, int bayerStep,
+                      int pairs, int blue, int bits)
+{
+    const __m256i max = _mm256_set1_epi32 ((1 << bits) - 1);
+    const __m256i one = _mm256_set1_epi32 (1);
+    const __m256i four = _mm256_set1_epi32 (4);
+    const uint16_t *r0 = bayer;
+    const uint16_t *r1 = bayer + bayerStep;
+    const uint16_t *r2 = bayer + 2 * bayerStep;
+    const uint16_t *r3 = bayer + 3 * bayerStep;
+    const uint16_t *r4 = bayer + 4 * bayerStep;
+    int n;
+
+    for (n = 0; n + 8 <= pairs; n += 8, r0 += 16, r1 += 16, r2 += 16,
+             r3 += 16, r4 += 16, rgb += 48) {
+        __m256i v;
+        __m256i r0_2, r0_3, r1_1, r1_2, r1_3, r1_4, r2_0, r2_1, r2_2, r2_3;
+        __m256i r2_4, r2_5, r3_1, r3_2, r3_3, r3_4, r4_2, r4_3;
+        __m256i cross, side, t0, t1, c0, c1, c2, d0, d1, d2;
+
+        v = LOAD256 (r0 + 2); r0_2 = EVEN16_256 (v); r0_3 = ODD16_256 (v);
+        v = LOAD256 (r1 + 1); r1_1 = EVEN16_256 (v); r1_2 = ODD16_256 (v);
+        v = LOAD256 (r1 + 3); r1_3 = EVEN16_256 (v); r1_4 = ODD16_256 (v);
+        v = LOAD256 (r2);     r2_0 = EVEN16_256 (v); r2_1 = ODD16_256 (v);
+        v = LOAD256 (r2 + 2); r2_2 = EVEN16_256 (v); r2_3 = ODD16_256 (v);
+        v = LOAD256 (r2 + 4); r2_4 = EVEN16_256 (v); r2_5 = ODD16_256 (v);
+        v = LOAD256 (r3 + 1); r3_1 = EVEN16_256 (v); r3_2 = ODD16_256 (v);
+        v = LOAD256 (r3 + 3); r3_3 = EVEN16_256 (v); r3_4 = ODD16_256 (v);
+        v = LOAD256 (r4 + 2); r4_2 = EVEN16_256 (v); r4_3 = ODD16_256 (v);
+
+        /* first pixel: R or B site */
+        c2 = r2_2;
+        cross = _mm256_add_epi32 (_mm256_add_epi32 (r0_2, r2_0),
+                                  _mm256_add_epi32 (r2_4, r4_2));
+        t0 = _mm256_slli_epi32 (_mm256_add_epi32 (_mm256_add_epi32 (r1_1, r1_3),
+                                                  _mm256_add_epi32 (r3_1, r3_3)), 1);
+        v = _mm256_add_epi32 (_mm256_add_epi32 (cross, cross), cross);
+        t0 = _mm256_sub_epi32 (t0, _mm256_srli_epi32 (_mm256_add_epi32 (v, one), 1));
+        v = _mm256_add_epi32 (c2, _mm256_add_epi32 (c2, c2));
+        t0 = _mm256_add_epi32 (t0, _mm256_add_epi32 (v, v));
+        t1 = _mm256_slli_epi32 (_mm256_add_epi32 (_mm256_add_epi32 (r1_2, r2_1),
+                                                  _mm256_add_epi32 (r2_3, r3_2)), 1);
+        t1 = _mm256_sub_epi32 (t1, cross);
+        t1 = _mm256_add_epi32 (t1, _mm256_slli_epi32 (c2, 2));
+        c0 = clip_s32_256 (_mm256_srai_epi32 (_mm256_add_epi32 (t0, four), 3), max);
+        c1 = clip_s32_256 (_mm256_srai_epi32 (_mm256_add_epi32 (t1, four), 3), max);
+
+        /* second pixel: green site */
+        d1 = r2_3;
+        side = _mm256_add_epi32 (_mm256_add_epi32 (r1_2, r1_4),
+                                 _mm256_add_epi32 (r3_2, r3_4));
+        v = _mm256_add_epi32 (_mm256_slli_epi32 (d1, 2), d1);
+        t0 = _mm256_add_epi32 (v, _mm256_slli_epi32 (_mm256_add_epi32 (r1_3, r3_3), 2));
+        t0 = _mm256_sub_epi32 (t0, _mm256_add_epi32 (_mm256_add_epi32 (r0_3, r4_3), side));
+        t0 = _mm256_add_epi32 (t0, _mm256_srli_epi32 (
+                                  _mm256_add_epi32 (_mm256_add_epi32 (r2_1, r2_5), one), 1));
+        t1 = _mm256_add_epi32 (v, _mm256_slli_epi32 (_mm256_add_epi32 (r2_2, r2_4), 2));
+        t1 = _mm256_sub_epi32 (t1, _mm256_add_epi32 (_mm256_add_epi32 (r2_1, r2_5), side));
+        t1 = _mm256_add_epi32 (t1, _mm256_srli_epi32 (
+                                  _mm256_add_epi32 (_mm256_add_epi32 (r0_3, r4_3), one), 1));
+        d0 = clip_s32_256 (_mm256_srai_epi32 (_mm256_add_epi32 (t0, four), 3), max);
+        d2 = clip_s32_256 (_mm256_srai_epi32 (_mm256_add_epi32 (t1, four), 3), max);
+
+        emit_rgb16 (rgb, LO (c0), LO (c1), LO (c2), LO (d0), LO (d1), LO (d2), blue);
+        emit_rgb16 (rgb + 24, HI (c0), HI (c1), HI (c2), HI (d0), HI (d1), HI (d2), blue);
+    }
+    return n;
+}
+
+const simd_dispatch_t simd_avx2 = {
+    "avx2",
+    bilinear_avx2,
+    bilinear_uint16_avx2,
+    hqlinear_avx2,
+    hqlinear_uint16_avx2,
+    yuv422_rgb8_avx2,
+    yuv411_rgb8_ssse3,
+    yuv444_rgb8_ssse3,
+    yuv422_planar_sse2,
+};
+
+#endif /* DC1394_SIMD_X86 */
+
+#ifdef DC1394_SIMD_NEON
+
+/**********************************************************************
+ *  NEON                                                              *
+ **********************************************************************/
+
+static inline void
+emit_rgb16_neon (uint16_t *rgb, uint16x4_t c0, uint16x4_t c1, uint16x4_t c2,
+                 uint16x4_t d0, uint16x4_t d1, uint16x4_t d2, int blue)
+{
+    uint16x8x3_t px;
+    uint16x4x2_t z;
+
+    if (blue < 0) {
+        uint16x4_t t;
+        t = c0; c0 = c2; c2 = t;
+        t = d0; d0 = d2; d2 = t;
+    }
+    z = vzip_u16 (c0, d0);
+    px.val[0] = vcombine_u16 (z.val[0], z.val[1]);
+    z = vzip_u16 (c1, d1);
+    px.val[1] = vcombine_u16 (z.val[0], z.val[1]);
+    z = vzip_u16 (c2, d2);
+    px.val[2] = vcombine_u16 (z.val[0], z.val[1]);
+    vst3q_u16 (rgb, px);
+}
+
+static int
+bilinear_neon (const uint8_t *bayer, uint8_t *rgb, int bayerStep,
+               int pairs, int blue)
+{
+    int n;
+
+    for (n = 0; n + 8 <= pairs; n += 8, bayer += 16, rgb += 48) {
+        uint8x8x2_t a = vld2_u8 (bayer);
+        uint8x8x2_t b = vld2_u8 (bayer + 2);
+        uint8x8x2_t c = vld2_u8 (bayer + bayerStep);
+        uint8x8x2_t d = vld2_u8 (bayer + bayerStep + 2);
+        uint8x8x2_t e = vld2_u8 (bayer + 2 * bayerStep);
+        uint8x8x2_t f = vld2_u8 (bayer + 2 * bayerStep + 2);
+        uint8x8_t c0, c1, d0, d2;
+
+        c0 = vrshrn_n_u16 (vaddq_u16 (vaddl_u8 (a.val[0], b.val[0]),
+                                      vaddl_u8 (e.val[0], f.val[0])), 2);
+        c1 = vrshrn_n_u16 (vaddq_u16 (vaddl_u8 (a.val[1], c.val[0]),
+                                      vaddl_u8 (d.val[0], e.val[1])), 2);
+        d0 = vrhadd_u8 (b.val[0], f.val[0]);
+        d2 = vrhadd_u8 (c.val[1], d.val[1]);
+
+        emit_rgb8_neon (rgb, c0, c1, c.val[1], d0, d.val[0], d2, blue);
+    }
+    return n;
+}
+
+static int
+bilinear_uint16_neon (const uint16_t *bayer, uint16_t *rgb, int bayerStep,
+                      int pairs, int blue, int bits)
+{
+    int n;
+
+    for (n = 0; n + 4 <= pairs; n += 4, bayer += 8, rgb += 24) {
+        uint16x4x2_t a = vld2_u16 (bayer);
+        uint16x4x2_t b = vld2_u16 (bayer + 2);
+        uint16x4x2_t c = vld2_u16 (bayer + bayerStep);
+        uint16x4x2_t d = vld2_u16 (bayer + bayerStep + 2);
+        uint16x4x2_t e = vld2_u16 (bayer + 2 * bayerStep);
+        uint16x4x2_t f = vld2_u16 (bayer + 2 * bayerStep + 2);
+        uint16x4_t c0, c1, d0, d2;
+
+        c0 = vrshrn_n_u32 (vaddq_u32 (vaddl_u16 (a.val[0], b.val[0]),
+                                      vaddl_u16 (e.val[0], f.val[0])), 2);
+        c1 = vrshrn_n_u32 (vaddq_u32 (vaddl_u16 (a.val[1], c.val[0]),
+                                      vaddl_u16 (d.val[0], e.val[1])), 2);
+        d0 = vrhadd_u16 (b.val[0], f.val[0]);
+        d2 = vrhadd_u16 (c.val[1], d.val[1]);
+
+        emit_rgb16_neon (rgb, c0, c1, c.val[1], d0, d.val[0], d2, blue);
+    }
+    return n;
+}
+
+#define S16(v)  vreinterpretq_s16_u16 (vmovl_u8 (v))
+#define S32(v)  vreinterpretq_s32_u32 (vmovl_u16 (v))
+
+static int
+hqlinear_neon (const uint8_t *bayer, uint8_t *rgb, int bayerStep,
+               int pairs, int blue)
+{
+    const uint8_t *r0 = bayer;
+    const uint8_t *r1 = bayer + bayerStep;
+    const uint8_t *r2 = bayer + 2 * bayerStep;
+    const uint8_t *r3 = bayer + 3 * bayerStep;
+    const uint8_t *r4 = bayer + 4 * bayerStep;
+    int n;
+
+    for (n = 0; n + 8 <= pairs; n += 8, r0 += 16, r1 += 16, r2 += 16,
+             r3 += 16, r4 += 16, rgb += 48) {
+        uint8x8x2_t v0 = vld2_u8 (r0 + 2);
+        uint8x8x2_t v1 = vld2_u8 (r1 + 1);
+        uint8x8x2_t v2 = vld2_u8 (r1 + 3);
+        uint8x8x2_t v3 = vld2_u8 (r2);
+        uint8x8x2_t v4 = vld2_u8 (r2 + 2);
+        uint8x8x2_t v5 = vld2_u8 (r2 + 4);
+        uint8x8x2_t v6 = vld2_u8 (r3 + 1);
+        uint8x8x2_t v7 = vld2_u8 (r3 + 3);
+        uint8x8x2_t v8 = vld2_u8 (r4 + 2);
+        int16x8_t r1_2 = S16 (v1.val[1]), r1_4 = S16 (v2.val[1]);
+        int16x8_t r2_1 = S16 (v3.val[1]), r2_2 = S16 (v4.val[0]);
+        int16x8_t r2_4 = S16 (v5.val[0]), r2_5 = S16 (v5.val[1]);
+        int16x8_t r3_2 = S16 (v6.val[1]), r3_4 = S16 (v7.val[1]);
+        int16x8_t c2, d1, cross, side, t0, t1;
+        uint8x8_t c0, c1, d0, d2;
+
+        /* first pixel: R or B site */
+        c2 = r2_2;
+        cross = vaddq_s16 (vaddq_s16 (S16 (v0.val[0]), S16 (v3.val[0])),
+                           vaddq_s16 (r2_4, S16 (v8.val[0])));
+        t0 = vshlq_n_s16 (vaddq_s16 (vaddq_s16 (S16 (v1.val[0]), S16 (v2.val[0])),
+                                     vaddq_s16 (S16 (v6.val[0]), S16 (v7.val[0]))), 1);
+        t0 = vsubq_s16 (t0, vshrq_n_s16 (vaddq_s16 (vmulq_n_s16 (cross, 3),
+                                                    vdupq_n_s16 (1)), 1));
+        t0 = vmlaq_n_s16 (t0, c2, 6);
+        t1 = vshlq_n_s16 (vaddq_s16 (vaddq_s16 (r1_2, r2_1),
+                                     vaddq_s16 (S16 (v4.val[1]), r3_2)), 1);
+        t1 = vsubq_s16 (t1, cross);
+        t1 = vaddq_s16 (t1, vshlq_n_s16 (c2, 2));
+        c0 = vqmovun_s16 (vrshrq_n_s16 (t0, 3));
+        c1 = vqmovun_s16 (vrshrq_n_s16 (t1, 3));
+
+        /* second pixel: green site */
+        d1 = S16 (v4.val[1]);
+        side = vaddq_s16 (vaddq_s16 (r1_2, r1_4), vaddq_s16 (r3_2, r3_4));
+        t0 = vmlaq_n_s16 (vshlq_n_s16 (vaddq_s16 (S16 (v2.val[0]),
+                                                  S16 (v7.val[0])), 2), d1, 5);
+        t0 = vsubq_s16 (t0, vaddq_s16 (vaddq_s16 (S16 (v0.val[1]),
+                                                  S16 (v8.val[1])), side));
+        t0 = vaddq_s16 (t0, S16 (vrhadd_u8 (v3.val[1], v5.val[1])));
+        t1 = vmlaq_n_s16 (vshlq_n_s16 (vaddq_s16 (r2_2, r2_4), 2), d1, 5);
+        t1 = vsubq_s16 (t1, vaddq_s16 (vaddq_s16 (r2_1, r2_5), side));
+        t1 = vaddq_s16 (t1, S16 (vrhadd_u8 (v0.val[1], v8.val[1])));
+        d0 = vqmovun_s16 (vrshrq_n_s16 (t0, 3));
+        d2 = vqmovun_s16 (vrshrq_n_s16 (t1, 3));
+
+        emit_rgb8_neon (rgb, c0, c1, v4.val[0], d0, v4.val[1], d2, blue);
+    }
+    return n;
+}
+
+static int
+hqlinear_uint16_neon (const uint16_t *bayer, uint16_t *rgb, int bayerStep,
+                      int pairs, int blue, int bits)
+{
+    const int32x4_t zero = vdupq_n_s32 (0);
+    const int32x4_t max = vdupq_n_s32 ((1 << bits) - 1);
+    const uint16_t *r0 = bayer;
+    const uint16_t *r1 = bayer + bayerStep;
+    const uint16_t *r2 = bayer + 2 * bayerStep;
+    const uint16_t *r3 = bayer + 3 * bayerStep;
+    const uint16_t *r4 = bayer + 4 * bayerStep;
+    int n;
+
+    for (n = 0; n + 4 <= pairs; n += 4, r0 += 8, r1 += 8, r2 += 8,
+             r3 += 8, r4 += 8, rgb += 24) {
+        uint16x4x2_t v0 = vld2_u16 (r0 + 2);
+        uint16x4x2_t v1 = vld2_u16 (r1 + 1);
+        uint16x4x2_t v2 = vld2_u16 (r1 + 3);
+        uint16x4x2_t v3 = vld2_u16 (r2);
+        uint16x4x2_t v4 = vld2_u16 (r2 + 2);
+        uint16x4x2_t v5 = vld2_u16 (r2 + 4);
+        uint16x4x2_t v6 = vld2_u16 (r3 + 1);
+        uint16x4x2_t v7 = vld2_u16 (r3 + 3);
+        uint16x4x2_t v8 = vld2_u16 (r4 + 2);
+        int32x4_t r1_2 = S32 (v1.val[1]), r1_4 = S32 (v2.val[1]);
+        int32x4_t r2_1 = S32 (v3.val[1]), r2_2 = S32 (v4.val[0]);
+        int32x4_t r2_4 = S32 (v5.val[0]), r2_5 = S32 (v5.val[1]);
+        int32x4_t r3_2 = S32 (v6.val[1]), r3_4 = S32 (v7.val[1]);
+        int32x4_t c2, d1, cross, side, t0, t1;
+        uint16x4_t c0, c1, d0, d2;
+
+        /* first pixel: R or B site */
+        c2 = r2_2;
+        cross = vaddq_s32 (vaddq_s32 (S32 (v0.val[0]), S32 (v3.val[0])),
+                           vaddq_s32 (r2_4, S32 (v8.val[0])));
+        t0 = vshlq_n_s32 (vaddq_s32 (vaddq_s32 (S32 (v1.val[0]), S32 (v2.val[0])),
+                                     vaddq_s32 (S32 (v6.val[0]), S32 (v7.val[0]))), 1);
+        t0 = vsubq_s32 (t0, vshrq_n_s32 (vaddq_s32 (vmulq_n_s32 (cross, 3),
+                                                    vdupq_n_s32 (1)), 1));
+        t0 = vmlaq_n_s32 (t0, c2, 6);
+        t1 = vshlq_n_s32 (vaddq_s32 (vaddq_s32 (r1_2, r2_1),
+                                     vaddq_s32 (S32 (v4.val[1]), r3_2)), 1);
+        t1 = vsubq_s32 (t1, cross);
+        t1 = vaddq_s32 (t1, vshlq_n_s32 (c2, 2));
+        t0 = vminq_s32 (vmaxq_s32 (vrshrq_n_s32 (t0, 3), zero), max);
+        t1 = vminq_s32 (vmaxq_s32 (vrshrq_n_s32 (t1, 3), zero), max);
+        c0 = vmovn_u32 (vreinterpretq_u32_s32 (t0));
+        c1 = vmovn_u32 (vreinterpretq_u32_s32 (t1));
+
+        /* second pixel: green site */
+        d1 = S32 (v4.val[1]);
+        side = vaddq_s32 (vaddq_s32 (r1_2, r1_4), vaddq_s32 (r3_2, r3_4));
+        t0 = vmlaq_n_s32 (vshlq_n_s32 (vaddq_s32 (S32 (v2.val[0]),
+                                                  S32 (v7.val[0])), 2), d1, 5);
+        t0 = vsubq_s32 (t0, vaddq_s32 (vaddq_s32 (S32 (v0.val[1]),
+                                                  S32 (v8.val[1])), side));
+        t0 = vaddq_s32 (t0, S32 (vrhadd_u16 (v3.val[1], v5.val[1])));
+        t1 = vmlaq_n_s32 (vshlq_n_s32 (vaddq_s32 (r2_2, r2_4), 2), d1, 5);
+        t1 = vsubq_s32 (t1, vaddq_s32 (vaddq_s32 (r2_1, r2_5), side));
+        t1 = vaddq_s32 (t1, S32 (vrhadd_u16 (v0.val[1], v8.val[1])));
+        t0 = vminq_s32 (vmaxq_s32 (vrshrq_n_s32 (t0, 3), zero), max);
+        t1 = vminq_s32 (vmaxq_s32 (vrshrq_n_s32 (t1, 3), zero), max);
+        d0 = vmovn_u32 (vreinterpretq_u32_s32 (t0));
+        d2 = vmovn_u32 (vreinterpretq_u32_s32 (t1));
+
+        emit_rgb16_neon (rgb, c0, c1, v4.val[0], d0, v4.val[1], d2, blue);
+    }
+    return n;
+}
+
+const simd_dispatch_t simd_neon = {
+    "neon",
+    bilinear_neon,
+    bilinear_uint16_neon,
+    hqlinear_neon,
+    hqlinear_uint16_neon,
+    yuv422_rgb8_neon,
+    yuv411_rgb8_neon,
+    yuv444_rgb8_neon,
+    yuv422_planar_neon,
+};
+
+#endif /* DC1394_SIMD_NEON */
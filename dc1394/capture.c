@@ -19,10 +19,278 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
 
 #include "control.h"
 #include "platform.h"
 #include "internal.h"
+#include "register.h"
+#include "utils.h"
+
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+
+/* the cycles of an iso_cycle, which wrap every 8 seconds */
+#define ISO_CYCLES(c) ((((c) >> 13) & 0x7) * 8000 + ((c) & 0x1fff))
+
+void
+capture_update_frame_interval (dc1394camera_t * camera)
+{
+    dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
+    dc1394video_mode_t mode;
+    dc1394framerate_t framerate;
+    uint64_t interval = 0;
+    float rate;
+
+    if (dc1394_video_get_mode (camera, &mode) == DC1394_SUCCESS &&
+            !dc1394_is_video_mode_scalable (mode) &&
+            dc1394_video_get_framerate (camera, &framerate) == DC1394_SUCCESS &&
+            dc1394_framerate_as_float (framerate, &rate) == DC1394_SUCCESS && rate > 0)
+        interval = 1000000 / rate + 0.5;
+    __atomic_store_n (&cpriv->frame_interval, interval, __ATOMIC_RELAXED);
+}
+
+/* the state of the trigger and the shots when the capture starts */
+static void
+read_trigger (dc1394camera_priv_t * cpriv)
+{
+    dc1394camera_t * camera = &cpriv->camera;
+    uint32_t value;
+
+    /* read directly: cameras without a trigger or one-shot log no errors */
+    __atomic_store_n (&cpriv->trigger_on,
+            dc1394_get_control_register (camera, REG_CAMERA_TRIGGER_MODE, &value) == DC1394_SUCCESS &&
+            (value & 0x02000000UL), __ATOMIC_RELAXED);
+    __atomic_store_n (&cpriv->shots_on,
+            dc1394_get_control_register (camera, REG_CAMERA_ONE_SHOT, &value) == DC1394_SUCCESS &&
+            (value & 0xC0000000UL), __ATOMIC_RELAXED);
+}
+
+/*
+  The setters of the camera tell the capture what they wrote, so that no
+  register is read again per shot. Outside of a capture, the setup reads
+  the registers.
+*/
+void
+capture_set_trigger (dc1394camera_t * camera, int on)
+{
+    dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
+
+    if (__atomic_load_n (&cpriv->capture_is_set, __ATOMIC_ACQUIRE))
+        __atomic_store_n (&cpriv->trigger_on, on, __ATOMIC_RELAXED);
+}
+
+void
+capture_set_shots (dc1394camera_t * camera, int on)
+{
+    dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
+
+    if (__atomic_load_n (&cpriv->capture_is_set, __ATOMIC_ACQUIRE))
+        __atomic_store_n (&cpriv->shots_on, on, __ATOMIC_RELAXED);
+}
+
+/* the transmission starts: continuous, and after a pause that drops nothing */
+void
+capture_restart (dc1394camera_t * camera)
+{
+    dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
+
+    if (__atomic_load_n (&cpriv->capture_is_set, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n (&cpriv->shots_on, 0, __ATOMIC_RELAXED);
+        __atomic_store_n (&cpriv->restarted, 1, __ATOMIC_RELEASE);
+    }
+}
+
+#ifdef HAVE_POLL_H
+int
+capture_wait_readable (int fd, uint32_t timeout_us)
+{
+    struct pollfd fds[1];
+    struct timespec deadline, now;
+    int64_t left_us;
+    int err;
+
+    clock_gettime (CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_us / 1000000;
+    deadline.tv_nsec += (timeout_us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    for (;;) {
+        /* poll() counts in milliseconds: round up, not to return early */
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        left_us = (deadline.tv_sec - now.tv_sec) * 1000000LL
+            + (deadline.tv_nsec - now.tv_nsec) / 1000;
+        err = poll (fds, 1, left_us > 0 ? (left_us + 999) / 1000 : 0);
+        if (err >= 0)
+            return err > 0;
+        if (errno != EINTR)
+            return -1;
+    }
+}
+#endif
+
+/*
+  Numbers a frame taken from the backend and counts it, as dequeued or as
+  skipped by DC1394_CAPTURE_POLICY_LATEST. The frames missing before it are
+  the number of frame intervals in the gap since the last frame, less one.
+  The interval comes from the framerate, or is the shortest gap seen in
+  scalable modes. Triggered frames come at any time, and the transmission
+  may have paused before the first frame after it restarts: none are
+  counted missing then.
+*/
+static void
+account_frame (dc1394camera_priv_t * cpriv, dc1394video_frame_t * frame, int skipped)
+{
+    const platform_dispatch_t * d = cpriv->platform->dispatch;
+    dc1394capture_stats_t * stats = &cpriv->capture_stats;
+    uint64_t gap = 0, interval, steps = 1;
+    int restarted = __atomic_exchange_n (&cpriv->restarted, 0, __ATOMIC_ACQ_REL);
+
+    frame->references = 1;
+
+    if (cpriv->sequenced && !restarted &&
+            !__atomic_load_n (&cpriv->trigger_on, __ATOMIC_RELAXED) &&
+            !__atomic_load_n (&cpriv->shots_on, __ATOMIC_RELAXED)) {
+        if (frame->iso_cycle && cpriv->last_cycle &&
+                frame->timestamp - cpriv->last_timestamp < 4000000)
+            gap = (uint64_t) ((ISO_CYCLES (frame->iso_cycle) + 64000 -
+                        ISO_CYCLES (cpriv->last_cycle)) % 64000) * 125;
+        else if (frame->timestamp > cpriv->last_timestamp)
+            gap = frame->timestamp - cpriv->last_timestamp;
+
+        interval = __atomic_load_n (&cpriv->frame_interval, __ATOMIC_RELAXED);
+        if (!interval && gap) {
+            if (!cpriv->min_frame_interval || gap < cpriv->min_frame_interval)
+                cpriv->min_frame_interval = gap;
+            interval = cpriv->min_frame_interval;
+        }
+        if (interval) {
+            steps = (gap + interval / 2) / interval;
+            if (steps < 1)
+                steps = 1;
+        }
+    }
+    frame->sequence = cpriv->sequenced ? cpriv->last_sequence + steps : 0;
+    cpriv->sequenced = 1;
+    cpriv->last_sequence = frame->sequence;
+    cpriv->last_timestamp = frame->timestamp;
+    cpriv->last_cycle = frame->iso_cycle;
+
+    /* other threads read the counters at any time */
+    if (skipped)
+        __atomic_add_fetch (&stats->dropped, steps, __ATOMIC_RELAXED);
+    else {
+        __atomic_add_fetch (&stats->frames, 1, __ATOMIC_RELAXED);
+        if (steps > 1)
+            __atomic_add_fetch (&stats->dropped, steps - 1, __ATOMIC_RELAXED);
+        if (d->capture_is_frame_corrupt &&
+                d->capture_is_frame_corrupt (cpriv->pcam, frame))
+            __atomic_add_fetch (&stats->corrupt, 1, __ATOMIC_RELAXED);
+    }
+    if (frame->frames_behind + 1 >= cpriv->capture_buffers)
+        __atomic_add_fetch (&stats->overruns, 1, __ATOMIC_RELAXED);
+}
+
+static void
+lock_held (dc1394camera_priv_t * cpriv)
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock (&cpriv->held_mutex);
+#endif
+}
+
+static void
+unlock_held (dc1394camera_priv_t * cpriv)
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock (&cpriv->held_mutex);
+#endif
+}
+
+/* notes a frame given to the user */
+static void
+hold_frame (dc1394camera_priv_t * cpriv, dc1394video_frame_t * frame)
+{
+    capture_held_t * h;
+
+    lock_held (cpriv);
+    if (cpriv->held && cpriv->num_held < cpriv->capture_buffers) {
+        h = cpriv->held + (cpriv->first_held + cpriv->num_held) % cpriv->capture_buffers;
+        h->frame = frame;
+        h->released = 0;
+        cpriv->num_held++;
+    }
+    else
+        dc1394_log_warning ("Capture: more frames dequeued than buffers");
+    unlock_held (cpriv);
+}
+
+/*
+  Gives a frame back to the backend. The backends queue their buffers again
+  in the order they are given back, and expect that order to be the one in
+  which they were filled: a frame released before older ones waits for
+  them. Frames the user did not dequeue go to the backend at once, which
+  refuses those it did not give.
+*/
+static dc1394error_t
+release_frame (dc1394camera_priv_t * cpriv, dc1394video_frame_t * frame)
+{
+    const platform_dispatch_t * d = cpriv->platform->dispatch;
+    dc1394error_t err = DC1394_SUCCESS, e;
+    capture_held_t * h = NULL;
+    uint32_t i;
+
+    lock_held (cpriv);
+    for (i = 0; i < cpriv->num_held; i++) {
+        h = cpriv->held + (cpriv->first_held + i) % cpriv->capture_buffers;
+        if (h->frame == frame && !h->released)
+            break;
+    }
+    if (i == cpriv->num_held) {
+        unlock_held (cpriv);
+        return d->capture_enqueue (cpriv->pcam, frame);
+    }
+
+    h->released = 1;
+    while (cpriv->num_held > 0) {
+        h = cpriv->held + cpriv->first_held;
+        if (!h->released)
+            break;
+        e = d->capture_enqueue (cpriv->pcam, h->frame);
+        if (e != DC1394_SUCCESS && err == DC1394_SUCCESS)
+            err = e;
+        cpriv->first_held = (cpriv->first_held + 1) % cpriv->capture_buffers;
+        cpriv->num_held--;
+    }
+    unlock_held (cpriv);
+    return err;
+}
+
+/* whether the user holds a frame: dequeued and not released */
+static int
+frame_held (dc1394camera_priv_t * cpriv, dc1394video_frame_t * frame)
+{
+    capture_held_t * h;
+    uint32_t i;
+    int held = 0;
+
+    lock_held (cpriv);
+    for (i = 0; i < cpriv->num_held && !held; i++) {
+        h = cpriv->held + (cpriv->first_held + i) % cpriv->capture_buffers;
+        held = h->frame == frame && !h->released;
+    }
+    unlock_held (cpriv);
+    return held;
+}
 
 dc1394error_t
 dc1394_capture_setup (dc1394camera_t *camera, uint32_t num_dma_buffers,
@@ -30,9 +298,60 @@ dc1394_capture_setup (dc1394camera_t *camera, uint32_t num_dma_buffers,
 {
     dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
     const platform_dispatch_t * d = cpriv->platform->dispatch;
+    dc1394error_t err;
     if (!d->capture_setup)
         return DC1394_FUNCTION_NOT_SUPPORTED;
-    return d->capture_setup (cpriv->pcam, num_dma_buffers, flags);
+    err = d->capture_setup (cpriv->pcam, num_dma_buffers, flags);
+    if (err != DC1394_SUCCESS)
+        return err;
+
+    lock_held (cpriv);
+    free (cpriv->held);
+    cpriv->held = calloc (num_dma_buffers, sizeof (capture_held_t));
+    cpriv->first_held = 0;
+    cpriv->num_held = 0;
+    unlock_held (cpriv);
+    if (!cpriv->held) {
+        d->capture_stop (cpriv->pcam);
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+    }
+
+    memset (&cpriv->capture_stats, 0, sizeof cpriv->capture_stats);
+    cpriv->capture_buffers = num_dma_buffers;
+    cpriv->min_frame_interval = 0;
+    cpriv->sequenced = 0;
+    cpriv->restarted = 0;
+    capture_update_frame_interval (camera);
+    read_trigger (cpriv);
+    __atomic_store_n (&cpriv->capture_is_set, 1, __ATOMIC_RELEASE);
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_capture_set_buffer (dc1394camera_t *camera, void *buffer, size_t size)
+{
+    dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
+    const platform_dispatch_t * d = cpriv->platform->dispatch;
+    if (!d->capture_set_buffer)
+        return DC1394_FUNCTION_NOT_SUPPORTED;
+    if (buffer && (uintptr_t) buffer % DC1394_CAPTURE_BUFFER_ALIGN)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    return d->capture_set_buffer (cpriv->pcam, buffer, size);
+}
+
+dc1394error_t
+dc1394_capture_get_buffer_size (dc1394camera_t *camera, uint32_t num_dma_buffers,
+        uint64_t *size)
+{
+    dc1394video_frame_t frame;
+    dc1394error_t err;
+
+    if (!size || num_dma_buffers == 0)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    err = capture_basic_setup (camera, &frame);
+    DC1394_ERR_RTN(err, "Could not get the size of the frames");
+    *size = CAPTURE_FRAME_STRIDE (frame.total_bytes) * num_dma_buffers;
+    return DC1394_SUCCESS;
 }
 
 dc1394error_t
@@ -40,9 +359,18 @@ dc1394_capture_stop (dc1394camera_t *camera)
 {
     dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
     const platform_dispatch_t * d = cpriv->platform->dispatch;
+    dc1394error_t err;
     if (!d->capture_stop)
         return DC1394_FUNCTION_NOT_SUPPORTED;
-    return d->capture_stop (cpriv->pcam);
+    __atomic_store_n (&cpriv->capture_is_set, 0, __ATOMIC_RELEASE);
+    err = d->capture_stop (cpriv->pcam);
+
+    lock_held (cpriv);
+    free (cpriv->held);
+    cpriv->held = NULL;
+    cpriv->num_held = 0;
+    unlock_held (cpriv);
+    return err;
 }
 
 int
@@ -61,9 +389,54 @@ dc1394_capture_dequeue (dc1394camera_t * camera, dc1394capture_policy_t policy,
 {
     dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
     const platform_dispatch_t * d = cpriv->platform->dispatch;
+    dc1394video_frame_t * next;
+    dc1394error_t err;
     if (!d->capture_dequeue)
         return DC1394_FUNCTION_NOT_SUPPORTED;
-    return d->capture_dequeue (cpriv->pcam, policy, frame);
+
+    /* the frames are skipped here rather than by the backend, which would
+       give them back before those the user holds, and uncounted */
+    if (policy == DC1394_CAPTURE_POLICY_LATEST) {
+        err = d->capture_dequeue (cpriv->pcam, DC1394_CAPTURE_POLICY_WAIT, frame);
+        if (err != DC1394_SUCCESS || !*frame)
+            return err;
+        hold_frame (cpriv, *frame);
+        while (1) {
+            err = d->capture_dequeue (cpriv->pcam, DC1394_CAPTURE_POLICY_POLL, &next);
+            if (err != DC1394_SUCCESS || !next)
+                break;
+            hold_frame (cpriv, next);
+            account_frame (cpriv, *frame, 1);
+            release_frame (cpriv, *frame);
+            *frame = next;
+        }
+        account_frame (cpriv, *frame, 0);
+        return DC1394_SUCCESS;
+    }
+
+    err = d->capture_dequeue (cpriv->pcam, policy, frame);
+    if (err == DC1394_SUCCESS && *frame) {
+        hold_frame (cpriv, *frame);
+        account_frame (cpriv, *frame, 0);
+    }
+    return err;
+}
+
+dc1394error_t
+dc1394_capture_dequeue_timeout (dc1394camera_t * camera, uint32_t timeout_us,
+        dc1394video_frame_t **frame)
+{
+    dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
+    const platform_dispatch_t * d = cpriv->platform->dispatch;
+    dc1394error_t err;
+    if (!d->capture_dequeue_timeout)
+        return DC1394_FUNCTION_NOT_SUPPORTED;
+    err = d->capture_dequeue_timeout (cpriv->pcam, timeout_us, frame);
+    if (err == DC1394_SUCCESS && *frame) {
+        hold_frame (cpriv, *frame);
+        account_frame (cpriv, *frame, 0);
+    }
+    return err;
 }
 
 dc1394error_t
@@ -73,7 +446,37 @@ dc1394_capture_enqueue (dc1394camera_t * camera, dc1394video_frame_t * frame)
     const platform_dispatch_t * d = cpriv->platform->dispatch;
     if (!d->capture_enqueue)
         return DC1394_FUNCTION_NOT_SUPPORTED;
-    return d->capture_enqueue (cpriv->pcam, frame);
+    /* the last holder gives the frame back. Frames that were not counted
+       (references is 0) go back at once, which lets the backend refuse
+       those that are not dequeued */
+    if (frame && __atomic_load_n (&frame->references, __ATOMIC_ACQUIRE) > 0 &&
+            __atomic_sub_fetch (&frame->references, 1, __ATOMIC_ACQ_REL) > 0)
+        return DC1394_SUCCESS;
+    return release_frame (cpriv, frame);
+}
+
+dc1394error_t
+dc1394_capture_frame_ref (dc1394video_frame_t * frame)
+{
+    uint32_t references;
+
+    if (!frame || !frame->camera)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    /* the caller holds the frame, so it cannot go back meanwhile. The last
+       holder gives it to release_frame(), which keeps the ring order */
+    references = __atomic_load_n (&frame->references, __ATOMIC_RELAXED);
+    if (references == 0 || !frame_held (DC1394_CAMERA_PRIV (frame->camera), frame))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    __atomic_add_fetch (&frame->references, 1, __ATOMIC_RELAXED);
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_capture_frame_unref (dc1394video_frame_t * frame)
+{
+    if (!frame || !frame->camera)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    return dc1394_capture_enqueue (frame->camera, frame);
 }
 
 dc1394bool_t
@@ -88,3 +491,18 @@ dc1394_capture_is_frame_corrupt (dc1394camera_t * camera,
         return DC1394_FALSE;
     return d->capture_is_frame_corrupt (cpriv->pcam, frame);
 }
+
+dc1394error_t
+dc1394_capture_get_stats (dc1394camera_t * camera, dc1394capture_stats_t * stats)
+{
+    dc1394camera_priv_t * cpriv = DC1394_CAMERA_PRIV (camera);
+    const dc1394capture_stats_t * s = &cpriv->capture_stats;
+
+    if (!stats)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    stats->frames = __atomic_load_n (&s->frames, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n (&s->dropped, __ATOMIC_RELAXED);
+    stats->overruns = __atomic_load_n (&s->overruns, __ATOMIC_RELAXED);
+    stats->corrupt = __atomic_load_n (&s->corrupt, __ATOMIC_RELAXED);
+    return DC1394_SUCCESS;
+}
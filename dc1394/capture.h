@@ -36,14 +36,17 @@
 /**
  * The capture policy.
  *
- * Can be blocking (wait for a frame forever) or polling (returns if no frames is in the ring buffer)
+ * Can be blocking (wait for a frame forever) or polling (returns if no frames is in the ring buffer). The latest
+ * policy waits like the blocking one, then gives the older frames of the ring buffer back and returns the newest.
+ * On Mac OS X and Windows it is the blocking policy.
  */
 typedef enum {
     DC1394_CAPTURE_POLICY_WAIT=672,
-    DC1394_CAPTURE_POLICY_POLL
+    DC1394_CAPTURE_POLICY_POLL,
+    DC1394_CAPTURE_POLICY_LATEST
 } dc1394capture_policy_t;
 #define DC1394_CAPTURE_POLICY_MIN    DC1394_CAPTURE_POLICY_WAIT
-#define DC1394_CAPTURE_POLICY_MAX    DC1394_CAPTURE_POLICY_POLL
+#define DC1394_CAPTURE_POLICY_MAX    DC1394_CAPTURE_POLICY_LATEST
 #define DC1394_CAPTURE_POLICY_NUM   (DC1394_CAPTURE_POLICY_MAX - DC1394_CAPTURE_POLICY_MIN + 1)
 
 /**
@@ -54,6 +57,29 @@ typedef enum {
 #define DC1394_CAPTURE_FLAGS_BANDWIDTH_ALLOC 0x00000002U
 #define DC1394_CAPTURE_FLAGS_DEFAULT         0x00000004U /* a reasonable default value: do bandwidth and channel allocation */
 #define DC1394_CAPTURE_FLAGS_AUTO_ISO        0x00000008U /* automatically start iso before capture and stop it after */
+#define DC1394_CAPTURE_FLAGS_HUGE_PAGES      0x00000010U /* allocate the ring buffer in huge pages where possible (USB only) */
+
+/**
+ * The alignment of the frames in a ring buffer given with dc1394_capture_set_buffer(), and of the buffer itself
+ */
+#define DC1394_CAPTURE_BUFFER_ALIGN          64
+
+/**
+ * The accounting of a capture, since dc1394_capture_setup()
+ */
+typedef struct
+{
+    uint64_t                 frames;                /* the frames dequeued */
+    uint64_t                 dropped;               /* the frames skipped by DC1394_CAPTURE_POLICY_LATEST, and those missing
+                                                       between the frames, from the gaps between their iso cycles or
+                                                       timestamps. The missing frames are not counted while the trigger,
+                                                       one-shot or multi-shot is on, nor when dc1394_video_set_transmission()
+                                                       starts the transmission again */
+    uint64_t                 overruns;              /* the frames dequeued or skipped from a full ring buffer, into which the
+                                                       camera may have had no room to write */
+    uint64_t                 corrupt;               /* the frames dequeued that dc1394_capture_is_frame_corrupt() finds
+                                                       corrupt */
+} dc1394capture_stats_t;
 
 #ifdef __cplusplus
 extern "C" {
@@ -68,6 +94,20 @@ extern "C" {
  */
 dc1394error_t dc1394_capture_setup(dc1394camera_t *camera, uint32_t num_dma_buffers, uint32_t flags);
 
+/**
+ * Makes dc1394_capture_setup() place the ring buffer in the given memory, for instance pinned memory or memory
+ * shared with another process, instead of allocating it. The buffer must be aligned on
+ * DC1394_CAPTURE_BUFFER_ALIGN bytes, hold at least dc1394_capture_get_buffer_size() bytes, and stay valid until
+ * dc1394_capture_stop(). A NULL buffer goes back to the buffers allocated by the library. USB only.
+ */
+dc1394error_t dc1394_capture_set_buffer(dc1394camera_t *camera, void *buffer, size_t size);
+
+/**
+ * Gets the size of the memory needed for a ring buffer of num_dma_buffers frames in the current video mode: the
+ * frames follow each other, each at a multiple of DC1394_CAPTURE_BUFFER_ALIGN bytes.
+ */
+dc1394error_t dc1394_capture_get_buffer_size(dc1394camera_t *camera, uint32_t num_dma_buffers, uint64_t *size);
+
 /**
  * Stop the capture
  */
@@ -85,10 +125,32 @@ int dc1394_capture_get_fileno (dc1394camera_t * camera);
 dc1394error_t dc1394_capture_dequeue(dc1394camera_t * camera, dc1394capture_policy_t policy, dc1394video_frame_t **frame);
 
 /**
- * Returns a frame to the ring buffer once it has been used.
+ * Captures a video frame, waiting for it at most timeout_us microseconds. If no frame came in time, *frame is NULL
+ * and DC1394_SUCCESS is returned, as with DC1394_CAPTURE_POLICY_POLL. Some platforms round the timeout up to the
+ * millisecond. Not supported on Mac OS X and Windows.
+ */
+dc1394error_t dc1394_capture_dequeue_timeout(dc1394camera_t * camera, uint32_t timeout_us, dc1394video_frame_t **frame);
+
+/**
+ * Returns a frame to the ring buffer once it has been used. If the frame has other holders (see
+ * dc1394_capture_frame_ref()), only drops the reference of the caller: the last holder returns it. The frames go
+ * back in the order they were dequeued: a frame returned before older ones waits for them.
  */
 dc1394error_t dc1394_capture_enqueue(dc1394camera_t * camera, dc1394video_frame_t * frame);
 
+/**
+ * Adds a holder to a frame returned by dc1394_capture_dequeue(), so that several threads can use the frame in
+ * place: each of them drops its reference with dc1394_capture_frame_unref() or dc1394_capture_enqueue(), and the
+ * frame goes back to the ring buffer with the last one, once the frames dequeued before it are back too. Must be
+ * called by a holder of the frame. Frames made by the conversion functions cannot be held that way.
+ */
+dc1394error_t dc1394_capture_frame_ref(dc1394video_frame_t * frame);
+
+/**
+ * Drops a reference to a frame, like dc1394_capture_enqueue() on the camera of the frame.
+ */
+dc1394error_t dc1394_capture_frame_unref(dc1394video_frame_t * frame);
+
 /**
  * Returns DC1394_TRUE if the given frame (previously dequeued) has been
  * detected to be corrupt (missing data, corrupted data, overrun buffer, etc.).
@@ -100,6 +162,11 @@ dc1394error_t dc1394_capture_enqueue(dc1394camera_t * camera, dc1394video_frame_
 dc1394bool_t dc1394_capture_is_frame_corrupt (dc1394camera_t * camera,
         dc1394video_frame_t * frame);
 
+/**
+ * Gets the accounting of the capture. Can be called from any thread, while frames are dequeued.
+ */
+dc1394error_t dc1394_capture_get_stats (dc1394camera_t * camera, dc1394capture_stats_t * stats);
+
 #ifdef __cplusplus
 }
 #endif
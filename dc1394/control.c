@@ -655,6 +655,8 @@ dc1394_video_set_framerate(dc1394camera_t *camera, dc1394framerate_t framerate)
     err=dc1394_set_control_register(camera, REG_CAMERA_FRAME_RATE, (uint32_t)(((framerate - DC1394_FRAMERATE_MIN) & 0x7UL) << 29));
     DC1394_ERR_RTN(err, "Could not set video framerate");
 
+    capture_update_frame_interval(camera);
+
     return err;
 }
 
@@ -952,6 +954,7 @@ dc1394_video_set_transmission(dc1394camera_t *camera, dc1394switch_t pwr)
     if (pwr==DC1394_ON) {
         err=dc1394_set_control_register(camera, REG_CAMERA_ISO_EN, DC1394_FEATURE_ON);
         DC1394_ERR_RTN(err, "Could not start ISO transmission");
+        capture_restart(camera);
     }
     else {
         // first we stop ISO
@@ -991,6 +994,7 @@ dc1394_video_set_one_shot(dc1394camera_t *camera, dc1394switch_t pwr)
         err=DC1394_INVALID_ARGUMENT_VALUE;
         DC1394_ERR_RTN(err, "Invalid switch value");
     }
+    capture_set_shots(camera, pwr==DC1394_ON);
     return err;
 }
 
@@ -1024,6 +1028,7 @@ dc1394_video_set_multi_shot(dc1394camera_t *camera, uint32_t numFrames, dc1394sw
     case DC1394_ON:
         err=dc1394_set_control_register(camera, REG_CAMERA_ONE_SHOT, (0x40000000UL | (numFrames & 0xFFFFUL)));
         DC1394_ERR_RTN(err, "Could not set multishot");
+        capture_set_shots(camera, 1);
         break;
     case DC1394_OFF:
         err=dc1394_video_set_one_shot(camera,pwr);
@@ -1444,6 +1449,9 @@ dc1394_feature_set_power(dc1394camera_t *camera, dc1394feature_t feature, dc1394
         DC1394_ERR_RTN(err, "Could not set feature power");
     }
 
+    if (feature == DC1394_FEATURE_TRIGGER)
+        capture_set_trigger(camera, value == DC1394_ON);
+
     return err;
 }
 
@@ -1963,6 +1971,12 @@ dc1394_new (void)
 #ifdef HAVE_LIBUSB
     usb_init (d);
 #endif
+#ifdef HAVE_SIM
+    sim_init (d);
+#endif
+#ifdef HAVE_REPLAY
+    replay_init (d);
+#endif
 
     int i;
     int initializations = 0;
@@ -2131,6 +2145,9 @@ dc1394_camera_new_unit (dc1394_t * d, uint64_t guid, int unit)
 
     camera = calloc (1, sizeof (dc1394camera_priv_t));
     cpriv = DC1394_CAMERA_PRIV (camera);
+#ifdef HAVE_PTHREAD
+    pthread_mutex_init (&cpriv->held_mutex, NULL);
+#endif
 
     cpriv->pcam = pcam;
     cpriv->platform = info->platform;
@@ -2193,6 +2210,10 @@ dc1394_camera_free(dc1394camera_t *camera)
         dc1394_iso_release_all (camera);
 
     cpriv->platform->dispatch->camera_free (cpriv->pcam);
+#ifdef HAVE_PTHREAD
+    pthread_mutex_destroy (&cpriv->held_mutex);
+#endif
+    free (cpriv->held);
     free (camera->vendor);
     free (camera->model);
     free (camera);
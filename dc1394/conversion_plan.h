@@ -0,0 +1,114 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Conversion plans and planar outputs, shared by the color conversion and
+ * de-mosaicing functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __DC1394_CONVERSION_PLAN_H__
+#define __DC1394_CONVERSION_PLAN_H__
+
+#include "conversions.h"
+
+/*
+  Converts one line of a source coding to 8-bit Y and to U and V at half the
+  horizontal resolution. The width is even.
+*/
+typedef void (*planar_line_t)(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t width,
+                              uint32_t byte_order, uint32_t bits);
+
+/* where the planes of a planar image are */
+typedef struct {
+    uint32_t width, height;
+    uint32_t vsub;                  /* 2 if the chroma has half the lines, else 1 */
+    uint32_t interleaved;           /* U and V alternate in a single plane (NV12) */
+    uint32_t chroma_stride;
+    size_t u_offset, v_offset;      /* from the Y plane */
+    size_t image_bytes;
+} planar_layout_t;
+
+/*
+  The layout of a width x height image in a planar color coding, converted
+  from source_coding. Returns DC1394_INVALID_COLOR_CODING if the coding is
+  not planar and DC1394_INVALID_ARGUMENT_VALUE if its chroma would split
+  pixels, or the lines would split the pixel groups of the source.
+*/
+dc1394error_t
+planar_get_layout(dc1394color_coding_t source_coding, dc1394color_coding_t color_coding,
+                  uint32_t width, uint32_t height, planar_layout_t *layout);
+
+/* the line conversion from a source coding, or NULL */
+planar_line_t
+planar_get_line(dc1394color_coding_t source_coding);
+
+/*
+  Converts 'rows' lines of a source image, starting with line 'first' of the
+  planar image at dest ('src' points to that line). 'first' and 'rows' are
+  multiples of layout->vsub.
+*/
+void
+planar_convert(planar_line_t line, uint32_t src_bpp, const uint8_t *src, uint32_t src_stride, uint8_t *dest,
+               const planar_layout_t *layout, uint32_t first, uint32_t rows, uint32_t byte_order, uint32_t bits);
+
+/* the alignment of the output images of the plans */
+#define CONVERSION_PLAN_ALIGN 64
+
+/* one of the pixel conversions of conversions.c, with all their parameters */
+typedef dc1394error_t (*plan_kernel_t)(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height,
+                                        uint32_t byte_order, uint32_t bits);
+
+/* processes the image of an input frame into plan->frame.image */
+typedef dc1394error_t (*plan_run_t)(dc1394conversion_plan_t *plan, const uint8_t *src);
+
+struct __dc1394conversion_plan_t {
+    dc1394video_frame_t frame;      /* the output; its image belongs to the plan */
+    uint8_t *buffer;                /* the allocation that holds frame.image */
+
+    /* the input frames the plan was made for */
+    dc1394color_coding_t color_coding;
+    uint32_t size[2];
+    uint32_t line;                  /* bytes in a line of pixels */
+    uint32_t stride;                /* bytes between the lines */
+
+    plan_run_t run;
+    uint32_t scale;                 /* the input pixels per output pixel along each axis */
+
+    /* pixel conversions: 'calls' runs of 'kernel' on 'lines' lines each */
+    plan_kernel_t kernel;
+    uint32_t byte_order;
+    uint32_t bits;
+    uint32_t calls, lines;
+
+    /* planar outputs: 'planar_line' on lines of src_bpp bits per pixel */
+    planar_line_t planar_line;
+    planar_layout_t layout;
+    uint32_t src_bpp;
+
+    /* de-mosaicing: the job prepared by bayer.c */
+    void *job;
+};
+
+/*
+  Allocates a plan for input frames like 'in' and lays out its output frame:
+  width x height pixels of the given coding and depth, with packed lines or
+  planes and an aligned image. The caller sets the conversion. Returns NULL on failure.
+*/
+dc1394conversion_plan_t *
+conversion_plan_new(const dc1394video_frame_t *in, dc1394color_coding_t color_coding,
+                    uint32_t width, uint32_t height, uint32_t data_depth);
+
+#endif /* __DC1394_CONVERSION_PLAN_H__ */
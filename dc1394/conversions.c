@@ -23,6 +23,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include "conversions.h"
+#include "conversion_plan.h"
+#include "simd.h"
 
 // this should disappear...
 extern void swab();
@@ -407,8 +409,14 @@ dc1394_YUV444_to_RGB8(uint8_t *restrict src, uint8_t *restrict dest, uint32_t wi
     register int j = (width*height) + ( (width*height) << 1 ) -1;
     register int y, u, v;
     register int r, g, b;
+    const simd_dispatch_t * simd = simd_get_dispatch ();
+    int stop = 0;
 
-    while (i >= 0) {
+    // the SIMD kernel converts the beginning of the buffer
+    if (simd->yuv444_rgb8)
+        stop = 3 * simd->yuv444_rgb8 (src, dest, width*height, 0);
+
+    while (i >= stop) {
         v = (uint8_t) src[i--] - 128;
         y = (uint8_t) src[i--];
         u = (uint8_t) src[i--] - 128;
@@ -427,11 +435,18 @@ dc1394_YUV422_to_RGB8(uint8_t *restrict src, uint8_t *restrict dest, uint32_t wi
     register int j = (width*height) + ( (width*height) << 1 ) -1;
     register int y0, y1, u, v;
     register int r, g, b;
+    const simd_dispatch_t * simd = simd_get_dispatch ();
+    int stop = 0;
 
+    // the SIMD kernel converts the beginning of the buffer
+    if (simd->yuv422_rgb8 &&
+        ((byte_order == DC1394_BYTE_ORDER_YUYV) || (byte_order == DC1394_BYTE_ORDER_UYVY)))
+        stop = 2 * simd->yuv422_rgb8 (src, dest, width*height,
+                                      byte_order == DC1394_BYTE_ORDER_UYVY);
 
     switch (byte_order) {
     case DC1394_BYTE_ORDER_YUYV:
-        while (i >= 0) {
+        while (i >= stop) {
             v  = (uint8_t) src[i--] -128;
             y1 = (uint8_t) src[i--];
             u  = (uint8_t) src[i--] -128;
@@ -447,7 +462,7 @@ dc1394_YUV422_to_RGB8(uint8_t *restrict src, uint8_t *restrict dest, uint32_t wi
         }
         return DC1394_SUCCESS;
     case DC1394_BYTE_ORDER_UYVY:
-        while (i >= 0) {
+        while (i >= stop) {
             y1 = (uint8_t) src[i--];
             v  = (uint8_t) src[i--] - 128;
             y0 = (uint8_t) src[i--];
@@ -476,8 +491,14 @@ dc1394_YUV411_to_RGB8(uint8_t *restrict src, uint8_t *restrict dest, uint32_t wi
     register int j = (width*height) + ( (width*height) << 1 )-1;
     register int y0, y1, y2, y3, u, v;
     register int r, g, b;
+    const simd_dispatch_t * simd = simd_get_dispatch ();
+    int stop = 0;
 
-    while (i >= 0) {
+    // the SIMD kernel converts the beginning of the buffer
+    if (simd->yuv411_rgb8)
+        stop = 3 * simd->yuv411_rgb8 (src, dest, width*height, 0) / 2;
+
+    while (i >= stop) {
         y3 = (uint8_t) src[i--];
         y2 = (uint8_t) src[i--];
         v  = (uint8_t) src[i--] - 128;
@@ -540,6 +561,254 @@ dc1394_MONO16_to_RGB8(uint8_t *restrict src, uint8_t *restrict dest, uint32_t wi
 }
 
 
+/**********************************************************************
+ *
+ *  CONVERSION FUNCTIONS TO PLANAR YUV
+ *
+ **********************************************************************/
+
+/*
+  Line conversions to Y and half-width U and V (see planar_line_t). They
+  compute the samples exactly like the conversions to YUV422.
+*/
+static void
+planar_line_YUV422(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t width,
+                   uint32_t byte_order, uint32_t bits)
+{
+    const simd_dispatch_t *simd = simd_get_dispatch();
+    const int uyvy = byte_order != DC1394_BYTE_ORDER_YUYV;
+    uint32_t i = 0;
+
+    if (simd->yuv422_planar)
+        i = simd->yuv422_planar(src, y, u, v, width, uyvy);
+    src += 2*i;
+
+    if (uyvy)
+        for (; i < width; i += 2, src += 4) {
+            u[i>>1] = src[0];
+            y[i]    = src[1];
+            v[i>>1] = src[2];
+            y[i+1]  = src[3];
+        }
+    else
+        for (; i < width; i += 2, src += 4) {
+            y[i]    = src[0];
+            u[i>>1] = src[1];
+            y[i+1]  = src[2];
+            v[i>>1] = src[3];
+        }
+}
+
+static void
+planar_line_YUV411(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t width,
+                   uint32_t byte_order, uint32_t bits)
+{
+    uint32_t i;
+
+    // U Y0 Y1 V Y2 Y3: the chroma of 4 pixels, shared by 2 pairs
+    for (i = 0; i + 4 <= width; i += 4, src += 6) {
+        u[i>>1] = u[(i>>1)+1] = src[0];
+        y[i]    = src[1];
+        y[i+1]  = src[2];
+        v[i>>1] = v[(i>>1)+1] = src[3];
+        y[i+2]  = src[4];
+        y[i+3]  = src[5];
+    }
+}
+
+static void
+planar_line_YUV444(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t width,
+                   uint32_t byte_order, uint32_t bits)
+{
+    uint32_t i;
+
+    for (i = 0; i < width; i += 2, src += 6) {
+        u[i>>1] = (src[0] + src[3]) >> 1;
+        y[i]    = src[1];
+        y[i+1]  = src[4];
+        v[i>>1] = (src[2] + src[5]) >> 1;
+    }
+}
+
+static void
+planar_line_RGB8(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t width,
+                 uint32_t byte_order, uint32_t bits)
+{
+    register int y0, y1, u0, u1, v0, v1;
+    uint32_t i;
+
+    for (i = 0; i < width; i += 2, src += 6) {
+        RGB2YUV (src[0], src[1], src[2], y0, u0, v0);
+        RGB2YUV (src[3], src[4], src[5], y1, u1, v1);
+        y[i]    = y0;
+        y[i+1]  = y1;
+        u[i>>1] = (u0+u1) >> 1;
+        v[i>>1] = (v0+v1) >> 1;
+    }
+}
+
+static void
+planar_line_RGB16(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t width,
+                  uint32_t byte_order, uint32_t bits)
+{
+    register int y0, y1, u0, u1, v0, v1;
+    uint8_t rgb[6];
+    uint32_t i, k;
+
+    for (i = 0; i < width; i += 2, src += 12) {
+        for (k = 0; k < 6; k++)
+            rgb[k] = (uint8_t) (((src[2*k]<<8) + src[2*k+1]) >> (bits-8));
+        RGB2YUV (rgb[0], rgb[1], rgb[2], y0, u0, v0);
+        RGB2YUV (rgb[3], rgb[4], rgb[5], y1, u1, v1);
+        y[i]    = y0;
+        y[i+1]  = y1;
+        u[i>>1] = (u0+u1) >> 1;
+        v[i>>1] = (v0+v1) >> 1;
+    }
+}
+
+static void
+planar_line_MONO8(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t width,
+                  uint32_t byte_order, uint32_t bits)
+{
+    memcpy(y, src, width);
+    memset(u, 128, width>>1);
+    memset(v, 128, width>>1);
+}
+
+static void
+planar_line_MONO16(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t width,
+                   uint32_t byte_order, uint32_t bits)
+{
+    uint32_t i;
+
+    for (i = 0; i < width; i++, src += 2)
+        y[i] = ((src[0]<<8) + src[1]) >> (bits-8);
+    memset(u, 128, width>>1);
+    memset(v, 128, width>>1);
+}
+
+planar_line_t
+planar_get_line(dc1394color_coding_t source_coding)
+{
+    switch(source_coding) {
+    case DC1394_COLOR_CODING_YUV422:
+        return planar_line_YUV422;
+    case DC1394_COLOR_CODING_YUV411:
+        return planar_line_YUV411;
+    case DC1394_COLOR_CODING_YUV444:
+        return planar_line_YUV444;
+    case DC1394_COLOR_CODING_RGB8:
+        return planar_line_RGB8;
+    case DC1394_COLOR_CODING_RGB16:
+        return planar_line_RGB16;
+    case DC1394_COLOR_CODING_MONO8:
+    case DC1394_COLOR_CODING_RAW8:
+        return planar_line_MONO8;
+    case DC1394_COLOR_CODING_MONO16:
+    case DC1394_COLOR_CODING_RAW16:
+        return planar_line_MONO16;
+    default:
+        return NULL;
+    }
+}
+
+dc1394error_t
+planar_get_layout(dc1394color_coding_t source_coding, dc1394color_coding_t color_coding,
+                  uint32_t width, uint32_t height, planar_layout_t *layout)
+{
+    size_t luma=(size_t)width*height;
+
+    layout->width=width;
+    layout->height=height;
+    layout->interleaved=0;
+    layout->chroma_stride=width/2;
+
+    switch(color_coding) {
+    case DC1394_COLOR_CODING_I420:
+        layout->vsub=2;
+        layout->u_offset=luma;
+        layout->v_offset=luma+(width/2)*(height/2);
+        break;
+    case DC1394_COLOR_CODING_NV12:
+        layout->vsub=2;
+        layout->interleaved=1;
+        layout->chroma_stride=width;
+        layout->u_offset=luma;
+        layout->v_offset=luma+1;
+        break;
+    case DC1394_COLOR_CODING_YV16:
+        layout->vsub=1;
+        layout->v_offset=luma;
+        layout->u_offset=luma+(width/2)*height;
+        break;
+    case DC1394_COLOR_CODING_I422:
+        layout->vsub=1;
+        layout->u_offset=luma;
+        layout->v_offset=luma+(width/2)*height;
+        break;
+    default:
+        return DC1394_INVALID_COLOR_CODING;
+    }
+    layout->image_bytes=luma+2*(width/2)*(height/layout->vsub);
+
+    if ((width%2)||(height%layout->vsub))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    // 4:1:1 lines are whole groups of 4 pixels
+    if ((source_coding==DC1394_COLOR_CODING_YUV411)&&(width%4))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    return DC1394_SUCCESS;
+}
+
+// pixels converted at once when the chroma goes through a buffer
+#define PLANAR_CHUNK 1024
+
+void
+planar_convert(planar_line_t line, uint32_t src_bpp, const uint8_t *src, uint32_t src_stride, uint8_t *dest,
+               const planar_layout_t *layout, uint32_t first, uint32_t rows, uint32_t byte_order, uint32_t bits)
+{
+    uint8_t u0[PLANAR_CHUNK/2], v0[PLANAR_CHUNK/2], u1[PLANAR_CHUNK/2], v1[PLANAR_CHUNK/2];
+    const uint32_t width=layout->width;
+    uint32_t r, x, n, i;
+    size_t offset;
+
+    for (r=0;r<rows;r+=layout->vsub, src+=layout->vsub*src_stride) {
+        uint8_t *y=dest+(size_t)(first+r)*width;
+        uint8_t *cu=dest+layout->u_offset+(size_t)((first+r)/layout->vsub)*layout->chroma_stride;
+        uint8_t *cv=dest+layout->v_offset+(size_t)((first+r)/layout->vsub)*layout->chroma_stride;
+
+        // 4:2:2 planes: straight to the output
+        if ((layout->vsub==1)&&(!layout->interleaved)) {
+            line(src, y, cu, cv, width, byte_order, bits);
+            continue;
+        }
+
+        for (x=0;x<width;x+=n) {
+            n=width-x<PLANAR_CHUNK ? width-x : PLANAR_CHUNK;
+            offset=((size_t)x*src_bpp)/8;
+            line(src+offset, y+x, u0, v0, n, byte_order, bits);
+            if (layout->vsub==2) {
+                line(src+src_stride+offset, y+width+x, u1, v1, n, byte_order, bits);
+                for (i=0;i<n/2;i++) {
+                    u0[i]=(u0[i]+u1[i]+1)>>1;
+                    v0[i]=(v0[i]+v1[i]+1)>>1;
+                }
+            }
+            if (layout->interleaved) {
+                for (i=0;i<n/2;i++) {
+                    cu[x+2*i]=u0[i];
+                    cu[x+2*i+1]=v0[i];
+                }
+            }
+            else {
+                memcpy(cu+x/2, u0, n/2);
+                memcpy(cv+x/2, v0, n/2);
+            }
+        }
+    }
+}
+
+
 // change a 16bit stereo image (8bit/channel) into two 8bit images on top
 // of each other
 dc1394error_t
@@ -648,16 +917,130 @@ dc1394_convert_to_RGB8(uint8_t *restrict src, uint8_t *restrict dest, uint32_t w
     return DC1394_SUCCESS;
 }
 
+typedef dc1394error_t (*convert_func_t)(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height,
+                                         uint32_t byte_order, dc1394color_coding_t source_coding, uint32_t bits);
+
+/*
+  Runs a conversion on buffers whose lines are src_stride and dest_stride
+  bytes apart (0 for packed lines). The conversions work pixel by pixel, so
+  unless both buffers are packed this is done one line at a time.
+*/
+static dc1394error_t
+convert_lines(convert_func_t convert, uint32_t dest_bpp, uint8_t *src, uint32_t src_stride,
+              uint8_t *dest, uint32_t dest_stride, uint32_t width, uint32_t height,
+              uint32_t byte_order, dc1394color_coding_t source_coding, uint32_t bits)
+{
+    uint32_t src_bpp, src_line, dest_line, y;
+    dc1394error_t err;
+
+    err=dc1394_get_color_coding_bit_size(source_coding, &src_bpp);
+    if (err!=DC1394_SUCCESS)
+        return err;
+
+    src_line=(width*src_bpp)/8;
+    dest_line=(width*dest_bpp)/8;
+    if (src_stride==0)
+        src_stride=src_line;
+    if (dest_stride==0)
+        dest_stride=dest_line;
+    if ((src_stride<src_line)||(dest_stride<dest_line))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    if ((src_stride==src_line)&&(dest_stride==dest_line))
+        return convert(src, dest, width, height, byte_order, source_coding, bits);
+
+    for (y=0;y<height;y++) {
+        err=convert(src+y*src_stride, dest+y*dest_stride, width, 1, byte_order, source_coding, bits);
+        if (err!=DC1394_SUCCESS)
+            return err;
+    }
+    return DC1394_SUCCESS;
+}
+
 dc1394error_t
-Adapt_buffer_convert(dc1394video_frame_t *in, dc1394video_frame_t *out)
+dc1394_convert_to_YUV422_stride(uint8_t *src, uint32_t src_stride, uint8_t *dest, uint32_t dest_stride,
+                                uint32_t width, uint32_t height, uint32_t byte_order,
+                                dc1394color_coding_t source_coding, uint32_t bits)
 {
+    return convert_lines(dc1394_convert_to_YUV422, 16, src, src_stride, dest, dest_stride,
+                         width, height, byte_order, source_coding, bits);
+}
+
+dc1394error_t
+dc1394_convert_to_MONO8_stride(uint8_t *src, uint32_t src_stride, uint8_t *dest, uint32_t dest_stride,
+                               uint32_t width, uint32_t height, uint32_t byte_order,
+                               dc1394color_coding_t source_coding, uint32_t bits)
+{
+    return convert_lines(dc1394_convert_to_MONO8, 8, src, src_stride, dest, dest_stride,
+                         width, height, byte_order, source_coding, bits);
+}
+
+dc1394error_t
+dc1394_convert_to_RGB8_stride(uint8_t *src, uint32_t src_stride, uint8_t *dest, uint32_t dest_stride,
+                              uint32_t width, uint32_t height, uint32_t byte_order,
+                              dc1394color_coding_t source_coding, uint32_t bits)
+{
+    return convert_lines(dc1394_convert_to_RGB8, 24, src, src_stride, dest, dest_stride,
+                         width, height, byte_order, source_coding, bits);
+}
+
+dc1394error_t
+dc1394_convert_to_planar_stride(uint8_t *src, uint32_t src_stride, uint8_t *dest, uint32_t width, uint32_t height,
+                                uint32_t byte_order, dc1394color_coding_t source_coding, uint32_t bits,
+                                dc1394color_coding_t dest_coding)
+{
+    planar_layout_t layout;
+    planar_line_t line;
     uint32_t bpp;
+    dc1394error_t err;
 
-    // conversions don't change the size of buffers or its position
-    out->size[0]=in->size[0];
-    out->size[1]=in->size[1];
-    out->position[0]=in->position[0];
-    out->position[1]=in->position[1];
+    line=planar_get_line(source_coding);
+    if (line==NULL)
+        return DC1394_FUNCTION_NOT_SUPPORTED;
+    if ((source_coding==DC1394_COLOR_CODING_YUV422)&&
+        (byte_order!=DC1394_BYTE_ORDER_YUYV)&&(byte_order!=DC1394_BYTE_ORDER_UYVY))
+        return DC1394_INVALID_BYTE_ORDER;
+
+    err=planar_get_layout(source_coding, dest_coding, width, height, &layout);
+    if (err!=DC1394_SUCCESS)
+        return err;
+
+    dc1394_get_color_coding_bit_size(source_coding, &bpp);
+    if (src_stride==0)
+        src_stride=(width*bpp)/8;
+    if (src_stride<(width*bpp)/8)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    planar_convert(line, bpp, src, src_stride, dest, &layout, 0, height, byte_order, bits);
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_convert_to_planar(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order,
+                         dc1394color_coding_t source_coding, uint32_t bits, dc1394color_coding_t dest_coding)
+{
+    return dc1394_convert_to_planar_stride(src, 0, dest, width, height, byte_order, source_coding, bits,
+                                           dest_coding);
+}
+
+/*
+  Same as Adapt_buffer_convert() for the conversion of the width x height
+  rectangle at (left, top) of the input. The output lines are 'stride' bytes
+  apart, or packed if stride is 0. The padding bytes only follow full frames
+  with packed lines.
+*/
+dc1394error_t
+Adapt_buffer_convert_rect(dc1394video_frame_t *in, dc1394video_frame_t *out,
+                          uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint32_t stride)
+{
+    planar_layout_t layout;
+    uint32_t bpp, line;
+
+    // conversions don't change the size of buffers or its position, except for the rectangle
+    out->size[0]=width;
+    out->size[1]=height;
+    out->position[0]=in->position[0]+left;
+    out->position[1]=in->position[1]+top;
 
     // color coding has already been set before conversion: don't touch it.
 
@@ -671,18 +1054,34 @@ Adapt_buffer_convert(dc1394video_frame_t *in, dc1394video_frame_t *out)
     // we always convert to 8bits (at this point) we can safely set this value to 8.
     out->data_depth=8;
 
-    // don't know what to do with stride... >>>> TODO: STRIDE SHOULD BE TAKEN INTO ACCOUNT... <<<<
-    // out->stride=??
-
     // the video mode should not change. Color coding and other stuff can be accessed in specific fields of this struct
     out->video_mode = in->video_mode;
 
-    // padding is kept:
-    out->padding_bytes = in->padding_bytes;
+    if (planar_get_layout(in->color_coding, out->color_coding, width, height, &layout)==DC1394_SUCCESS) {
+        // planes are packed, the stride is that of the Y plane:
+        out->stride=width;
+        out->padding_bytes=0;
+        out->image_bytes=layout.image_bytes;
+    }
+    else {
+        // lines are packed unless a larger stride was asked for:
+        dc1394_get_color_coding_bit_size(out->color_coding, &bpp);
+        line=(out->size[0]*bpp)/8;
+        if (stride==0)
+            stride=line;
+        if (stride<line)
+            return DC1394_INVALID_ARGUMENT_VALUE;
+        out->stride=stride;
+
+        // padding is kept for full frames:
+        if ((left==0)&&(top==0)&&(width==in->size[0])&&(height==in->size[1])&&(stride==line))
+            out->padding_bytes = in->padding_bytes;
+        else
+            out->padding_bytes = 0;
 
-    // image bytes changes:    >>>> TODO: STRIDE SHOULD BE TAKEN INTO ACCOUNT... <<<<
-    dc1394_get_color_coding_bit_size(out->color_coding, &bpp);
-    out->image_bytes=(out->size[0]*out->size[1]*bpp)/8;
+        // image bytes changes: the last line is not followed by a stride's worth of bytes
+        out->image_bytes=out->size[1]>0 ? stride*(out->size[1]-1)+line : 0;
+    }
 
     // total is image_bytes + padding_bytes
     out->total_bytes = out->image_bytes + out->padding_bytes;
@@ -693,6 +1092,8 @@ Adapt_buffer_convert(dc1394video_frame_t *in, dc1394video_frame_t *out)
 
     // timestamp, frame_behind, id and camera are copied too:
     out->timestamp = in->timestamp;
+    out->iso_cycle = in->iso_cycle;
+    out->sequence = in->sequence;
     out->frames_behind = in->frames_behind;
     out->camera = in->camera;
     out->id = in->id;
@@ -721,165 +1122,129 @@ Adapt_buffer_convert(dc1394video_frame_t *in, dc1394video_frame_t *out)
 }
 
 dc1394error_t
-dc1394_convert_frames(dc1394video_frame_t *in, dc1394video_frame_t *out)
+Adapt_buffer_convert(dc1394video_frame_t *in, dc1394video_frame_t *out)
 {
+    return Adapt_buffer_convert_rect(in, out, 0, 0, in->size[0], in->size[1], 0);
+}
 
-    switch(out->color_coding) {
+/* whether dc1394_convert_frames() can convert from one color coding to another */
+static dc1394bool_t
+convert_supported(dc1394color_coding_t from, dc1394color_coding_t to)
+{
+    switch(to) {
     case DC1394_COLOR_CODING_YUV422:
-        switch(in->color_coding) {
+    case DC1394_COLOR_CODING_RGB8:
+    case DC1394_COLOR_CODING_I420:
+    case DC1394_COLOR_CODING_NV12:
+    case DC1394_COLOR_CODING_YV16:
+    case DC1394_COLOR_CODING_I422:
+        switch(from) {
         case DC1394_COLOR_CODING_YUV422:
-            
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_YUV422_to_YUV422(in->image, out->image, in->size[0], in->size[1], out->yuv_byte_order);
-            break;
-            
         case DC1394_COLOR_CODING_YUV411:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_YUV411_to_YUV422(in->image, out->image, in->size[0], in->size[1], out->yuv_byte_order);
-            break;
-            
         case DC1394_COLOR_CODING_YUV444:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_YUV444_to_YUV422(in->image, out->image, in->size[0], in->size[1], out->yuv_byte_order);
-            break;
-            
         case DC1394_COLOR_CODING_RGB8:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_RGB8_to_YUV422(in->image, out->image, in->size[0], in->size[1], out->yuv_byte_order);
-            break;
-            
         case DC1394_COLOR_CODING_MONO8:
         case DC1394_COLOR_CODING_RAW8:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_MONO8_to_YUV422(in->image, out->image, in->size[0], in->size[1], out->yuv_byte_order);
-            break;
-            
         case DC1394_COLOR_CODING_MONO16:
         case DC1394_COLOR_CODING_RAW16:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_MONO16_to_YUV422(in->image, out->image, in->size[0], in->size[1], out->yuv_byte_order, in->data_depth);
-            break;
-            
         case DC1394_COLOR_CODING_RGB16:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_RGB16_to_YUV422(in->image, out->image, in->size[0], in->size[1], out->yuv_byte_order, in->data_depth);
-            break;
-            
+            return DC1394_TRUE;
         default:
-            return DC1394_FUNCTION_NOT_SUPPORTED;
+            return DC1394_FALSE;
         }
-        break;
     case DC1394_COLOR_CODING_MONO8:
-        switch(in->color_coding) {
-        case DC1394_COLOR_CODING_MONO16:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_MONO16_to_MONO8(in->image, out->image, in->size[0], in->size[1], in->data_depth);
-            break;
-            
-        case DC1394_COLOR_CODING_MONO8:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            memcpy(out->image, in->image, in->size[0]*in->size[1]);
-            break;
-            
-        default:
-            return DC1394_FUNCTION_NOT_SUPPORTED;
-        }
-        break;
-    case DC1394_COLOR_CODING_RGB8:
-        switch(in->color_coding) {
-        case DC1394_COLOR_CODING_RGB16:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_RGB16_to_RGB8 (in->image, out->image, in->size[0], in->size[1], in->data_depth);
-            break;
-            
-        case DC1394_COLOR_CODING_YUV444:
-
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_YUV444_to_RGB8 (in->image, out->image, in->size[0], in->size[1]);
-            break;
-            
-        case DC1394_COLOR_CODING_YUV422:
+        return (from==DC1394_COLOR_CODING_MONO16)||(from==DC1394_COLOR_CODING_MONO8);
+    default:
+        return DC1394_FALSE;
+    }
+}
 
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_YUV422_to_RGB8 (in->image, out->image, in->size[0], in->size[1], in->yuv_byte_order);
-            break;
-            
-        case DC1394_COLOR_CODING_YUV411:
+/* the number of bytes between the lines of a frame: its stride if it was set, else packed lines */
+static uint32_t
+frame_stride(dc1394video_frame_t *frame)
+{
+    uint32_t bpp, line;
 
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_YUV411_to_RGB8 (in->image, out->image, in->size[0], in->size[1]);
-            break;
-            
-        case DC1394_COLOR_CODING_MONO8:
-        case DC1394_COLOR_CODING_RAW8:
+    if (dc1394_get_color_coding_bit_size(frame->color_coding, &bpp)!=DC1394_SUCCESS)
+        return 0;
+    line=(frame->size[0]*bpp)/8;
+    return frame->stride>line ? frame->stride : line;
+}
 
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_MONO8_to_RGB8 (in->image, out->image, in->size[0], in->size[1]);
-            break;
-            
-        case DC1394_COLOR_CODING_MONO16:
-        case DC1394_COLOR_CODING_RAW16:
+static dc1394error_t
+convert_frames(dc1394video_frame_t *in, dc1394video_frame_t *out,
+               uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint32_t stride)
+{
+    planar_layout_t layout;
+    uint32_t bpp, in_stride, align;
+    uint8_t *src;
+    dc1394error_t err;
 
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            return dc1394_MONO16_to_RGB8 (in->image, out->image, in->size[0], in->size[1],in->data_depth);
-            break;
-            
-        case DC1394_COLOR_CODING_RGB8:
+    if (!convert_supported(in->color_coding, out->color_coding))
+        return DC1394_FUNCTION_NOT_SUPPORTED;
 
-            if(DC1394_SUCCESS != Adapt_buffer_convert(in,out))
-                return DC1394_MEMORY_ALLOCATION_FAILURE;
-                
-            memcpy(out->image, in->image, in->size[0]*in->size[1]*3);
-            break;
-            
-        default:
-            return DC1394_FUNCTION_NOT_SUPPORTED;
-        }
+    // YUV pixels share their chroma: don't split the groups
+    switch (in->color_coding) {
+    case DC1394_COLOR_CODING_YUV422:
+        align=2;
+        break;
+    case DC1394_COLOR_CODING_YUV411:
+        align=4;
         break;
+    default:
+        align=1;
+        break;
+    }
+    if (out->color_coding==DC1394_COLOR_CODING_YUV422)
+        align=align<2 ? 2 : align;
+    if ((width==0)||(height==0)||(left+width>in->size[0])||(top+height>in->size[1]))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    if (((width!=in->size[0])||(height!=in->size[1]))&&((left%align)||(width%align)))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    // planar outputs subsample the chroma of the rectangle itself
+    if (planar_get_layout(in->color_coding, out->color_coding, width, height, &layout)==DC1394_INVALID_ARGUMENT_VALUE)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    err=Adapt_buffer_convert_rect(in,out,left,top,width,height,stride);
+    if (err!=DC1394_SUCCESS)
+        return err;
+
+    dc1394_get_color_coding_bit_size(in->color_coding, &bpp);
+    in_stride=frame_stride(in);
+    src=in->image+top*in_stride+(left*bpp)/8;
+
+    switch(out->color_coding) {
+    case DC1394_COLOR_CODING_YUV422:
+        return dc1394_convert_to_YUV422_stride(src, in_stride, out->image, out->stride, width, height,
+                                               out->yuv_byte_order, in->color_coding, in->data_depth);
+    case DC1394_COLOR_CODING_MONO8:
+        return dc1394_convert_to_MONO8_stride(src, in_stride, out->image, out->stride, width, height,
+                                              in->yuv_byte_order, in->color_coding, in->data_depth);
+    case DC1394_COLOR_CODING_RGB8:
+        return dc1394_convert_to_RGB8_stride(src, in_stride, out->image, out->stride, width, height,
+                                             in->yuv_byte_order, in->color_coding, in->data_depth);
+    case DC1394_COLOR_CODING_I420:
+    case DC1394_COLOR_CODING_NV12:
+    case DC1394_COLOR_CODING_YV16:
+    case DC1394_COLOR_CODING_I422:
+        return dc1394_convert_to_planar_stride(src, in_stride, out->image, width, height, in->yuv_byte_order,
+                                               in->color_coding, in->data_depth, out->color_coding);
     default:
         return DC1394_FUNCTION_NOT_SUPPORTED;
     }
+}
 
-    return DC1394_SUCCESS;
+dc1394error_t
+dc1394_convert_frames(dc1394video_frame_t *in, dc1394video_frame_t *out)
+{
+    return convert_frames(in, out, 0, 0, in->size[0], in->size[1], 0);
+}
+
+dc1394error_t
+dc1394_convert_frames_rect(dc1394video_frame_t *in, dc1394video_frame_t *out,
+                           uint32_t left, uint32_t top, uint32_t width, uint32_t height)
+{
+    return convert_frames(in, out, left, top, width, height, out->stride);
 }
 
 
@@ -917,18 +1282,16 @@ Adapt_buffer_stereo(dc1394video_frame_t *in, dc1394video_frame_t *out)
     // we always convert to 8bits (at this point) we can safely set this value to 8.
     out->data_depth=8;
 
-    // don't know what to do with stride... >>>> TODO: STRIDE SHOULD BE TAKEN INTO ACCOUNT... <<<<
-    // out->stride=??
-
     // the video mode should not change. Color coding and other stuff can be accessed in specific fields of this struct
     out->video_mode = in->video_mode;
 
     // padding is kept:
     out->padding_bytes = in->padding_bytes;
 
-    // image bytes changes:    >>>> TODO: STRIDE SHOULD BE TAKEN INTO ACCOUNT... <<<<
+    // image bytes changes, lines are packed:
     dc1394_get_color_coding_bit_size(out->color_coding, &bpp);
-    out->image_bytes=(out->size[0]*out->size[1]*bpp)/8;
+    out->stride=(out->size[0]*bpp)/8;
+    out->image_bytes=out->stride*out->size[1];
 
     // total is image_bytes + padding_bytes
     out->total_bytes = out->image_bytes + out->padding_bytes;
@@ -939,6 +1302,8 @@ Adapt_buffer_stereo(dc1394video_frame_t *in, dc1394video_frame_t *out)
 
     // timestamp, frame_behind, id and camera are copied too:
     out->timestamp = in->timestamp;
+    out->iso_cycle = in->iso_cycle;
+    out->sequence = in->sequence;
     out->frames_behind = in->frames_behind;
     out->camera = in->camera;
     out->id = in->id;
@@ -1000,3 +1365,349 @@ dc1394_deinterlace_stereo_frames(dc1394video_frame_t *in, dc1394video_frame_t *o
     else
         return DC1394_FUNCTION_NOT_SUPPORTED;
 }
+
+/**********************************************************************
+ *
+ *  CONVERSION PLANS
+ *
+ **********************************************************************/
+
+/*
+  The pixel conversions with the parameters of plan_kernel_t, so that a plan
+  calls them through a single pointer.
+*/
+static dc1394error_t
+plan_YUV422_to_YUV422(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_YUV422_to_YUV422(src, dest, width, height, byte_order);
+}
+
+static dc1394error_t
+plan_YUV411_to_YUV422(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_YUV411_to_YUV422(src, dest, width, height, byte_order);
+}
+
+static dc1394error_t
+plan_YUV444_to_YUV422(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_YUV444_to_YUV422(src, dest, width, height, byte_order);
+}
+
+static dc1394error_t
+plan_RGB8_to_YUV422(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_RGB8_to_YUV422(src, dest, width, height, byte_order);
+}
+
+static dc1394error_t
+plan_MONO8_to_YUV422(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_MONO8_to_YUV422(src, dest, width, height, byte_order);
+}
+
+static dc1394error_t
+plan_MONO16_to_YUV422(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_MONO16_to_YUV422(src, dest, width, height, byte_order, bits);
+}
+
+static dc1394error_t
+plan_RGB16_to_YUV422(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_RGB16_to_YUV422(src, dest, width, height, byte_order, bits);
+}
+
+static dc1394error_t
+plan_MONO16_to_MONO8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_MONO16_to_MONO8(src, dest, width, height, bits);
+}
+
+static dc1394error_t
+plan_MONO8_to_MONO8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    memcpy(dest, src, width*height);
+    return DC1394_SUCCESS;
+}
+
+static dc1394error_t
+plan_RGB16_to_RGB8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_RGB16_to_RGB8(src, dest, width, height, bits);
+}
+
+static dc1394error_t
+plan_YUV444_to_RGB8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_YUV444_to_RGB8(src, dest, width, height);
+}
+
+static dc1394error_t
+plan_YUV422_to_RGB8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_YUV422_to_RGB8(src, dest, width, height, byte_order);
+}
+
+static dc1394error_t
+plan_YUV411_to_RGB8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_YUV411_to_RGB8(src, dest, width, height);
+}
+
+static dc1394error_t
+plan_MONO8_to_RGB8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_MONO8_to_RGB8(src, dest, width, height);
+}
+
+static dc1394error_t
+plan_MONO16_to_RGB8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    return dc1394_MONO16_to_RGB8(src, dest, width, height, bits);
+}
+
+static dc1394error_t
+plan_RGB8_to_RGB8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order, uint32_t bits)
+{
+    memcpy(dest, src, width*height*3);
+    return DC1394_SUCCESS;
+}
+
+/* the conversion dc1394_convert_frames() would use, or NULL */
+static plan_kernel_t
+plan_kernel(dc1394color_coding_t from, dc1394color_coding_t to)
+{
+    switch(to) {
+    case DC1394_COLOR_CODING_YUV422:
+        switch(from) {
+        case DC1394_COLOR_CODING_YUV422:
+            return plan_YUV422_to_YUV422;
+        case DC1394_COLOR_CODING_YUV411:
+            return plan_YUV411_to_YUV422;
+        case DC1394_COLOR_CODING_YUV444:
+            return plan_YUV444_to_YUV422;
+        case DC1394_COLOR_CODING_RGB8:
+            return plan_RGB8_to_YUV422;
+        case DC1394_COLOR_CODING_MONO8:
+        case DC1394_COLOR_CODING_RAW8:
+            return plan_MONO8_to_YUV422;
+        case DC1394_COLOR_CODING_MONO16:
+        case DC1394_COLOR_CODING_RAW16:
+            return plan_MONO16_to_YUV422;
+        case DC1394_COLOR_CODING_RGB16:
+            return plan_RGB16_to_YUV422;
+        default:
+            return NULL;
+        }
+    case DC1394_COLOR_CODING_MONO8:
+        switch(from) {
+        case DC1394_COLOR_CODING_MONO16:
+            return plan_MONO16_to_MONO8;
+        case DC1394_COLOR_CODING_MONO8:
+            return plan_MONO8_to_MONO8;
+        default:
+            return NULL;
+        }
+    case DC1394_COLOR_CODING_RGB8:
+        switch(from) {
+        case DC1394_COLOR_CODING_RGB16:
+            return plan_RGB16_to_RGB8;
+        case DC1394_COLOR_CODING_YUV444:
+            return plan_YUV444_to_RGB8;
+        case DC1394_COLOR_CODING_YUV422:
+            return plan_YUV422_to_RGB8;
+        case DC1394_COLOR_CODING_YUV411:
+            return plan_YUV411_to_RGB8;
+        case DC1394_COLOR_CODING_MONO8:
+        case DC1394_COLOR_CODING_RAW8:
+            return plan_MONO8_to_RGB8;
+        case DC1394_COLOR_CODING_MONO16:
+        case DC1394_COLOR_CODING_RAW16:
+            return plan_MONO16_to_RGB8;
+        case DC1394_COLOR_CODING_RGB8:
+            return plan_RGB8_to_RGB8;
+        default:
+            return NULL;
+        }
+    default:
+        return NULL;
+    }
+}
+
+dc1394conversion_plan_t *
+conversion_plan_new(const dc1394video_frame_t *in, dc1394color_coding_t color_coding,
+                    uint32_t width, uint32_t height, uint32_t data_depth)
+{
+    dc1394conversion_plan_t *plan;
+    uint32_t bpp;
+
+    plan=(dc1394conversion_plan_t*)calloc(1, sizeof(dc1394conversion_plan_t));
+    if (plan==NULL)
+        return NULL;
+
+    // the input frames:
+    if (dc1394_get_color_coding_bit_size(in->color_coding, &bpp)!=DC1394_SUCCESS)
+        goto fail;
+    plan->color_coding=in->color_coding;
+    plan->size[0]=in->size[0];
+    plan->size[1]=in->size[1];
+    plan->line=(in->size[0]*bpp)/8;
+    plan->stride=in->stride>plan->line ? in->stride : plan->line;
+
+    // the output frame, as Adapt_buffer_convert() and Adapt_buffer_bayer() would set it but without padding
+    // so that nothing has to be copied besides the image:
+    if (dc1394_get_color_coding_bit_size(color_coding, &bpp)!=DC1394_SUCCESS)
+        goto fail;
+    plan->frame.size[0]=width;
+    plan->frame.size[1]=height;
+    plan->frame.color_coding=color_coding;
+    plan->frame.color_filter=in->color_filter;
+    plan->frame.yuv_byte_order=in->yuv_byte_order;
+    plan->frame.data_depth=data_depth;
+    plan->frame.video_mode=in->video_mode;
+    if (planar_get_layout(in->color_coding, color_coding, width, height, &plan->layout)==DC1394_SUCCESS) {
+        plan->frame.stride=width;
+        plan->frame.image_bytes=plan->layout.image_bytes;
+    }
+    else {
+        plan->frame.stride=(width*bpp)/8;
+        plan->frame.image_bytes=plan->frame.stride*height;
+    }
+    plan->frame.padding_bytes=0;
+    plan->frame.total_bytes=plan->frame.image_bytes;
+    plan->frame.allocated_image_bytes=plan->frame.image_bytes;
+
+    plan->buffer=(uint8_t*)malloc(plan->frame.image_bytes+CONVERSION_PLAN_ALIGN-1);
+    if (plan->buffer==NULL)
+        goto fail;
+    plan->frame.image=(uint8_t*)(((uintptr_t)plan->buffer+CONVERSION_PLAN_ALIGN-1)&~(uintptr_t)(CONVERSION_PLAN_ALIGN-1));
+    plan->scale=1;
+
+    return plan;
+
+ fail:
+    free(plan);
+    return NULL;
+}
+
+static dc1394error_t
+plan_convert(dc1394conversion_plan_t *plan, const uint8_t *src)
+{
+    uint32_t i;
+    dc1394error_t err;
+
+    for (i=0;i<plan->calls;i++) {
+        err=plan->kernel((uint8_t*)src+i*plan->stride, plan->frame.image+i*plan->frame.stride,
+                         plan->size[0], plan->lines, plan->byte_order, plan->bits);
+        if (err!=DC1394_SUCCESS)
+            return err;
+    }
+    return DC1394_SUCCESS;
+}
+
+static dc1394error_t
+plan_planar(dc1394conversion_plan_t *plan, const uint8_t *src)
+{
+    planar_convert(plan->planar_line, plan->src_bpp, src, plan->stride, plan->frame.image, &plan->layout,
+                   0, plan->size[1], plan->byte_order, plan->bits);
+    return DC1394_SUCCESS;
+}
+
+dc1394conversion_plan_t *
+dc1394_conversion_plan_new(const dc1394video_frame_t *in, dc1394color_coding_t color_coding, uint32_t byte_order)
+{
+    dc1394conversion_plan_t *plan;
+    plan_kernel_t kernel;
+
+    planar_layout_t layout;
+
+    if ((in->size[0]==0)||(in->size[1]==0))
+        return NULL;
+
+    kernel=plan_kernel(in->color_coding, color_coding);
+    if (kernel==NULL) {
+        // planar outputs have a single conversion from each source coding
+        if ((planar_get_line(in->color_coding)==NULL)||
+            (planar_get_layout(in->color_coding, color_coding, in->size[0], in->size[1], &layout)!=DC1394_SUCCESS))
+            return NULL;
+        plan=conversion_plan_new(in, color_coding, in->size[0], in->size[1], 8);
+        if (plan==NULL)
+            return NULL;
+        plan->run=plan_planar;
+        plan->planar_line=planar_get_line(in->color_coding);
+        dc1394_get_color_coding_bit_size(in->color_coding, &plan->src_bpp);
+        plan->byte_order=in->yuv_byte_order;
+        plan->bits=in->data_depth;
+        return plan;
+    }
+
+    plan=conversion_plan_new(in, color_coding, in->size[0], in->size[1], 8);
+    if (plan==NULL)
+        return NULL;
+
+    plan->run=plan_convert;
+    plan->kernel=kernel;
+    plan->bits=in->data_depth;
+    if (color_coding==DC1394_COLOR_CODING_YUV422) {
+        plan->byte_order=byte_order;
+        plan->frame.yuv_byte_order=byte_order;
+    }
+    else
+        plan->byte_order=in->yuv_byte_order;
+
+    // the conversions work pixel by pixel: strided inputs are converted one line at a time
+    if (plan->stride==plan->line) {
+        plan->calls=1;
+        plan->lines=in->size[1];
+    }
+    else {
+        plan->calls=in->size[1];
+        plan->lines=1;
+    }
+
+    return plan;
+}
+
+dc1394error_t
+dc1394_conversion_plan_execute(dc1394conversion_plan_t *plan, const dc1394video_frame_t *in,
+                               dc1394video_frame_t **out)
+{
+    uint32_t stride;
+    dc1394error_t err;
+
+    stride=in->stride>plan->line ? in->stride : plan->line;
+    if ((in->color_coding!=plan->color_coding)||(in->size[0]!=plan->size[0])||
+        (in->size[1]!=plan->size[1])||(stride!=plan->stride))
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    err=plan->run(plan, in->image);
+    if (err!=DC1394_SUCCESS)
+        return err;
+
+    // the frame information that changes from one frame to the next:
+    plan->frame.position[0]=in->position[0]/plan->scale;
+    plan->frame.position[1]=in->position[1]/plan->scale;
+    plan->frame.packet_size=in->packet_size;
+    plan->frame.packets_per_frame=in->packets_per_frame;
+    plan->frame.timestamp=in->timestamp;
+    plan->frame.iso_cycle=in->iso_cycle;
+    plan->frame.sequence=in->sequence;
+    plan->frame.frames_behind=in->frames_behind;
+    plan->frame.camera=in->camera;
+    plan->frame.id=in->id;
+
+    if (out!=NULL)
+        *out=&plan->frame;
+    return DC1394_SUCCESS;
+}
+
+void
+dc1394_conversion_plan_free(dc1394conversion_plan_t *plan)
+{
+    if (plan==NULL)
+        return;
+    free(plan->job);
+    free(plan->buffer);
+    free(plan);
+}
@@ -121,6 +121,58 @@ dc1394error_t
 dc1394_convert_to_RGB8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order,
                        dc1394color_coding_t source_coding, uint32_t bits);
 
+/**
+ * Converts an image buffer to YUV422, with lines src_stride and dest_stride bytes apart
+ *
+ * A stride of 0 stands for packed lines. Pointing src and dest inside larger images converts a rectangle of
+ * one into a rectangle of the other. With YUV422 and YUV411 sources, src must point to the first pixel of a
+ * group sharing their chroma and the width must be a multiple of 2 (YUV422) or 4 (YUV411).
+ */
+dc1394error_t
+dc1394_convert_to_YUV422_stride(uint8_t *src, uint32_t src_stride, uint8_t *dest, uint32_t dest_stride,
+                                uint32_t width, uint32_t height, uint32_t byte_order,
+                                dc1394color_coding_t source_coding, uint32_t bits);
+
+/**
+ * Converts an image buffer to MONO8, with lines src_stride and dest_stride bytes apart (0 for packed lines)
+ */
+dc1394error_t
+dc1394_convert_to_MONO8_stride(uint8_t *src, uint32_t src_stride, uint8_t *dest, uint32_t dest_stride,
+                               uint32_t width, uint32_t height, uint32_t byte_order,
+                               dc1394color_coding_t source_coding, uint32_t bits);
+
+/**
+ * Converts an image buffer to RGB8, with lines src_stride and dest_stride bytes apart (0 for packed lines)
+ */
+dc1394error_t
+dc1394_convert_to_RGB8_stride(uint8_t *src, uint32_t src_stride, uint8_t *dest, uint32_t dest_stride,
+                              uint32_t width, uint32_t height, uint32_t byte_order,
+                              dc1394color_coding_t source_coding, uint32_t bits);
+
+/**********************************************************************
+ *  CONVERSION FUNCTIONS TO PLANAR YUV
+ **********************************************************************/
+
+/**
+ * Converts an image buffer to a planar YUV coding: DC1394_COLOR_CODING_I420, DC1394_COLOR_CODING_NV12,
+ * DC1394_COLOR_CODING_YV16 or DC1394_COLOR_CODING_I422
+ *
+ * The planes follow each other in dest without padding. The width must be even, or a multiple of 4 from YUV411,
+ * and the height must be even for the codings with vertically subsampled chroma (I420 and NV12), whose chroma is
+ * the average of two lines.
+ */
+dc1394error_t
+dc1394_convert_to_planar(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height, uint32_t byte_order,
+                         dc1394color_coding_t source_coding, uint32_t bits, dc1394color_coding_t dest_coding);
+
+/**
+ * Converts an image buffer to a planar YUV coding, with source lines src_stride bytes apart (0 for packed lines)
+ */
+dc1394error_t
+dc1394_convert_to_planar_stride(uint8_t *src, uint32_t src_stride, uint8_t *dest, uint32_t width, uint32_t height,
+                                uint32_t byte_order, dc1394color_coding_t source_coding, uint32_t bits,
+                                dc1394color_coding_t dest_coding);
+
 /**********************************************************************
  *  CONVERSION FUNCTIONS FOR STEREO IMAGES
  **********************************************************************/
@@ -177,6 +229,30 @@ dc1394_bayer_decoding_16bit(const uint16_t *bayer, uint16_t *rgb,
                             uint32_t width, uint32_t height, dc1394color_filter_t tile,
                             dc1394bayer_method_t method, uint32_t bits);
 
+/**
+ * Perform de-mosaicing on an 8-bit image buffer, with lines bayer_stride and rgb_stride bytes apart
+ *
+ * A stride of 0 stands for packed lines. The filter is that of the first pixel of the buffer. The nearest
+ * neighbor, simple, bilinear and HQ linear methods work on the buffers in place, the others go through packed
+ * copies of the images.
+ */
+dc1394error_t
+dc1394_bayer_decoding_8bit_stride(const uint8_t *bayer, uint32_t bayer_stride,
+                                  uint8_t *rgb, uint32_t rgb_stride,
+                                  uint32_t width, uint32_t height, dc1394color_filter_t tile,
+                                  dc1394bayer_method_t method);
+
+/**
+ * Perform de-mosaicing on a 16-bit image buffer, with lines bayer_stride and rgb_stride bytes apart
+ *
+ * Same as dc1394_bayer_decoding_8bit_stride(). The strides must be even.
+ */
+dc1394error_t
+dc1394_bayer_decoding_16bit_stride(const uint16_t *bayer, uint32_t bayer_stride,
+                                   uint16_t *rgb, uint32_t rgb_stride,
+                                   uint32_t width, uint32_t height, dc1394color_filter_t tile,
+                                   dc1394bayer_method_t method, uint32_t bits);
+
 
 /**********************************************************************************
  *  Frame based conversions
@@ -190,6 +266,21 @@ dc1394_bayer_decoding_16bit(const uint16_t *bayer, uint16_t *rgb,
 dc1394error_t
 dc1394_convert_frames(dc1394video_frame_t *in, dc1394video_frame_t *out);
 
+/**
+ * Converts the format of a rectangle of a video frame.
+ *
+ * Same as dc1394_convert_frames() for the width x height rectangle at (left, top) of the input frame. The
+ * output frame is width x height pixels and its lines are out->stride bytes apart, or packed if the stride is
+ * smaller than a line. To convert into a part of a larger image, set out->image to its first pixel,
+ * out->allocated_image_bytes to the bytes available from there and out->stride to the stride of that image.
+ * The input lines are in->stride bytes apart. For YUV422 and YUV411 frames, left and width must be multiples
+ * of 2 and 4 respectively. Planar outputs (see dc1394_convert_to_planar()) are always packed, with out->stride
+ * set to the width of their Y plane.
+ */
+dc1394error_t
+dc1394_convert_frames_rect(dc1394video_frame_t *in, dc1394video_frame_t *out,
+                           uint32_t left, uint32_t top, uint32_t width, uint32_t height);
+
 /**
  * De-mosaicing of a Bayer-encoded video frame
  *
@@ -203,6 +294,83 @@ dc1394_convert_frames(dc1394video_frame_t *in, dc1394video_frame_t *out);
 dc1394error_t
 dc1394_debayer_frames(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method);
 
+/**
+ * De-mosaicing of a rectangle of a Bayer-encoded video frame
+ *
+ * Same as dc1394_debayer_frames() for the width x height rectangle at (left, top) of the input frame, with the
+ * output lines out->stride bytes apart (see dc1394_convert_frames_rect()). The rectangle may start at any
+ * pixel: the color filter is adjusted accordingly.
+ */
+dc1394error_t
+dc1394_debayer_frames_rect(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method,
+                           uint32_t left, uint32_t top, uint32_t width, uint32_t height);
+
+/**
+ * De-mosaicing, white balance, color conversion and decimation of a Bayer-encoded video frame in a single pass
+ *
+ * The frame is processed in strips of rows small enough to stay in the cache: each strip is de-mosaiced with
+ * 'method', multiplied by the red, green and blue 'gains' (between 0 and 16, NULL for none), decimated by
+ * 'decimation' (1, 2 or 4) in both directions by averaging blocks of pixels and converted to the color coding of
+ * the output frame: DC1394_COLOR_CODING_RGB8, DC1394_COLOR_CODING_YUV422 (in the YUV byte order of the output
+ * frame) or one of the planar codings of dc1394_convert_to_planar(). The output lines are packed. The last column
+ * and line are dropped when needed to give the YUV outputs an even width and, for I420 and NV12, an even height.
+ * The strips are spread over the threads set by dc1394_debayer_set_num_threads().
+ */
+dc1394error_t
+dc1394_debayer_convert_frames(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394bayer_method_t method,
+                              const float *gains, uint32_t decimation);
+
+/**
+ * Sets the number of threads used by dc1394_debayer_frames()
+ *
+ * With more than one thread, frames are split into horizontal bands that are de-mosaiced in parallel by a pool
+ * of threads kept from one call to the next. The result is identical to the single-threaded one. The default is
+ * one thread, i.e. de-mosaicing is done by the calling thread only.
+ */
+dc1394error_t
+dc1394_debayer_set_num_threads(uint32_t num_threads);
+
+/**
+ * Gets the number of threads used by dc1394_debayer_frames()
+ */
+dc1394error_t
+dc1394_debayer_get_num_threads(uint32_t *num_threads);
+
+/**
+ * A workspace for the AHD de-mosaicing: the tile buffers and, optionally, threads that process the tiles in
+ * parallel. A workspace can be reused for any number of frames of any size but by one caller at a time; use one
+ * workspace per thread to decode several streams at once.
+ */
+typedef struct __dc1394ahd_workspace_t dc1394ahd_workspace_t;
+
+/**
+ * Creates an AHD workspace that uses num_threads threads (including the caller). Returns NULL on failure.
+ */
+dc1394ahd_workspace_t *
+dc1394_ahd_workspace_new(uint32_t num_threads);
+
+/**
+ * Frees an AHD workspace and stops its threads
+ */
+void
+dc1394_ahd_workspace_free(dc1394ahd_workspace_t *ws);
+
+/**
+ * AHD de-mosaicing of a raw buffer using a workspace. The result is identical to that of
+ * dc1394_bayer_decoding_8bit() with DC1394_BAYER_METHOD_AHD. A NULL workspace uses a tile buffer private to the
+ * calling thread.
+ */
+dc1394error_t
+dc1394_bayer_AHD_workspace(dc1394ahd_workspace_t *ws, const uint8_t *restrict bayer, uint8_t *restrict rgb,
+                           int sx, int sy, dc1394color_filter_t tile);
+
+/**
+ * 16-bit version of dc1394_bayer_AHD_workspace()
+ */
+dc1394error_t
+dc1394_bayer_AHD_uint16_workspace(dc1394ahd_workspace_t *ws, const uint16_t *restrict bayer, uint16_t *restrict rgb,
+                                  int sx, int sy, dc1394color_filter_t tile, int bits);
+
 /**
  * De-interlacing of stereo data for cideo frames
  *
@@ -211,6 +379,45 @@ dc1394_debayer_frames(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394b
 dc1394error_t
 dc1394_deinterlace_stereo_frames(dc1394video_frame_t *in, dc1394video_frame_t *out, dc1394stereo_method_t method);
 
+/**
+ * A conversion plan: a color conversion or a de-mosaicing prepared once for a stream of frames of the same color
+ * coding, size and stride. The plan owns the output frame, whose image is allocated once and aligned on 64 bytes,
+ * and picks the conversion routine when it is created. Executing it does no allocation. A plan is used by one
+ * caller at a time.
+ */
+typedef struct __dc1394conversion_plan_t dc1394conversion_plan_t;
+
+/**
+ * Creates a plan that converts frames like 'in' to the given color coding, as dc1394_convert_frames() would.
+ * The byte order is that of YUV422 outputs and is ignored for other color codings. Only the color coding,
+ * size, stride, data depth, YUV byte order and color filter of 'in' are used. Returns NULL if the conversion is
+ * not supported or on allocation failure.
+ */
+dc1394conversion_plan_t *
+dc1394_conversion_plan_new(const dc1394video_frame_t *in, dc1394color_coding_t color_coding, uint32_t byte_order);
+
+/**
+ * Creates a plan that de-mosaics frames like 'in' with the given method, as dc1394_debayer_frames() would.
+ * Returns NULL if the method or color coding is not supported or on allocation failure.
+ */
+dc1394conversion_plan_t *
+dc1394_debayer_plan_new(const dc1394video_frame_t *in, dc1394bayer_method_t method);
+
+/**
+ * Runs a plan on a frame. The input frame must have the color coding, size and stride the plan was made for.
+ * On success *out points to the output frame of the plan, which is overwritten by the next execution and must
+ * neither be freed nor passed as the output of the other conversion functions.
+ */
+dc1394error_t
+dc1394_conversion_plan_execute(dc1394conversion_plan_t *plan, const dc1394video_frame_t *in,
+                               dc1394video_frame_t **out);
+
+/**
+ * Frees a plan and its output frame
+ */
+void
+dc1394_conversion_plan_free(dc1394conversion_plan_t *plan);
+
 #ifdef __cplusplus
 }
 #endif
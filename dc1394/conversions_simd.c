@@ -0,0 +1,426 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * SIMD versions of the YUV to RGB8 conversions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  The kernels below evaluate the YUV2RGB macro of conversions.h on 16-bit
+  lanes and give bit-identical results:
+
+    r = y + ((v*1436) >> 10)
+    g = y - ((u*352 + v*731) >> 10)
+    b = y + ((u*1814) >> 10)
+
+  With u and v in -128..127, (v*1436) >> 10 is the high half of the 16x16
+  bit product (v<<6) * 1436, and the same holds for u*1814. The green term
+  is a sum of two products and is computed on 32 bits. Clamping to 0..255 is
+  done on 16 bits since y plus any of the terms fits easily.
+
+  The chroma is computed once per pair of pixels for YUV422 and YUV411, and
+  pixels are handled as an even and an odd half that share it.
+*/
+
+#include <string.h>
+#include "simd.h"
+#include "simd_store.h"
+
+#ifdef DC1394_SIMD_X86
+
+#define LOAD(p)    _mm_loadu_si128 ((const __m128i *) (p))
+
+/**********************************************************************
+ *  SSE2                                                              *
+ **********************************************************************/
+
+/* chroma terms of YUV2RGB for u, v in -128..127 */
+static inline void
+chroma_sse2 (__m128i u, __m128i v, __m128i *rv, __m128i *guv, __m128i *bu)
+{
+    const __m128i kg = _mm_set1_epi32 ((731 << 16) | 352);
+
+    *rv = _mm_mulhi_epi16 (_mm_slli_epi16 (v, 6), _mm_set1_epi16 (1436));
+    *bu = _mm_mulhi_epi16 (_mm_slli_epi16 (u, 6), _mm_set1_epi16 (1814));
+    *guv = _mm_packs_epi32 (
+        _mm_srai_epi32 (_mm_madd_epi16 (_mm_unpacklo_epi16 (u, v), kg), 10),
+        _mm_srai_epi32 (_mm_madd_epi16 (_mm_unpackhi_epi16 (u, v), kg), 10));
+}
+
+static inline __m128i
+clip_u8_sse2 (__m128i x)
+{
+    return _mm_min_epi16 (_mm_max_epi16 (x, _mm_setzero_si128 ()),
+                          _mm_set1_epi16 (255));
+}
+
+/* even pixels y0 with chroma (u0, v0), odd pixels y1 with (u1, v1) */
+static inline void
+yuv_emit_sse2 (uint8_t *rgb, __m128i y0, __m128i u0, __m128i v0,
+               __m128i y1, __m128i u1, __m128i v1)
+{
+    __m128i rv0, guv0, bu0, rv1, guv1, bu1;
+
+    chroma_sse2 (u0, v0, &rv0, &guv0, &bu0);
+    chroma_sse2 (u1, v1, &rv1, &guv1, &bu1);
+    emit_rgb8 (rgb,
+               clip_u8_sse2 (_mm_add_epi16 (y0, rv0)),
+               clip_u8_sse2 (_mm_sub_epi16 (y0, guv0)),
+               clip_u8_sse2 (_mm_add_epi16 (y0, bu0)),
+               clip_u8_sse2 (_mm_add_epi16 (y1, rv1)),
+               clip_u8_sse2 (_mm_sub_epi16 (y1, guv1)),
+               clip_u8_sse2 (_mm_add_epi16 (y1, bu1)), 1);
+}
+
+int
+yuv422_rgb8_sse2 (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy)
+{
+    const __m128i mask = _mm_set1_epi32 (0xff);
+    const __m128i c128 = _mm_set1_epi16 (128);
+    /* bit positions of y0 and u in each 32-bit Y0-U-Y1-V or U-Y0-V-Y1 group;
+       y1 and v follow 16 bits higher */
+    const __m128i sy = _mm_cvtsi32_si128 (uyvy ? 8 : 0);
+    const __m128i su = _mm_cvtsi32_si128 (uyvy ? 0 : 8);
+    const __m128i s16 = _mm_cvtsi32_si128 (16);
+    int n;
+
+    for (n = 0; n + 16 <= pixels; n += 16, src += 32, rgb += 48) {
+        __m128i a = LOAD (src);
+        __m128i b = LOAD (src + 16);
+        __m128i ya = _mm_srl_epi32 (a, sy), yb = _mm_srl_epi32 (b, sy);
+        __m128i ca = _mm_srl_epi32 (a, su), cb = _mm_srl_epi32 (b, su);
+        __m128i y0, y1, u, v;
+
+        y0 = _mm_packs_epi32 (_mm_and_si128 (ya, mask), _mm_and_si128 (yb, mask));
+        y1 = _mm_packs_epi32 (_mm_and_si128 (_mm_srl_epi32 (ya, s16), mask),
+                              _mm_and_si128 (_mm_srl_epi32 (yb, s16), mask));
+        u = _mm_packs_epi32 (_mm_and_si128 (ca, mask), _mm_and_si128 (cb, mask));
+        v = _mm_packs_epi32 (_mm_and_si128 (_mm_srl_epi32 (ca, s16), mask),
+                             _mm_and_si128 (_mm_srl_epi32 (cb, s16), mask));
+        u = _mm_sub_epi16 (u, c128);
+        v = _mm_sub_epi16 (v, c128);
+
+        yuv_emit_sse2 (rgb, y0, u, v, y1, u, v);
+    }
+    return n;
+}
+
+int
+yuv422_planar_sse2 (const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, int pixels, int uyvy)
+{
+    const __m128i mask = _mm_set1_epi16 (0xff);
+    /* bit positions of the luma and chroma samples in each 16-bit pair */
+    const __m128i sy = _mm_cvtsi32_si128 (uyvy ? 8 : 0);
+    const __m128i sc = _mm_cvtsi32_si128 (uyvy ? 0 : 8);
+    int n;
+
+    for (n = 0; n + 16 <= pixels; n += 16, src += 32) {
+        __m128i a = LOAD (src);
+        __m128i b = LOAD (src + 16);
+        __m128i luma = _mm_packus_epi16 (_mm_and_si128 (_mm_srl_epi16 (a, sy), mask),
+                                         _mm_and_si128 (_mm_srl_epi16 (b, sy), mask));
+        /* U-V pairs */
+        __m128i chroma = _mm_packus_epi16 (_mm_and_si128 (_mm_srl_epi16 (a, sc), mask),
+                                           _mm_and_si128 (_mm_srl_epi16 (b, sc), mask));
+        __m128i cu = _mm_and_si128 (chroma, mask);
+        __m128i cv = _mm_srli_epi16 (chroma, 8);
+
+        _mm_storeu_si128 ((__m128i *) (y + n), luma);
+        _mm_storel_epi64 ((__m128i *) (u + n / 2), _mm_packus_epi16 (cu, cu));
+        _mm_storel_epi64 ((__m128i *) (v + n / 2), _mm_packus_epi16 (cv, cv));
+    }
+    return n;
+}
+
+/**********************************************************************
+ *  SSSE3                                                             *
+ **********************************************************************/
+
+/*
+  YUV411 (U-Y0-Y1-V-Y2-Y3) and YUV444 (U-Y-V) need byte shuffles to split
+  the samples. These kernels are only selected together with the AVX2 ones.
+*/
+
+#define SSSE3 __attribute__ ((target ("ssse3")))
+
+/* shuffle bytes of a and b into one vector: the even half then the odd half */
+static inline SSSE3 __m128i
+shuffle2 (__m128i a, __m128i b, __m128i ma, __m128i mb)
+{
+    return _mm_or_si128 (_mm_shuffle_epi8 (a, ma), _mm_shuffle_epi8 (b, mb));
+}
+
+static inline SSSE3 __m128i
+shuffle3 (__m128i a, __m128i b, __m128i c, __m128i ma, __m128i mb, __m128i mc)
+{
+    return _mm_or_si128 (shuffle2 (a, b, ma, mb), _mm_shuffle_epi8 (c, mc));
+}
+
+SSSE3 int
+yuv411_rgb8_ssse3 (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i c128 = _mm_set1_epi16 (128);
+    /* 16 pixels are 24 bytes, read as bytes 0..15 and 8..23 */
+    const __m128i my_lo = _mm_setr_epi8 (1, 4, 7, 10, 13, -1, -1, -1,
+                                         2, 5, 8, 11, 14, -1, -1, -1);
+    const __m128i my_hi = _mm_setr_epi8 (-1, -1, -1, -1, -1, 8, 11, 14,
+                                         -1, -1, -1, -1, -1, 9, 12, 15);
+    /* u then v of each pair of pixels */
+    const __m128i mc_lo = _mm_setr_epi8 (0, 0, 6, 6, 12, 12, -1, -1,
+                                         3, 3, 9, 9, 15, 15, -1, -1);
+    const __m128i mc_hi = _mm_setr_epi8 (-1, -1, -1, -1, -1, -1, 10, 10,
+                                         -1, -1, -1, -1, -1, -1, 13, 13);
+    int n;
+
+    for (n = 0; n + 16 <= pixels; n += 16, src += 24, rgb += 48) {
+        __m128i lo = LOAD (src);
+        __m128i hi = LOAD (src + 8);
+        __m128i y = shuffle2 (lo, hi, my_lo, my_hi);
+        __m128i c = shuffle2 (lo, hi, mc_lo, mc_hi);
+        __m128i u = _mm_sub_epi16 (_mm_unpacklo_epi8 (c, zero), c128);
+        __m128i v = _mm_sub_epi16 (_mm_unpackhi_epi8 (c, zero), c128);
+
+        yuv_emit_sse2 (rgb, _mm_unpacklo_epi8 (y, zero), u, v,
+                       _mm_unpackhi_epi8 (y, zero), u, v);
+    }
+    return n;
+}
+
+SSSE3 int
+yuv444_rgb8_ssse3 (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i c128 = _mm_set1_epi16 (128);
+    /* 16 pixels are 48 bytes: one mask per component and source vector */
+    const __m128i mu0 = _mm_setr_epi8 ( 0,  6, 12, -1, -1, -1, -1, -1,  3,  9, 15, -1, -1, -1, -1, -1);
+    const __m128i mu1 = _mm_setr_epi8 (-1, -1, -1,  2,  8, 14, -1, -1, -1, -1, -1,  5, 11, -1, -1, -1);
+    const __m128i mu2 = _mm_setr_epi8 (-1, -1, -1, -1, -1, -1,  4, 10, -1, -1, -1, -1, -1,  1,  7, 13);
+    const __m128i my0 = _mm_setr_epi8 ( 1,  7, 13, -1, -1, -1, -1, -1,  4, 10, -1, -1, -1, -1, -1, -1);
+    const __m128i my1 = _mm_setr_epi8 (-1, -1, -1,  3,  9, 15, -1, -1, -1, -1,  0,  6, 12, -1, -1, -1);
+    const __m128i my2 = _mm_setr_epi8 (-1, -1, -1, -1, -1, -1,  5, 11, -1, -1, -1, -1, -1,  2,  8, 14);
+    const __m128i mv0 = _mm_setr_epi8 ( 2,  8, 14, -1, -1, -1, -1, -1,  5, 11, -1, -1, -1, -1, -1, -1);
+    const __m128i mv1 = _mm_setr_epi8 (-1, -1, -1,  4, 10, -1, -1, -1, -1, -1,  1,  7, 13, -1, -1, -1);
+    const __m128i mv2 = _mm_setr_epi8 (-1, -1, -1, -1, -1,  0,  6, 12, -1, -1, -1, -1, -1,  3,  9, 15);
+    int n;
+
+    for (n = 0; n + 16 <= pixels; n += 16, src += 48, rgb += 48) {
+        __m128i a = LOAD (src);
+        __m128i b = LOAD (src + 16);
+        __m128i c = LOAD (src + 32);
+        __m128i y = shuffle3 (a, b, c, my0, my1, my2);
+        __m128i u = shuffle3 (a, b, c, mu0, mu1, mu2);
+        __m128i v = shuffle3 (a, b, c, mv0, mv1, mv2);
+
+        yuv_emit_sse2 (rgb,
+                       _mm_unpacklo_epi8 (y, zero),
+                       _mm_sub_epi16 (_mm_unpacklo_epi8 (u, zero), c128),
+                       _mm_sub_epi16 (_mm_unpacklo_epi8 (v, zero), c128),
+                       _mm_unpackhi_epi8 (y, zero),
+                       _mm_sub_epi16 (_mm_unpackhi_epi8 (u, zero), c128),
+                       _mm_sub_epi16 (_mm_unpackhi_epi8 (v, zero), c128));
+    }
+    return n;
+}
+
+/**********************************************************************
+ *  AVX2                                                              *
+ **********************************************************************/
+
+#define AVX2 __attribute__ ((target ("avx2")))
+
+#define LOAD256(p)     _mm256_loadu_si256 ((const __m256i *) (p))
+#define LO(v)          _mm256_castsi256_si128 (v)
+#define HI(v)          _mm256_extracti128_si256 (v, 1)
+
+static inline AVX2 __m256i
+clip_u8_avx2 (__m256i x)
+{
+    return _mm256_min_epi16 (_mm256_max_epi16 (x, _mm256_setzero_si256 ()),
+                             _mm256_set1_epi16 (255));
+}
+
+/* pack the 32-bit lanes of a and b to 16 bits, keeping them in order */
+static inline AVX2 __m256i
+pack_ordered (__m256i a, __m256i b)
+{
+    return _mm256_permute4x64_epi64 (_mm256_packs_epi32 (a, b), 0xd8);
+}
+
+AVX2 int
+yuv422_rgb8_avx2 (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy)
+{
+    const __m256i mask = _mm256_set1_epi32 (0xff);
+    const __m256i c128 = _mm256_set1_epi16 (128);
+    const __m256i kg = _mm256_set1_epi32 ((731 << 16) | 352);
+    const __m128i sy = _mm_cvtsi32_si128 (uyvy ? 8 : 0);
+    const __m128i su = _mm_cvtsi32_si128 (uyvy ? 0 : 8);
+    const __m128i s16 = _mm_cvtsi32_si128 (16);
+    int n;
+
+    for (n = 0; n + 32 <= pixels; n += 32, src += 64, rgb += 96) {
+        __m256i a = LOAD256 (src);
+        __m256i b = LOAD256 (src + 32);
+        __m256i ya = _mm256_srl_epi32 (a, sy), yb = _mm256_srl_epi32 (b, sy);
+        __m256i ca = _mm256_srl_epi32 (a, su), cb = _mm256_srl_epi32 (b, su);
+        __m256i y0, y1, u, v, rv, guv, bu, r0, g0, b0, r1, g1, b1;
+
+        y0 = pack_ordered (_mm256_and_si256 (ya, mask), _mm256_and_si256 (yb, mask));
+        y1 = pack_ordered (_mm256_and_si256 (_mm256_srl_epi32 (ya, s16), mask),
+                           _mm256_and_si256 (_mm256_srl_epi32 (yb, s16), mask));
+        u = pack_ordered (_mm256_and_si256 (ca, mask), _mm256_and_si256 (cb, mask));
+        v = pack_ordered (_mm256_and_si256 (_mm256_srl_epi32 (ca, s16), mask),
+                          _mm256_and_si256 (_mm256_srl_epi32 (cb, s16), mask));
+        u = _mm256_sub_epi16 (u, c128);
+        v = _mm256_sub_epi16 (v, c128);
+
+        rv = _mm256_mulhi_epi16 (_mm256_slli_epi16 (v, 6), _mm256_set1_epi16 (1436));
+        bu = _mm256_mulhi_epi16 (_mm256_slli_epi16 (u, 6), _mm256_set1_epi16 (1814));
+        /* unpack and pack are both lane-local, so the order is preserved */
+        guv = _mm256_packs_epi32 (
+            _mm256_srai_epi32 (_mm256_madd_epi16 (_mm256_unpacklo_epi16 (u, v), kg), 10),
+            _mm256_srai_epi32 (_mm256_madd_epi16 (_mm256_unpackhi_epi16 (u, v), kg), 10));
+
+        r0 = clip_u8_avx2 (_mm256_add_epi16 (y0, rv));
+        g0 = clip_u8_avx2 (_mm256_sub_epi16 (y0, guv));
+        b0 = clip_u8_avx2 (_mm256_add_epi16 (y0, bu));
+        r1 = clip_u8_avx2 (_mm256_add_epi16 (y1, rv));
+        g1 = clip_u8_avx2 (_mm256_sub_epi16 (y1, guv));
+        b1 = clip_u8_avx2 (_mm256_add_epi16 (y1, bu));
+
+        emit_rgb8 (rgb,      LO (r0), LO (g0), LO (b0), LO (r1), LO (g1), LO (b1), 1);
+        emit_rgb8 (rgb + 48, HI (r0), HI (g0), HI (b0), HI (r1), HI (g1), HI (b1), 1);
+    }
+    return n;
+}
+
+#endif /* DC1394_SIMD_X86 */
+
+#ifdef DC1394_SIMD_NEON
+
+/**********************************************************************
+ *  NEON                                                              *
+ **********************************************************************/
+
+/* the samples of one kind, widened and centered */
+#define CHROMA_NEON(x) vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (x)), vdupq_n_s16 (128))
+
+static inline void
+chroma_neon (int16x8_t u, int16x8_t v, int16x8_t *rv, int16x8_t *guv, int16x8_t *bu)
+{
+    int32x4_t lo, hi;
+
+    *rv = vcombine_s16 (vshrn_n_s32 (vmull_n_s16 (vget_low_s16 (v), 1436), 10),
+                        vshrn_n_s32 (vmull_n_s16 (vget_high_s16 (v), 1436), 10));
+    *bu = vcombine_s16 (vshrn_n_s32 (vmull_n_s16 (vget_low_s16 (u), 1814), 10),
+                        vshrn_n_s32 (vmull_n_s16 (vget_high_s16 (u), 1814), 10));
+    lo = vmlal_n_s16 (vmull_n_s16 (vget_low_s16 (u), 352), vget_low_s16 (v), 731);
+    hi = vmlal_n_s16 (vmull_n_s16 (vget_high_s16 (u), 352), vget_high_s16 (v), 731);
+    *guv = vcombine_s16 (vshrn_n_s32 (lo, 10), vshrn_n_s32 (hi, 10));
+}
+
+#define ADD_U8(y, t) vqmovun_s16 (vaddq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (y)), t))
+#define SUB_U8(y, t) vqmovun_s16 (vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (y)), t))
+
+/* even pixels y0 and odd pixels y1 sharing the chroma of (u, v) */
+static inline void
+yuv_emit_neon (uint8_t *rgb, uint8x8_t y0, uint8x8_t y1, uint8x8_t u, uint8x8_t v)
+{
+    int16x8_t rv, guv, bu;
+
+    chroma_neon (CHROMA_NEON (u), CHROMA_NEON (v), &rv, &guv, &bu);
+    emit_rgb8_neon (rgb, ADD_U8 (y0, rv), SUB_U8 (y0, guv), ADD_U8 (y0, bu),
+                    ADD_U8 (y1, rv), SUB_U8 (y1, guv), ADD_U8 (y1, bu), 1);
+}
+
+int
+yuv422_rgb8_neon (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy)
+{
+    int n;
+
+    for (n = 0; n + 16 <= pixels; n += 16, src += 32, rgb += 48) {
+        uint8x8x4_t s = vld4_u8 (src);
+
+        if (uyvy)
+            yuv_emit_neon (rgb, s.val[1], s.val[3], s.val[0], s.val[2]);
+        else
+            yuv_emit_neon (rgb, s.val[0], s.val[2], s.val[1], s.val[3]);
+    }
+    return n;
+}
+
+int
+yuv411_rgb8_neon (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy)
+{
+    int n;
+
+    /* read as triplets U-Y0-Y1 and V-Y2-Y3: the second and third samples
+       are the even and odd pixels, the first alternates between u and v */
+    for (n = 0; n + 16 <= pixels; n += 16, src += 24, rgb += 48) {
+        uint8x8x3_t s = vld3_u8 (src);
+        uint8x8x2_t c = vtrn_u8 (s.val[0], s.val[0]);
+
+        yuv_emit_neon (rgb, s.val[1], s.val[2], c.val[0], c.val[1]);
+    }
+    return n;
+}
+
+int
+yuv444_rgb8_neon (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy)
+{
+    int n;
+
+    for (n = 0; n + 8 <= pixels; n += 8, src += 24, rgb += 24) {
+        uint8x8x3_t s = vld3_u8 (src);
+        uint8x8x3_t px;
+        int16x8_t rv, guv, bu;
+
+        chroma_neon (CHROMA_NEON (s.val[0]), CHROMA_NEON (s.val[2]), &rv, &guv, &bu);
+        px.val[0] = ADD_U8 (s.val[1], rv);
+        px.val[1] = SUB_U8 (s.val[1], guv);
+        px.val[2] = ADD_U8 (s.val[1], bu);
+        vst3_u8 (rgb, px);
+    }
+    return n;
+}
+
+int
+yuv422_planar_neon (const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, int pixels, int uyvy)
+{
+    int n;
+
+    for (n = 0; n + 32 <= pixels; n += 32, src += 64) {
+        uint8x16x4_t s = vld4q_u8 (src);
+        uint8x16x2_t luma;
+
+        if (uyvy) {
+            luma.val[0] = s.val[1];
+            luma.val[1] = s.val[3];
+            vst1q_u8 (u + n / 2, s.val[0]);
+            vst1q_u8 (v + n / 2, s.val[2]);
+        }
+        else {
+            luma.val[0] = s.val[0];
+            luma.val[1] = s.val[2];
+            vst1q_u8 (u + n / 2, s.val[1]);
+            vst1q_u8 (v + n / 2, s.val[3]);
+        }
+        vst2q_u8 (y + n, luma);
+    }
+    return n;
+}
+
+#endif /* DC1394_SIMD_NEON */
@@ -52,6 +52,9 @@
 #include <dc1394/log.h>
 #include <dc1394/register.h>
 #include <dc1394/video.h>
+#include <dc1394/record.h>
+#include <dc1394/group.h>
+#include <dc1394/async.h>
 #include <dc1394/utils.h>
 
 #endif
@@ -0,0 +1,381 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Synchronized capture from groups of cameras
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "config.h"
+#include "internal.h"
+#include "capture.h"
+#include "group.h"
+#include "log.h"
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#elif defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+typedef struct {
+    dc1394video_frame_t * frame;
+    int64_t time;                    /* [microseconds] */
+} group_frame_t;
+
+typedef struct {
+    dc1394camera_t * camera;
+    int fd;
+    /* the frames kept, oldest first */
+    group_frame_t pending[DC1394_GROUP_MAX_PENDING];
+    int first;
+    int count;
+} group_camera_t;
+
+struct __dc1394group_t {
+    uint32_t num_cameras;
+    group_camera_t * cameras;
+    int64_t tolerance;
+    uint32_t flags;
+
+#if defined(HAVE_SYS_EPOLL_H)
+    int epoll_fd;
+#elif defined(HAVE_POLL_H)
+    struct pollfd * fds;
+#endif
+
+    /* the last cycle matched on, unwrapped into last_time */
+    uint32_t last_cycles;
+    int64_t last_time;
+};
+
+/* the time to match a frame on */
+static int64_t
+frame_time (dc1394group_t * g, const dc1394video_frame_t * frame)
+{
+    uint32_t cycles;
+    int32_t delta;
+
+    if (!(g->flags & DC1394_GROUP_FLAGS_MATCH_CYCLE))
+        return frame->timestamp;
+
+    /* 3 bits of seconds and 13 bits of cycles wrap every 8 seconds: the
+       frame is placed within 4 seconds of the last one */
+    cycles = ((frame->iso_cycle >> 13) & 0x7) * 8000 + (frame->iso_cycle & 0x1fff);
+    delta = (cycles + 64000 - g->last_cycles) % 64000;
+    if (delta >= 32000)
+        delta -= 64000;
+    g->last_cycles = cycles;
+    g->last_time += (int64_t) delta * 125;
+    return g->last_time;
+}
+
+static group_frame_t *
+head (group_camera_t * c)
+{
+    return c->count ? c->pending + c->first : NULL;
+}
+
+static dc1394video_frame_t *
+pop (group_camera_t * c)
+{
+    dc1394video_frame_t * frame = c->pending[c->first].frame;
+
+    c->first = (c->first + 1) % DC1394_GROUP_MAX_PENDING;
+    c->count--;
+    return frame;
+}
+
+/* gives the oldest frame kept back to its camera */
+static void
+drop (group_camera_t * c)
+{
+    if (dc1394_capture_enqueue (c->camera, pop (c)) != DC1394_SUCCESS)
+        dc1394_log_warning ("Group: could not give back a frame");
+}
+
+/* takes the frames the cameras have captured */
+static dc1394error_t
+pull_frames (dc1394group_t * g)
+{
+    dc1394video_frame_t * frame;
+    group_frame_t * f;
+    dc1394error_t err;
+    uint32_t i;
+
+    for (i = 0; i < g->num_cameras; i++) {
+        group_camera_t * c = g->cameras + i;
+        for (;;) {
+            err = dc1394_capture_dequeue (c->camera, DC1394_CAPTURE_POLICY_POLL,
+                    &frame);
+            DC1394_ERR_RTN(err, "Could not dequeue a frame");
+            if (!frame)
+                break;
+            if (c->count == DC1394_GROUP_MAX_PENDING)
+                drop (c);
+            f = c->pending + (c->first + c->count) % DC1394_GROUP_MAX_PENDING;
+            f->frame = frame;
+            f->time = frame_time (g, frame);
+            c->count++;
+        }
+    }
+    return DC1394_SUCCESS;
+}
+
+/*
+  Gives back the frames that can no longer be part of a set: older than the
+  tolerance before the latest of the oldest frames of each camera, since all
+  the frames of that camera are later. Returns 1 if the oldest frames then
+  make a complete set.
+*/
+static int
+match_set (dc1394group_t * g)
+{
+    group_frame_t * f;
+    int64_t latest;
+    uint32_t i;
+    int dropped;
+
+    for (;;) {
+        latest = INT64_MIN;
+        for (i = 0; i < g->num_cameras; i++) {
+            f = head (g->cameras + i);
+            if (!f)
+                return 0;
+            if (f->time > latest)
+                latest = f->time;
+        }
+
+        dropped = 0;
+        for (i = 0; i < g->num_cameras; i++) {
+            f = head (g->cameras + i);
+            if (f->time + g->tolerance < latest) {
+                drop (g->cameras + i);
+                dropped = 1;
+            }
+        }
+        if (!dropped)
+            return 1;
+    }
+}
+
+/* takes the oldest frames of each camera that are within the tolerance of
+   the latest of them */
+static void
+take_set (dc1394group_t * g, dc1394video_frame_t ** frames,
+        uint32_t * num_frames)
+{
+    group_frame_t * f;
+    int64_t latest = INT64_MIN;
+    uint32_t i;
+
+    for (i = 0; i < g->num_cameras; i++) {
+        f = head (g->cameras + i);
+        if (f && f->time > latest)
+            latest = f->time;
+    }
+
+    for (i = 0; i < g->num_cameras; i++) {
+        f = head (g->cameras + i);
+        if (f && f->time + g->tolerance >= latest) {
+            frames[i] = pop (g->cameras + i);
+            (*num_frames)++;
+        }
+    }
+}
+
+/* waits for frames from any camera. Returns -1 on failure. */
+static int
+wait_frames (dc1394group_t * g, int timeout_ms)
+{
+    int n;
+
+#if defined(HAVE_SYS_EPOLL_H)
+    struct epoll_event events[8];
+    n = epoll_wait (g->epoll_fd, events, 8, timeout_ms);
+#elif defined(HAVE_POLL_H)
+    n = poll (g->fds, g->num_cameras, timeout_ms);
+#else
+    n = -1;
+#endif
+    if (n < 0 && errno == EINTR)
+        n = 0;
+    return n;
+}
+
+dc1394group_t *
+dc1394_group_new(dc1394camera_t **cameras, uint32_t num_cameras, uint32_t tolerance_us, uint32_t flags)
+{
+    dc1394group_t * g;
+    uint32_t i;
+
+    if (!cameras || num_cameras == 0)
+        return NULL;
+
+    g = calloc (1, sizeof (dc1394group_t));
+    if (!g)
+        return NULL;
+    g->cameras = calloc (num_cameras, sizeof (group_camera_t));
+    if (!g->cameras) {
+        free (g);
+        return NULL;
+    }
+    g->num_cameras = num_cameras;
+    g->tolerance = tolerance_us;
+    g->flags = flags;
+
+#if defined(HAVE_SYS_EPOLL_H)
+    g->epoll_fd = epoll_create (num_cameras);
+    if (g->epoll_fd < 0) {
+        dc1394_log_error ("Group: could not create an epoll instance: %s", strerror (errno));
+        free (g->cameras);
+        free (g);
+        return NULL;
+    }
+#elif defined(HAVE_POLL_H)
+    g->fds = calloc (num_cameras, sizeof (struct pollfd));
+    if (!g->fds) {
+        free (g->cameras);
+        free (g);
+        return NULL;
+    }
+#else
+    dc1394_log_error ("Group: no way to wait for several cameras on this system");
+    free (g->cameras);
+    free (g);
+    return NULL;
+#endif
+
+    for (i = 0; i < num_cameras; i++) {
+        group_camera_t * c = g->cameras + i;
+        c->camera = cameras[i];
+        c->fd = dc1394_capture_get_fileno (cameras[i]);
+        if (c->fd < 0) {
+            dc1394_log_error ("Group: camera %d has no capture to wait for", i);
+            g->num_cameras = i;
+            dc1394_group_free (g);
+            return NULL;
+        }
+#if defined(HAVE_SYS_EPOLL_H)
+        {
+            struct epoll_event event;
+            memset (&event, 0, sizeof event);
+            event.events = EPOLLIN;
+            event.data.u32 = i;
+            if (epoll_ctl (g->epoll_fd, EPOLL_CTL_ADD, c->fd, &event) < 0) {
+                dc1394_log_error ("Group: could not wait for camera %d: %s", i, strerror (errno));
+                g->num_cameras = i;
+                dc1394_group_free (g);
+                return NULL;
+            }
+        }
+#elif defined(HAVE_POLL_H)
+        g->fds[i].fd = c->fd;
+        g->fds[i].events = POLLIN;
+#endif
+    }
+
+    return g;
+}
+
+void
+dc1394_group_free(dc1394group_t *group)
+{
+    uint32_t i;
+
+    if (!group)
+        return;
+
+    for (i = 0; i < group->num_cameras; i++) {
+        while (group->cameras[i].count)
+            drop (group->cameras + i);
+    }
+
+#if defined(HAVE_SYS_EPOLL_H)
+    close (group->epoll_fd);
+#elif defined(HAVE_POLL_H)
+    free (group->fds);
+#endif
+    free (group->cameras);
+    free (group);
+}
+
+dc1394error_t
+dc1394_group_dequeue(dc1394group_t *group, uint32_t timeout_us, dc1394video_frame_t **frames,
+                     uint32_t *num_frames)
+{
+    struct timespec deadline, now;
+    int64_t left_us;
+    dc1394error_t err;
+    uint32_t i;
+
+    *num_frames = 0;
+    for (i = 0; i < group->num_cameras; i++)
+        frames[i] = NULL;
+
+    clock_gettime (CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_us / 1000000;
+    deadline.tv_nsec += (timeout_us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    for (;;) {
+        err = pull_frames (group);
+        if (err != DC1394_SUCCESS)
+            return err;
+
+        if (match_set (group))
+            break;
+
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        left_us = (deadline.tv_sec - now.tv_sec) * 1000000LL
+            + (deadline.tv_nsec - now.tv_nsec) / 1000;
+        if (left_us <= 0)
+            break;
+
+        /* wait() counts in milliseconds: round up, not to return early */
+        if (wait_frames (group, (left_us + 999) / 1000) < 0) {
+            dc1394_log_error ("Group: could not wait for the cameras: %s", strerror (errno));
+            return DC1394_FAILURE;
+        }
+    }
+
+    take_set (group, frames, num_frames);
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_group_enqueue(dc1394group_t *group, dc1394video_frame_t **frames)
+{
+    dc1394error_t err, ret = DC1394_SUCCESS;
+    uint32_t i;
+
+    for (i = 0; i < group->num_cameras; i++) {
+        if (!frames[i])
+            continue;
+        err = dc1394_capture_enqueue (group->cameras[i].camera, frames[i]);
+        if (err != DC1394_SUCCESS)
+            ret = err;
+        frames[i] = NULL;
+    }
+    return ret;
+}
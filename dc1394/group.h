@@ -0,0 +1,97 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Synchronized capture from groups of cameras
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdint.h>
+#include <dc1394/log.h>
+#include <dc1394/camera.h>
+#include <dc1394/video.h>
+
+#ifndef __DC1394_GROUP_H__
+#define __DC1394_GROUP_H__
+
+/*! \file dc1394/group.h
+    \brief Synchronized capture from groups of cameras
+
+    A group captures from several cameras at once, from a single thread. It
+    waits for the frames of all the cameras together, and gives them as sets
+    of frames taken at the same time: their timestamps, or bus cycles, are
+    within a tolerance. Frames that cannot be part of a set are given back to
+    their camera.
+*/
+
+/**
+ * Group flags
+ */
+#define DC1394_GROUP_FLAGS_MATCH_CYCLE     0x00000001U /* match the frames on their iso_cycle rather than their
+                                                          timestamp: for cameras on the same bus, with juju */
+
+/**
+ * The number of frames of each camera a group may keep while it waits for the frames of the other cameras.
+ * The cameras need more DMA buffers than that.
+ */
+#define DC1394_GROUP_MAX_PENDING           4
+
+/**
+ * A group of cameras
+ */
+typedef struct __dc1394group_t dc1394group_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************
+     Group Functions
+ ***************************************************************************/
+
+/**
+ * Creates a group of cameras, whose capture must already be set up with dc1394_capture_setup(). The frames of a
+ * set are at most tolerance_us microseconds apart. Returns NULL on failure.
+ */
+dc1394group_t *
+dc1394_group_new(dc1394camera_t **cameras, uint32_t num_cameras, uint32_t tolerance_us, uint32_t flags);
+
+/**
+ * Frees a group and gives back to their cameras the frames it kept. The capture of the cameras goes on.
+ */
+void
+dc1394_group_free(dc1394group_t *group);
+
+/**
+ * Captures a set of frames, one per camera in the order of the group: frames must have room for num_cameras
+ * frames. Waits at most timeout_us microseconds for a complete set, else gives the partial set of the frames
+ * captured, in which the frames of the missing cameras are NULL. num_frames is the number of frames of the set,
+ * which is num_cameras if the set is complete and 0 if no camera gave a frame.
+ */
+dc1394error_t
+dc1394_group_dequeue(dc1394group_t *group, uint32_t timeout_us, dc1394video_frame_t **frames,
+                     uint32_t *num_frames);
+
+/**
+ * Gives back to their cameras the frames of a set, like dc1394_capture_enqueue() does for each of them.
+ */
+dc1394error_t
+dc1394_group_enqueue(dc1394group_t *group, dc1394video_frame_t **frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -279,6 +279,10 @@ capture_basic_setup (dc1394camera_t * camera, dc1394video_frame_t * frame)
 
     frame->little_endian=0;   // not used before 1.32 is out.
     frame->data_in_padding=0; // not used before 1.32 is out.
+    frame->timestamp=0;
+    frame->iso_cycle=0;
+    frame->references=0;
+    frame->sequence=0;
 
     return DC1394_SUCCESS;
 }
@@ -26,6 +26,11 @@
 #include "config.h"
 #include "offsets.h"
 #include "platform.h"
+#include <dc1394/capture.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 typedef struct _platform_info_t {
     const platform_dispatch_t * dispatch;
@@ -34,6 +39,13 @@ typedef struct _platform_info_t {
     platform_t * p;
 } platform_info_t;
 
+/* a frame dequeued by the user, which goes back to the backend once it and
+   all the older ones are released */
+typedef struct {
+    dc1394video_frame_t * frame;
+    int released;
+} capture_held_t;
+
 typedef struct _dc1394camera_priv_t {
     dc1394camera_t camera;
 
@@ -43,6 +55,31 @@ typedef struct _dc1394camera_priv_t {
     uint64_t allocated_channels;
     int allocated_bandwidth;
     int iso_persist;
+
+    /* the accounting of the capture, by the thread that dequeues */
+    dc1394capture_stats_t capture_stats;
+    int capture_is_set;
+    uint32_t capture_buffers;
+    uint64_t frame_interval;         /* [microseconds] from the framerate, 0 for scalable modes */
+    uint64_t min_frame_interval;     /* [microseconds] the shortest seen, for scalable modes */
+    /* the frames come at the framerate unless the trigger or the shots are
+       on: both are set by the thread that controls the camera */
+    int trigger_on;
+    int shots_on;                    /* one-shot or multi-shot */
+    int restarted;                   /* the transmission started again since the last frame */
+    int sequenced;                   /* last_sequence is that of a frame */
+    uint64_t last_sequence;
+    uint64_t last_timestamp;
+    uint32_t last_cycle;
+
+    /* the frames dequeued and not given back to the backend yet, oldest
+       first, in a ring of capture_buffers entries */
+    capture_held_t * held;
+    uint32_t first_held;
+    uint32_t num_held;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t held_mutex;
+#endif
 } dc1394camera_priv_t;
 
 #define DC1394_CAMERA_PRIV(c) ((dc1394camera_priv_t *)c)
@@ -75,6 +112,8 @@ void linux_init(dc1394_t *d);
 void macosx_init(dc1394_t *d);
 void windows_init(dc1394_t *d);
 void usb_init(dc1394_t *d);
+void sim_init(dc1394_t *d);
+void replay_init(dc1394_t *d);
 
 void register_platform (dc1394_t * d, const platform_dispatch_t * dispatch,
         const char * name);
@@ -188,4 +227,20 @@ _dc1394_iidc_check_video_mode(dc1394camera_t *camera, dc1394video_mode_t *mode);
 */
 dc1394error_t capture_basic_setup (dc1394camera_t * camera, dc1394video_frame_t * frame);
 
+void capture_update_frame_interval (dc1394camera_t * camera);
+void capture_set_trigger (dc1394camera_t * camera, int on);
+void capture_set_shots (dc1394camera_t * camera, int on);
+void capture_restart (dc1394camera_t * camera);
+
+#ifdef HAVE_POLL_H
+/* waits up to timeout_us for fd to be readable, through the interruptions
+   by signals: returns 1 once it is, 0 on timeout and -1 on errors */
+int capture_wait_readable (int fd, uint32_t timeout_us);
+#endif
+
+/* the distance between the frames of a ring buffer placed with
+   dc1394_capture_set_buffer() */
+#define CAPTURE_FRAME_STRIDE(total_bytes) \
+    (((total_bytes) + DC1394_CAPTURE_BUFFER_ALIGN - 1) / DC1394_CAPTURE_BUFFER_ALIGN * DC1394_CAPTURE_BUFFER_ALIGN)
+
 #endif /* _DC1394_INTERNAL_H */
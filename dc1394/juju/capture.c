@@ -20,6 +20,9 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+/* for ppoll() */
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,6 +36,7 @@
 #include <errno.h>
 #include <poll.h>
 #include <inttypes.h>
+#include <time.h>
 
 #include "juju/juju.h"
 
@@ -101,6 +105,156 @@ queue_frame (platform_camera_t *craw, int index)
     return DC1394_SUCCESS;
 }
 
+/*
+  Reads the cycle timer together with CLOCK_MONOTONIC. Kernels older than
+  2.6.33 only give the system time, which is moved to CLOCK_MONOTONIC.
+*/
+static dc1394error_t
+refresh_clock (platform_camera_t *craw)
+{
+    struct fw_cdev_get_cycle_timer2 tm2;
+    struct fw_cdev_get_cycle_timer tm;
+    struct timespec real, mono;
+
+    tm2.clk_id = CLOCK_MONOTONIC;
+    if (ioctl(craw->fd, FW_CDEV_IOC_GET_CYCLE_TIMER2, &tm2) == 0) {
+        craw->clock_cycle_timer = tm2.cycle_timer;
+        craw->clock_local_time = tm2.tv_sec * 1000000ULL + tm2.tv_nsec / 1000;
+        return DC1394_SUCCESS;
+    }
+
+    if (ioctl(craw->fd, FW_CDEV_IOC_GET_CYCLE_TIMER, &tm) < 0) {
+        dc1394_log_error("failed to read the cycle timer: %m");
+        return DC1394_IOCTL_FAILURE;
+    }
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    craw->clock_cycle_timer = tm.cycle_timer;
+    craw->clock_local_time = tm.local_time
+        - (real.tv_sec * 1000000ULL + real.tv_nsec / 1000)
+        + (mono.tv_sec * 1000000ULL + mono.tv_nsec / 1000);
+    return DC1394_SUCCESS;
+}
+
+/*
+  Sets the capture time of a frame from the cycle of its last packet, as
+  given by the iso interrupt. The cycle wraps every 8 seconds: the frame is
+  placed within 4 seconds of the last clock correlation, which is refreshed
+  when it is older than JUJU_CLOCK_REFRESH.
+*/
+static void
+stamp_frame (platform_camera_t *craw, struct juju_frame *f, uint32_t cycle)
+{
+    struct timespec now;
+    int32_t ref, delta;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec * 1000000ULL + now.tv_nsec / 1000 >=
+            craw->clock_local_time + JUJU_CLOCK_REFRESH) {
+        if (refresh_clock(craw) != DC1394_SUCCESS) {
+            f->frame.timestamp = 0;
+            f->frame.iso_cycle = cycle;
+            return;
+        }
+    }
+
+    // cycles since the start of the 8 second period, for both
+    ref = ((craw->clock_cycle_timer >> 25) & 7) * 8000
+        + ((craw->clock_cycle_timer >> 12) & 0x1fff);
+    delta = (((cycle >> 13) & 7) * 8000 + (cycle & 0x1fff) - ref + 64000) % 64000;
+    if (delta >= 32000)
+        delta -= 64000;
+
+    // 125us per cycle, 3072 ticks per cycle
+    f->frame.timestamp = craw->clock_local_time
+        - (craw->clock_cycle_timer & 0xfff) * 125 / 3072 + (int64_t) delta * 125;
+    f->frame.iso_cycle = cycle;
+}
+
+/*
+  Checks the iso packet headers of a frame, which are big endian:
+  data_length:16 tag:2 channel:6 tcode:4 sy:4. A whole frame gives one
+  header per packet, each packet carries packet_size bytes on the channel,
+  and only the first one has the start of frame sync bit: if packets are
+  lost, the next frame starts within this one. The kernel keeps a page of
+  headers, so the frames of more packets are only checked in part.
+*/
+static int
+check_iso_headers (platform_camera_t *craw, struct juju_frame *f,
+        const struct fw_cdev_event_iso_interrupt *iso)
+{
+    unsigned int i, count = iso->header_length / 4;
+    uint32_t header, expected;
+
+    if (count == 0 || count > craw->iso_event_headers ||
+            (count < f->frame.packets_per_frame &&
+             craw->iso_event_headers == f->frame.packets_per_frame))
+        return 1;
+
+    expected = (f->frame.packet_size << 16) | (craw->iso_channel << 8);
+    for (i = 0; i < count; i++) {
+        header = ntohl (iso->header[i]);
+        if ((header & 0xffff3f00) != expected)
+            return 1;
+        if (i > 0 && (header & 0xf) != 0)
+            return 1;
+    }
+    if (count == f->frame.packets_per_frame &&
+            (ntohl (iso->header[0]) & 0xf) != 1)
+        return 1;
+
+    return 0;
+}
+
+/* frees the channel and bandwidth allocated by the capture setup, if any */
+static void
+release_iso_resources (platform_camera_t * craw)
+{
+    dc1394camera_t * camera = craw->camera;
+
+    if (craw->allocated_channel >= 0) {
+        if (dc1394_iso_release_channel (camera, craw->allocated_channel)
+            != DC1394_SUCCESS)
+            dc1394_log_warning("Warning: Could not free ISO channel");
+    }
+    if (craw->allocated_bandwidth) {
+        if (dc1394_iso_release_bandwidth (camera, craw->allocated_bandwidth)
+            != DC1394_SUCCESS)
+            dc1394_log_warning("Warning: Could not free bandwidth");
+    }
+    craw->allocated_channel = -1;
+    craw->allocated_bandwidth = 0;
+}
+
+/*
+  Gets the speed code of the iso stream of the camera, which follows its
+  operation mode, and checks that the path from the camera to the
+  controller is fast enough for it.
+*/
+static dc1394error_t
+get_iso_speed (platform_camera_t * craw, uint32_t * scode)
+{
+    dc1394speed_t speed;
+    dc1394error_t err;
+    int max;
+
+    err = dc1394_video_get_iso_speed (craw->camera, &speed);
+    DC1394_ERR_RTN(err, "Could not get the ISO speed");
+    *scode = SCODE_100 + (speed - DC1394_ISO_SPEED_100);
+
+    // kernels before 2.6.30 do not tell the speed of the path
+    max = ioctl (craw->fd, FW_CDEV_IOC_GET_SPEED, NULL);
+    if (max < 0)
+        return DC1394_SUCCESS;
+
+    if (*scode > (uint32_t) max) {
+        dc1394_log_error("iso speed S%d is faster than the S%d of %s",
+                100 << *scode, 100 << max, craw->filename);
+        return DC1394_INVALID_ISO_SPEED;
+    }
+    return DC1394_SUCCESS;
+}
+
 dc1394error_t
 dc1394_juju_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
         uint32_t flags)
@@ -110,18 +264,21 @@ dc1394_juju_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
     dc1394error_t err;
     dc1394video_frame_t proto;
     int i, j, retval;
+    uint32_t speed;
     dc1394camera_t * camera = craw->camera;
 
     if (flags & DC1394_CAPTURE_FLAGS_DEFAULT)
         flags = DC1394_CAPTURE_FLAGS_CHANNEL_ALLOC |
             DC1394_CAPTURE_FLAGS_BANDWIDTH_ALLOC;
 
-    craw->flags = flags;
-
     // if capture is already set, abort
     if (craw->capture_is_set>0)
         return DC1394_CAPTURE_IS_RUNNING;
 
+    craw->flags = flags;
+    craw->allocated_channel = -1;
+    craw->allocated_bandwidth = 0;
+
     // if auto iso is requested, stop ISO (if necessary)
     if (flags & DC1394_CAPTURE_FLAGS_AUTO_ISO) {
         dc1394switch_t is_iso_on;
@@ -134,31 +291,66 @@ dc1394_juju_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
 
     // allocate channel/bandwidth if requested
     if (flags & DC1394_CAPTURE_FLAGS_CHANNEL_ALLOC) {
-        dc1394_log_warning ("iso allocation not implemented yet for "
-                "juju drivers, using channel 0...");
-        if (dc1394_video_set_iso_channel (camera, 0) != DC1394_SUCCESS)
-            return DC1394_NO_ISO_CHANNEL;
+        err = dc1394_iso_allocate_channel (camera, 0, &craw->allocated_channel);
+        if (err == DC1394_FUNCTION_NOT_SUPPORTED) {
+            // kernels before 2.6.30 cannot allocate iso resources
+            dc1394_log_warning ("iso allocation not supported by %s, "
+                    "using channel 0...", craw->filename);
+            craw->allocated_channel = -1;
+            flags &= ~DC1394_CAPTURE_FLAGS_BANDWIDTH_ALLOC;
+            if (dc1394_video_set_iso_channel (camera, 0) != DC1394_SUCCESS)
+                return DC1394_NO_ISO_CHANNEL;
+        }
+        else {
+            if (err != DC1394_SUCCESS)
+                goto error_alloc;
+            err = dc1394_video_set_iso_channel (camera, craw->allocated_channel);
+            if (err != DC1394_SUCCESS)
+                goto error_alloc;
+        }
+    }
+    if (flags & DC1394_CAPTURE_FLAGS_BANDWIDTH_ALLOC) {
+        unsigned int bandwidth_usage;
+        err = dc1394_video_get_bandwidth_usage (camera, &bandwidth_usage);
+        if (err != DC1394_SUCCESS)
+            goto error_alloc;
+        err = dc1394_iso_allocate_bandwidth (camera, bandwidth_usage);
+        if (err == DC1394_FUNCTION_NOT_SUPPORTED) {
+            dc1394_log_warning ("iso allocation not supported by %s, "
+                    "not allocating bandwidth", craw->filename);
+        }
+        else if (err != DC1394_SUCCESS)
+            goto error_alloc;
+        else
+            craw->allocated_bandwidth = bandwidth_usage;
     }
 
+    err = DC1394_FAILURE;
     if (capture_basic_setup(camera, &proto) != DC1394_SUCCESS) {
         dc1394_log_error("basic setup failed");
-        return DC1394_FAILURE;
+        goto error_alloc;
     }
 
     if (dc1394_video_get_iso_channel (camera, &craw->iso_channel)
             != DC1394_SUCCESS)
-        return DC1394_FAILURE;
+        goto error_alloc;
+
+    err = get_iso_speed (craw, &speed);
+    if (err != DC1394_SUCCESS)
+        goto error_alloc;
 
-    craw->iso_fd = open(craw->filename, O_RDWR);
+    err = DC1394_FAILURE;
+    // the events are drained without blocking, see drain_iso_events()
+    craw->iso_fd = open(craw->filename, O_RDWR | O_NONBLOCK);
     if (craw->iso_fd < 0) {
         dc1394_log_error("error opening file: %s", strerror (errno));
-        return DC1394_FAILURE;
+        goto error_alloc;
     }
 
     create.type = FW_CDEV_ISO_CONTEXT_RECEIVE;
     create.header_size = 4;
     create.channel = craw->iso_channel;
-    create.speed = SCODE_400;
+    create.speed = speed;
     err = DC1394_IOCTL_FAILURE;
     if (ioctl(craw->iso_fd, FW_CDEV_IOC_CREATE_ISO_CONTEXT, &create) < 0) {
         dc1394_log_error("failed to create iso context");
@@ -167,9 +359,22 @@ dc1394_juju_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
 
     craw->iso_handle = create.handle;
 
+    // an interrupt event carries the headers of all the packets of a frame,
+    // up to a page of them
+    craw->iso_event_headers = proto.packets_per_frame;
+    if (craw->iso_event_headers > sysconf(_SC_PAGESIZE) / create.header_size)
+        craw->iso_event_headers = sysconf(_SC_PAGESIZE) / create.header_size;
+    craw->iso_event_size = sizeof (struct fw_cdev_event_iso_interrupt)
+        + create.header_size * proto.packets_per_frame;
+    err = DC1394_MEMORY_ALLOCATION_FAILURE;
+    craw->iso_event = malloc (craw->iso_event_size);
+    if (craw->iso_event == NULL)
+        goto error_fd;
+
     craw->num_frames = num_dma_buffers;
     craw->current = -1;
     craw->ready_frames = 0;
+    craw->clock_local_time = 0;
     craw->buffer_size = proto.total_bytes * num_dma_buffers;
     craw->buffer =
         mmap(NULL, craw->buffer_size, PROT_READ, MAP_SHARED, craw->iso_fd, 0);
@@ -233,7 +438,11 @@ error_frames:
 error_mmap:
     munmap(craw->buffer, craw->buffer_size);
 error_fd:
+    free(craw->iso_event);
+    craw->iso_event = NULL;
     close(craw->iso_fd);
+error_alloc:
+    release_iso_resources(craw);
 
     return err;
 }
@@ -253,10 +462,14 @@ dc1394_juju_capture_stop(platform_camera_t *craw)
 
     munmap(craw->buffer, craw->buffer_size);
     close(craw->iso_fd);
+    free (craw->iso_event);
+    craw->iso_event = NULL;
     free (craw->frames);
     craw->frames = NULL;
     craw->capture_is_set = 0;
 
+    release_iso_resources(craw);
+
     // stop ISO if it was started automatically
     if (craw->iso_auto_started>0) {
         dc1394error_t err=dc1394_video_set_transmission(camera, DC1394_OFF);
@@ -268,64 +481,170 @@ dc1394_juju_capture_stop(platform_camera_t *craw)
 }
 
 
-dc1394error_t
-dc1394_juju_capture_dequeue (platform_camera_t * craw,
-        dc1394capture_policy_t policy, dc1394video_frame_t **frame_return)
+/*
+  Reads all the pending events of the iso context without blocking, and
+  counts the frames they complete. The kernel gives one event per read(),
+  so this is one read per event plus the one that finds the queue empty.
+  Returns the number of frames that became ready, or -1 on failure.
+*/
+static int
+drain_iso_events (platform_camera_t * craw)
 {
-    struct pollfd fds[1];
+    struct fw_cdev_event_iso_interrupt *iso = craw->iso_event;
     struct juju_frame *f;
-    int err, timeout, len;
-    struct {
-        struct fw_cdev_event_iso_interrupt i;
-        __u32 headers[256];
-    } iso;
+    int len, frames = 0;
 
-    if ( (policy<DC1394_CAPTURE_POLICY_MIN) || (policy>DC1394_CAPTURE_POLICY_MAX) )
-        return DC1394_INVALID_CAPTURE_POLICY;
+    while (1) {
+        len = read (craw->iso_fd, iso, craw->iso_event_size);
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return frames;
+            if (errno == EINTR)
+                continue;
+            dc1394_log_error("failed to read a response: %m");
+            return -1;
+        }
 
-    // default: return NULL in case of failures or lack of frames
-    *frame_return=NULL;
+        if (iso->type == FW_CDEV_EVENT_ISO_INTERRUPT) {
+            // the frames complete in the order they were queued
+            f = craw->frames +
+                (craw->current + craw->ready_frames + 1) % craw->num_frames;
+            stamp_frame(craw, f, iso->cycle);
+            f->corrupt = check_iso_headers(craw, f, iso);
+            craw->ready_frames++;
+            frames++;
+        }
+    }
+}
+
+/*
+  Waits for the iso events until a frame is ready, or until the timeout
+  runs out: NULL waits without a timeout, and a zero timeout only takes
+  the events already there.
+*/
+static dc1394error_t
+wait_frame (platform_camera_t * craw, const struct timespec * timeout)
+{
+    struct pollfd fds[1];
+    struct timespec deadline, now, left;
+    int err;
+
+    if (craw->ready_frames > 0)
+        return DC1394_SUCCESS;
+
+    if (timeout && timeout->tv_sec == 0 && timeout->tv_nsec == 0)
+        return drain_iso_events (craw) < 0 ? DC1394_FAILURE : DC1394_SUCCESS;
 
     fds[0].fd = craw->iso_fd;
     fds[0].events = POLLIN;
 
-    switch (policy) {
-    case DC1394_CAPTURE_POLICY_POLL:
-        timeout = 0;
-        break;
-    case DC1394_CAPTURE_POLICY_WAIT:
-    default:
-        timeout = -1;
-        break;
+    if (timeout) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout->tv_sec;
+        deadline.tv_nsec += timeout->tv_nsec;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
     }
 
     while (craw->ready_frames == 0) {
-        err = poll(fds, 1, timeout);
+        if (timeout) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            left.tv_sec = deadline.tv_sec - now.tv_sec;
+            left.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+            if (left.tv_nsec < 0) {
+                left.tv_sec--;
+                left.tv_nsec += 1000000000;
+            }
+            if (left.tv_sec < 0)
+                left.tv_sec = left.tv_nsec = 0;
+        }
+        err = ppoll(fds, 1, timeout ? &left : NULL, NULL);
         if (err < 0) {
+            if (errno == EINTR)
+                continue;
             dc1394_log_error("poll() failed for device %s.", craw->filename);
             return DC1394_FAILURE;
         } else if (err == 0) {
             return DC1394_SUCCESS;
         }
 
-        len = read (craw->iso_fd, &iso, sizeof iso);
-        if (len < 0) {
-            dc1394_log_error("failed to read a response: %m");
+        if (drain_iso_events (craw) < 0)
             return DC1394_FAILURE;
-        }
-
-        if (iso.i.type == FW_CDEV_EVENT_ISO_INTERRUPT)
-            craw->ready_frames++;
     }
+    return DC1394_SUCCESS;
+}
+
+/* returns the next ready frame */
+static void
+take_frame (platform_camera_t * craw, dc1394video_frame_t **frame_return)
+{
+    struct juju_frame *f;
 
     craw->current = (craw->current + 1) % craw->num_frames;
     f = craw->frames + craw->current;
     craw->ready_frames--;
 
     f->frame.frames_behind = craw->ready_frames;
-    f->frame.timestamp = 0;
 
     *frame_return = &f->frame;
+}
+
+dc1394error_t
+dc1394_juju_capture_dequeue (platform_camera_t * craw,
+        dc1394capture_policy_t policy, dc1394video_frame_t **frame_return)
+{
+    struct timespec no_wait = { 0, 0 };
+    int err;
+
+    if ( (policy<DC1394_CAPTURE_POLICY_MIN) || (policy>DC1394_CAPTURE_POLICY_MAX) )
+        return DC1394_INVALID_CAPTURE_POLICY;
+
+    // default: return NULL in case of failures or lack of frames
+    *frame_return=NULL;
+
+    // frames ready from an earlier call: take those completed since too
+    if (policy == DC1394_CAPTURE_POLICY_LATEST && craw->ready_frames > 0 &&
+            drain_iso_events (craw) < 0)
+        return DC1394_FAILURE;
+
+    err = wait_frame (craw, policy == DC1394_CAPTURE_POLICY_POLL ? &no_wait : NULL);
+    if (err != DC1394_SUCCESS || craw->ready_frames == 0)
+        return err;
+
+    if (policy == DC1394_CAPTURE_POLICY_LATEST) {
+        // queue all but the newest frame again
+        while (craw->ready_frames > 1) {
+            craw->current = (craw->current + 1) % craw->num_frames;
+            craw->ready_frames--;
+            err = queue_frame (craw, craw->current);
+            DC1394_ERR_RTN(err, "Failed to queue frame");
+        }
+    }
+
+    take_frame (craw, frame_return);
+
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_juju_capture_dequeue_timeout (platform_camera_t * craw,
+        uint32_t timeout_us, dc1394video_frame_t **frame_return)
+{
+    struct timespec timeout;
+    int err;
+
+    // default: return NULL in case of failures or lack of frames
+    *frame_return=NULL;
+
+    timeout.tv_sec = timeout_us / 1000000;
+    timeout.tv_nsec = timeout_us % 1000000 * 1000;
+    err = wait_frame (craw, &timeout);
+    if (err != DC1394_SUCCESS || craw->ready_frames == 0)
+        return err;
+
+    take_frame (craw, frame_return);
 
     return DC1394_SUCCESS;
 }
@@ -353,3 +672,15 @@ dc1394_juju_capture_get_fileno (platform_camera_t * craw)
     return craw->iso_fd;
 }
 
+dc1394bool_t
+dc1394_juju_capture_is_frame_corrupt (platform_camera_t * craw,
+        dc1394video_frame_t * frame)
+{
+    struct juju_frame * f = (struct juju_frame *) frame;
+
+    if (f->corrupt)
+        return DC1394_TRUE;
+
+    return DC1394_FALSE;
+}
+
@@ -212,7 +212,14 @@ dc1394_juju_camera_new (platform_t * p, platform_device_t * device, uint32_t uni
 
 static void dc1394_juju_camera_free (platform_camera_t * cam)
 {
+    struct juju_iso_resource * res;
+
+    /* closing the file frees the iso resources it holds */
     close (cam->fd);
+    while ((res = cam->iso_resources) != NULL) {
+        cam->iso_resources = res->next;
+        free (res);
+    }
     free (cam);
 }
 
@@ -230,6 +237,29 @@ dc1394_juju_camera_print_info (platform_camera_t * camera, FILE *fd)
     return DC1394_SUCCESS;
 }
 
+/* an iso resource the kernel could not reallocate after a bus reset, and
+   therefore freed */
+static void
+juju_iso_resource_lost (platform_camera_t * cam,
+        const struct fw_cdev_event_iso_resource * event)
+{
+    struct juju_iso_resource ** prev, * res;
+
+    for (prev = &cam->iso_resources; (res = *prev) != NULL; prev = &res->next) {
+        if (res->closure != event->closure)
+            continue;
+        if (res->channel >= 0)
+            dc1394_log_warning("Juju: iso channel %d of %s lost after a bus reset",
+                    res->channel, cam->filename);
+        else
+            dc1394_log_warning("Juju: iso bandwidth of %s lost after a bus reset",
+                    cam->filename);
+        *prev = res->next;
+        free (res);
+        return;
+    }
+}
+
 int
 _juju_await_response (platform_camera_t * cam, uint32_t * out, int num_quads)
 {
@@ -239,6 +269,7 @@ _juju_await_response (platform_camera_t * cam, uint32_t * out, int num_quads)
             __u32 buffer[out ? num_quads : 0];
         } response;
         struct fw_cdev_event_bus_reset reset;
+        struct fw_cdev_event_iso_resource resource;
     } u;
     int len, i;
 
@@ -267,11 +298,147 @@ _juju_await_response (platform_camera_t * cam, uint32_t * out, int num_quads)
         for (i = 0; i < u.response.r.length/4 && i < num_quads && out; i++)
             out[i] = ntohl (u.response.r.data[i]);
         return 1;
+
+    case FW_CDEV_EVENT_ISO_RESOURCE_DEALLOCATED:
+        juju_iso_resource_lost (cam, &u.resource);
+        break;
     }
 
     return 0;
 }
 
+/* reads the events until the iso resource event of the request 'closure' */
+static int
+juju_await_iso_resource (platform_camera_t * cam, uint64_t closure,
+        struct fw_cdev_event_iso_resource * event)
+{
+    union {
+        struct fw_cdev_event_common common;
+        struct fw_cdev_event_bus_reset reset;
+        struct fw_cdev_event_iso_resource resource;
+    } u;
+    int len;
+
+    for (;;) {
+        len = read (cam->fd, &u, sizeof u);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            dc1394_log_error("failed to read iso resource event for %s: %m",
+                    cam->filename);
+            return -1;
+        }
+
+        switch (u.common.type) {
+        case FW_CDEV_EVENT_BUS_RESET:
+            cam->generation = u.reset.generation;
+            cam->node_id = u.reset.node_id;
+            break;
+
+        case FW_CDEV_EVENT_ISO_RESOURCE_ALLOCATED:
+        case FW_CDEV_EVENT_ISO_RESOURCE_DEALLOCATED:
+            if (u.resource.closure == closure) {
+                *event = u.resource;
+                return 0;
+            }
+            /* reallocations after a bus reset */
+            if (u.resource.type == FW_CDEV_EVENT_ISO_RESOURCE_DEALLOCATED)
+                juju_iso_resource_lost (cam, &u.resource);
+            break;
+        }
+    }
+}
+
+/* allocates a channel out of 'channels', or 'bandwidth' units, at the IRM.
+   Returns DC1394_FUNCTION_NOT_SUPPORTED on kernels before 2.6.30, which
+   cannot allocate. */
+static dc1394error_t
+juju_iso_allocate (platform_camera_t * cam, uint64_t channels, int bandwidth,
+        struct fw_cdev_event_iso_resource * event)
+{
+    struct fw_cdev_allocate_iso_resource request;
+    struct juju_iso_resource * res = NULL;
+
+    if (!cam->iso_persist) {
+        res = malloc (sizeof (struct juju_iso_resource));
+        if (!res)
+            return DC1394_MEMORY_ALLOCATION_FAILURE;
+    }
+
+    request.closure = ++cam->iso_closure;
+    request.channels = channels;
+    request.bandwidth = bandwidth;
+    request.handle = 0;
+    if (ioctl (cam->fd, res ? FW_CDEV_IOC_ALLOCATE_ISO_RESOURCE :
+                FW_CDEV_IOC_ALLOCATE_ISO_RESOURCE_ONCE, &request) < 0) {
+        free (res);
+        if (errno == ENOTTY || errno == EINVAL)
+            return DC1394_FUNCTION_NOT_SUPPORTED;
+        dc1394_log_error("failed to allocate iso resources: %m");
+        return DC1394_IOCTL_FAILURE;
+    }
+
+    /* a failed allocation is freed by the kernel */
+    if (juju_await_iso_resource (cam, request.closure, event) < 0 ||
+            (channels && event->channel < 0) ||
+            (bandwidth && event->bandwidth <= 0)) {
+        free (res);
+        return DC1394_FAILURE;
+    }
+
+    if (res) {
+        res->handle = request.handle;
+        res->closure = request.closure;
+        res->channel = channels ? event->channel : -1;
+        res->bandwidth = event->bandwidth;
+        res->next = cam->iso_resources;
+        cam->iso_resources = res;
+    }
+    return DC1394_SUCCESS;
+}
+
+/* frees an iso resource of ours, or else one allocated by a persistent
+   allocation, maybe of another process */
+static dc1394error_t
+juju_iso_release (platform_camera_t * cam, struct juju_iso_resource ** prev,
+        uint64_t channels, int bandwidth)
+{
+    struct juju_iso_resource * res = prev ? *prev : NULL;
+    struct fw_cdev_allocate_iso_resource request;
+    struct fw_cdev_deallocate deallocate;
+    struct fw_cdev_event_iso_resource event;
+
+    if (res) {
+        deallocate.handle = res->handle;
+        *prev = res->next;
+        if (ioctl (cam->fd, FW_CDEV_IOC_DEALLOCATE_ISO_RESOURCE,
+                    &deallocate) < 0) {
+            dc1394_log_error("failed to free iso resources: %m");
+            free (res);
+            return DC1394_IOCTL_FAILURE;
+        }
+        request.closure = res->closure;
+        free (res);
+    }
+    else {
+        request.closure = ++cam->iso_closure;
+        request.channels = channels;
+        request.bandwidth = bandwidth;
+        request.handle = 0;
+        if (ioctl (cam->fd, FW_CDEV_IOC_DEALLOCATE_ISO_RESOURCE_ONCE,
+                    &request) < 0) {
+            dc1394_log_error("failed to free iso resources: %m");
+            return DC1394_IOCTL_FAILURE;
+        }
+    }
+
+    if (juju_await_iso_resource (cam, request.closure, &event) < 0 ||
+            (channels && event.channel < 0) ||
+            (bandwidth && event.bandwidth <= 0))
+        return DC1394_FAILURE;
+    return DC1394_SUCCESS;
+}
+
 static dc1394error_t
 do_transaction(platform_camera_t * cam, int tcode, uint64_t offset, const uint32_t * in, uint32_t * out, uint32_t num_quads)
 {
@@ -354,6 +521,22 @@ dc1394_juju_reset_bus (platform_camera_t * cam)
         return DC1394_FAILURE;
 }
 
+static dc1394error_t
+dc1394_juju_read_cycle_timer (platform_camera_t * cam,
+        uint32_t * cycle_timer, uint64_t * local_time)
+{
+    struct fw_cdev_get_cycle_timer tm;
+
+    if (ioctl(cam->fd, FW_CDEV_IOC_GET_CYCLE_TIMER, &tm) < 0) {
+        dc1394_log_error("failed to read the cycle timer: %m");
+        return DC1394_IOCTL_FAILURE;
+    }
+
+    *cycle_timer = tm.cycle_timer;
+    *local_time = tm.local_time;
+    return DC1394_SUCCESS;
+}
+
 static dc1394error_t
 dc1394_juju_camera_get_node(platform_camera_t *cam, uint32_t *node,
         uint32_t * generation)
@@ -365,6 +548,93 @@ dc1394_juju_camera_get_node(platform_camera_t *cam, uint32_t *node,
     return DC1394_SUCCESS;
 }
 
+static dc1394error_t
+dc1394_juju_iso_set_persist (platform_camera_t * cam)
+{
+    cam->iso_persist = 1;
+    return DC1394_SUCCESS;
+}
+
+static dc1394error_t
+dc1394_juju_iso_allocate_channel (platform_camera_t * cam,
+        uint64_t channels_allowed, int * channel)
+{
+    struct fw_cdev_event_iso_resource event;
+    dc1394error_t err;
+
+    err = juju_iso_allocate (cam, channels_allowed, 0, &event);
+    if (err == DC1394_FAILURE) {
+        dc1394_log_error ("Error: Failed to allocate iso channel");
+        return DC1394_NO_ISO_CHANNEL;
+    }
+    if (err != DC1394_SUCCESS)
+        return err;
+
+    *channel = event.channel;
+    return DC1394_SUCCESS;
+}
+
+static dc1394error_t
+dc1394_juju_iso_release_channel (platform_camera_t * cam, int channel)
+{
+    struct juju_iso_resource ** prev;
+
+    for (prev = &cam->iso_resources; *prev; prev = &(*prev)->next)
+        if ((*prev)->channel == channel)
+            break;
+
+    if (juju_iso_release (cam, *prev ? prev : NULL, (uint64_t)1 << channel, 0)
+            != DC1394_SUCCESS) {
+        dc1394_log_error("Error: Could not free iso channel");
+        return DC1394_FAILURE;
+    }
+
+    return DC1394_SUCCESS;
+}
+
+static dc1394error_t
+dc1394_juju_iso_allocate_bandwidth (platform_camera_t * cam,
+        int bandwidth_units)
+{
+    struct fw_cdev_event_iso_resource event;
+    dc1394error_t err;
+
+    err = juju_iso_allocate (cam, 0, bandwidth_units, &event);
+    if (err == DC1394_FAILURE) {
+        dc1394_log_error ("Error: Failed to allocate iso bandwidth");
+        return DC1394_NO_BANDWIDTH;
+    }
+
+    return err;
+}
+
+static dc1394error_t
+dc1394_juju_iso_release_bandwidth (platform_camera_t * cam,
+        int bandwidth_units)
+{
+    struct juju_iso_resource ** prev = &cam->iso_resources;
+    dc1394error_t err = DC1394_SUCCESS;
+
+    /* the units may add up several allocations of ours */
+    while (*prev && bandwidth_units > 0) {
+        int units = (*prev)->bandwidth;
+        if ((*prev)->channel >= 0 || units > bandwidth_units) {
+            prev = &(*prev)->next;
+            continue;
+        }
+        if (juju_iso_release (cam, prev, 0, units) != DC1394_SUCCESS)
+            err = DC1394_FAILURE;
+        bandwidth_units -= units;
+    }
+    if (bandwidth_units > 0 &&
+            juju_iso_release (cam, NULL, 0, bandwidth_units) != DC1394_SUCCESS)
+        err = DC1394_FAILURE;
+
+    if (err != DC1394_SUCCESS)
+        dc1394_log_error ("Error: Failed to free iso bandwidth");
+    return err;
+}
+
 static platform_dispatch_t
 juju_dispatch = {
     .platform_new = dc1394_juju_new,
@@ -382,14 +652,23 @@ juju_dispatch = {
     .camera_write = dc1394_juju_camera_write,
 
     .reset_bus = dc1394_juju_reset_bus,
+    .read_cycle_timer = dc1394_juju_read_cycle_timer,
     .camera_print_info = dc1394_juju_camera_print_info,
     .camera_get_node = dc1394_juju_camera_get_node,
 
     .capture_setup = dc1394_juju_capture_setup,
     .capture_stop = dc1394_juju_capture_stop,
     .capture_dequeue = dc1394_juju_capture_dequeue,
+    .capture_dequeue_timeout = dc1394_juju_capture_dequeue_timeout,
     .capture_enqueue = dc1394_juju_capture_enqueue,
     .capture_get_fileno = dc1394_juju_capture_get_fileno,
+    .capture_is_frame_corrupt = dc1394_juju_capture_is_frame_corrupt,
+
+    .iso_set_persist = dc1394_juju_iso_set_persist,
+    .iso_allocate_channel = dc1394_juju_iso_allocate_channel,
+    .iso_release_channel = dc1394_juju_iso_release_channel,
+    .iso_allocate_bandwidth = dc1394_juju_iso_allocate_bandwidth,
+    .iso_release_bandwidth = dc1394_juju_iso_release_bandwidth,
 };
 
 void
@@ -34,6 +34,16 @@ struct _platform_t {
     int dummy;
 };
 
+/* iso resources held for the lifetime of the device file: the kernel
+   reallocates them after bus resets and frees them when the file is closed */
+struct juju_iso_resource {
+    uint32_t handle;
+    uint64_t closure;
+    int channel;                /* -1 for bandwidth */
+    int bandwidth;
+    struct juju_iso_resource * next;
+};
+
 struct _platform_camera_t {
     int fd;
     char filename[32];
@@ -42,8 +52,15 @@ struct _platform_camera_t {
 
     dc1394camera_t * camera;
 
+    int iso_persist;            /* allocate the iso resources once, unowned */
+    uint64_t iso_closure;       /* tells the iso resource events apart */
+    struct juju_iso_resource * iso_resources;
+
     int iso_fd;
     int iso_handle;
+    void * iso_event;           /* room for one iso interrupt event */
+    size_t iso_event_size;
+    unsigned int iso_event_headers; /* the packet headers of a frame event */
     struct juju_frame        * frames;
     unsigned char        * buffer;
     size_t buffer_size;
@@ -53,15 +70,25 @@ struct _platform_camera_t {
     int ready_frames;
 
     unsigned int iso_channel;
+    int allocated_channel;      /* -1 if none */
+    int allocated_bandwidth;
     int capture_is_set;
     int iso_auto_started;
+
+    /* the cycle timer and CLOCK_MONOTONIC [microseconds] read together,
+       refreshed every JUJU_CLOCK_REFRESH microseconds */
+    uint32_t clock_cycle_timer;
+    uint64_t clock_local_time;
 };
 
+#define JUJU_CLOCK_REFRESH 1000000
+
 
 struct juju_frame {
     dc1394video_frame_t                 frame;
     size_t                         size;
     struct fw_cdev_iso_packet        *packets;
+    int                                corrupt;
 };
 
 dc1394error_t
@@ -78,6 +105,10 @@ dc1394error_t
 dc1394_juju_capture_dequeue (platform_camera_t * craw,
         dc1394capture_policy_t policy, dc1394video_frame_t **frame_return);
 
+dc1394error_t
+dc1394_juju_capture_dequeue_timeout (platform_camera_t * craw,
+        uint32_t timeout_us, dc1394video_frame_t **frame_return);
+
 dc1394error_t
 dc1394_juju_capture_enqueue (platform_camera_t * craw,
         dc1394video_frame_t * frame);
@@ -85,4 +116,8 @@ dc1394_juju_capture_enqueue (platform_camera_t * craw,
 int
 dc1394_juju_capture_get_fileno (platform_camera_t * craw);
 
+dc1394bool_t
+dc1394_juju_capture_is_frame_corrupt (platform_camera_t * craw,
+        dc1394video_frame_t * frame);
+
 #endif
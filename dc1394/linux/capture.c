@@ -400,6 +400,7 @@ dc1394_linux_capture_dequeue (platform_camera_t * craw,
         result=ioctl(capture->dma_fd, VIDEO1394_IOC_LISTEN_POLL_BUFFER, &vwait);
         break;
     case DC1394_CAPTURE_POLICY_WAIT:
+    case DC1394_CAPTURE_POLICY_LATEST:
     default:
         while (1) {
             result=ioctl(capture->dma_fd, VIDEO1394_IOC_LISTEN_WAIT_BUFFER,
@@ -420,6 +421,25 @@ dc1394_linux_capture_dequeue (platform_camera_t * craw,
         }
     }
 
+    // the buffers filled after this one are ready: queue this one again and take the next
+    while (policy == DC1394_CAPTURE_POLICY_LATEST && vwait.buffer > 0) {
+        vwait.channel = craw->iso_channel;
+        vwait.buffer = cb;
+        if (ioctl(capture->dma_fd, VIDEO1394_IOC_LISTEN_QUEUE_BUFFER, &vwait) < 0) {
+            dc1394_log_error("VIDEO1394_IOC_LISTEN_QUEUE_BUFFER ioctl failed!");
+            return DC1394_IOCTL_FAILURE;
+        }
+        capture->dma_last_buffer = cb;
+        cb = (cb + 1) % capture->num_dma_buffers;
+        frame_tmp = capture->frames + cb;
+        vwait.channel = craw->iso_channel;
+        vwait.buffer = cb;
+        if (ioctl(capture->dma_fd, VIDEO1394_IOC_LISTEN_POLL_BUFFER, &vwait) != 0) {
+            dc1394_log_error("VIDEO1394_IOC_LISTEN_POLL_BUFFER ioctl failed!");
+            return DC1394_IOCTL_FAILURE;
+        }
+    }
+
     capture->dma_last_buffer = cb;
 
     frame_tmp->frames_behind = vwait.buffer;
@@ -430,6 +450,28 @@ dc1394_linux_capture_dequeue (platform_camera_t * craw,
     return DC1394_SUCCESS;
 }
 
+dc1394error_t
+dc1394_linux_capture_dequeue_timeout (platform_camera_t * craw,
+                        uint32_t timeout_us,
+                        dc1394video_frame_t **frame)
+{
+    int err;
+
+    // default: return NULL in case of failures or lack of frames
+    *frame=NULL;
+
+    // the device is readable once the next buffer is filled
+    err = capture_wait_readable (craw->capture.dma_fd, timeout_us);
+    if (err < 0) {
+        dc1394_log_error("poll() failed!");
+        return DC1394_FAILURE;
+    }
+    if (err == 0)
+        return DC1394_SUCCESS;
+
+    return dc1394_linux_capture_dequeue (craw, DC1394_CAPTURE_POLICY_POLL, frame);
+}
+
 dc1394error_t
 dc1394_linux_capture_enqueue (platform_camera_t * craw,
                         dc1394video_frame_t * frame)
@@ -477,6 +477,7 @@ linux_dispatch = {
     .capture_setup = dc1394_linux_capture_setup,
     .capture_stop = dc1394_linux_capture_stop,
     .capture_dequeue = dc1394_linux_capture_dequeue,
+    .capture_dequeue_timeout = dc1394_linux_capture_dequeue_timeout,
     .capture_enqueue = dc1394_linux_capture_enqueue,
     .capture_get_fileno = dc1394_linux_capture_get_fileno,
 
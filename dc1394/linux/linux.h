@@ -83,6 +83,10 @@ dc1394error_t
 dc1394_linux_capture_dequeue (platform_camera_t * craw,
         dc1394capture_policy_t policy, dc1394video_frame_t **frame_return);
 
+dc1394error_t
+dc1394_linux_capture_dequeue_timeout (platform_camera_t * craw,
+        uint32_t timeout_us, dc1394video_frame_t **frame_return);
+
 dc1394error_t
 dc1394_linux_capture_enqueue (platform_camera_t * craw,
         dc1394video_frame_t * frame);
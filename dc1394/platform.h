@@ -65,9 +65,12 @@ typedef struct _platform_dispatch_t {
 
     dc1394error_t (*capture_setup)(platform_camera_t *, uint32_t, uint32_t);
     dc1394error_t (*capture_stop)(platform_camera_t *);
+    dc1394error_t (*capture_set_buffer)(platform_camera_t *, void *, size_t);
 
     dc1394error_t (*capture_dequeue)(platform_camera_t *,
             dc1394capture_policy_t, dc1394video_frame_t **);
+    dc1394error_t (*capture_dequeue_timeout)(platform_camera_t *,
+            uint32_t, dc1394video_frame_t **);
     dc1394error_t (*capture_enqueue)(platform_camera_t *,
             dc1394video_frame_t *);
 
@@ -0,0 +1,600 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Recordings of cameras
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* for O_DIRECT */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include "config.h"
+#include "internal.h"
+#include "offsets.h"
+#include "register.h"
+#include "capture.h"
+#include "record.h"
+#include "log.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define ROUND_UP(x,a) (((x) + (a) - 1) / (a) * (a))
+
+/* the frames a recorder holds before its queue grows */
+#define RECORDER_QUEUE_SIZE 16
+
+/* the index is written when this many frames are not in it, or after
+   this long (in us), and first gets room for RECORDER_INDEX_ROOM frames */
+#define RECORDER_INDEX_FRAMES 32
+#define RECORDER_INDEX_INTERVAL 1000000
+#define RECORDER_INDEX_ROOM 1024
+
+struct __dc1394recorder_t {
+    dc1394camera_t * camera;
+    int fd;
+    int direct;                      /* the file is open with O_DIRECT */
+    uint64_t position;               /* where the next image goes */
+
+    /* the header and the register snapshot, written again with the index */
+    unsigned char * head;
+    size_t head_size;
+
+    dc1394record_frame_t * index;
+    uint64_t num_frames;
+    uint64_t index_size;
+
+    /* the index in the file: room for index_room frames at index_offset,
+       of which the first index_written are there */
+    uint64_t index_offset;
+    uint64_t index_room;
+    uint64_t index_written;
+    uint64_t index_time;             /* us, when the index was last written */
+
+    /* aligned copies of what O_DIRECT cannot write in place */
+    unsigned char * bounce;
+    void * bounce_alloc;
+    size_t bounce_size;
+
+    dc1394error_t error;             /* the first write error */
+    uint64_t bytes_written;
+
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t work;             /* frames were queued, or closing */
+    dc1394video_frame_t ** queue;
+    uint32_t queue_size;
+    uint32_t first;
+    uint32_t pending;                /* queued, including the one being written */
+    int quit;
+#endif
+};
+
+/* appends the registers [offset, offset+4*num_quads) that can be read to
+   the snapshot, as blocks of consecutive quadlets starting on 8 bytes */
+static dc1394error_t
+snapshot_registers (dc1394recorder_t * r, uint64_t offset, uint32_t num_quads)
+{
+    uint32_t i = 0, n, quad;
+    dc1394record_registers_t * b;
+    unsigned char * head;
+
+    while (i < num_quads) {
+        if (dc1394_get_registers (r->camera, offset + 4 * i, &quad, 1) != DC1394_SUCCESS) {
+            i++;
+            continue;
+        }
+        head = realloc (r->head, r->head_size + sizeof *b + 4 * (num_quads - i) + 4);
+        if (!head)
+            return DC1394_MEMORY_ALLOCATION_FAILURE;
+        r->head = head;
+        b = (dc1394record_registers_t *) (r->head + r->head_size);
+        b->offset = offset + 4 * i;
+        b->reserved = 0;
+        n = 0;
+        do {
+            memcpy ((unsigned char *) (b + 1) + 4 * n++, &quad, 4);
+            i++;
+        } while (i < num_quads &&
+                dc1394_get_registers (r->camera, offset + 4 * i, &quad, 1) == DC1394_SUCCESS);
+        b->num_quads = n;
+        if (n % 2)
+            memset ((unsigned char *) (b + 1) + 4 * n, 0, 4);
+        r->head_size += sizeof *b + ROUND_UP (4 * n, 8);
+        i++;
+    }
+    return DC1394_SUCCESS;
+}
+
+/*
+  The snapshot: the config ROM, the command registers, and the blocks they
+  point to for the absolute values of the features and for Format_7.
+*/
+static dc1394error_t
+snapshot_camera (dc1394recorder_t * r)
+{
+    uint64_t base = r->camera->command_registers_base;
+    uint32_t value;
+    dc1394error_t err;
+    int i;
+
+    err = snapshot_registers (r, ROM_BUS_INFO_BLOCK, 256);
+    if (err == DC1394_SUCCESS)
+        err = snapshot_registers (r, base, 0x900 / 4);
+
+    for (i = 0; i < 64 && err == DC1394_SUCCESS; i++) {
+        if (dc1394_get_control_register (r->camera, REG_CAMERA_FEATURE_ABS_HI_BASE + 4 * i,
+                    &value) == DC1394_SUCCESS && value)
+            err = snapshot_registers (r, (uint64_t) value * 4, 3);
+    }
+    for (i = 0; i < DC1394_VIDEO_MODE_FORMAT7_NUM && err == DC1394_SUCCESS; i++) {
+        if (dc1394_get_control_register (r->camera, REG_CAMERA_V_CSR_INQ_BASE + 4 * i,
+                    &value) == DC1394_SUCCESS && value)
+            err = snapshot_registers (r, (uint64_t) value * 4, 0x80 / 4);
+    }
+    return err;
+}
+
+static dc1394error_t
+write_all (dc1394recorder_t * r, const unsigned char * data, size_t len, uint64_t position)
+{
+    if (lseek (r->fd, position, SEEK_SET) == (off_t) -1) {
+        dc1394_log_error ("Recorder: seek failed: %s", strerror (errno));
+        return DC1394_FAILURE;
+    }
+    while (len > 0) {
+        ssize_t n = write (r->fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return DC1394_FAILURE;
+        data += n;
+        len -= n;
+    }
+    return DC1394_SUCCESS;
+}
+
+static unsigned char *
+get_bounce (dc1394recorder_t * r, size_t size)
+{
+    if (size > r->bounce_size) {
+        free (r->bounce_alloc);
+        r->bounce_alloc = malloc (size + DC1394_RECORD_ALIGN);
+        if (!r->bounce_alloc) {
+            r->bounce_size = 0;
+            return NULL;
+        }
+        r->bounce = (unsigned char *) ROUND_UP ((uintptr_t) r->bounce_alloc, DC1394_RECORD_ALIGN);
+        r->bounce_size = size;
+    }
+    return r->bounce;
+}
+
+/*
+  Writes len bytes at an aligned position. With O_DIRECT, the aligned part
+  of the data is written from where it is, and the rest from an aligned
+  copy padded with zeros. If the system refuses a direct write, the file
+  goes back to buffered writes.
+*/
+static dc1394error_t
+write_aligned (dc1394recorder_t * r, const unsigned char * data, size_t len, uint64_t position)
+{
+    dc1394error_t err;
+
+    if (!r->direct)
+        return write_all (r, data, len, position);
+
+    size_t direct = 0;
+    if ((uintptr_t) data % DC1394_RECORD_ALIGN == 0)
+        direct = len / DC1394_RECORD_ALIGN * DC1394_RECORD_ALIGN;
+    err = write_all (r, data, direct, position);
+    if (err == DC1394_SUCCESS && direct < len) {
+        size_t rest = ROUND_UP (len - direct, DC1394_RECORD_ALIGN);
+        unsigned char * copy = get_bounce (r, rest);
+        if (!copy)
+            return DC1394_MEMORY_ALLOCATION_FAILURE;
+        memcpy (copy, data + direct, len - direct);
+        memset (copy + len - direct, 0, rest - (len - direct));
+        err = write_all (r, copy, rest, position + direct);
+    }
+    if (err != DC1394_SUCCESS && (errno == EINVAL || errno == EFAULT)) {
+#ifdef O_DIRECT
+        dc1394_log_debug ("Recorder: direct write refused, using buffered writes");
+        fcntl (r->fd, F_SETFL, fcntl (r->fd, F_GETFL) & ~O_DIRECT);
+#endif
+        r->direct = 0;
+        err = write_all (r, data, len, position);
+    }
+    return err;
+}
+
+/* writes one frame and adds it to the index */
+static dc1394error_t
+write_frame (dc1394recorder_t * r, dc1394video_frame_t * frame)
+{
+    dc1394record_frame_t * f;
+    dc1394error_t err;
+
+    if (r->num_frames == r->index_size) {
+        uint64_t size = r->index_size ? 2 * r->index_size : 1024;
+        f = realloc (r->index, size * sizeof *f);
+        if (!f)
+            return DC1394_MEMORY_ALLOCATION_FAILURE;
+        r->index = f;
+        r->index_size = size;
+    }
+
+    err = write_aligned (r, frame->image, frame->total_bytes, r->position);
+    if (err != DC1394_SUCCESS) {
+        dc1394_log_error ("Recorder: failed to write frame %"PRIu64": %s",
+                r->num_frames, strerror (errno));
+        return err;
+    }
+
+    f = r->index + r->num_frames;
+    memset (f, 0, sizeof *f);
+    f->offset = r->position;
+    f->total_bytes = frame->total_bytes;
+    f->image_bytes = frame->image_bytes;
+    f->timestamp = frame->timestamp;
+    f->sequence = frame->sequence;
+    f->size[0] = frame->size[0];
+    f->size[1] = frame->size[1];
+    f->position[0] = frame->position[0];
+    f->position[1] = frame->position[1];
+    f->color_coding = frame->color_coding;
+    f->color_filter = frame->color_filter;
+    f->yuv_byte_order = frame->yuv_byte_order;
+    f->data_depth = frame->data_depth;
+    f->stride = frame->stride;
+    f->video_mode = frame->video_mode;
+    f->padding_bytes = frame->padding_bytes;
+    f->packet_size = frame->packet_size;
+    f->packets_per_frame = frame->packets_per_frame;
+    f->id = frame->id;
+    f->frames_behind = frame->frames_behind;
+    f->iso_cycle = frame->iso_cycle;
+    f->little_endian = frame->little_endian;
+    f->data_in_padding = frame->data_in_padding;
+    if (frame->camera && dc1394_capture_is_frame_corrupt (frame->camera, frame))
+        f->flags |= DC1394_RECORD_FRAME_CORRUPT;
+
+    r->position += ROUND_UP (frame->total_bytes, DC1394_RECORD_ALIGN);
+    return DC1394_SUCCESS;
+}
+
+/*
+  Writes the first num_frames entries of the index that are not in the
+  file yet, then the header that points to them. When they do not fit in
+  the room of the index, it moves after the images with twice the room,
+  and the images go on after it. The header only counts entries already
+  written, so that the file stays a recording whenever it stops.
+*/
+static dc1394error_t
+write_index (dc1394recorder_t * r, uint64_t num_frames)
+{
+    dc1394record_header_t * h = (dc1394record_header_t *) r->head;
+    const size_t frame_size = sizeof (dc1394record_frame_t);
+    dc1394error_t err = DC1394_SUCCESS;
+    uint64_t from;
+
+    if (num_frames > r->index_room) {
+        if (!r->index_room)
+            r->index_room = RECORDER_INDEX_ROOM;
+        while (r->index_room < num_frames)
+            r->index_room *= 2;
+        r->index_offset = r->position;
+        r->index_written = 0;
+        r->position += ROUND_UP (r->index_room * frame_size, DC1394_RECORD_ALIGN);
+    }
+
+    /* from the start of the aligned block holding the first new entry */
+    from = r->index_written * frame_size / DC1394_RECORD_ALIGN * DC1394_RECORD_ALIGN;
+    if (num_frames > r->index_written)
+        err = write_aligned (r, (unsigned char *) r->index + from,
+                num_frames * frame_size - from, r->index_offset + from);
+    if (err == DC1394_SUCCESS) {
+        h->index_offset = r->index_offset;
+        h->num_frames = num_frames;
+        err = write_aligned (r, r->head, r->head_size, 0);
+    }
+    if (err != DC1394_SUCCESS) {
+        dc1394_log_error ("Recorder: failed to write the index: %s", strerror (errno));
+        return err;
+    }
+    r->index_written = num_frames;
+    return DC1394_SUCCESS;
+}
+
+/* whether the index should be written with num_frames entries */
+static int
+index_due (dc1394recorder_t * r, uint64_t num_frames)
+{
+    struct timespec now;
+    uint64_t t;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    t = (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    if (num_frames - r->index_written < RECORDER_INDEX_FRAMES &&
+            t - r->index_time < RECORDER_INDEX_INTERVAL)
+        return 0;
+    r->index_time = t;
+    return 1;
+}
+
+/* writes a frame, or skips it after an error, then gives it back */
+static void
+record_frame (dc1394recorder_t * r, dc1394video_frame_t * frame)
+{
+    dc1394error_t err = DC1394_SUCCESS;
+    int written = 0;
+
+    /* only this thread sets the error and the number of frames: it can
+       read them unlocked */
+    if (r->error == DC1394_SUCCESS) {
+        err = write_frame (r, frame);
+        written = err == DC1394_SUCCESS;
+    }
+    if (frame->camera)
+        dc1394_capture_enqueue (frame->camera, frame);
+    if (written && index_due (r, r->num_frames + 1))
+        err = write_index (r, r->num_frames + 1);
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock (&r->mutex);
+#endif
+    if (err != DC1394_SUCCESS)
+        r->error = err;
+    if (written) {
+        r->num_frames++;
+        r->bytes_written += frame->total_bytes;
+    }
+#ifdef HAVE_PTHREAD
+    r->first = (r->first + 1) % r->queue_size;
+    r->pending--;
+    pthread_mutex_unlock (&r->mutex);
+#endif
+}
+
+#ifdef HAVE_PTHREAD
+static void *
+writer_thread (void * arg)
+{
+    dc1394recorder_t * r = arg;
+
+    pthread_mutex_lock (&r->mutex);
+    while (1) {
+        if (r->pending == 0) {
+            if (r->quit)
+                break;
+            pthread_cond_wait (&r->work, &r->mutex);
+            continue;
+        }
+        dc1394video_frame_t * frame = r->queue[r->first];
+        pthread_mutex_unlock (&r->mutex);
+        record_frame (r, frame);
+        pthread_mutex_lock (&r->mutex);
+    }
+    pthread_mutex_unlock (&r->mutex);
+    return NULL;
+}
+#endif
+
+static void
+recorder_release (dc1394recorder_t * r)
+{
+    if (r->fd >= 0)
+        close (r->fd);
+    free (r->head);
+    free (r->index);
+    free (r->bounce_alloc);
+#ifdef HAVE_PTHREAD
+    free (r->queue);
+#endif
+    free (r);
+}
+
+dc1394recorder_t *
+dc1394_recorder_new(dc1394camera_t *camera, const char *filename, uint32_t flags)
+{
+    dc1394recorder_t * r;
+    dc1394record_header_t * h;
+    int mode = O_WRONLY | O_CREAT | O_TRUNC | O_BINARY;
+
+    if (!camera || !filename)
+        return NULL;
+
+    r = calloc (1, sizeof (dc1394recorder_t));
+    if (!r)
+        return NULL;
+    r->camera = camera;
+    r->fd = -1;
+
+#ifdef O_DIRECT
+    if (flags & DC1394_RECORDER_FLAGS_DIRECT) {
+        r->fd = open (filename, mode | O_DIRECT, 0644);
+        r->direct = r->fd >= 0;
+        if (!r->direct)
+            dc1394_log_debug ("Recorder: no direct writes to %s: %s", filename, strerror (errno));
+    }
+#endif
+    if (r->fd < 0)
+        r->fd = open (filename, mode, 0644);
+    if (r->fd < 0) {
+        dc1394_log_error ("Recorder: could not create %s: %s", filename, strerror (errno));
+        recorder_release (r);
+        return NULL;
+    }
+
+    r->head_size = sizeof (dc1394record_header_t);
+    r->head = calloc (1, r->head_size);
+    if (!r->head || snapshot_camera (r) != DC1394_SUCCESS) {
+        recorder_release (r);
+        return NULL;
+    }
+
+    h = (dc1394record_header_t *) r->head;
+    memcpy (h->magic, DC1394_RECORD_MAGIC, sizeof h->magic);
+    h->version = DC1394_RECORD_VERSION;
+    h->byte_order = DC1394_RECORD_BYTE_ORDER;
+    h->guid = camera->guid;
+    h->command_registers_base = camera->command_registers_base;
+    h->registers_offset = sizeof (dc1394record_header_t);
+    h->registers_size = r->head_size - sizeof (dc1394record_header_t);
+    h->frame_size = sizeof (dc1394record_frame_t);
+    r->position = ROUND_UP (r->head_size, DC1394_RECORD_ALIGN);
+
+    /* an empty recording until the index is first written */
+    if (write_aligned (r, r->head, r->head_size, 0) != DC1394_SUCCESS) {
+        dc1394_log_error ("Recorder: could not write to %s: %s", filename, strerror (errno));
+        recorder_release (r);
+        return NULL;
+    }
+
+#ifdef HAVE_PTHREAD
+    r->queue_size = RECORDER_QUEUE_SIZE;
+    r->queue = malloc (r->queue_size * sizeof *r->queue);
+    if (!r->queue) {
+        recorder_release (r);
+        return NULL;
+    }
+    pthread_mutex_init (&r->mutex, NULL);
+    pthread_cond_init (&r->work, NULL);
+    if (pthread_create (&r->thread, NULL, writer_thread, r) != 0) {
+        dc1394_log_error ("Recorder: failed to launch the writer thread");
+        pthread_cond_destroy (&r->work);
+        pthread_mutex_destroy (&r->mutex);
+        recorder_release (r);
+        return NULL;
+    }
+#endif
+
+    dc1394_log_debug ("Recorder: recording %s, %s writes", filename,
+            r->direct ? "direct" : "buffered");
+    return r;
+}
+
+dc1394error_t
+dc1394_recorder_write(dc1394recorder_t *r, dc1394video_frame_t *frame)
+{
+    if (!r || !frame)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock (&r->mutex);
+    if (r->error != DC1394_SUCCESS) {
+        dc1394error_t err = r->error;
+        pthread_mutex_unlock (&r->mutex);
+        return err;
+    }
+    if (r->pending == r->queue_size) {
+        /* the queue is as long as the ring buffers it holds */
+        dc1394video_frame_t ** queue = malloc (2 * r->queue_size * sizeof *queue);
+        uint32_t i;
+        if (!queue) {
+            pthread_mutex_unlock (&r->mutex);
+            return DC1394_MEMORY_ALLOCATION_FAILURE;
+        }
+        for (i = 0; i < r->pending; i++)
+            queue[i] = r->queue[(r->first + i) % r->queue_size];
+        free (r->queue);
+        r->queue = queue;
+        r->queue_size *= 2;
+        r->first = 0;
+    }
+    r->queue[(r->first + r->pending) % r->queue_size] = frame;
+    r->pending++;
+    pthread_cond_signal (&r->work);
+    pthread_mutex_unlock (&r->mutex);
+#else
+    if (r->error != DC1394_SUCCESS)
+        return r->error;
+    record_frame (r, frame);
+#endif
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_recorder_get_status(dc1394recorder_t *r, uint64_t *frames_written, uint64_t *bytes_written,
+                           uint32_t *frames_pending)
+{
+    dc1394error_t err;
+
+    if (!r)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock (&r->mutex);
+#endif
+    if (frames_written)
+        *frames_written = r->num_frames;
+    if (bytes_written)
+        *bytes_written = r->bytes_written;
+    if (frames_pending) {
+#ifdef HAVE_PTHREAD
+        *frames_pending = r->pending;
+#else
+        *frames_pending = 0;
+#endif
+    }
+    err = r->error;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock (&r->mutex);
+#endif
+    return err;
+}
+
+dc1394error_t
+dc1394_recorder_free(dc1394recorder_t *r)
+{
+    dc1394error_t err;
+
+    if (!r)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock (&r->mutex);
+    r->quit = 1;
+    pthread_cond_signal (&r->work);
+    pthread_mutex_unlock (&r->mutex);
+    pthread_join (r->thread, NULL);
+    pthread_cond_destroy (&r->work);
+    pthread_mutex_destroy (&r->mutex);
+#endif
+
+    err = r->error;
+    if (err == DC1394_SUCCESS)
+        err = write_index (r, r->num_frames);
+    if (close (r->fd) < 0 && err == DC1394_SUCCESS)
+        err = DC1394_FAILURE;
+    r->fd = -1;
+
+    dc1394_log_debug ("Recorder: %"PRIu64" frames recorded", r->num_frames);
+    recorder_release (r);
+    return err;
+}
@@ -0,0 +1,176 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Recordings of cameras
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdint.h>
+#include <dc1394/log.h>
+#include <dc1394/camera.h>
+#include <dc1394/video.h>
+
+#ifndef __DC1394_RECORD_H__
+#define __DC1394_RECORD_H__
+
+/*! \file dc1394/record.h
+    \brief Recordings of cameras
+
+    A recording holds the frames of one camera and a snapshot of its
+    registers. Recordings are made with a dc1394recorder_t. The "replay" platform plays recordings back as cameras: set
+    the DC1394_REPLAY environment variable to a comma separated list of
+    recordings, and of the settings
+
+      speed=S   the playback speed, relative to the recorded one (1). 0 plays
+                the frames as fast as they are given back with
+                dc1394_capture_enqueue().
+      loop=1    start again at the end of the recordings. Without it, the
+                dequeue of a frame after the last one fails.
+
+    Recordings are made of:
+     - a header (dc1394record_header_t) at the start of the file
+     - the register snapshot: blocks of quadlets, each preceded by a
+       dc1394record_registers_t
+     - the images, each at an offset that is a multiple of
+       DC1394_RECORD_ALIGN
+     - the index: one dc1394record_frame_t per image, in capture order. It
+       is written while recording, every few frames and at least every
+       second, between the images: a recording cut short keeps the frames
+       up to the last update of the index.
+
+    All fields are in the byte order of the host that made the recording.
+*/
+
+#define DC1394_RECORD_MAGIC          "DC1394RC"
+#define DC1394_RECORD_VERSION        1
+#define DC1394_RECORD_BYTE_ORDER     0x01020304U
+#define DC1394_RECORD_ALIGN          4096
+
+/**
+ * The header of a recording
+ */
+typedef struct
+{
+    char                     magic[8];              /* DC1394_RECORD_MAGIC, without the final '\0' */
+    uint32_t                 version;               /* DC1394_RECORD_VERSION */
+    uint32_t                 byte_order;            /* DC1394_RECORD_BYTE_ORDER, as written by the recording host */
+    uint64_t                 guid;                  /* the camera */
+    uint64_t                 command_registers_base;/* from CONFIG_ROM_BASE, as in dc1394camera_t */
+    uint64_t                 registers_offset;      /* the register snapshot, from the start of the file */
+    uint64_t                 registers_size;        /* in bytes */
+    uint64_t                 index_offset;          /* the index, from the start of the file */
+    uint64_t                 num_frames;            /* the number of entries in the index */
+    uint32_t                 frame_size;            /* the size of an index entry */
+    uint32_t                 reserved[13];
+} dc1394record_header_t;
+
+/**
+ * A block of consecutive registers of the snapshot, followed by their num_quads values
+ */
+typedef struct
+{
+    uint64_t                 offset;                /* from CONFIG_ROM_BASE, like dc1394_get_registers() */
+    uint32_t                 num_quads;
+    uint32_t                 reserved;
+} dc1394record_registers_t;
+
+/**
+ * An entry of the index: a recorded frame. The fields are those of the dc1394video_frame_t.
+ */
+typedef struct
+{
+    uint64_t                 offset;                /* the image, from the start of the file */
+    uint64_t                 total_bytes;
+    uint64_t                 image_bytes;
+    uint64_t                 timestamp;
+    uint64_t                 sequence;
+    uint32_t                 size[2];
+    uint32_t                 position[2];
+    uint32_t                 color_coding;
+    uint32_t                 color_filter;
+    uint32_t                 yuv_byte_order;
+    uint32_t                 data_depth;
+    uint32_t                 stride;
+    uint32_t                 video_mode;
+    uint32_t                 padding_bytes;
+    uint32_t                 packet_size;
+    uint32_t                 packets_per_frame;
+    uint32_t                 id;
+    uint32_t                 frames_behind;
+    uint32_t                 iso_cycle;
+    uint32_t                 little_endian;
+    uint32_t                 data_in_padding;
+    uint32_t                 flags;                 /* DC1394_RECORD_FRAME_* */
+    uint32_t                 reserved;
+} dc1394record_frame_t;
+
+/* dc1394_capture_is_frame_corrupt() was true */
+#define DC1394_RECORD_FRAME_CORRUPT  0x00000001U
+
+/**
+ * Recorder flags
+ */
+#define DC1394_RECORDER_FLAGS_DIRECT 0x00000001U /* bypass the page cache (O_DIRECT) where the system allows it */
+
+/**
+ * A recorder: writes the frames of a camera to a recording from a thread of its own. The frames given to it are
+ * written from the buffers they were captured in, and go back to the ring buffer of their camera once written.
+ */
+typedef struct __dc1394recorder_t dc1394recorder_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************
+     Recorder Functions
+ ***************************************************************************/
+
+/**
+ * Creates the recording 'filename' and takes the snapshot of the registers of the camera, which should
+ * therefore already be set up in the video mode to record. Returns NULL on failure.
+ */
+dc1394recorder_t *
+dc1394_recorder_new(dc1394camera_t *camera, const char *filename, uint32_t flags);
+
+/**
+ * Queues a frame for writing. The recorder takes the frame: it is given back with dc1394_capture_enqueue() once
+ * written (or skipped after a write error), and must not be used afterwards. Frames that do not come from a
+ * camera (frame->camera is NULL) are left to the caller, who must keep them until dc1394_recorder_free().
+ * Returns the first write error, if any, in which case the frame is not taken.
+ */
+dc1394error_t
+dc1394_recorder_write(dc1394recorder_t *recorder, dc1394video_frame_t *frame);
+
+/**
+ * Gets the number of frames written, of bytes written and of frames waiting to be written
+ */
+dc1394error_t
+dc1394_recorder_get_status(dc1394recorder_t *recorder, uint64_t *frames_written, uint64_t *bytes_written,
+                           uint32_t *frames_pending);
+
+/**
+ * Writes the queued frames and the rest of the index, then closes the recording and frees the recorder. Must be called
+ * before dc1394_capture_stop(). Returns the first write error, if any.
+ */
+dc1394error_t
+dc1394_recorder_free(dc1394recorder_t *recorder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
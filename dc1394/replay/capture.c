@@ -0,0 +1,453 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Recording playback backend for dc1394
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "replay/replay.h"
+#include "utils.h"
+#include "log.h"
+
+static uint64_t
+now_ns (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void
+timespec_from_ns (struct timespec * ts, uint64_t ns)
+{
+    ts->tv_sec = ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
+/*
+  Hands the next recorded frame to the next buffer of the ring. The image
+  is not copied: the buffer points into the mapping of the file. A frame
+  that finds no free buffer is lost, like on the bus. Called with the
+  mutex held.
+*/
+static void
+send_frame (platform_camera_t * craw)
+{
+    struct replay_frame * f = craw->frames + craw->fill;
+    const dc1394record_frame_t * r = craw->rec->index + craw->next;
+
+    if (f->status != BUFFER_EMPTY) {
+        dc1394_log_debug ("replay: No buffer for frame %"PRIu64, craw->next);
+        return;
+    }
+
+    f->frame.image = craw->map + r->offset;
+    f->frame.size[0] = r->size[0];
+    f->frame.size[1] = r->size[1];
+    f->frame.position[0] = r->position[0];
+    f->frame.position[1] = r->position[1];
+    f->frame.color_coding = r->color_coding;
+    f->frame.color_filter = r->color_filter;
+    f->frame.yuv_byte_order = r->yuv_byte_order;
+    f->frame.data_depth = r->data_depth;
+    f->frame.stride = r->stride;
+    f->frame.video_mode = r->video_mode;
+    f->frame.total_bytes = r->total_bytes;
+    f->frame.image_bytes = r->image_bytes;
+    f->frame.padding_bytes = r->padding_bytes;
+    f->frame.packet_size = r->packet_size;
+    f->frame.packets_per_frame = r->packets_per_frame;
+    f->frame.timestamp = r->timestamp;
+    f->frame.allocated_image_bytes = 0;
+    f->frame.little_endian = r->little_endian;
+    f->frame.data_in_padding = r->data_in_padding;
+    f->frame.iso_cycle = r->iso_cycle;
+
+    f->status = (r->flags & DC1394_RECORD_FRAME_CORRUPT) ? BUFFER_CORRUPT : BUFFER_FILLED;
+    craw->frames_ready++;
+    craw->fill = (craw->fill + 1) % craw->num_frames;
+
+    write (craw->notify_pipe[1], "+", 1);
+}
+
+/* moves to the next recorded frame. At the end, the write end of the pipe
+   is closed so that readers see the end of the file. */
+static void
+next_frame (platform_camera_t * craw)
+{
+    if (++craw->next < craw->rec->header->num_frames)
+        return;
+    if (craw->p->loop) {
+        craw->next = 0;
+        return;
+    }
+    dc1394_log_debug ("replay: All %"PRIu64" frames sent", craw->next);
+    craw->end = 1;
+    close (craw->notify_pipe[1]);
+    craw->notify_pipe[1] = -1;
+}
+
+/*
+  Sends the recorded frames while the transmission is on, or for one-shot
+  requests, with the recorded intervals scaled by the playback speed.
+  Without a speed, or without timestamps, it sends them as fast as the
+  buffers are given back.
+*/
+static void *
+capture_thread (void * arg)
+{
+    platform_camera_t * craw = arg;
+    const dc1394record_frame_t * index = craw->rec->index;
+    double speed = craw->p->speed;
+    uint64_t start_ns = 0, start_ts = 0;
+    int anchored = 0;
+    struct timespec ts;
+
+    dc1394_log_debug ("replay: Frame thread starting");
+
+    pthread_mutex_lock (&craw->mutex);
+    while (!craw->kill_thread) {
+        int iso_on = (craw->iso_en & 0x80000000UL) != 0;
+        if ((!iso_on && craw->shots == 0) || craw->end) {
+            pthread_cond_wait (&craw->cond, &craw->mutex);
+            anchored = 0;
+            continue;
+        }
+
+        uint64_t stamp = index[craw->next].timestamp;
+        if (speed > 0 && stamp > 0) {
+            uint64_t now = now_ns ();
+            /* restart the cadence at the first frame, and where the time
+               of the recording goes back, as when it loops */
+            if (!anchored || stamp < start_ts) {
+                start_ns = now;
+                start_ts = stamp;
+                anchored = 1;
+            }
+            uint64_t due = start_ns + (uint64_t) ((stamp - start_ts) * 1000 / speed);
+            if (now < due) {
+                timespec_from_ns (&ts, due);
+                pthread_cond_timedwait (&craw->cond, &craw->mutex, &ts);
+                continue;
+            }
+        }
+        else if (craw->frames[craw->fill].status != BUFFER_EMPTY) {
+            pthread_cond_wait (&craw->cond, &craw->mutex);
+            continue;
+        }
+
+        if (!iso_on)
+            replay_shot_done (craw);
+        send_frame (craw);
+        next_frame (craw);
+    }
+    pthread_mutex_unlock (&craw->mutex);
+
+    dc1394_log_debug ("replay: Frame thread ending");
+    return NULL;
+}
+
+dc1394error_t
+dc1394_replay_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
+        uint32_t flags)
+{
+    dc1394camera_t * camera = craw->camera;
+    int fd, i;
+
+    // if capture is already set, abort
+    if (craw->capture_is_set > 0)
+        return DC1394_CAPTURE_IS_RUNNING;
+
+    if (num_dma_buffers == 0)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    if (craw->rec->header->num_frames == 0) {
+        dc1394_log_error("replay: %s has no frames", craw->rec->path);
+        return DC1394_FAILURE;
+    }
+
+    craw->capture_is_set = 1;
+    craw->notify_pipe[0] = -1;
+    craw->notify_pipe[1] = -1;
+
+    if (flags & DC1394_CAPTURE_FLAGS_DEFAULT)
+        flags = DC1394_CAPTURE_FLAGS_CHANNEL_ALLOC |
+            DC1394_CAPTURE_FLAGS_BANDWIDTH_ALLOC;
+
+    craw->flags = flags;
+
+    /* a private mapping, so that the images can be written to like
+       those of the other platforms without changing the recording */
+    fd = open (craw->rec->path, O_RDONLY);
+    if (fd < 0) {
+        dc1394_log_error("replay: Cannot open %s", craw->rec->path);
+        dc1394_replay_capture_stop (craw);
+        return DC1394_FAILURE;
+    }
+    craw->map = mmap (NULL, craw->rec->size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (craw->map == MAP_FAILED) {
+        craw->map = NULL;
+        dc1394_log_error("replay: Cannot map %s", craw->rec->path);
+        dc1394_replay_capture_stop (craw);
+        return DC1394_FAILURE;
+    }
+
+    if (pipe (craw->notify_pipe) < 0) {
+        craw->notify_pipe[0] = -1;
+        craw->notify_pipe[1] = -1;
+        dc1394_replay_capture_stop (craw);
+        return DC1394_FAILURE;
+    }
+
+    craw->num_frames = num_dma_buffers;
+    craw->current = -1;
+    craw->fill = 0;
+    craw->frames_ready = 0;
+    craw->next = 0;
+    craw->end = 0;
+
+    craw->frames = calloc (num_dma_buffers, sizeof *craw->frames);
+    if (craw->frames == NULL) {
+        dc1394_replay_capture_stop (craw);
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+    }
+
+    for (i = 0; i < num_dma_buffers; i++) {
+        craw->frames[i].frame.camera = camera;
+        craw->frames[i].frame.id = i;
+        craw->frames[i].status = BUFFER_EMPTY;
+    }
+
+    if (pthread_create (&craw->thread, NULL, capture_thread, craw) != 0) {
+        dc1394_log_error ("replay: Failed to launch frame thread");
+        dc1394_replay_capture_stop (craw);
+        return DC1394_FAILURE;
+    }
+    craw->thread_created = 1;
+
+    // if auto iso is requested, start ISO
+    if (flags & DC1394_CAPTURE_FLAGS_AUTO_ISO) {
+        dc1394_video_set_transmission(camera, DC1394_ON);
+        craw->iso_auto_started = 1;
+    }
+
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_replay_capture_stop(platform_camera_t *craw)
+{
+    dc1394camera_t * camera = craw->camera;
+
+    if (craw->capture_is_set == 0)
+        return DC1394_CAPTURE_IS_NOT_SET;
+
+    dc1394_log_debug ("replay: Capture stopping");
+
+    // stop ISO if it was started automatically
+    if (craw->iso_auto_started > 0) {
+        dc1394_video_set_transmission(camera, DC1394_OFF);
+        craw->iso_auto_started = 0;
+    }
+
+    if (craw->thread_created) {
+        pthread_mutex_lock (&craw->mutex);
+        craw->kill_thread = 1;
+        pthread_cond_broadcast (&craw->cond);
+        pthread_mutex_unlock (&craw->mutex);
+        pthread_join (craw->thread, NULL);
+        dc1394_log_debug ("replay: Joined with frame thread");
+        craw->kill_thread = 0;
+        craw->thread_created = 0;
+    }
+
+    free (craw->frames);
+    craw->frames = NULL;
+    if (craw->map)
+        munmap (craw->map, craw->rec->size);
+    craw->map = NULL;
+
+    if (craw->notify_pipe[0] >= 0)
+        close (craw->notify_pipe[0]);
+    if (craw->notify_pipe[1] >= 0)
+        close (craw->notify_pipe[1]);
+    craw->notify_pipe[0] = -1;
+    craw->notify_pipe[1] = -1;
+
+    craw->capture_is_set = 0;
+
+    return DC1394_SUCCESS;
+}
+
+#define NEXT_BUFFER(c,i) (((i) == -1) ? 0 : ((i)+1)%(c)->num_frames)
+
+/* takes the next frame of the ring, waiting for it to be filled */
+static struct replay_frame *
+take_frame (platform_camera_t * craw)
+{
+    int next = NEXT_BUFFER (craw, craw->current);
+    struct replay_frame * f = craw->frames + next;
+
+    char ch;
+    ssize_t len = read (craw->notify_pipe[0], &ch, 1);
+    if (len == 0)
+        dc1394_log_debug ("replay: End of the recording");
+    if (len != 1)
+        return NULL;
+
+    pthread_mutex_lock (&craw->mutex);
+    if (f->status != BUFFER_FILLED && f->status != BUFFER_CORRUPT) {
+        dc1394_log_error ("replay: Expected filled buffer");
+        pthread_mutex_unlock (&craw->mutex);
+        return NULL;
+    }
+    craw->frames_ready--;
+    f->frame.frames_behind = craw->frames_ready;
+    pthread_mutex_unlock (&craw->mutex);
+
+    craw->current = next;
+    return f;
+}
+
+dc1394error_t
+dc1394_replay_capture_dequeue (platform_camera_t * craw,
+        dc1394capture_policy_t policy, dc1394video_frame_t **frame_return)
+{
+    struct replay_frame * f = craw->frames + NEXT_BUFFER (craw, craw->current);
+
+    if ((policy < DC1394_CAPTURE_POLICY_MIN)
+            || (policy > DC1394_CAPTURE_POLICY_MAX))
+        return DC1394_INVALID_CAPTURE_POLICY;
+
+    /* default: return NULL in case of failures or lack of frames */
+    *frame_return = NULL;
+
+    if (policy == DC1394_CAPTURE_POLICY_POLL) {
+        int status, end;
+        pthread_mutex_lock (&craw->mutex);
+        status = f->status;
+        end = craw->end && craw->frames_ready == 0;
+        pthread_mutex_unlock (&craw->mutex);
+        if (end) {
+            dc1394_log_debug ("replay: End of the recording");
+            return DC1394_FAILURE;
+        }
+        if (status != BUFFER_FILLED && status != BUFFER_CORRUPT)
+            return DC1394_SUCCESS;
+    }
+
+    f = take_frame (craw);
+    if (!f)
+        return DC1394_FAILURE;
+
+    /* the frames filled after this one are ready: give it back and take the next */
+    while (policy == DC1394_CAPTURE_POLICY_LATEST && f->frame.frames_behind > 0) {
+        dc1394_replay_capture_enqueue (craw, &f->frame);
+        f = take_frame (craw);
+        if (!f)
+            return DC1394_FAILURE;
+    }
+
+    *frame_return = &f->frame;
+
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_replay_capture_dequeue_timeout (platform_camera_t * craw,
+        uint32_t timeout_us, dc1394video_frame_t **frame_return)
+{
+    struct replay_frame * f;
+    int err;
+
+    /* default: return NULL in case of failures or lack of frames */
+    *frame_return = NULL;
+
+    err = capture_wait_readable (craw->notify_pipe[0], timeout_us);
+    if (err < 0) {
+        dc1394_log_error ("replay: poll() failed");
+        return DC1394_FAILURE;
+    }
+    if (err == 0)
+        return DC1394_SUCCESS;
+
+    f = take_frame (craw);
+    if (!f)
+        return DC1394_FAILURE;
+
+    *frame_return = &f->frame;
+
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_replay_capture_enqueue (platform_camera_t * craw,
+        dc1394video_frame_t * frame)
+{
+    dc1394camera_t * camera = craw->camera;
+    struct replay_frame * f = (struct replay_frame *) frame;
+
+    if (frame->camera != camera) {
+        dc1394_log_error("replay: Camera does not match frame's camera");
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    }
+
+    pthread_mutex_lock (&craw->mutex);
+    if (f->status != BUFFER_FILLED && f->status != BUFFER_CORRUPT) {
+        pthread_mutex_unlock (&craw->mutex);
+        dc1394_log_error ("replay: Frame is not enqueuable");
+        return DC1394_FAILURE;
+    }
+
+    f->status = BUFFER_EMPTY;
+    pthread_cond_broadcast (&craw->cond);
+    pthread_mutex_unlock (&craw->mutex);
+
+    return DC1394_SUCCESS;
+}
+
+int
+dc1394_replay_capture_get_fileno (platform_camera_t * craw)
+{
+    if (!craw->capture_is_set)
+        return -1;
+
+    return craw->notify_pipe[0];
+}
+
+dc1394bool_t
+dc1394_replay_capture_is_frame_corrupt (platform_camera_t * craw,
+        dc1394video_frame_t * frame)
+{
+    struct replay_frame * f = (struct replay_frame *) frame;
+
+    if (f->status == BUFFER_CORRUPT)
+        return DC1394_TRUE;
+
+    return DC1394_FALSE;
+}
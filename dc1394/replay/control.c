@@ -0,0 +1,434 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Recording playback backend for dc1394
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "config.h"
+#include "platform.h"
+#include "internal.h"
+#include "replay/replay.h"
+#include "utils.h"
+#include "log.h"
+
+/* checks that a frame fits in the file, and its image in the frame */
+static int
+frame_fits (const dc1394record_frame_t * f, uint64_t file_size)
+{
+    uint64_t pixels = (uint64_t) f->size[0] * f->size[1];
+    uint32_t bits;
+
+    if (f->offset > file_size || f->total_bytes > file_size - f->offset ||
+            f->image_bytes > f->total_bytes ||
+            (uint64_t) f->stride * f->size[1] > f->total_bytes)
+        return 0;
+    /* a pixel takes at least a byte: bounds pixels * bits */
+    if (dc1394_get_color_coding_bit_size (f->color_coding, &bits) != DC1394_SUCCESS ||
+            pixels > f->total_bytes || pixels * bits / 8 > f->total_bytes)
+        return 0;
+    return 1;
+}
+
+/* checks that the header, the snapshot and the index fit in the file */
+static int
+check_recording (replay_recording_t * rec)
+{
+    const dc1394record_header_t * h = rec->header;
+    uint64_t i, pos;
+
+    if (rec->size < sizeof (dc1394record_header_t) ||
+            memcmp (h->magic, DC1394_RECORD_MAGIC, sizeof h->magic)) {
+        dc1394_log_warning ("replay: %s is not a recording", rec->path);
+        return -1;
+    }
+    if (h->version != DC1394_RECORD_VERSION ||
+            h->byte_order != DC1394_RECORD_BYTE_ORDER ||
+            h->frame_size != sizeof (dc1394record_frame_t)) {
+        dc1394_log_warning ("replay: Cannot play %s: version %d or byte order",
+                rec->path, h->version);
+        return -1;
+    }
+    if (h->registers_offset > rec->size || h->registers_size > rec->size - h->registers_offset ||
+            h->registers_offset % 8 || h->index_offset > rec->size || h->index_offset % 8 ||
+            h->num_frames > (rec->size - h->index_offset) / sizeof (dc1394record_frame_t)) {
+        dc1394_log_warning ("replay: %s is truncated", rec->path);
+        return -1;
+    }
+
+    for (pos = 0; pos < h->registers_size; ) {
+        const dc1394record_registers_t * b = (const void *) (rec->map + h->registers_offset + pos);
+        if (h->registers_size - pos < sizeof *b ||
+                b->num_quads > (h->registers_size - pos - sizeof *b) / 4) {
+            dc1394_log_warning ("replay: Bad register snapshot in %s", rec->path);
+            return -1;
+        }
+        pos += sizeof *b + ((b->num_quads * 4 + 7) & ~7);
+    }
+
+    rec->index = (const dc1394record_frame_t *) (rec->map + h->index_offset);
+    for (i = 0; i < h->num_frames; i++) {
+        if (!frame_fits (rec->index + i, rec->size)) {
+            dc1394_log_warning ("replay: Frame %"PRIu64" of %s is out of the file",
+                    i, rec->path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int
+open_recording (replay_recording_t * rec, const char * path)
+{
+    struct stat st;
+    int fd = open (path, O_RDONLY);
+    if (fd < 0) {
+        dc1394_log_warning ("replay: Cannot open %s", path);
+        return -1;
+    }
+    if (fstat (fd, &st) < 0 || st.st_size == 0) {
+        close (fd);
+        return -1;
+    }
+    rec->size = st.st_size;
+    rec->map = mmap (NULL, rec->size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (rec->map == MAP_FAILED) {
+        dc1394_log_warning ("replay: Cannot map %s", path);
+        return -1;
+    }
+    rec->path = strdup (path);
+    rec->header = (const dc1394record_header_t *) rec->map;
+    if (check_recording (rec) < 0) {
+        munmap (rec->map, rec->size);
+        free (rec->path);
+        return -1;
+    }
+    return 0;
+}
+
+static platform_t *
+dc1394_replay_new (void)
+{
+    const char * env = getenv (REPLAY_ENV);
+    if (!env)
+        return NULL;
+
+    platform_t * p = calloc (1, sizeof (platform_t));
+    if (!p)
+        return NULL;
+    p->speed = 1;
+
+    char * settings = strdup (env);
+    char * save = NULL;
+    char * tok;
+    for (tok = strtok_r (settings, ",", &save); tok;
+            tok = strtok_r (NULL, ",", &save)) {
+        char * end;
+        if (!strncmp (tok, "speed=", 6)) {
+            p->speed = strtod (tok + 6, &end);
+            if (end == tok + 6 || *end != '\0' || p->speed < 0) {
+                dc1394_log_warning ("replay: Ignoring invalid setting %s", tok);
+                p->speed = 1;
+            }
+        }
+        else if (!strncmp (tok, "loop=", 5))
+            p->loop = atoi (tok + 5);
+        else {
+            replay_recording_t * recs = realloc (p->recordings,
+                    (p->num_recordings + 1) * sizeof (replay_recording_t));
+            if (!recs)
+                break;
+            p->recordings = recs;
+            memset (recs + p->num_recordings, 0, sizeof (replay_recording_t));
+            if (open_recording (recs + p->num_recordings, tok) == 0)
+                p->num_recordings++;
+        }
+    }
+    free (settings);
+
+    dc1394_log_debug ("replay: %d recording(s)", p->num_recordings);
+    return p;
+}
+
+static void
+dc1394_replay_free (platform_t * p)
+{
+    int i;
+    for (i = 0; i < p->num_recordings; i++) {
+        munmap (p->recordings[i].map, p->recordings[i].size);
+        free (p->recordings[i].path);
+    }
+    free (p->recordings);
+    free (p);
+}
+
+static platform_device_list_t *
+dc1394_replay_get_device_list (platform_t * p)
+{
+    platform_device_list_t * list;
+    int i;
+
+    list = calloc (1, sizeof (platform_device_list_t));
+    if (!list)
+        return NULL;
+    if (p->num_recordings == 0)
+        return list;
+
+    list->devices = calloc (p->num_recordings, sizeof (platform_device_t *));
+    if (!list->devices) {
+        free (list);
+        return NULL;
+    }
+    for (i = 0; i < p->num_recordings; i++) {
+        platform_device_t * dev = calloc (1, sizeof (platform_device_t));
+        if (!dev)
+            break;
+        dev->rec = p->recordings + i;
+        dev->index = i;
+        list->devices[i] = dev;
+    }
+    list->num_devices = i;
+    return list;
+}
+
+static void
+dc1394_replay_free_device_list (platform_device_list_t * d)
+{
+    int i;
+    for (i = 0; i < d->num_devices; i++)
+        free (d->devices[i]);
+    free (d->devices);
+    free (d);
+}
+
+/* the snapshot of the register at 'offset', or NULL if it was not recorded */
+static const uint32_t *
+find_register (const replay_recording_t * rec, uint64_t offset)
+{
+    const dc1394record_header_t * h = rec->header;
+    uint64_t pos;
+
+    for (pos = 0; pos < h->registers_size; ) {
+        const dc1394record_registers_t * b = (const void *) (rec->map + h->registers_offset + pos);
+        const uint32_t * quads = (const uint32_t *) (b + 1);
+        if (offset >= b->offset && offset < b->offset + 4 * (uint64_t) b->num_quads &&
+                (offset - b->offset) % 4 == 0)
+            return quads + (offset - b->offset) / 4;
+        pos += sizeof *b + ((b->num_quads * 4 + 7) & ~7);
+    }
+    return NULL;
+}
+
+static int
+dc1394_replay_device_get_config_rom (platform_device_t * device,
+                                     uint32_t * quads, int * num_quads)
+{
+    int i;
+
+    for (i = 0; i < *num_quads; i++) {
+        const uint32_t * q = find_register (device->rec, ROM_BUS_INFO_BLOCK + 4 * i);
+        if (!q)
+            break;
+        quads[i] = *q;
+    }
+    if (i == 0) {
+        dc1394_log_warning ("replay: No config ROM in %s", device->rec->path);
+        return -1;
+    }
+    *num_quads = i;
+    return 0;
+}
+
+static platform_camera_t *
+dc1394_replay_camera_new (platform_t * p, platform_device_t * device,
+                          uint32_t unit_directory_offset)
+{
+    platform_camera_t * craw;
+    pthread_condattr_t attr;
+
+    craw = calloc (1, sizeof (platform_camera_t));
+    if (!craw)
+        return NULL;
+    craw->p = p;
+    craw->rec = device->rec;
+    craw->index = device->index;
+    craw->notify_pipe[0] = -1;
+    craw->notify_pipe[1] = -1;
+
+    pthread_mutex_init (&craw->mutex, NULL);
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_cond_init (&craw->cond, &attr);
+    pthread_condattr_destroy (&attr);
+    return craw;
+}
+
+static void
+dc1394_replay_camera_free (platform_camera_t * craw)
+{
+    if (craw->capture_is_set)
+        dc1394_replay_capture_stop (craw);
+    pthread_cond_destroy (&craw->cond);
+    pthread_mutex_destroy (&craw->mutex);
+    free (craw);
+}
+
+static void
+dc1394_replay_camera_set_parent (platform_camera_t * craw, dc1394camera_t * parent)
+{
+    craw->camera = parent;
+}
+
+static dc1394error_t
+dc1394_replay_camera_print_info (platform_camera_t * craw, FILE *fd)
+{
+    const replay_recording_t * rec = craw->rec;
+    uint64_t n = rec->header->num_frames;
+
+    fprintf(fd,"------ Camera platform-specific information ------\n");
+    fprintf(fd,"Recording                         :     %s\n", rec->path);
+    fprintf(fd,"Frames                            :     %"PRIu64"\n", n);
+    if (n > 1)
+        fprintf(fd,"Duration                          :     %.3f s\n",
+                (rec->index[n-1].timestamp - rec->index[0].timestamp) / 1e6);
+    if (craw->p->speed > 0)
+        fprintf(fd,"Playback speed                    :     %g\n", craw->p->speed);
+    else
+        fprintf(fd,"Playback speed                    :     as fast as possible\n");
+    return DC1394_SUCCESS;
+}
+
+void
+replay_shot_done (platform_camera_t * craw)
+{
+    if (craw->shots > 0 && --craw->shots == 0)
+        craw->one_shot = 0;
+}
+
+/*
+  Register reads come from the snapshot, except for the transmission
+  registers which start and stop the playback.
+*/
+static dc1394error_t
+dc1394_replay_camera_read (platform_camera_t * craw, uint64_t offset,
+                           uint32_t * quads, int num_quads)
+{
+    uint64_t base = craw->rec->header->command_registers_base;
+    int i;
+
+    pthread_mutex_lock (&craw->mutex);
+    for (i = 0; i < num_quads; i++) {
+        uint64_t address = offset + 4 * i;
+        const uint32_t * q;
+        if (address == base + REG_CAMERA_ISO_EN)
+            quads[i] = craw->iso_en;
+        else if (address == base + REG_CAMERA_ONE_SHOT)
+            quads[i] = craw->one_shot;
+        else if ((q = find_register (craw->rec, address)) != NULL)
+            quads[i] = *q;
+        else {
+            pthread_mutex_unlock (&craw->mutex);
+            return DC1394_FAILURE;
+        }
+    }
+    pthread_mutex_unlock (&craw->mutex);
+    return DC1394_SUCCESS;
+}
+
+/* the recording cannot change, so the other writes are ignored */
+static dc1394error_t
+dc1394_replay_camera_write (platform_camera_t * craw, uint64_t offset,
+                            const uint32_t * quads, int num_quads)
+{
+    uint64_t base = craw->rec->header->command_registers_base;
+    int i;
+
+    pthread_mutex_lock (&craw->mutex);
+    for (i = 0; i < num_quads; i++) {
+        uint64_t address = offset + 4 * i;
+        if (address == base + REG_CAMERA_ISO_EN) {
+            craw->iso_en = quads[i] & 0x80000000UL;
+            pthread_cond_broadcast (&craw->cond);
+        }
+        else if (address == base + REG_CAMERA_ONE_SHOT && !craw->iso_en) {
+            if (quads[i] & 0x80000000UL)
+                craw->shots = 1;
+            else if (quads[i] & 0x40000000UL)
+                craw->shots = quads[i] & 0xFFFF;
+            else
+                craw->shots = 0;
+            craw->one_shot = craw->shots ? quads[i] & 0xC000FFFFUL : 0;
+            pthread_cond_broadcast (&craw->cond);
+        }
+    }
+    pthread_mutex_unlock (&craw->mutex);
+    return DC1394_SUCCESS;
+}
+
+static dc1394error_t
+dc1394_replay_camera_get_node (platform_camera_t * craw, uint32_t * node,
+        uint32_t * generation)
+{
+    if (node)
+        *node = craw->index;
+    if (generation)
+        *generation = 0;
+    return DC1394_SUCCESS;
+}
+
+static platform_dispatch_t
+replay_dispatch = {
+    .platform_new = dc1394_replay_new,
+    .platform_free = dc1394_replay_free,
+
+    .get_device_list = dc1394_replay_get_device_list,
+    .free_device_list = dc1394_replay_free_device_list,
+    .device_get_config_rom = dc1394_replay_device_get_config_rom,
+
+    .camera_new = dc1394_replay_camera_new,
+    .camera_free = dc1394_replay_camera_free,
+    .camera_set_parent = dc1394_replay_camera_set_parent,
+
+    .camera_print_info = dc1394_replay_camera_print_info,
+    .camera_get_node = dc1394_replay_camera_get_node,
+
+    .camera_read = dc1394_replay_camera_read,
+    .camera_write = dc1394_replay_camera_write,
+
+    .capture_setup = dc1394_replay_capture_setup,
+    .capture_stop = dc1394_replay_capture_stop,
+    .capture_dequeue = dc1394_replay_capture_dequeue,
+    .capture_dequeue_timeout = dc1394_replay_capture_dequeue_timeout,
+    .capture_enqueue = dc1394_replay_capture_enqueue,
+    .capture_get_fileno = dc1394_replay_capture_get_fileno,
+    .capture_is_frame_corrupt = dc1394_replay_capture_is_frame_corrupt,
+};
+
+void
+replay_init(dc1394_t * d)
+{
+    register_platform (d, &replay_dispatch, "replay");
+}
@@ -0,0 +1,128 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Recording playback backend for dc1394
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __DC1394_REPLAY_H__
+#define __DC1394_REPLAY_H__
+
+#include <pthread.h>
+#include "config.h"
+#include "internal.h"
+#include "register.h"
+#include "offsets.h"
+#include "record.h"
+
+/* the list of recordings and settings, see record.h */
+#define REPLAY_ENV             "DC1394_REPLAY"
+
+typedef struct {
+    char * path;
+    unsigned char * map;        /* the whole file, read-only */
+    size_t size;
+    const dc1394record_header_t * header;
+    const dc1394record_frame_t * index;
+} replay_recording_t;
+
+struct _platform_t {
+    int num_recordings;
+    replay_recording_t * recordings;
+    double speed;               /* 0: as fast as the frames are enqueued */
+    int loop;
+};
+
+struct _platform_device_t {
+    replay_recording_t * rec;
+    int index;
+};
+
+typedef enum {
+    BUFFER_EMPTY,
+    BUFFER_FILLED,
+    BUFFER_CORRUPT,
+} replay_frame_status;
+
+struct replay_frame {
+    dc1394video_frame_t frame;
+    replay_frame_status status;
+};
+
+struct _platform_camera_t {
+    platform_t * p;
+    replay_recording_t * rec;
+    int index;
+    dc1394camera_t * camera;
+
+    /* the only live registers; the mutex also protects the ring buffer */
+    uint32_t iso_en;
+    uint32_t one_shot;
+    uint32_t shots;             /* frames left to send for ONE_SHOT */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* signalled when the playback starts or stops */
+
+    struct replay_frame * frames;
+    unsigned char * map;        /* the file, copy-on-write for the frames */
+    uint32_t flags;
+    unsigned int num_frames;
+    int current;
+    int fill;                   /* the next buffer to fill */
+    int frames_ready;
+    uint64_t next;              /* the next recorded frame */
+    int end;                    /* all the frames were sent */
+
+    int notify_pipe[2];
+    pthread_t thread;
+    int thread_created;
+    int kill_thread;
+
+    int capture_is_set;
+    int iso_auto_started;
+};
+
+/* counts one frame of a ONE_SHOT or multi-shot request. Called with the
+   mutex held. */
+void
+replay_shot_done (platform_camera_t * craw);
+
+dc1394error_t
+dc1394_replay_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
+        uint32_t flags);
+
+dc1394error_t
+dc1394_replay_capture_stop(platform_camera_t *craw);
+
+dc1394error_t
+dc1394_replay_capture_dequeue (platform_camera_t * craw,
+        dc1394capture_policy_t policy, dc1394video_frame_t **frame_return);
+
+dc1394error_t
+dc1394_replay_capture_dequeue_timeout (platform_camera_t * craw,
+        uint32_t timeout_us, dc1394video_frame_t **frame_return);
+
+dc1394error_t
+dc1394_replay_capture_enqueue (platform_camera_t * craw,
+        dc1394video_frame_t * frame);
+
+int
+dc1394_replay_capture_get_fileno (platform_camera_t * craw);
+
+dc1394bool_t
+dc1394_replay_capture_is_frame_corrupt (platform_camera_t * craw,
+        dc1394video_frame_t * frame);
+
+#endif
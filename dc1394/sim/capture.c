@@ -0,0 +1,565 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Simulated camera backend for dc1394
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sim/sim.h"
+#include "utils.h"
+#include "conversions.h"
+
+/* a uniform random number in [0,1) */
+static double
+sim_random (platform_camera_t * craw)
+{
+    uint32_t x = craw->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    craw->random = x;
+    return x / 4294967296.0;
+}
+
+static void
+put16 (unsigned char * p, uint32_t v, uint32_t depth)
+{
+    v <<= depth - 8;
+    p[0] = v >> 8;
+    p[1] = v & 0xff;
+}
+
+/*
+  Renders the test pattern in the color coding of the frames. It repeats
+  every SIM_PATTERN_PERIOD pixels along the lines, so that a frame is a
+  window into it.
+*/
+static dc1394error_t
+make_pattern (platform_camera_t * craw, const dc1394video_frame_t * proto)
+{
+    uint32_t width = proto->size[0] + SIM_PATTERN_PERIOD;
+    uint32_t height = proto->size[1];
+    uint32_t depth = proto->data_depth;
+    uint32_t bits, x, y;
+    int rx = 0, ry = 0;
+
+    if (dc1394_get_color_coding_bit_size (proto->color_coding, &bits) != DC1394_SUCCESS)
+        return DC1394_INVALID_COLOR_CODING;
+    if (depth < 8 || depth > 16)
+        depth = 16;
+
+    /* where the red pixel is in the color filter tile */
+    switch (proto->color_filter) {
+    case DC1394_COLOR_FILTER_GBRG:
+        ry = 1;
+        break;
+    case DC1394_COLOR_FILTER_GRBG:
+        rx = 1;
+        break;
+    case DC1394_COLOR_FILTER_BGGR:
+        rx = ry = 1;
+        break;
+    default:
+        break;
+    }
+
+    craw->pattern_stride = width * bits / 8;
+    craw->pattern = malloc ((size_t) craw->pattern_stride * height);
+    if (craw->pattern == NULL)
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+
+    for (y = 0; y < height; y++) {
+        unsigned char * line = craw->pattern + (size_t) y * craw->pattern_stride;
+        for (x = 0; x < width; x++) {
+            unsigned char * p = line + x * bits / 8;
+            int r = x % SIM_PATTERN_PERIOD;
+            int g = (y * 2) & 0xff;
+            int b = ((x + y) ^ (y / 16 * 16)) & 0xff;
+            int Y, u, v, c;
+            RGB2YUV (r, g, b, Y, u, v);
+
+            switch (proto->color_coding) {
+            case DC1394_COLOR_CODING_MONO8:
+                p[0] = Y;
+                break;
+            case DC1394_COLOR_CODING_MONO16:
+                put16 (p, Y, depth);
+                break;
+            case DC1394_COLOR_CODING_RGB8:
+                p[0] = r;
+                p[1] = g;
+                p[2] = b;
+                break;
+            case DC1394_COLOR_CODING_RGB16:
+                put16 (p, r, depth);
+                put16 (p + 2, g, depth);
+                put16 (p + 4, b, depth);
+                break;
+            case DC1394_COLOR_CODING_YUV444:
+                p[0] = u;
+                p[1] = Y;
+                p[2] = v;
+                break;
+            case DC1394_COLOR_CODING_YUV422:
+                /* u y0 v y1, with the chroma of the first pixel */
+                p = line + x / 2 * 4;
+                if (x % 2 == 0) {
+                    p[0] = u;
+                    p[2] = v;
+                }
+                p[1 + 2 * (x % 2)] = Y;
+                break;
+            case DC1394_COLOR_CODING_YUV411:
+                /* u y0 y1 v y2 y3 */
+                p = line + x / 4 * 6;
+                if (x % 4 == 0) {
+                    p[0] = u;
+                    p[3] = v;
+                }
+                p[1 + x % 4 + (x % 4) / 2] = Y;
+                break;
+            case DC1394_COLOR_CODING_RAW8:
+            case DC1394_COLOR_CODING_RAW16:
+                if ((x & 1) == rx && (y & 1) == ry)
+                    c = r;
+                else if ((x & 1) != rx && (y & 1) != ry)
+                    c = b;
+                else
+                    c = g;
+                if (proto->color_coding == DC1394_COLOR_CODING_RAW8)
+                    p[0] = c;
+                else
+                    put16 (p, c, depth);
+                break;
+            default:
+                free (craw->pattern);
+                craw->pattern = NULL;
+                return DC1394_INVALID_COLOR_CODING;
+            }
+        }
+    }
+    return DC1394_SUCCESS;
+}
+
+static void
+render_frame (platform_camera_t * craw, struct sim_frame * f, uint64_t n)
+{
+    dc1394video_frame_t * frame = &f->frame;
+    uint32_t bits, y;
+    uint32_t shift = n * SIM_PATTERN_STEP % SIM_PATTERN_PERIOD;
+    const unsigned char * src;
+
+    dc1394_get_color_coding_bit_size (frame->color_coding, &bits);
+    src = craw->pattern + shift * bits / 8;
+    for (y = 0; y < frame->size[1]; y++)
+        memcpy (frame->image + (size_t) y * frame->stride,
+                src + (size_t) y * craw->pattern_stride, frame->stride);
+}
+
+static uint64_t
+now_ns (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*
+  Sends one frame into the next buffer of the ring. A frame that finds no
+  free buffer is lost, like on the bus. Called with the mutex held.
+*/
+static void
+send_frame (platform_camera_t * craw)
+{
+    struct sim_frame * f = craw->frames + craw->fill;
+    uint64_t n = craw->frame_count++;
+    int64_t lost_packet = -1;
+
+    if (f->status != BUFFER_EMPTY) {
+        dc1394_log_debug ("sim: No buffer for frame %"PRIu64, n);
+        return;
+    }
+    if (craw->p->drop > 0 && sim_random (craw) < craw->p->drop) {
+        dc1394_log_debug ("sim: Dropping frame %"PRIu64, n);
+        return;
+    }
+    if (craw->p->corrupt > 0 && sim_random (craw) < craw->p->corrupt)
+        lost_packet = sim_random (craw) * f->frame.packets_per_frame;
+
+    /* the buffer is ours until it is marked as filled */
+    pthread_mutex_unlock (&craw->mutex);
+
+    render_frame (craw, f, n);
+    if (lost_packet >= 0) {
+        uint64_t offset = lost_packet * f->frame.packet_size;
+        uint64_t len = f->frame.packet_size;
+        if (offset + len > f->frame.total_bytes)
+            len = f->frame.total_bytes - offset;
+        memset (f->frame.image + offset, 0, len);
+    }
+    f->frame.timestamp = now_ns () / 1000;
+
+    pthread_mutex_lock (&craw->mutex);
+    f->status = lost_packet >= 0 ? BUFFER_CORRUPT : BUFFER_FILLED;
+    craw->frames_ready++;
+    craw->fill = (craw->fill + 1) % craw->num_frames;
+
+    write (craw->notify_pipe[1], "+", 1);
+}
+
+static void
+timespec_from_ns (struct timespec * ts, uint64_t ns)
+{
+    ts->tv_sec = ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
+/*
+  Sends frames while the transmission is on, or for one-shot requests, at
+  the frame interval. Without an interval, it sends them as fast as the
+  buffers are given back.
+*/
+static void *
+capture_thread (void * arg)
+{
+    platform_camera_t * craw = arg;
+    uint64_t due = 0;
+    struct timespec ts;
+
+    dc1394_log_debug ("sim: Frame thread starting");
+
+    pthread_mutex_lock (&craw->mutex);
+    while (!craw->kill_thread) {
+        int iso_on = (SIM_CMD (craw, REG_CAMERA_ISO_EN) & 0x80000000UL) != 0;
+        if (!iso_on && craw->shots == 0) {
+            pthread_cond_wait (&craw->cond, &craw->mutex);
+            due = 0;
+            continue;
+        }
+
+        uint64_t interval = sim_frame_interval (craw);
+        uint64_t now = now_ns ();
+        if (interval == 0) {
+            if (craw->frames[craw->fill].status != BUFFER_EMPTY) {
+                pthread_cond_wait (&craw->cond, &craw->mutex);
+                continue;
+            }
+        }
+        else if (due == 0 || due + interval < now)
+            due = now;
+        else if (now < due) {
+            timespec_from_ns (&ts, due);
+            pthread_cond_timedwait (&craw->cond, &craw->mutex, &ts);
+            continue;
+        }
+
+        if (!iso_on)
+            sim_shot_done (craw);
+        send_frame (craw);
+        if (interval)
+            due += interval;
+    }
+    pthread_mutex_unlock (&craw->mutex);
+
+    dc1394_log_debug ("sim: Frame thread ending");
+    return NULL;
+}
+
+static void
+init_frame(platform_camera_t *craw, int index, dc1394video_frame_t *proto)
+{
+    struct sim_frame *f = craw->frames + index;
+
+    memcpy (&f->frame, proto, sizeof f->frame);
+    f->frame.image = craw->buffer + index * proto->total_bytes;
+    f->frame.id = index;
+    f->status = BUFFER_EMPTY;
+}
+
+dc1394error_t
+dc1394_sim_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
+        uint32_t flags)
+{
+    dc1394video_frame_t proto;
+    dc1394error_t err;
+    int i;
+    dc1394camera_t * camera = craw->camera;
+
+    // if capture is already set, abort
+    if (craw->capture_is_set > 0)
+        return DC1394_CAPTURE_IS_RUNNING;
+
+    if (num_dma_buffers == 0)
+        return DC1394_INVALID_ARGUMENT_VALUE;
+
+    craw->capture_is_set = 1;
+
+    if (flags & DC1394_CAPTURE_FLAGS_DEFAULT)
+        flags = DC1394_CAPTURE_FLAGS_CHANNEL_ALLOC |
+            DC1394_CAPTURE_FLAGS_BANDWIDTH_ALLOC;
+
+    craw->flags = flags;
+
+    if (capture_basic_setup(camera, &proto) != DC1394_SUCCESS) {
+        dc1394_log_error("sim: Basic capture setup failed");
+        dc1394_sim_capture_stop (craw);
+        return DC1394_FAILURE;
+    }
+
+    err = make_pattern (craw, &proto);
+    if (err != DC1394_SUCCESS) {
+        dc1394_log_error("sim: Cannot make frames of this color coding");
+        dc1394_sim_capture_stop (craw);
+        return err;
+    }
+
+    if (pipe (craw->notify_pipe) < 0) {
+        dc1394_sim_capture_stop (craw);
+        return DC1394_FAILURE;
+    }
+
+    dc1394_log_debug ("sim: Frame size is %"PRId64, proto.total_bytes);
+
+    craw->num_frames = num_dma_buffers;
+    craw->current = -1;
+    craw->fill = 0;
+    craw->frames_ready = 0;
+    craw->frame_count = 0;
+    craw->buffer_size = proto.total_bytes * num_dma_buffers;
+    craw->buffer = calloc (1, craw->buffer_size);
+    if (craw->buffer == NULL) {
+        dc1394_sim_capture_stop (craw);
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+    }
+
+    craw->frames = calloc (num_dma_buffers, sizeof *craw->frames);
+    if (craw->frames == NULL) {
+        dc1394_sim_capture_stop (craw);
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+    }
+
+    for (i = 0; i < num_dma_buffers; i++)
+        init_frame(craw, i, &proto);
+
+    if (pthread_create (&craw->thread, NULL, capture_thread, craw) != 0) {
+        dc1394_log_error ("sim: Failed to launch frame thread");
+        dc1394_sim_capture_stop (craw);
+        return DC1394_FAILURE;
+    }
+    craw->thread_created = 1;
+
+    // if auto iso is requested, start ISO
+    if (flags & DC1394_CAPTURE_FLAGS_AUTO_ISO) {
+        dc1394_video_set_transmission(camera, DC1394_ON);
+        craw->iso_auto_started = 1;
+    }
+
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_sim_capture_stop(platform_camera_t *craw)
+{
+    dc1394camera_t * camera = craw->camera;
+
+    if (craw->capture_is_set == 0)
+        return DC1394_CAPTURE_IS_NOT_SET;
+
+    dc1394_log_debug ("sim: Capture stopping");
+
+    // stop ISO if it was started automatically
+    if (craw->iso_auto_started > 0) {
+        dc1394_video_set_transmission(camera, DC1394_OFF);
+        craw->iso_auto_started = 0;
+    }
+
+    if (craw->thread_created) {
+        pthread_mutex_lock (&craw->mutex);
+        craw->kill_thread = 1;
+        pthread_cond_broadcast (&craw->cond);
+        pthread_mutex_unlock (&craw->mutex);
+        pthread_join (craw->thread, NULL);
+        dc1394_log_debug ("sim: Joined with frame thread");
+        craw->kill_thread = 0;
+        craw->thread_created = 0;
+    }
+
+    free (craw->frames);
+    craw->frames = NULL;
+    free (craw->buffer);
+    craw->buffer = NULL;
+    free (craw->pattern);
+    craw->pattern = NULL;
+
+    if (craw->notify_pipe[0] != 0 || craw->notify_pipe[1] != 0) {
+        close (craw->notify_pipe[0]);
+        close (craw->notify_pipe[1]);
+    }
+    craw->notify_pipe[0] = 0;
+    craw->notify_pipe[1] = 0;
+
+    craw->capture_is_set = 0;
+
+    return DC1394_SUCCESS;
+}
+
+#define NEXT_BUFFER(c,i) (((i) == -1) ? 0 : ((i)+1)%(c)->num_frames)
+
+/* takes the next frame of the ring, waiting for it to be filled */
+static struct sim_frame *
+take_frame (platform_camera_t * craw)
+{
+    int next = NEXT_BUFFER (craw, craw->current);
+    struct sim_frame * f = craw->frames + next;
+
+    char ch;
+    if (read (craw->notify_pipe[0], &ch, 1) != 1)
+        return NULL;
+
+    pthread_mutex_lock (&craw->mutex);
+    if (f->status != BUFFER_FILLED && f->status != BUFFER_CORRUPT) {
+        dc1394_log_error ("sim: Expected filled buffer");
+        pthread_mutex_unlock (&craw->mutex);
+        return NULL;
+    }
+    craw->frames_ready--;
+    f->frame.frames_behind = craw->frames_ready;
+    pthread_mutex_unlock (&craw->mutex);
+
+    craw->current = next;
+    return f;
+}
+
+dc1394error_t
+dc1394_sim_capture_dequeue (platform_camera_t * craw,
+        dc1394capture_policy_t policy, dc1394video_frame_t **frame_return)
+{
+    struct sim_frame * f = craw->frames + NEXT_BUFFER (craw, craw->current);
+
+    if ((policy < DC1394_CAPTURE_POLICY_MIN)
+            || (policy > DC1394_CAPTURE_POLICY_MAX))
+        return DC1394_INVALID_CAPTURE_POLICY;
+
+    /* default: return NULL in case of failures or lack of frames */
+    *frame_return = NULL;
+
+    if (policy == DC1394_CAPTURE_POLICY_POLL) {
+        int status;
+        pthread_mutex_lock (&craw->mutex);
+        status = f->status;
+        pthread_mutex_unlock (&craw->mutex);
+        if (status != BUFFER_FILLED && status != BUFFER_CORRUPT)
+            return DC1394_SUCCESS;
+    }
+
+    f = take_frame (craw);
+    if (!f)
+        return DC1394_FAILURE;
+
+    /* the frames filled after this one are ready: give it back and take the next */
+    while (policy == DC1394_CAPTURE_POLICY_LATEST && f->frame.frames_behind > 0) {
+        dc1394_sim_capture_enqueue (craw, &f->frame);
+        f = take_frame (craw);
+        if (!f)
+            return DC1394_FAILURE;
+    }
+
+    *frame_return = &f->frame;
+
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_sim_capture_dequeue_timeout (platform_camera_t * craw,
+        uint32_t timeout_us, dc1394video_frame_t **frame_return)
+{
+    struct sim_frame * f;
+    int err;
+
+    /* default: return NULL in case of failures or lack of frames */
+    *frame_return = NULL;
+
+    err = capture_wait_readable (craw->notify_pipe[0], timeout_us);
+    if (err < 0) {
+        dc1394_log_error ("sim: poll() failed");
+        return DC1394_FAILURE;
+    }
+    if (err == 0)
+        return DC1394_SUCCESS;
+
+    f = take_frame (craw);
+    if (!f)
+        return DC1394_FAILURE;
+
+    *frame_return = &f->frame;
+
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_sim_capture_enqueue (platform_camera_t * craw,
+        dc1394video_frame_t * frame)
+{
+    dc1394camera_t * camera = craw->camera;
+    struct sim_frame * f = (struct sim_frame *) frame;
+
+    if (frame->camera != camera) {
+        dc1394_log_error("sim: Camera does not match frame's camera");
+        return DC1394_INVALID_ARGUMENT_VALUE;
+    }
+
+    pthread_mutex_lock (&craw->mutex);
+    if (f->status != BUFFER_FILLED && f->status != BUFFER_CORRUPT) {
+        pthread_mutex_unlock (&craw->mutex);
+        dc1394_log_error ("sim: Frame is not enqueuable");
+        return DC1394_FAILURE;
+    }
+
+    f->status = BUFFER_EMPTY;
+    pthread_cond_broadcast (&craw->cond);
+    pthread_mutex_unlock (&craw->mutex);
+
+    return DC1394_SUCCESS;
+}
+
+int
+dc1394_sim_capture_get_fileno (platform_camera_t * craw)
+{
+    if (craw->notify_pipe[0] == 0 && craw->notify_pipe[1] == 0)
+        return -1;
+
+    return craw->notify_pipe[0];
+}
+
+dc1394bool_t
+dc1394_sim_capture_is_frame_corrupt (platform_camera_t * craw,
+        dc1394video_frame_t * frame)
+{
+    struct sim_frame * f = (struct sim_frame *) frame;
+
+    if (f->status == BUFFER_CORRUPT)
+        return DC1394_TRUE;
+
+    return DC1394_FALSE;
+}
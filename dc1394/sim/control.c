@@ -0,0 +1,700 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Simulated camera backend for dc1394
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "config.h"
+#include "platform.h"
+#include "internal.h"
+#include "sim/sim.h"
+#include "utils.h"
+#include "log.h"
+
+#define SIM_VENDOR_ID          0xDC1394
+#define SIM_MODEL_ID           0x000001
+
+/* the largest isochronous packet at S400 */
+#define SIM_MAX_PACKET         4096
+
+/* the features of the simulated cameras: inquiry and default value */
+static const struct {
+    dc1394feature_t feature;
+    uint32_t inquiry;
+    uint32_t value;
+} sim_features[] = {
+    { DC1394_FEATURE_BRIGHTNESS,    0x89000000 | (0 << 12) | 255,  0x82000000 | 128 },
+    { DC1394_FEATURE_EXPOSURE,      0x8F000000 | (0 << 12) | 1023, 0x82000000 | 512 },
+    { DC1394_FEATURE_WHITE_BALANCE, 0x9F000000 | (0 << 12) | 1023, 0x82000000 | (512 << 12) | 512 },
+    { DC1394_FEATURE_GAMMA,         0x8D000000 | (0 << 12) | 1,    0x82000000 | 1 },
+    { DC1394_FEATURE_SHUTTER,       0x8B000000 | (1 << 12) | 4095, 0x82000000 | 1000 },
+    { DC1394_FEATURE_GAIN,          0x8B000000 | (0 << 12) | 1023, 0x82000000 },
+};
+
+#define NUM_SIM_FEATURES  (sizeof sim_features / sizeof sim_features[0])
+
+/* the color codings of the Format_7 modes */
+static const dc1394color_coding_t sim_format7_codings[] = {
+    DC1394_COLOR_CODING_MONO8,
+    DC1394_COLOR_CODING_YUV411,
+    DC1394_COLOR_CODING_YUV422,
+    DC1394_COLOR_CODING_YUV444,
+    DC1394_COLOR_CODING_RGB8,
+    DC1394_COLOR_CODING_MONO16,
+    DC1394_COLOR_CODING_RGB16,
+    DC1394_COLOR_CODING_RAW8,
+    DC1394_COLOR_CODING_RAW16,
+};
+
+#define NUM_SIM_FORMAT7_CODINGS  (sizeof sim_format7_codings / sizeof sim_format7_codings[0])
+
+static int
+parse_setting (platform_t * p, const char * key, const char * value)
+{
+    char * end;
+    double d = strtod (value, &end);
+    if (end == value || *end != '\0' || d < 0)
+        return -1;
+
+    if (!strcmp (key, "cameras"))
+        p->num_cameras = d;
+    else if (!strcmp (key, "rate"))
+        p->rate = d;
+    else if (!strcmp (key, "drop"))
+        p->drop = d > 1 ? 1 : d;
+    else if (!strcmp (key, "corrupt"))
+        p->corrupt = d > 1 ? 1 : d;
+    else if (!strcmp (key, "width"))
+        p->width = d;
+    else if (!strcmp (key, "height"))
+        p->height = d;
+    else if (!strcmp (key, "depth"))
+        p->depth = d;
+    else if (!strcmp (key, "seed"))
+        p->seed = d;
+    else
+        return -1;
+    return 0;
+}
+
+static platform_t *
+dc1394_sim_new (void)
+{
+    const char * env = getenv (SIM_ENV);
+    if (!env)
+        return NULL;
+
+    platform_t * p = calloc (1, sizeof (platform_t));
+    if (!p)
+        return NULL;
+    p->num_cameras = 1;
+    p->rate = -1;
+    p->width = 1280;
+    p->height = 960;
+    p->depth = 12;
+    p->seed = 1;
+
+    char * settings = strdup (env);
+    char * save = NULL;
+    char * tok;
+    for (tok = strtok_r (settings, ",", &save); tok;
+            tok = strtok_r (NULL, ",", &save)) {
+        char * value = strchr (tok, '=');
+        if (value)
+            *value++ = '\0';
+        if (!value || parse_setting (p, tok, value) < 0)
+            dc1394_log_warning ("sim: Ignoring invalid setting %s", tok);
+    }
+    free (settings);
+
+    /* keep the binned Format_7 mode and the pattern aligned */
+    if (p->width > 0xFFF8)
+        p->width = 0xFFF8;
+    if (p->height > 0xFFF8)
+        p->height = 0xFFF8;
+    p->width = p->width < 16 ? 16 : p->width & ~7;
+    p->height = p->height < 16 ? 16 : p->height & ~3;
+    if (p->depth < 8 || p->depth > 16)
+        p->depth = 16;
+
+    dc1394_log_debug ("sim: %d camera(s) of %dx%d", p->num_cameras,
+            p->width, p->height);
+    return p;
+}
+
+static void
+dc1394_sim_free (platform_t * p)
+{
+    free (p);
+}
+
+static platform_device_list_t *
+dc1394_sim_get_device_list (platform_t * p)
+{
+    platform_device_list_t * list;
+    int i;
+
+    list = calloc (1, sizeof (platform_device_list_t));
+    if (!list)
+        return NULL;
+    if (p->num_cameras == 0)
+        return list;
+
+    list->devices = calloc (p->num_cameras, sizeof (platform_device_t *));
+    if (!list->devices) {
+        free (list);
+        return NULL;
+    }
+    for (i = 0; i < p->num_cameras; i++) {
+        platform_device_t * dev = calloc (1, sizeof (platform_device_t));
+        if (!dev)
+            break;
+        dev->p = p;
+        dev->index = i;
+        list->devices[i] = dev;
+    }
+    list->num_devices = i;
+    return list;
+}
+
+static void
+dc1394_sim_free_device_list (platform_device_list_t * d)
+{
+    int i;
+    for (i = 0; i < d->num_devices; i++)
+        free (d->devices[i]);
+    free (d->devices);
+    free (d);
+}
+
+/* appends a text leaf at quadlet n of the ROM, returns the next free quadlet */
+static int
+add_leaf (uint32_t * rom, int n, const char * text)
+{
+    int len = (strlen (text) + 4) / 4;
+    int i;
+
+    rom[n] = (len + 2) << 16;
+    rom[n + 1] = 0;
+    rom[n + 2] = 0;
+    for (i = 0; i < 4 * len; i++) {
+        uint32_t c = i < strlen (text) ? (unsigned char) text[i] : 0;
+        rom[n + 3 + i / 4] |= c << (24 - 8 * (i % 4));
+    }
+    return n + 3 + len;
+}
+
+/*
+  The configuration ROM of camera 'index', from offset 0x400: the bus info
+  block, a root directory with a single IIDC unit, its unit dependent
+  directory and the vendor and model leaves.
+*/
+static int
+build_config_rom (int index, uint32_t * rom)
+{
+    char model[32];
+    int n;
+
+    memset (rom, 0, SIM_ROM_QUADS * 4);
+
+    /* bus info block, 'max_rec' 10 and S400 */
+    rom[1] = 0x31333934;
+    rom[2] = 0x0000A002;
+    rom[3] = SIM_VENDOR_ID << 8;
+    rom[4] = index + 1;
+
+    /* root directory */
+    rom[5] = 3 << 16;
+    rom[6] = 0x03000000 | SIM_VENDOR_ID;
+    rom[7] = 0x0C0083C0;
+    rom[8] = 0xD1000001;
+
+    /* unit directory at 9 */
+    rom[9] = 4 << 16;
+    rom[10] = 0x12000000 | 0xA02D;
+    rom[11] = 0x13000000 | 0x102;
+    rom[12] = 0xD4000002;
+    rom[13] = 0x17000000 | SIM_MODEL_ID;
+
+    /* unit dependent directory at 14, IIDC 1.31 */
+    rom[14] = 4 << 16;
+    rom[15] = 0x40000000 | (SIM_CMD_BASE / 4);
+    rom[16] = 0x81000003;
+    rom[18] = 0x38000010;
+
+    n = add_leaf (rom, 19, "libdc1394");
+    rom[17] = 0x82000000 | (n - 17);
+    snprintf (model, sizeof model, "Simulated camera %d", index);
+    n = add_leaf (rom, n, model);
+
+    rom[0] = 0x04000000 | (n - 1) << 16;
+    return n;
+}
+
+static int
+dc1394_sim_device_get_config_rom (platform_device_t * device,
+                                  uint32_t * quads, int * num_quads)
+{
+    uint32_t rom[SIM_ROM_QUADS];
+    int n = build_config_rom (device->index, rom);
+
+    if (*num_quads > n)
+        *num_quads = n;
+    memcpy (quads, rom, *num_quads * 4);
+    return 0;
+}
+
+/* the largest packet at the current ISO speed */
+static uint32_t
+max_packet (platform_camera_t * craw)
+{
+    uint32_t speed = (SIM_CMD (craw, REG_CAMERA_ISO_DATA) >> 24) & 0x3;
+    if (speed > DC1394_ISO_SPEED_400)
+        speed = DC1394_ISO_SPEED_400;
+    return (SIM_MAX_PACKET >> DC1394_ISO_SPEED_400) << speed;
+}
+
+/*
+  Recomputes the inquiry registers of a Format_7 mode from its settings, as
+  a camera does when the value setting bit is written.
+*/
+static void
+format7_update (platform_camera_t * craw, int mode)
+{
+    uint32_t * f7 = craw->format7[mode];
+    uint32_t max_w = f7[REG_CAMERA_FORMAT7_MAX_IMAGE_SIZE_INQ / 4] >> 16;
+    uint32_t max_h = f7[REG_CAMERA_FORMAT7_MAX_IMAGE_SIZE_INQ / 4] & 0xFFFF;
+    uint32_t unit_w = f7[REG_CAMERA_FORMAT7_UNIT_SIZE_INQ / 4] >> 16;
+    uint32_t unit_h = f7[REG_CAMERA_FORMAT7_UNIT_SIZE_INQ / 4] & 0xFFFF;
+    uint32_t pos_w = f7[REG_CAMERA_FORMAT7_UNIT_POSITION_INQ / 4] >> 16;
+    uint32_t pos_h = f7[REG_CAMERA_FORMAT7_UNIT_POSITION_INQ / 4] & 0xFFFF;
+    uint32_t left = f7[REG_CAMERA_FORMAT7_IMAGE_POSITION / 4] >> 16;
+    uint32_t top = f7[REG_CAMERA_FORMAT7_IMAGE_POSITION / 4] & 0xFFFF;
+    uint32_t width = f7[REG_CAMERA_FORMAT7_IMAGE_SIZE / 4] >> 16;
+    uint32_t height = f7[REG_CAMERA_FORMAT7_IMAGE_SIZE / 4] & 0xFFFF;
+    uint32_t id = f7[REG_CAMERA_FORMAT7_COLOR_CODING_ID / 4] >> 24;
+    uint32_t bpp = f7[REG_CAMERA_FORMAT7_BYTE_PER_PACKET / 4] >> 16;
+    uint32_t max = max_packet (craw);
+    uint32_t bits = 0, depth = 8, ppf = 0;
+    uint64_t total = 0;
+    int err1, err2;
+
+    err1 = id > 31 || !(f7[REG_CAMERA_FORMAT7_COLOR_CODING_INQ / 4] & (0x80000000UL >> id)) ||
+        width == 0 || height == 0 || left + width > max_w || top + height > max_h ||
+        width % unit_w || height % unit_h || left % pos_w || top % pos_h;
+    if (!err1) {
+        dc1394color_coding_t coding = id + DC1394_COLOR_CODING_MIN;
+        dc1394_get_color_coding_bit_size (coding, &bits);
+        dc1394_get_color_coding_data_depth (coding, &depth);
+        if (depth > 8)
+            depth = craw->p->depth;
+        total = (uint64_t) width * height * bits / 8;
+    }
+    err2 = bpp == 0 || bpp > max || bpp % 4;
+    if (!err1 && !err2)
+        ppf = (total + bpp - 1) / bpp;
+
+    f7[REG_CAMERA_FORMAT7_PIXEL_NUMBER_INQ / 4] = width * height;
+    f7[REG_CAMERA_FORMAT7_TOTAL_BYTES_HI_INQ / 4] = total >> 32;
+    f7[REG_CAMERA_FORMAT7_TOTAL_BYTES_LO_INQ / 4] = total & 0xFFFFFFFF;
+    f7[REG_CAMERA_FORMAT7_PACKET_PARA_INQ / 4] = (4 << 16) | max;
+    f7[REG_CAMERA_FORMAT7_BYTE_PER_PACKET / 4] = (bpp << 16) | max;
+    f7[REG_CAMERA_FORMAT7_PACKET_PER_FRAME_INQ / 4] = ppf;
+    f7[REG_CAMERA_FORMAT7_DATA_DEPTH_INQ / 4] = depth << 24;
+    f7[REG_CAMERA_FORMAT7_VALUE_SETTING / 4] = 0x80000000UL |
+        (err1 ? 0x00800000UL : 0) | (err2 ? 0x00400000UL : 0);
+}
+
+/* the registers after a power up or an INITIALIZE */
+static void
+reset_registers (platform_camera_t * craw)
+{
+    uint32_t format, mode, rate, qpp, i;
+
+    memset (craw->cmd, 0, sizeof craw->cmd);
+    memset (craw->format7, 0, sizeof craw->format7);
+    craw->shots = 0;
+
+    /* Formats 0, 1, 2 and 7 */
+    SIM_CMD (craw, REG_CAMERA_V_FORMAT_INQ) = 0xE1000000;
+    for (format = 0; format < 3; format++) {
+        uint32_t first = format == 0 ? DC1394_VIDEO_MODE_FORMAT0_MIN :
+            format == 1 ? DC1394_VIDEO_MODE_FORMAT1_MIN : DC1394_VIDEO_MODE_FORMAT2_MIN;
+        uint32_t last = format == 0 ? DC1394_VIDEO_MODE_FORMAT0_MAX :
+            format == 1 ? DC1394_VIDEO_MODE_FORMAT1_MAX : DC1394_VIDEO_MODE_FORMAT2_MAX;
+
+        /* all the framerates that fit in an S400 packet */
+        for (mode = first; mode <= last; mode++) {
+            uint32_t rates = 0;
+            for (rate = DC1394_FRAMERATE_MIN; rate <= DC1394_FRAMERATE_MAX; rate++)
+                if (get_quadlets_per_packet (mode, rate, &qpp) == DC1394_SUCCESS &&
+                        qpp != (uint32_t) -1 && qpp * 4 <= SIM_MAX_PACKET)
+                    rates |= 0x80000000UL >> (rate - DC1394_FRAMERATE_MIN);
+            if (rates)
+                SIM_CMD (craw, REG_CAMERA_V_MODE_INQ_BASE + format * 4) |=
+                    0x80000000UL >> (mode - first);
+            SIM_CMD (craw, REG_CAMERA_V_RATE_INQ_BASE + format * 0x20 +
+                     (mode - first) * 4) = rates;
+        }
+    }
+    SIM_CMD (craw, REG_CAMERA_V_MODE_INQ_BASE + (DC1394_FORMAT7 - DC1394_FORMAT_MIN) * 4) =
+        ~(0xFFFFFFFFU >> SIM_FORMAT7_MODES);
+    for (mode = 0; mode < SIM_FORMAT7_MODES; mode++)
+        SIM_CMD (craw, REG_CAMERA_V_CSR_INQ_BASE + mode * 4) =
+            (SIM_FORMAT7_BASE + mode * SIM_FORMAT7_SIZE) / 4;
+
+    /* power switch, one shot and multi shot */
+    SIM_CMD (craw, REG_CAMERA_BASIC_FUNC_INQ) = 0x00009800;
+    for (i = 0; i < NUM_SIM_FEATURES; i++) {
+        uint32_t f = sim_features[i].feature - DC1394_FEATURE_MIN;
+        SIM_CMD (craw, REG_CAMERA_FEATURE_HI_INQ) |= 0x80000000UL >> f;
+        SIM_CMD (craw, REG_CAMERA_FEATURE_HI_BASE_INQ + f * 4) = sim_features[i].inquiry;
+        SIM_CMD (craw, REG_CAMERA_FEATURE_HI_BASE + f * 4) = sim_features[i].value;
+    }
+
+    /* 640x480 YUV422 at 30 fps, channel 0 at S400 */
+    SIM_CMD (craw, REG_CAMERA_FRAME_RATE) = (DC1394_FRAMERATE_30 - DC1394_FRAMERATE_MIN) << 29;
+    SIM_CMD (craw, REG_CAMERA_VIDEO_MODE) = (DC1394_VIDEO_MODE_640x480_YUV422 -
+                                             DC1394_VIDEO_MODE_FORMAT0_MIN) << 29;
+    SIM_CMD (craw, REG_CAMERA_VIDEO_FORMAT) = (DC1394_FORMAT0 - DC1394_FORMAT_MIN) << 29;
+    SIM_CMD (craw, REG_CAMERA_ISO_DATA) = DC1394_ISO_SPEED_400 << 24;
+    SIM_CMD (craw, REG_CAMERA_POWER) = 0x80000000UL;
+
+    /* mode 0 is the full sensor in RAW8, mode 1 a 2x2 binned MONO8 */
+    for (mode = 0; mode < SIM_FORMAT7_MODES; mode++) {
+        uint32_t * f7 = craw->format7[mode];
+        uint32_t width = craw->p->width >> mode;
+        uint32_t height = craw->p->height >> mode;
+        dc1394color_coding_t coding = mode ? DC1394_COLOR_CODING_MONO8 : DC1394_COLOR_CODING_RAW8;
+
+        f7[REG_CAMERA_FORMAT7_MAX_IMAGE_SIZE_INQ / 4] = (width << 16) | height;
+        f7[REG_CAMERA_FORMAT7_UNIT_SIZE_INQ / 4] = (4 << 16) | 2;
+        f7[REG_CAMERA_FORMAT7_UNIT_POSITION_INQ / 4] = (2 << 16) | 2;
+        f7[REG_CAMERA_FORMAT7_IMAGE_SIZE / 4] = (width << 16) | height;
+        f7[REG_CAMERA_FORMAT7_COLOR_CODING_ID / 4] = (coding - DC1394_COLOR_CODING_MIN) << 24;
+        for (i = 0; i < NUM_SIM_FORMAT7_CODINGS; i++)
+            f7[REG_CAMERA_FORMAT7_COLOR_CODING_INQ / 4] |=
+                0x80000000UL >> (sim_format7_codings[i] - DC1394_COLOR_CODING_MIN);
+        f7[REG_CAMERA_FORMAT7_BYTE_PER_PACKET / 4] = max_packet (craw) << 16;
+        f7[REG_CAMERA_FORMAT7_COLOR_FILTER_ID / 4] =
+            (DC1394_COLOR_FILTER_RGGB - DC1394_COLOR_FILTER_MIN) << 24;
+        format7_update (craw, mode);
+    }
+}
+
+uint64_t
+sim_frame_interval (platform_camera_t * craw)
+{
+    float fps;
+
+    if (craw->p->rate > 0)
+        return 1e9 / craw->p->rate;
+    if (craw->p->rate == 0)
+        return 0;
+
+    /* Format_7 sends one packet per bus cycle */
+    if ((SIM_CMD (craw, REG_CAMERA_VIDEO_FORMAT) >> 29) + DC1394_FORMAT_MIN == DC1394_FORMAT7) {
+        uint32_t mode = SIM_CMD (craw, REG_CAMERA_VIDEO_MODE) >> 29;
+        if (mode >= SIM_FORMAT7_MODES)
+            return 0;
+        return (uint64_t) craw->format7[mode][REG_CAMERA_FORMAT7_PACKET_PER_FRAME_INQ / 4] * 125000;
+    }
+
+    if (dc1394_framerate_as_float ((SIM_CMD (craw, REG_CAMERA_FRAME_RATE) >> 29) +
+                                   DC1394_FRAMERATE_MIN, &fps) != DC1394_SUCCESS)
+        return 0;
+    return 1e9 / fps;
+}
+
+void
+sim_shot_done (platform_camera_t * craw)
+{
+    if (craw->shots > 0 && --craw->shots == 0)
+        SIM_CMD (craw, REG_CAMERA_ONE_SHOT) = 0;
+}
+
+static void
+write_command (platform_camera_t * craw, uint32_t offset, uint32_t value)
+{
+    uint32_t i;
+
+    switch (offset) {
+    case REG_CAMERA_INITIALIZE:
+        if (value & 0x80000000UL) {
+            reset_registers (craw);
+            pthread_cond_broadcast (&craw->cond);
+        }
+        break;
+    case REG_CAMERA_FRAME_RATE:
+    case REG_CAMERA_VIDEO_MODE:
+    case REG_CAMERA_VIDEO_FORMAT:
+    case REG_CAMERA_POWER:
+        SIM_CMD (craw, offset) = value & 0xE0000000UL;
+        break;
+    case REG_CAMERA_ISO_DATA:
+        SIM_CMD (craw, offset) = value;
+        for (i = 0; i < SIM_FORMAT7_MODES; i++)
+            format7_update (craw, i);
+        break;
+    case REG_CAMERA_ISO_EN:
+        SIM_CMD (craw, offset) = value & 0x80000000UL;
+        pthread_cond_broadcast (&craw->cond);
+        break;
+    case REG_CAMERA_ONE_SHOT:
+        /* ignored while the camera is sending frames */
+        if (SIM_CMD (craw, REG_CAMERA_ISO_EN) & 0x80000000UL)
+            break;
+        if (value & 0x80000000UL)
+            craw->shots = 1;
+        else if (value & 0x40000000UL)
+            craw->shots = value & 0xFFFF;
+        else
+            craw->shots = 0;
+        SIM_CMD (craw, offset) = craw->shots ? value & 0xC000FFFFUL : 0;
+        pthread_cond_broadcast (&craw->cond);
+        break;
+    default:
+        /* the feature values, for the features that are present. The one
+           push bit clears at once. */
+        if (offset >= REG_CAMERA_FEATURE_HI_BASE && offset < REG_CAMERA_FEATURE_LO_BASE + 0x80 &&
+                (SIM_CMD (craw, offset - REG_CAMERA_FEATURE_HI_BASE + REG_CAMERA_FEATURE_HI_BASE_INQ) &
+                 0x80000000UL))
+            SIM_CMD (craw, offset) = 0x80000000UL | (value & 0x03FFFFFFUL);
+        /* the other registers are read-only */
+        break;
+    }
+}
+
+static void
+write_format7 (platform_camera_t * craw, int mode, uint32_t offset, uint32_t value)
+{
+    uint32_t * f7 = craw->format7[mode];
+
+    switch (offset) {
+    case REG_CAMERA_FORMAT7_IMAGE_POSITION:
+    case REG_CAMERA_FORMAT7_IMAGE_SIZE:
+        f7[offset / 4] = value;
+        break;
+    case REG_CAMERA_FORMAT7_COLOR_CODING_ID:
+        f7[offset / 4] = value & 0xFF000000UL;
+        break;
+    case REG_CAMERA_FORMAT7_BYTE_PER_PACKET:
+        f7[offset / 4] = value & 0xFFFF0000UL;
+        break;
+    case REG_CAMERA_FORMAT7_VALUE_SETTING:
+        /* the settings apply at once, so setting_1 never stays up */
+        break;
+    default:
+        return;
+    }
+    format7_update (craw, mode);
+}
+
+static platform_camera_t *
+dc1394_sim_camera_new (platform_t * p, platform_device_t * device,
+                       uint32_t unit_directory_offset)
+{
+    platform_camera_t * craw;
+    pthread_condattr_t attr;
+
+    craw = calloc (1, sizeof (platform_camera_t));
+    if (!craw)
+        return NULL;
+    craw->p = p;
+    craw->index = device->index;
+    craw->random = p->seed * 2654435761U + device->index + 1;
+    if (craw->random == 0)
+        craw->random = 1;
+    build_config_rom (device->index, craw->rom);
+    reset_registers (craw);
+
+    pthread_mutex_init (&craw->mutex, NULL);
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_cond_init (&craw->cond, &attr);
+    pthread_condattr_destroy (&attr);
+    return craw;
+}
+
+static void
+dc1394_sim_camera_free (platform_camera_t * craw)
+{
+    if (craw->capture_is_set)
+        dc1394_sim_capture_stop (craw);
+    pthread_cond_destroy (&craw->cond);
+    pthread_mutex_destroy (&craw->mutex);
+    free (craw);
+}
+
+static void
+dc1394_sim_camera_set_parent (platform_camera_t * craw, dc1394camera_t * parent)
+{
+    craw->camera = parent;
+}
+
+static dc1394error_t
+dc1394_sim_camera_print_info (platform_camera_t * craw, FILE *fd)
+{
+    fprintf(fd,"------ Camera platform-specific information ------\n");
+    fprintf(fd,"Simulated camera                  :     %d of %d\n",
+            craw->index, craw->p->num_cameras);
+    if (craw->p->rate < 0)
+        fprintf(fd,"Frame rate                        :     from the video mode\n");
+    else
+        fprintf(fd,"Frame rate                        :     %g fps\n",
+                craw->p->rate);
+    fprintf(fd,"Lost frames                       :     %g\n", craw->p->drop);
+    fprintf(fd,"Corrupt frames                    :     %g\n", craw->p->corrupt);
+    return DC1394_SUCCESS;
+}
+
+/* decodes an address into the register it designates, or NULL */
+static uint32_t *
+get_register (platform_camera_t * craw, uint64_t offset, int * mode)
+{
+    *mode = -1;
+    if (offset % 4)
+        return NULL;
+    if (offset >= ROM_BUS_INFO_BLOCK && offset < ROM_BUS_INFO_BLOCK + SIM_ROM_QUADS * 4)
+        return craw->rom + (offset - ROM_BUS_INFO_BLOCK) / 4;
+    if (offset >= SIM_CMD_BASE && offset < SIM_CMD_BASE + SIM_CMD_QUADS * 4)
+        return craw->cmd + (offset - SIM_CMD_BASE) / 4;
+    if (offset >= SIM_FORMAT7_BASE && offset < SIM_FORMAT7_BASE + SIM_FORMAT7_MODES * SIM_FORMAT7_SIZE) {
+        *mode = (offset - SIM_FORMAT7_BASE) / SIM_FORMAT7_SIZE;
+        return craw->format7[*mode] + (offset - SIM_FORMAT7_BASE) % SIM_FORMAT7_SIZE / 4;
+    }
+    return NULL;
+}
+
+static dc1394error_t
+dc1394_sim_camera_read (platform_camera_t * craw, uint64_t offset,
+                        uint32_t * quads, int num_quads)
+{
+    int i, mode;
+
+    pthread_mutex_lock (&craw->mutex);
+    for (i = 0; i < num_quads; i++) {
+        uint32_t * reg = get_register (craw, offset + 4 * i, &mode);
+        if (!reg) {
+            pthread_mutex_unlock (&craw->mutex);
+            return DC1394_FAILURE;
+        }
+        quads[i] = *reg;
+    }
+    pthread_mutex_unlock (&craw->mutex);
+    return DC1394_SUCCESS;
+}
+
+static dc1394error_t
+dc1394_sim_camera_write (platform_camera_t * craw, uint64_t offset,
+                         const uint32_t * quads, int num_quads)
+{
+    int i, mode;
+
+    pthread_mutex_lock (&craw->mutex);
+    for (i = 0; i < num_quads; i++) {
+        uint64_t address = offset + 4 * i;
+        uint32_t * reg = get_register (craw, address, &mode);
+        if (!reg) {
+            pthread_mutex_unlock (&craw->mutex);
+            return DC1394_FAILURE;
+        }
+        if (mode >= 0)
+            write_format7 (craw, mode, (address - SIM_FORMAT7_BASE) % SIM_FORMAT7_SIZE, quads[i]);
+        else if (address >= SIM_CMD_BASE)
+            write_command (craw, address - SIM_CMD_BASE, quads[i]);
+    }
+    pthread_mutex_unlock (&craw->mutex);
+    return DC1394_SUCCESS;
+}
+
+/* a cycle timer that runs on CLOCK_MONOTONIC, the clock of the frame timestamps */
+static dc1394error_t
+dc1394_sim_read_cycle_timer (platform_camera_t * craw,
+        uint32_t * cycle_timer, uint64_t * local_time)
+{
+    struct timespec now;
+    uint64_t ticks;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    *local_time = (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+    /* 24.576 MHz ticks, 3072 per cycle and 8000 cycles per second */
+    ticks = (uint64_t) now.tv_sec * 24576000 + (uint64_t) now.tv_nsec * 3072 / 125000;
+    *cycle_timer = ((ticks / 3072 / 8000) & 0x7F) << 25 |
+        ((ticks / 3072) % 8000) << 12 | ticks % 3072;
+    return DC1394_SUCCESS;
+}
+
+static dc1394error_t
+dc1394_sim_camera_get_node (platform_camera_t * craw, uint32_t * node,
+        uint32_t * generation)
+{
+    if (node)
+        *node = craw->index;
+    if (generation)
+        *generation = 0;
+    return DC1394_SUCCESS;
+}
+
+static dc1394error_t
+dc1394_sim_reset_bus (platform_camera_t * craw)
+{
+    return DC1394_SUCCESS;
+}
+
+static platform_dispatch_t
+sim_dispatch = {
+    .platform_new = dc1394_sim_new,
+    .platform_free = dc1394_sim_free,
+
+    .get_device_list = dc1394_sim_get_device_list,
+    .free_device_list = dc1394_sim_free_device_list,
+    .device_get_config_rom = dc1394_sim_device_get_config_rom,
+
+    .camera_new = dc1394_sim_camera_new,
+    .camera_free = dc1394_sim_camera_free,
+    .camera_set_parent = dc1394_sim_camera_set_parent,
+
+    .camera_print_info = dc1394_sim_camera_print_info,
+    .camera_get_node = dc1394_sim_camera_get_node,
+    .read_cycle_timer = dc1394_sim_read_cycle_timer,
+    .reset_bus = dc1394_sim_reset_bus,
+
+    .camera_read = dc1394_sim_camera_read,
+    .camera_write = dc1394_sim_camera_write,
+
+    .capture_setup = dc1394_sim_capture_setup,
+    .capture_stop = dc1394_sim_capture_stop,
+    .capture_dequeue = dc1394_sim_capture_dequeue,
+    .capture_dequeue_timeout = dc1394_sim_capture_dequeue_timeout,
+    .capture_enqueue = dc1394_sim_capture_enqueue,
+    .capture_get_fileno = dc1394_sim_capture_get_fileno,
+    .capture_is_frame_corrupt = dc1394_sim_capture_is_frame_corrupt,
+};
+
+void
+sim_init(dc1394_t * d)
+{
+    register_platform (d, &sim_dispatch, "sim");
+}
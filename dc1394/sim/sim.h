@@ -0,0 +1,158 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Simulated camera backend for dc1394
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __DC1394_SIM_H__
+#define __DC1394_SIM_H__
+
+#include <pthread.h>
+#include "config.h"
+#include "internal.h"
+#include "register.h"
+#include "offsets.h"
+
+/*
+  The simulated cameras only exist when the DC1394_SIM environment variable
+  is set. It holds comma separated settings, all of them optional:
+
+    cameras=N     the number of cameras (1)
+    rate=F        frames per second; 0 generates frames as fast as they are
+                  consumed. By default, the rate of the current video mode.
+    drop=P        the probability that a frame is lost (0)
+    corrupt=P     the probability that a packet of a frame is lost (0)
+    width=W       the size of the sensor, i.e. of Format_7 mode 0 (1280)
+    height=H      (960)
+    depth=D       the data depth of the 16-bit color codings (12)
+    seed=S        the seed of the drops and corruptions (1)
+*/
+#define SIM_ENV                "DC1394_SIM"
+
+/* the address map of a simulated camera, from CONFIG_ROM_BASE */
+#define SIM_ROM_QUADS          256
+#define SIM_CMD_BASE           0xF00000U
+#define SIM_CMD_QUADS          0x400
+#define SIM_FORMAT7_BASE       0xF10000U
+#define SIM_FORMAT7_SIZE       0x100U
+#define SIM_FORMAT7_MODES      2
+
+/* the frames move this many pixels to the left in each frame ... */
+#define SIM_PATTERN_STEP       4
+/* ... and repeat after this many pixels */
+#define SIM_PATTERN_PERIOD     256
+
+struct _platform_t {
+    int num_cameras;
+    double rate;                /* < 0: the rate of the video mode */
+    double drop;
+    double corrupt;
+    uint32_t width, height;
+    uint32_t depth;
+    uint32_t seed;
+};
+
+struct _platform_device_t {
+    platform_t * p;
+    int index;
+};
+
+typedef enum {
+    BUFFER_EMPTY,
+    BUFFER_FILLED,
+    BUFFER_CORRUPT,
+} sim_frame_status;
+
+struct sim_frame {
+    dc1394video_frame_t frame;
+    sim_frame_status status;
+};
+
+struct _platform_camera_t {
+    platform_t * p;
+    int index;
+    dc1394camera_t * camera;
+
+    /* the register space; the mutex also protects the ring buffer */
+    uint32_t rom[SIM_ROM_QUADS];
+    uint32_t cmd[SIM_CMD_QUADS];
+    uint32_t format7[SIM_FORMAT7_MODES][SIM_FORMAT7_SIZE/4];
+    uint32_t shots;             /* frames left to send for ONE_SHOT */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* signalled when the frames start or stop */
+
+    struct sim_frame * frames;
+    unsigned char * buffer;
+    size_t buffer_size;
+    unsigned char * pattern;    /* the test pattern, SIM_PATTERN_PERIOD pixels wider than a frame */
+    uint32_t pattern_stride;
+    uint32_t flags;
+    unsigned int num_frames;
+    int current;
+    int fill;                   /* the next buffer to fill */
+    int frames_ready;
+    uint64_t frame_count;       /* the frames sent so far, including the lost ones */
+    uint32_t random;            /* the state of the drop and corruption generator */
+
+    int notify_pipe[2];
+    pthread_t thread;
+    int thread_created;
+    int kill_thread;
+
+    int capture_is_set;
+    int iso_auto_started;
+};
+
+#define SIM_CMD(craw, offset)  ((craw)->cmd[(offset) / 4])
+
+/* the time between two frames in ns, 0 if frames are sent as fast as
+   possible. Called with the mutex held. */
+uint64_t
+sim_frame_interval (platform_camera_t * craw);
+
+/* counts one frame of a ONE_SHOT or multi-shot request. Called with the
+   mutex held. */
+void
+sim_shot_done (platform_camera_t * craw);
+
+dc1394error_t
+dc1394_sim_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
+        uint32_t flags);
+
+dc1394error_t
+dc1394_sim_capture_stop(platform_camera_t *craw);
+
+dc1394error_t
+dc1394_sim_capture_dequeue (platform_camera_t * craw,
+        dc1394capture_policy_t policy, dc1394video_frame_t **frame_return);
+
+dc1394error_t
+dc1394_sim_capture_dequeue_timeout (platform_camera_t * craw,
+        uint32_t timeout_us, dc1394video_frame_t **frame_return);
+
+dc1394error_t
+dc1394_sim_capture_enqueue (platform_camera_t * craw,
+        dc1394video_frame_t * frame);
+
+int
+dc1394_sim_capture_get_fileno (platform_camera_t * craw);
+
+dc1394bool_t
+dc1394_sim_capture_is_frame_corrupt (platform_camera_t * craw,
+        dc1394video_frame_t * frame);
+
+#endif
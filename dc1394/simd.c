@@ -0,0 +1,61 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Run-time selection of the SIMD kernels
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdlib.h>
+#include "simd.h"
+#include "log.h"
+
+static const simd_dispatch_t simd_none = { "none", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+
+static const simd_dispatch_t * simd_selected = NULL;
+
+static const simd_dispatch_t *
+simd_probe (void)
+{
+    /* setting DC1394_NO_SIMD in the environment forces the scalar code */
+    if (getenv ("DC1394_NO_SIMD") != NULL)
+        return &simd_none;
+
+#ifdef DC1394_SIMD_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        return &simd_avx2;
+    return &simd_sse2;
+#elif defined(DC1394_SIMD_NEON)
+    return &simd_neon;
+#else
+    return &simd_none;
+#endif
+}
+
+const simd_dispatch_t *
+simd_get_dispatch (void)
+{
+    /* the probe always yields the same table, so a racing first call from
+       another thread only stores the same pointer twice */
+    const simd_dispatch_t * s = simd_selected;
+
+    if (s == NULL) {
+        s = simd_probe ();
+        dc1394_log_debug ("Using %s kernels for color conversions", s->name);
+        simd_selected = s;
+    }
+    return s;
+}
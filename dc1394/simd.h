@@ -0,0 +1,103 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * SIMD kernels for the color conversion functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __DC1394_SIMD_H__
+#define __DC1394_SIMD_H__
+
+#include <stdint.h>
+
+/*
+  The x86 kernels rely on the target attribute so that SSE2 and AVX2 code can
+  live in the same translation unit and be selected at run time. SSE2 is part
+  of the x86-64 baseline, AVX2 is probed with CPUID.
+*/
+#if defined(__x86_64__) && (defined(__clang__) || \
+    (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define DC1394_SIMD_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DC1394_SIMD_NEON
+#endif
+
+/*
+  Row kernels for the Bayer decoders. They process the interior of one row by
+  pairs of pixels, exactly like the scalar inner loops of bayer.c, and return
+  the number of pairs they handled. The caller finishes the remaining pairs
+  with the scalar code. 'bayer' points to the top-left sample of the
+  neighbourhood, 'rgb' to the first output pixel and 'blue' is the +1/-1
+  channel swap of the scalar code.
+*/
+typedef int (*bayer_row_8bit_t)(const uint8_t *bayer, uint8_t *rgb,
+                                 int bayer_step, int pairs, int blue);
+typedef int (*bayer_row_16bit_t)(const uint16_t *bayer, uint16_t *rgb,
+                                  int bayer_step, int pairs, int blue, int bits);
+
+/*
+  YUV to RGB8 kernels. They convert the first pixels of a buffer with the
+  fixed-point YUV2RGB macro of conversions.h and return how many they did
+  (always a multiple of 4); the caller converts the rest. 'uyvy' selects the
+  byte order of YUV422, the other formats have a single one.
+*/
+typedef int (*yuv_rgb8_t)(const uint8_t *src, uint8_t *rgb, int pixels, int uyvy);
+
+/*
+  YUV422 to planar kernel: splits the first pixels of a line into the Y, U
+  and V planes and returns how many it did (a multiple of 16).
+*/
+typedef int (*yuv422_planar_t)(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, int pixels, int uyvy);
+
+typedef struct {
+    const char * name;
+    bayer_row_8bit_t   bilinear;
+    bayer_row_16bit_t  bilinear_uint16;
+    bayer_row_8bit_t   hqlinear;
+    bayer_row_16bit_t  hqlinear_uint16;
+    yuv_rgb8_t         yuv422_rgb8;
+    yuv_rgb8_t         yuv411_rgb8;
+    yuv_rgb8_t         yuv444_rgb8;
+    yuv422_planar_t    yuv422_planar;
+} simd_dispatch_t;
+
+/* Returns the kernels for the running CPU. Never NULL, members may be. */
+const simd_dispatch_t * simd_get_dispatch (void);
+
+#ifdef DC1394_SIMD_X86
+extern const simd_dispatch_t simd_sse2;
+extern const simd_dispatch_t simd_avx2;
+
+/* conversions_simd.c */
+int yuv422_rgb8_sse2 (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy);
+int yuv422_rgb8_avx2 (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy);
+int yuv411_rgb8_ssse3 (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy);
+int yuv444_rgb8_ssse3 (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy);
+int yuv422_planar_sse2 (const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, int pixels, int uyvy);
+#endif
+#ifdef DC1394_SIMD_NEON
+extern const simd_dispatch_t simd_neon;
+
+/* conversions_simd.c */
+int yuv422_rgb8_neon (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy);
+int yuv411_rgb8_neon (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy);
+int yuv444_rgb8_neon (const uint8_t *src, uint8_t *rgb, int pixels, int uyvy);
+int yuv422_planar_neon (const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, int pixels, int uyvy);
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * Helpers that store the results of the SIMD kernels as RGB pixels
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __DC1394_SIMD_STORE_H__
+#define __DC1394_SIMD_STORE_H__
+
+#include <stdint.h>
+#include <string.h>
+#include "simd.h"
+
+#ifdef DC1394_SIMD_X86
+#include <immintrin.h>
+
+/* store four 0x00BBGGRR pixels as 12 bytes */
+static inline void
+store_rgb8_x4 (uint8_t *dst, __m128i p)
+{
+    uint32_t last;
+    __m128i x = _mm_or_si128 (
+        _mm_and_si128 (p, _mm_set_epi32 (0, 0x00ffffff, 0, 0x00ffffff)),
+        _mm_and_si128 (_mm_srli_epi64 (p, 8),
+                       _mm_set_epi32 (0x0000ffff, 0xff000000, 0x0000ffff, 0xff000000)));
+    x = _mm_or_si128 (
+        _mm_and_si128 (x, _mm_set_epi32 (0, 0, 0x0000ffff, 0xffffffff)),
+        _mm_and_si128 (_mm_srli_si128 (x, 2),
+                       _mm_set_epi32 (0, 0xffffffff, 0xffff0000, 0)));
+    _mm_storel_epi64 ((__m128i *) dst, x);
+    last = _mm_cvtsi128_si32 (_mm_srli_si128 (x, 8));
+    memcpy (dst + 8, &last, 4);
+}
+
+/*
+  Interleave eight pairs of 8-bit pixels held in 16-bit lanes (values must
+  already be in 0..255) and store them as 16 RGB pixels.
+*/
+static inline void
+emit_rgb8 (uint8_t *rgb, __m128i c0, __m128i c1, __m128i c2,
+           __m128i d0, __m128i d1, __m128i d2, int blue)
+{
+    __m128i r_lo, r_hi, g_lo, g_hi, b_lo, b_hi;
+
+    if (blue < 0) {
+        __m128i t;
+        t = c0; c0 = c2; c2 = t;
+        t = d0; d0 = d2; d2 = t;
+    }
+    r_lo = _mm_unpacklo_epi16 (c0, d0);
+    r_hi = _mm_unpackhi_epi16 (c0, d0);
+    g_lo = _mm_unpacklo_epi16 (c1, d1);
+    g_hi = _mm_unpackhi_epi16 (c1, d1);
+    b_lo = _mm_unpacklo_epi16 (c2, d2);
+    b_hi = _mm_unpackhi_epi16 (c2, d2);
+
+    r_lo = _mm_or_si128 (r_lo, _mm_slli_epi16 (g_lo, 8));
+    r_hi = _mm_or_si128 (r_hi, _mm_slli_epi16 (g_hi, 8));
+
+    store_rgb8_x4 (rgb,      _mm_unpacklo_epi16 (r_lo, b_lo));
+    store_rgb8_x4 (rgb + 12, _mm_unpackhi_epi16 (r_lo, b_lo));
+    store_rgb8_x4 (rgb + 24, _mm_unpacklo_epi16 (r_hi, b_hi));
+    store_rgb8_x4 (rgb + 36, _mm_unpackhi_epi16 (r_hi, b_hi));
+}
+
+#endif /* DC1394_SIMD_X86 */
+
+#ifdef DC1394_SIMD_NEON
+#include <arm_neon.h>
+
+/* same as emit_rgb8() with eight pairs of 8-bit pixels */
+static inline void
+emit_rgb8_neon (uint8_t *rgb, uint8x8_t c0, uint8x8_t c1, uint8x8_t c2,
+                uint8x8_t d0, uint8x8_t d1, uint8x8_t d2, int blue)
+{
+    uint8x16x3_t px;
+    uint8x8x2_t z;
+
+    if (blue < 0) {
+        uint8x8_t t;
+        t = c0; c0 = c2; c2 = t;
+        t = d0; d0 = d2; d2 = t;
+    }
+    z = vzip_u8 (c0, d0);
+    px.val[0] = vcombine_u8 (z.val[0], z.val[1]);
+    z = vzip_u8 (c1, d1);
+    px.val[1] = vcombine_u8 (z.val[0], z.val[1]);
+    z = vzip_u8 (c2, d2);
+    px.val[2] = vcombine_u8 (z.val[0], z.val[1]);
+    vst3q_u8 (rgb, px);
+}
+
+#endif /* DC1394_SIMD_NEON */
+
+#endif
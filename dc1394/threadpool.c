@@ -0,0 +1,287 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * A small pool of worker threads for the image processing functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdlib.h>
+#include "config.h"
+#include "threadpool.h"
+#include "log.h"
+
+typedef struct {
+    void * data;
+    size_t size;
+} scratch_t;
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+
+typedef struct _threadpool_job_t {
+    threadpool_task_t task;
+    void * arg;
+    int count;
+    int next;                        /* next index to hand out */
+    int done;                        /* indices completed */
+    pthread_cond_t finished;
+    struct _threadpool_job_t * next_job;
+} threadpool_job_t;
+
+struct _threadpool_t {
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    pthread_t * threads;
+    int num_workers;
+    int quit;
+    threadpool_job_t * jobs;         /* jobs that still have indices to hand out */
+};
+
+static void
+job_unlink (threadpool_t * pool, threadpool_job_t * job)
+{
+    threadpool_job_t ** p;
+
+    for (p = &pool->jobs; *p; p = &(*p)->next_job) {
+        if (*p == job) {
+            *p = job->next_job;
+            return;
+        }
+    }
+}
+
+/* must be called with the pool mutex held; the mutex is released while the
+   item runs */
+static void
+job_run_one (threadpool_t * pool, threadpool_job_t * job)
+{
+    int index = job->next++;
+
+    if (job->next == job->count)
+        job_unlink (pool, job);
+
+    pthread_mutex_unlock (&pool->mutex);
+    job->task (job->arg, index);
+    pthread_mutex_lock (&pool->mutex);
+
+    if (++job->done == job->count)
+        pthread_cond_signal (&job->finished);
+}
+
+static void *
+threadpool_worker (void * arg)
+{
+    threadpool_t * pool = arg;
+
+    pthread_mutex_lock (&pool->mutex);
+    for (;;) {
+        while (!pool->quit && !pool->jobs)
+            pthread_cond_wait (&pool->wakeup, &pool->mutex);
+        if (pool->quit)
+            break;
+        job_run_one (pool, pool->jobs);
+    }
+    pthread_mutex_unlock (&pool->mutex);
+    return NULL;
+}
+
+threadpool_t *
+threadpool_new (int num_threads)
+{
+    threadpool_t * pool;
+    int i;
+
+    if (num_threads < 1)
+        return NULL;
+
+    pool = calloc (1, sizeof (threadpool_t));
+    if (!pool)
+        return NULL;
+    pool->threads = calloc (num_threads, sizeof (pthread_t));
+    if (!pool->threads) {
+        free (pool);
+        return NULL;
+    }
+    pthread_mutex_init (&pool->mutex, NULL);
+    pthread_cond_init (&pool->wakeup, NULL);
+
+    for (i = 0; i < num_threads - 1; i++) {
+        if (pthread_create (&pool->threads[i], NULL, threadpool_worker, pool) != 0) {
+            dc1394_log_error ("Failed to create worker thread %d", i);
+            threadpool_free (pool);
+            return NULL;
+        }
+        pool->num_workers++;
+    }
+    return pool;
+}
+
+void
+threadpool_free (threadpool_t * pool)
+{
+    int i;
+
+    if (!pool)
+        return;
+
+    pthread_mutex_lock (&pool->mutex);
+    pool->quit = 1;
+    pthread_cond_broadcast (&pool->wakeup);
+    pthread_mutex_unlock (&pool->mutex);
+
+    for (i = 0; i < pool->num_workers; i++)
+        pthread_join (pool->threads[i], NULL);
+
+    pthread_cond_destroy (&pool->wakeup);
+    pthread_mutex_destroy (&pool->mutex);
+    free (pool->threads);
+    free (pool);
+}
+
+int
+threadpool_get_num_threads (threadpool_t * pool)
+{
+    return pool ? pool->num_workers + 1 : 1;
+}
+
+void
+threadpool_run (threadpool_t * pool, threadpool_task_t task, void * arg,
+        int count)
+{
+    threadpool_job_t job;
+    threadpool_job_t ** p;
+    int i;
+
+    if (!pool || pool->num_workers == 0 || count <= 1) {
+        for (i = 0; i < count; i++)
+            task (arg, i);
+        return;
+    }
+
+    job.task = task;
+    job.arg = arg;
+    job.count = count;
+    job.next = 0;
+    job.done = 0;
+    job.next_job = NULL;
+    pthread_cond_init (&job.finished, NULL);
+
+    pthread_mutex_lock (&pool->mutex);
+    for (p = &pool->jobs; *p; p = &(*p)->next_job);
+    *p = &job;
+    pthread_cond_broadcast (&pool->wakeup);
+
+    while (job.next < job.count)
+        job_run_one (pool, &job);
+    while (job.done < job.count)
+        pthread_cond_wait (&job.finished, &pool->mutex);
+    pthread_mutex_unlock (&pool->mutex);
+
+    pthread_cond_destroy (&job.finished);
+}
+
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+
+static void
+scratch_destroy (void * arg)
+{
+    scratch_t * s = arg;
+    int i;
+
+    for (i = 0; i < THREADPOOL_SCRATCH_NUM; i++)
+        free (s[i].data);
+    free (s);
+}
+
+static void
+scratch_init (void)
+{
+    pthread_key_create (&scratch_key, scratch_destroy);
+}
+
+static scratch_t *
+scratch_get (void)
+{
+    scratch_t * s;
+
+    pthread_once (&scratch_once, scratch_init);
+    s = pthread_getspecific (scratch_key);
+    if (!s) {
+        s = calloc (THREADPOOL_SCRATCH_NUM, sizeof (scratch_t));
+        if (s)
+            pthread_setspecific (scratch_key, s);
+    }
+    return s;
+}
+
+#else /* HAVE_PTHREAD */
+
+threadpool_t *
+threadpool_new (int num_threads)
+{
+    return NULL;
+}
+
+void
+threadpool_free (threadpool_t * pool)
+{
+}
+
+int
+threadpool_get_num_threads (threadpool_t * pool)
+{
+    return 1;
+}
+
+void
+threadpool_run (threadpool_t * pool, threadpool_task_t task, void * arg,
+        int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+        task (arg, i);
+}
+
+static scratch_t *
+scratch_get (void)
+{
+    static scratch_t s[THREADPOOL_SCRATCH_NUM];
+
+    return s;
+}
+
+#endif /* HAVE_PTHREAD */
+
+void *
+threadpool_get_scratch (int slot, size_t size)
+{
+    scratch_t * s = scratch_get ();
+    void * data;
+
+    if (!s)
+        return NULL;
+    s += slot;
+    if (s->size < size) {
+        data = realloc (s->data, size);
+        if (!data)
+            return NULL;
+        s->data = data;
+        s->size = size;
+    }
+    return s->data;
+}
@@ -0,0 +1,70 @@
+/*
+ * 1394-Based Digital Camera Control Library
+ *
+ * A small pool of worker threads for the image processing functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __DC1394_THREADPOOL_H__
+#define __DC1394_THREADPOOL_H__
+
+#include <stddef.h>
+
+typedef struct _threadpool_t threadpool_t;
+
+/* one item of a parallel job: called once for each index in [0, count) */
+typedef void (*threadpool_task_t) (void * arg, int index);
+
+/*
+  Creates a pool that runs jobs on 'num_threads' threads: num_threads-1
+  workers plus the thread calling threadpool_run(). Returns NULL if the
+  threads could not be created or if the library was built without pthreads.
+*/
+threadpool_t * threadpool_new (int num_threads);
+
+/* Stops and joins the workers. No job may be running. */
+void threadpool_free (threadpool_t * pool);
+
+/* Number of threads, including the caller of threadpool_run(). */
+int threadpool_get_num_threads (threadpool_t * pool);
+
+/*
+  Runs task(arg, i) for every i in [0, count) and returns once all of them
+  are done. The calling thread takes part in the work. Several threads may
+  submit jobs to the same pool at once. A NULL pool runs the items in order
+  on the calling thread.
+*/
+void threadpool_run (threadpool_t * pool, threadpool_task_t task, void * arg,
+        int count);
+
+/* the per-thread scratch buffers; a function and the ones it calls must use
+   different slots */
+enum {
+    THREADPOOL_SCRATCH_BAND = 0,    /* one band of dc1394_debayer_frames() */
+    THREADPOOL_SCRATCH_FUSED,       /* the RGB8 rows of dc1394_debayer_convert_frames() */
+    THREADPOOL_SCRATCH_STRIDE,      /* packed copies for the strided de-mosaicing */
+    THREADPOOL_SCRATCH_AHD,         /* the AHD tile buffer */
+    THREADPOOL_SCRATCH_NUM
+};
+
+/*
+  Returns a buffer of at least 'size' bytes private to the calling thread.
+  The buffer is kept (and grown when needed) across calls and is released
+  when the thread exits. Returns NULL on allocation failure.
+*/
+void * threadpool_get_scratch (int slot, size_t size);
+
+#endif
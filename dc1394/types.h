@@ -115,7 +115,12 @@ typedef enum {
     DC1394_COLOR_CODING_MONO16S,
     DC1394_COLOR_CODING_RGB16S,
     DC1394_COLOR_CODING_RAW8,
-    DC1394_COLOR_CODING_RAW16
+    DC1394_COLOR_CODING_RAW16,
+    /* planar codings produced by the conversion functions, never by cameras. All have an 8-bit Y plane first: */
+    DC1394_COLOR_CODING_I420,     /* then U and V planes at half the resolution in both directions */
+    DC1394_COLOR_CODING_NV12,     /* then a plane of interleaved U-V pairs at half the resolution in both directions */
+    DC1394_COLOR_CODING_YV16,     /* then V and U planes at half the horizontal resolution */
+    DC1394_COLOR_CODING_I422      /* then U and V planes at half the horizontal resolution */
 } dc1394color_coding_t;
 #define DC1394_COLOR_CODING_MIN     DC1394_COLOR_CODING_MONO8
 #define DC1394_COLOR_CODING_MAX     DC1394_COLOR_CODING_RAW16
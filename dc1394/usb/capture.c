@@ -26,36 +26,108 @@
 #include <inttypes.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+
+#include "config.h"
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include "usb/usb.h"
 
-/* Callback whenever a bulk transfer finishes. */
+/* Signals that a frame is ready. */
 static void
-callback (struct libusb_transfer * transfer)
+notify_frame (platform_camera_t * craw)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+    uint64_t one = 1;
+    write (craw->notify_fd[1], &one, sizeof one);
+#else
+    write (craw->notify_fd[1], "+", 1);
+#endif
+}
+
+/* Clears the notifications once no frame is ready, and signals again
+   if a frame completed meanwhile. The fd thus stays readable while frames
+   are ready, for only one read() per burst of frames. */
+static void
+clear_notify (platform_camera_t * craw)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+    uint64_t count;
+    read (craw->notify_fd[0], &count, sizeof count);
+#else
+    char buf[64];
+    while (read (craw->notify_fd[0], buf, sizeof buf) == sizeof buf);
+#endif
+    if (__atomic_load_n (&craw->frames_ready, __ATOMIC_SEQ_CST) > 0)
+        notify_frame (craw);
+}
+
+static int
+frame_filled (struct usb_frame * f)
+{
+    usb_frame_status status = __atomic_load_n (&f->status, __ATOMIC_ACQUIRE);
+    return status == BUFFER_FILLED || status == BUFFER_CORRUPT;
+}
+
+/* Counts finished transfers of a frame, and the frame as filled once they
+   all are. */
+static void
+transfers_done (struct usb_frame * f, int count)
 {
-    struct usb_frame * f = transfer->user_data;
     platform_camera_t * craw = f->pcam;
+    usb_frame_status status = BUFFER_FILLED;
+    struct timespec now;
 
-    if (transfer->status == LIBUSB_TRANSFER_CANCELLED) {
-        dc1394_log_warning ("usb: Bulk transfer %d cancelled", f->frame.id);
+    if (__atomic_add_fetch (&f->transfers_done, count, __ATOMIC_ACQ_REL)
+            < craw->transfers_per_frame)
         return;
-    }
 
-    if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
-        dc1394_log_error ("usb: Bulk transfer %d failed with code %d",
-                f->frame.id, transfer->status);
-
-    dc1394_log_debug ("usb: Bulk transfer %d complete, %d of %d bytes",
-            f->frame.id, transfer->actual_length, transfer->length);
-    int status = BUFFER_FILLED;
-    if (transfer->actual_length < transfer->length)
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    f->frame.timestamp = (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    if (__atomic_load_n (&f->short_transfer, __ATOMIC_RELAXED))
         status = BUFFER_CORRUPT;
-    pthread_mutex_lock (&craw->mutex);
-    f->status = status;
-    craw->frames_ready++;
-    pthread_mutex_unlock (&craw->mutex);
+    /* counted before it is flagged, so that a filled frame is always counted */
+    __atomic_add_fetch (&craw->frames_ready, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n (&f->status, status, __ATOMIC_RELEASE);
 
-    write (craw->notify_pipe[1], "+", 1);
+    notify_frame (craw);
+}
+
+/*
+  Starts a resync, with resync_mutex held: the transfers in flight are
+  cancelled and the drain transfer reads the stream in their place. Their
+  frames are then flagged corrupt as they are called back.
+*/
+static void
+start_resync (platform_camera_t * craw)
+{
+    int i, j;
+
+    if (craw->resync || __atomic_load_n (&craw->kill_thread, __ATOMIC_ACQUIRE))
+        return;
+
+    dc1394_log_debug ("usb: Frames out of step, reading up to the next one");
+    __atomic_store_n (&craw->resync, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < craw->num_frames; i++) {
+        for (j = 0; j < craw->transfers_per_frame; j++)
+            libusb_cancel_transfer (craw->frames[i].transfers[j]);
+    }
+
+    __atomic_add_fetch (&craw->transfers_pending, 1, __ATOMIC_ACQ_REL);
+    if (libusb_submit_transfer (craw->drain) < 0) {
+        /* no frame waits yet: the next ones go as they are enqueued */
+        __atomic_sub_fetch (&craw->transfers_pending, 1, __ATOMIC_RELEASE);
+        dc1394_log_error ("usb: Failed to submit the drain transfer");
+        __atomic_store_n (&craw->resync, 0, __ATOMIC_RELEASE);
+    }
 }
 
 static void *
@@ -71,12 +143,9 @@ capture_thread (void * arg)
             .tv_usec = 100000,
         };
         libusb_handle_events_timeout(craw->thread_context, &tv);
-        pthread_mutex_lock (&craw->mutex);
-        if (craw->kill_thread)
+        if (__atomic_load_n (&craw->kill_thread, __ATOMIC_ACQUIRE))
             break;
-        pthread_mutex_unlock (&craw->mutex);
     }
-    pthread_mutex_unlock (&craw->mutex);
     dc1394_log_debug ("usb: Helper thread ending");
     return NULL;
 }
@@ -85,29 +154,293 @@ static dc1394error_t
 init_frame(platform_camera_t *craw, int index, dc1394video_frame_t *proto)
 {
     struct usb_frame *f = craw->frames + index;
+    int i;
 
     memcpy (&f->frame, proto, sizeof f->frame);
-    f->frame.image = craw->buffer + index * proto->total_bytes;
+    f->frame.image = craw->buffer + index * craw->frame_stride;
     f->frame.id = index;
-    f->transfer = libusb_alloc_transfer (0);
     f->pcam = craw;
     f->status = BUFFER_EMPTY;
+    f->transfers = calloc (craw->transfers_per_frame, sizeof *f->transfers);
+    if (f->transfers == NULL)
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+    for (i = 0; i < craw->transfers_per_frame; i++) {
+        f->transfers[i] = libusb_alloc_transfer (0);
+        if (f->transfers[i] == NULL)
+            return DC1394_MEMORY_ALLOCATION_FAILURE;
+    }
+    return DC1394_SUCCESS;
+}
+
+/* Submits the transfers of a frame, in the order of the frame, with
+   resync_mutex held. */
+static dc1394error_t
+submit_frame (platform_camera_t *craw, struct usb_frame *f)
+{
+    int i;
+
+    f->transfers_done = 0;
+    f->short_transfer = 0;
+    __atomic_store_n (&f->status, BUFFER_EMPTY, __ATOMIC_RELAXED);
+    for (i = 0; i < craw->transfers_per_frame; i++) {
+        __atomic_add_fetch (&craw->transfers_pending, 1, __ATOMIC_ACQ_REL);
+        if (libusb_submit_transfer (f->transfers[i]) < 0) {
+            __atomic_sub_fetch (&craw->transfers_pending, 1, __ATOMIC_RELEASE);
+            dc1394_log_error ("usb: Failed to submit transfer %d of frame %d",
+                    i, f->frame.id);
+            /* the transfers submitted would take the start of the next
+               frame: the frame is done once they are cancelled */
+            __atomic_store_n (&f->short_transfer, 1, __ATOMIC_RELAXED);
+            transfers_done (f, craw->transfers_per_frame - i);
+            start_resync (craw);
+            return DC1394_FAILURE;
+        }
+    }
+    return DC1394_SUCCESS;
+}
+
+/* Submits a frame enqueued, or has it wait for the end of a resync. */
+static dc1394error_t
+enqueue_frame (platform_camera_t * craw, struct usb_frame * f)
+{
+    dc1394error_t err = DC1394_SUCCESS;
+
+    pthread_mutex_lock (&craw->resync_mutex);
+    if (craw->resync) {
+        f->transfers_done = 0;
+        f->short_transfer = 0;
+        __atomic_store_n (&f->status, BUFFER_EMPTY, __ATOMIC_RELAXED);
+        craw->waiting[craw->num_waiting++] = f->frame.id;
+    }
+    else
+        err = submit_frame (craw, f);
+    pthread_mutex_unlock (&craw->resync_mutex);
+    return err;
+}
+
+/* Callback whenever a bulk transfer of a frame finishes. The transfer is
+   no longer pending once it has done with the frame. */
+static void
+callback (struct libusb_transfer * transfer)
+{
+    struct usb_frame * f = transfer->user_data;
+    platform_camera_t * craw = f->pcam;
+
+    if (transfer->status == LIBUSB_TRANSFER_CANCELLED) {
+        dc1394_log_debug ("usb: Bulk transfer of frame %d cancelled",
+                f->frame.id);
+        __atomic_store_n (&f->short_transfer, 1, __ATOMIC_RELAXED);
+        transfers_done (f, 1);
+        __atomic_sub_fetch (&craw->transfers_pending, 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+        dc1394_log_error ("usb: Bulk transfer of frame %d failed with code %d",
+                f->frame.id, transfer->status);
+
+    dc1394_log_debug ("usb: Bulk transfer of frame %d complete, %d of %d bytes",
+            f->frame.id, transfer->actual_length, transfer->length);
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED ||
+            transfer->actual_length < transfer->length) {
+        /* the frame ended early, or some of it was lost: the transfers
+           in flight would take the next frames out of step */
+        __atomic_store_n (&f->short_transfer, 1, __ATOMIC_RELAXED);
+        pthread_mutex_lock (&craw->resync_mutex);
+        start_resync (craw);
+        pthread_mutex_unlock (&craw->resync_mutex);
+    }
+    else if (__atomic_load_n (&craw->resync, __ATOMIC_ACQUIRE))
+        /* filled before its cancellation, from anywhere in a frame */
+        __atomic_store_n (&f->short_transfer, 1, __ATOMIC_RELAXED);
+    transfers_done (f, 1);
+    __atomic_sub_fetch (&craw->transfers_pending, 1, __ATOMIC_RELEASE);
+}
+
+/*
+  Callback of the drain transfer. It is submitted again as long as it is
+  filled. Once it ends short, the next data starts a frame: the frames that
+  waited are submitted, in the order they were enqueued.
+*/
+static void
+drain_callback (struct libusb_transfer * transfer)
+{
+    platform_camera_t * craw = transfer->user_data;
+    int i;
+
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED &&
+            transfer->actual_length == transfer->length &&
+            !__atomic_load_n (&craw->kill_thread, __ATOMIC_ACQUIRE) &&
+            libusb_submit_transfer (transfer) == 0)
+        return;
+
+    if (transfer->status == LIBUSB_TRANSFER_CANCELLED) {
+        __atomic_sub_fetch (&craw->transfers_pending, 1, __ATOMIC_RELEASE);
+        return;
+    }
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+        dc1394_log_error ("usb: Drain transfer failed with code %d",
+                transfer->status);
+
+    dc1394_log_debug ("usb: Back in step, submitting %d frames",
+            craw->num_waiting);
+    pthread_mutex_lock (&craw->resync_mutex);
+    __atomic_store_n (&craw->resync, 0, __ATOMIC_RELEASE);
+    /* a failed submission starts another resync, which the others wait for */
+    for (i = 0; i < craw->num_waiting && !craw->resync; i++)
+        submit_frame (craw, craw->frames + craw->waiting[i]);
+    memmove (craw->waiting, craw->waiting + i,
+            (craw->num_waiting - i) * sizeof *craw->waiting);
+    craw->num_waiting -= i;
+    pthread_mutex_unlock (&craw->resync_mutex);
+    __atomic_sub_fetch (&craw->transfers_pending, 1, __ATOMIC_RELEASE);
+}
+
+/*
+  Cancels the transfers in flight and handles the events until all of them
+  are called back, as they write to the frames until then. Returns 0 if
+  some are still pending after USB_CANCEL_TIMEOUT.
+*/
+static int
+cancel_transfers (platform_camera_t *craw)
+{
+    struct timespec deadline, now;
+    int i, j;
+
+    for (i = 0; i < craw->num_frames; i++) {
+        struct usb_frame *f = craw->frames + i;
+        for (j = 0; f->transfers && j < craw->transfers_per_frame; j++) {
+            if (f->transfers[j])
+                libusb_cancel_transfer (f->transfers[j]);
+        }
+    }
+    if (craw->drain)
+        libusb_cancel_transfer (craw->drain);
+
+    clock_gettime (CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += USB_CANCEL_TIMEOUT;
+    while (__atomic_load_n (&craw->transfers_pending, __ATOMIC_ACQUIRE) > 0) {
+        struct timeval tv = {
+            .tv_sec = 0,
+            .tv_usec = 100000,
+        };
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > deadline.tv_sec ||
+                (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec))
+            return 0;
+        libusb_handle_events_timeout (craw->thread_context, &tv);
+    }
+    return 1;
+}
+
+/*
+  Allocates the ring buffer, on a page boundary. In huge pages if asked,
+  falling back to pages the kernel may still merge into huge ones.
+*/
+static dc1394error_t
+alloc_buffer (platform_camera_t *craw, int huge_pages)
+{
+    void * buffer;
+
+    if (craw->user_buffer) {
+        if (craw->user_buffer_size < craw->buffer_size) {
+            dc1394_log_error ("usb: The buffer given holds %zu bytes, %zu are needed",
+                    craw->user_buffer_size, craw->buffer_size);
+            return DC1394_INVALID_ARGUMENT_VALUE;
+        }
+        craw->buffer = craw->user_buffer;
+        return DC1394_SUCCESS;
+    }
+
+#ifdef HAVE_SYS_MMAN_H
+    if (huge_pages) {
+#ifdef MAP_HUGETLB
+        /* huge pages are unmapped whole */
+        size_t length = (craw->buffer_size + USB_HUGE_PAGE_SIZE - 1) /
+            USB_HUGE_PAGE_SIZE * USB_HUGE_PAGE_SIZE;
+        buffer = mmap (NULL, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (buffer != MAP_FAILED) {
+            craw->buffer = buffer;
+            craw->buffer_mapped = length;
+            return DC1394_SUCCESS;
+        }
+        dc1394_log_warning ("usb: No huge pages for the ring buffer: %s",
+                strerror (errno));
+#endif
+        buffer = mmap (NULL, craw->buffer_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED)
+            return DC1394_MEMORY_ALLOCATION_FAILURE;
+#ifdef MADV_HUGEPAGE
+        madvise (buffer, craw->buffer_size, MADV_HUGEPAGE);
+#endif
+        craw->buffer = buffer;
+        craw->buffer_mapped = craw->buffer_size;
+        return DC1394_SUCCESS;
+    }
+#endif
+
+    if (posix_memalign (&buffer, sysconf (_SC_PAGESIZE), craw->buffer_size) != 0)
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+    craw->buffer = buffer;
     return DC1394_SUCCESS;
 }
 
+static void
+free_buffer (platform_camera_t *craw)
+{
+    if (craw->buffer != NULL && craw->buffer != craw->user_buffer) {
+#ifdef HAVE_SYS_MMAN_H
+        if (craw->buffer_mapped)
+            munmap (craw->buffer, craw->buffer_mapped);
+        else
+#endif
+            free (craw->buffer);
+    }
+    craw->buffer = NULL;
+    craw->buffer_mapped = 0;
+}
+
+/* Gets the number of transfers per frame asked for, if any. */
+static int
+get_transfers_per_frame (void)
+{
+    const char * env = getenv (USB_TRANSFERS_ENV);
+    char * end;
+    long n;
+
+    if (env == NULL)
+        return USB_TRANSFERS_DEFAULT;
+
+    n = strtol (env, &end, 10);
+    if (end == env || *end != '\0' || n < 1 || n > USB_TRANSFERS_MAX) {
+        dc1394_log_warning ("usb: Invalid %s \"%s\", using %d transfers",
+                USB_TRANSFERS_ENV, env, USB_TRANSFERS_DEFAULT);
+        return USB_TRANSFERS_DEFAULT;
+    }
+    return n;
+}
+
 dc1394error_t
 dc1394_usb_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
         uint32_t flags)
 {
     dc1394video_frame_t proto;
-    int i;
+    dc1394error_t err;
+    int i, j, packet_size, transfers;
+    uint64_t size;
     dc1394camera_t * camera = craw->camera;
+    int huge_pages = flags & DC1394_CAPTURE_FLAGS_HUGE_PAGES;
 
     // if capture is already set, abort
     if (craw->capture_is_set > 0)
         return DC1394_CAPTURE_IS_RUNNING;
 
     craw->capture_is_set = 1;
+    pthread_mutex_init (&craw->resync_mutex, NULL);
+    craw->resync = 0;
+    craw->num_waiting = 0;
 
     if (flags & DC1394_CAPTURE_FLAGS_DEFAULT)
         flags = DC1394_CAPTURE_FLAGS_CHANNEL_ALLOC |
@@ -121,21 +454,48 @@ dc1394_usb_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
         return DC1394_FAILURE;
     }
 
-    if (pipe (craw->notify_pipe) < 0) {
+#ifdef HAVE_SYS_EVENTFD_H
+    craw->notify_fd[0] = craw->notify_fd[1] = eventfd (0, EFD_NONBLOCK);
+    if (craw->notify_fd[0] < 0) {
+        dc1394_usb_capture_stop (craw);
+        return DC1394_FAILURE;
+    }
+#else
+    if (pipe (craw->notify_fd) < 0) {
+        craw->notify_fd[0] = craw->notify_fd[1] = -1;
         dc1394_usb_capture_stop (craw);
         return DC1394_FAILURE;
     }
+    fcntl (craw->notify_fd[0], F_SETFL, O_NONBLOCK);
+    fcntl (craw->notify_fd[1], F_SETFL, O_NONBLOCK);
+#endif
 
     dc1394_log_debug ("usb: Frame size is %"PRId64, proto.total_bytes);
 
+    /* the frames are split at multiples of the packet size, so that the
+       transfers end with the packets of the camera */
+    packet_size = libusb_get_max_packet_size (libusb_get_device (craw->handle),
+            0x81);
+    if (packet_size <= 0)
+        packet_size = 1024;
+    transfers = get_transfers_per_frame ();
+    size = (proto.total_bytes + transfers - 1) / transfers;
+    size = (size + packet_size - 1) / packet_size * packet_size;
+    craw->transfer_size = size;
+    craw->transfers_per_frame = (proto.total_bytes + size - 1) / size;
+    dc1394_log_debug ("usb: %d transfers of %"PRIu32" bytes per frame",
+            craw->transfers_per_frame, craw->transfer_size);
+
     craw->num_frames = num_dma_buffers;
     craw->current = -1;
     craw->frames_ready = 0;
-    craw->buffer_size = proto.total_bytes * num_dma_buffers;
-    craw->buffer = malloc (craw->buffer_size);
-    if (craw->buffer == NULL) {
+    craw->transfers_pending = 0;
+    craw->frame_stride = CAPTURE_FRAME_STRIDE (proto.total_bytes);
+    craw->buffer_size = craw->frame_stride * num_dma_buffers;
+    err = alloc_buffer (craw, huge_pages);
+    if (err != DC1394_SUCCESS) {
         dc1394_usb_capture_stop (craw);
-        return DC1394_MEMORY_ALLOCATION_FAILURE;
+        return err;
     }
 
     craw->frames = calloc (num_dma_buffers, sizeof *craw->frames);
@@ -144,8 +504,21 @@ dc1394_usb_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
         return DC1394_MEMORY_ALLOCATION_FAILURE;
     }
 
-    for (i = 0; i < num_dma_buffers; i++)
-        init_frame(craw, i, &proto);
+    for (i = 0; i < num_dma_buffers; i++) {
+        err = init_frame(craw, i, &proto);
+        if (err != DC1394_SUCCESS) {
+            dc1394_usb_capture_stop (craw);
+            return err;
+        }
+    }
+
+    craw->waiting = malloc (num_dma_buffers * sizeof *craw->waiting);
+    craw->drain = libusb_alloc_transfer (0);
+    craw->drain_buffer = malloc (craw->transfer_size);
+    if (!craw->waiting || !craw->drain || !craw->drain_buffer) {
+        dc1394_usb_capture_stop (craw);
+        return DC1394_MEMORY_ALLOCATION_FAILURE;
+    }
 
     if (libusb_init(&craw->thread_context) != 0) {
         dc1394_log_error ("usb: Failed to create thread USB context");
@@ -186,23 +559,26 @@ dc1394_usb_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
 
     for (i = 0; i < craw->num_frames; i++) {
         struct usb_frame *f = craw->frames + i;
-        libusb_fill_bulk_transfer (f->transfer, craw->thread_handle,
-                0x81, f->frame.image, f->frame.total_bytes,
-                callback, f, 0);
+        for (j = 0; j < craw->transfers_per_frame; j++) {
+            uint64_t offset = (uint64_t) j * craw->transfer_size;
+            uint64_t length = f->frame.total_bytes - offset;
+            if (length > craw->transfer_size)
+                length = craw->transfer_size;
+            libusb_fill_bulk_transfer (f->transfers[j], craw->thread_handle,
+                    0x81, f->frame.image + offset, length,
+                    callback, f, 0);
+        }
     }
+    libusb_fill_bulk_transfer (craw->drain, craw->thread_handle, 0x81,
+            craw->drain_buffer, craw->transfer_size, drain_callback, craw, 0);
     for (i = 0; i < craw->num_frames; i++) {
-        if (libusb_submit_transfer (craw->frames[i].transfer) < 0) {
-            dc1394_log_error ("usb: Failed to submit initial transfer %d", i);
+        if (enqueue_frame (craw, craw->frames + i) != DC1394_SUCCESS) {
+            dc1394_log_error ("usb: Failed to submit initial frame %d", i);
             dc1394_usb_capture_stop (craw);
             return DC1394_FAILURE;
         }
     }
 
-    if (pthread_mutex_init (&craw->mutex, NULL) < 0) {
-        dc1394_usb_capture_stop (craw);
-        return DC1394_FAILURE;
-    }
-    craw->mutex_created = 1;
     if (pthread_create (&craw->thread, NULL, capture_thread, craw) < 0) {
         dc1394_log_error ("usb: Failed to launch helper thread");
         dc1394_usb_capture_stop (craw);
@@ -223,7 +599,7 @@ dc1394error_t
 dc1394_usb_capture_stop(platform_camera_t *craw)
 {
     dc1394camera_t * camera = craw->camera;
-    int i;
+    int i, j;
 
     if (craw->capture_is_set == 0)
         return DC1394_CAPTURE_IS_NOT_SET;
@@ -237,23 +613,25 @@ dc1394_usb_capture_stop(platform_camera_t *craw)
     }
 
     if (craw->thread_created) {
-#if 0
-        for (i = 0; i < craw->num_frames; i++) {
-            libusb_cancel_transfer (craw->frames[i].transfer);
-        }
-#endif
-        pthread_mutex_lock (&craw->mutex);
-        craw->kill_thread = 1;
-        pthread_mutex_unlock (&craw->mutex);
+        __atomic_store_n (&craw->kill_thread, 1, __ATOMIC_RELEASE);
         pthread_join (craw->thread, NULL);
         dc1394_log_debug ("usb: Joined with helper thread");
         craw->kill_thread = 0;
         craw->thread_created = 0;
     }
 
-    if (craw->mutex_created) {
-        pthread_mutex_destroy (&craw->mutex);
-        craw->mutex_created = 0;
+    if (craw->thread_context && craw->frames && !cancel_transfers (craw)) {
+        /* the frames and the buffer are left to the transfers, which
+           may still write to them */
+        dc1394_log_error ("usb: %d transfers still pending, leaking the ring buffer",
+                __atomic_load_n (&craw->transfers_pending, __ATOMIC_ACQUIRE));
+        craw->frames = NULL;
+        craw->buffer = NULL;
+        craw->buffer_mapped = 0;
+        craw->drain = NULL;
+        craw->drain_buffer = NULL;
+        craw->thread_handle = NULL;
+        craw->thread_context = NULL;
     }
 
     if (craw->thread_handle) {
@@ -269,35 +647,131 @@ dc1394_usb_capture_stop(platform_camera_t *craw)
 
     if (craw->frames) {
         for (i = 0; i < craw->num_frames; i++) {
-            libusb_free_transfer (craw->frames[i].transfer);
+            struct usb_frame *f = craw->frames + i;
+            for (j = 0; f->transfers && j < craw->transfers_per_frame; j++)
+                libusb_free_transfer (f->transfers[j]);
+            free (f->transfers);
         }
         free (craw->frames);
         craw->frames = NULL;
     }
-
-    free (craw->buffer);
-    craw->buffer = NULL;
-
-    if (craw->notify_pipe[0] != 0 || craw->notify_pipe[1] != 0) {
-        close (craw->notify_pipe[0]);
-        close (craw->notify_pipe[1]);
+    if (craw->drain) {
+        libusb_free_transfer (craw->drain);
+        craw->drain = NULL;
     }
-    craw->notify_pipe[0] = 0;
-    craw->notify_pipe[1] = 0;
+    free (craw->drain_buffer);
+    craw->drain_buffer = NULL;
+    free (craw->waiting);
+    craw->waiting = NULL;
+    craw->num_waiting = 0;
+    craw->resync = 0;
+    pthread_mutex_destroy (&craw->resync_mutex);
+
+    free_buffer (craw);
+
+    if (craw->notify_fd[1] >= 0 && craw->notify_fd[1] != craw->notify_fd[0])
+        close (craw->notify_fd[1]);
+    if (craw->notify_fd[0] >= 0)
+        close (craw->notify_fd[0]);
+    craw->notify_fd[0] = craw->notify_fd[1] = -1;
 
     craw->capture_is_set = 0;
 
     return DC1394_SUCCESS;
 }
 
+dc1394error_t
+dc1394_usb_capture_set_buffer(platform_camera_t *craw, void *buffer,
+        size_t size)
+{
+    if (craw->capture_is_set > 0)
+        return DC1394_CAPTURE_IS_RUNNING;
+
+    craw->user_buffer = buffer;
+    craw->user_buffer_size = buffer ? size : 0;
+    return DC1394_SUCCESS;
+}
+
 #define NEXT_BUFFER(c,i) (((i) == -1) ? 0 : ((i)+1)%(c)->num_frames)
 
+/*
+  Waits for the next frame of the ring to be filled, for at most timeout_us
+  microseconds unless timeout_us is NULL. Returns 1 if it is filled, 0 on
+  timeout and -1 on failure.
+*/
+static int
+wait_frame (platform_camera_t * craw, const uint32_t * timeout_us)
+{
+    struct usb_frame * f = craw->frames + NEXT_BUFFER (craw, craw->current);
+    struct pollfd fds[1];
+    struct timespec deadline, now;
+    int64_t left_us, left_ms = -1;
+    int err;
+
+    if (timeout_us) {
+        clock_gettime (CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += *timeout_us / 1000000;
+        deadline.tv_nsec += (*timeout_us % 1000000) * 1000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    fds[0].fd = craw->notify_fd[0];
+    fds[0].events = POLLIN;
+    while (!frame_filled (f)) {
+        /* a notification of a frame that was already taken */
+        if (__atomic_load_n (&craw->frames_ready, __ATOMIC_SEQ_CST) == 0)
+            clear_notify (craw);
+
+        if (timeout_us) {
+            /* poll() counts in milliseconds: round up, not to return early */
+            clock_gettime (CLOCK_MONOTONIC, &now);
+            left_us = (deadline.tv_sec - now.tv_sec) * 1000000LL
+                + (deadline.tv_nsec - now.tv_nsec) / 1000;
+            left_ms = left_us > 0 ? (left_us + 999) / 1000 : 0;
+        }
+        err = poll (fds, 1, left_ms);
+        if (err < 0) {
+            if (errno == EINTR)
+                continue;
+            dc1394_log_error ("usb: poll() failed");
+            return -1;
+        }
+        if (err == 0)
+            return frame_filled (f);
+    }
+
+    return 1;
+}
+
+/* takes the next frame of the ring, which is filled */
+static struct usb_frame *
+take_frame (platform_camera_t * craw)
+{
+    int next = NEXT_BUFFER (craw, craw->current);
+    struct usb_frame * f = craw->frames + next;
+    int ready;
+
+    if (!frame_filled (f)) {
+        dc1394_log_error ("usb: Expected filled buffer");
+        return NULL;
+    }
+    ready = __atomic_sub_fetch (&craw->frames_ready, 1, __ATOMIC_SEQ_CST);
+    if (ready == 0)
+        clear_notify (craw);
+    f->frame.frames_behind = ready;
+
+    craw->current = next;
+    return f;
+}
+
 dc1394error_t
 dc1394_usb_capture_dequeue (platform_camera_t * craw,
         dc1394capture_policy_t policy, dc1394video_frame_t **frame_return)
 {
-    int next = NEXT_BUFFER (craw, craw->current);
-    struct usb_frame * f = craw->frames + next;
+    struct usb_frame * f;
 
     if ((policy < DC1394_CAPTURE_POLICY_MIN)
             || (policy > DC1394_CAPTURE_POLICY_MAX))
@@ -307,28 +781,49 @@ dc1394_usb_capture_dequeue (platform_camera_t * craw,
     *frame_return = NULL;
 
     if (policy == DC1394_CAPTURE_POLICY_POLL) {
-        int status;
-        pthread_mutex_lock (&craw->mutex);
-        status = f->status;
-        pthread_mutex_unlock (&craw->mutex);
-        if (status != BUFFER_FILLED && status != BUFFER_CORRUPT)
+        if (!frame_filled (craw->frames + NEXT_BUFFER (craw, craw->current)))
             return DC1394_SUCCESS;
     }
+    else if (wait_frame (craw, NULL) < 0)
+        return DC1394_FAILURE;
 
-    char ch;
-    read (craw->notify_pipe[0], &ch, 1);
-
-    pthread_mutex_lock (&craw->mutex);
-    if (f->status != BUFFER_FILLED && f->status != BUFFER_CORRUPT) {
-        dc1394_log_error ("usb: Expected filled buffer");
-        pthread_mutex_unlock (&craw->mutex);
+    f = take_frame (craw);
+    if (!f)
         return DC1394_FAILURE;
+
+    /* the frames filled after this one are ready: give it back and take the next */
+    while (policy == DC1394_CAPTURE_POLICY_LATEST &&
+            frame_filled (craw->frames + NEXT_BUFFER (craw, craw->current))) {
+        dc1394_usb_capture_enqueue (craw, &f->frame);
+        f = take_frame (craw);
+        if (!f)
+            return DC1394_FAILURE;
     }
-    craw->frames_ready--;
-    f->frame.frames_behind = craw->frames_ready;
-    pthread_mutex_unlock (&craw->mutex);
 
-    craw->current = next;
+    *frame_return = &f->frame;
+
+    return DC1394_SUCCESS;
+}
+
+dc1394error_t
+dc1394_usb_capture_dequeue_timeout (platform_camera_t * craw,
+        uint32_t timeout_us, dc1394video_frame_t **frame_return)
+{
+    struct usb_frame * f;
+    int err;
+
+    /* default: return NULL in case of failures or lack of frames */
+    *frame_return = NULL;
+
+    err = wait_frame (craw, &timeout_us);
+    if (err < 0)
+        return DC1394_FAILURE;
+    if (err == 0)
+        return DC1394_SUCCESS;
+
+    f = take_frame (craw);
+    if (!f)
+        return DC1394_FAILURE;
 
     *frame_return = &f->frame;
 
@@ -347,24 +842,18 @@ dc1394_usb_capture_enqueue (platform_camera_t * craw,
         return DC1394_INVALID_ARGUMENT_VALUE;
     }
 
-    if (f->status != BUFFER_FILLED && f->status != BUFFER_CORRUPT) {
+    if (!frame_filled (f)) {
         dc1394_log_error ("usb: Frame is not enqueuable");
         return DC1394_FAILURE;
     }
 
-    f->status = BUFFER_EMPTY;
-    libusb_submit_transfer (f->transfer);
-
-    return DC1394_SUCCESS;
+    return enqueue_frame (craw, f);
 }
 
 int
 dc1394_usb_capture_get_fileno (platform_camera_t * craw)
 {
-    if (craw->notify_pipe[0] == 0 && craw->notify_pipe[1] == 0)
-        return -1;
-
-    return craw->notify_pipe[0];
+    return craw->notify_fd[0];
 }
 
 dc1394bool_t
@@ -269,6 +269,7 @@ dc1394_usb_camera_new (platform_t * p, platform_device_t * device,
 
     camera = calloc (1, sizeof (platform_camera_t));
     camera->handle = handle;
+    camera->notify_fd[0] = camera->notify_fd[1] = -1;
     return camera;
 }
 
@@ -371,7 +372,9 @@ usb_dispatch = {
 
     .capture_setup = dc1394_usb_capture_setup,
     .capture_stop = dc1394_usb_capture_stop,
+    .capture_set_buffer = dc1394_usb_capture_set_buffer,
     .capture_dequeue = dc1394_usb_capture_dequeue,
+    .capture_dequeue_timeout = dc1394_usb_capture_dequeue_timeout,
     .capture_enqueue = dc1394_usb_capture_enqueue,
     .capture_get_fileno = dc1394_usb_capture_get_fileno,
     .capture_is_frame_corrupt = dc1394_usb_capture_is_frame_corrupt,
@@ -33,6 +33,20 @@ struct _platform_t {
     libusb_context *context;
 };
 
+/* Each frame is read by several bulk transfers in flight at once, each
+   into its part of the frame buffer. Their number can be set from 1 to
+   USB_TRANSFERS_MAX with the DC1394_USB_TRANSFERS environment variable. */
+#define USB_TRANSFERS_ENV      "DC1394_USB_TRANSFERS"
+#define USB_TRANSFERS_DEFAULT  4
+#define USB_TRANSFERS_MAX      64
+
+/* the size of the huge pages of DC1394_CAPTURE_FLAGS_HUGE_PAGES: the
+   default one of x86 and most 64-bit ARM systems */
+#define USB_HUGE_PAGE_SIZE     (2 * 1024 * 1024)
+
+/* the seconds dc1394_capture_stop() waits for the cancelled transfers */
+#define USB_CANCEL_TIMEOUT     1
+
 struct _platform_camera_t {
     libusb_device_handle * handle;
     dc1394camera_t * camera;
@@ -40,18 +54,39 @@ struct _platform_camera_t {
     struct usb_frame        * frames;
     unsigned char        * buffer;
     size_t buffer_size;
+    size_t buffer_mapped;       /* the length of the mmap() of buffer, or 0 */
+    uint64_t frame_stride;
+    /* the ring buffer given with dc1394_capture_set_buffer(), if any */
+    unsigned char        * user_buffer;
+    size_t user_buffer_size;
     uint32_t flags;
     unsigned int num_frames;
     int current;
     int frames_ready;
+    int transfers_per_frame;
+    uint32_t transfer_size;     /* but the last transfer of a frame */
+    int transfers_pending;      /* submitted and not called back yet, atomic */
+
+    /* After a transfer ends short or fails, the transfers in flight may
+       hold any part of the next frames. They are all cancelled, and the
+       drain transfer reads the stream up to the next short packet, the end
+       of a frame. The frames enqueued meanwhile wait in waiting, in the
+       order of the ring, until the drain is done. */
+    pthread_mutex_t resync_mutex;
+    int resync;                 /* atomic, set under resync_mutex */
+    struct libusb_transfer * drain;
+    unsigned char * drain_buffer;
+    int * waiting;
+    int num_waiting;
 
     uint8_t bus;
     uint8_t addr;
-    int notify_pipe[2];
+    /* [0] is readable while frames are ready, [1] signals them: the same
+       eventfd where available, else a pipe. The frames are counted by
+       frames_ready and flagged by their status, both atomic. */
+    int notify_fd[2];
     pthread_t thread;
     int thread_created;
-    pthread_mutex_t mutex;
-    int mutex_created;
     libusb_context *thread_context;
     libusb_device_handle *thread_handle;
     int kill_thread;
@@ -68,7 +103,9 @@ typedef enum {
 
 struct usb_frame {
     dc1394video_frame_t frame;
-    struct libusb_transfer * transfer;
+    struct libusb_transfer ** transfers;    /* in the order of the frame */
+    int transfers_done;                     /* completed or cancelled */
+    int short_transfer;                     /* the frame is incomplete */
     platform_camera_t * pcam;
     usb_frame_status status;
 };
@@ -81,10 +118,18 @@ dc1394_usb_capture_setup(platform_camera_t *craw, uint32_t num_dma_buffers,
 dc1394error_t
 dc1394_usb_capture_stop(platform_camera_t *craw);
 
+dc1394error_t
+dc1394_usb_capture_set_buffer(platform_camera_t *craw, void *buffer,
+        size_t size);
+
 dc1394error_t
 dc1394_usb_capture_dequeue (platform_camera_t * craw,
         dc1394capture_policy_t policy, dc1394video_frame_t **frame_return);
 
+dc1394error_t
+dc1394_usb_capture_dequeue_timeout (platform_camera_t * craw,
+        uint32_t timeout_us, dc1394video_frame_t **frame_return);
+
 dc1394error_t
 dc1394_usb_capture_enqueue (platform_camera_t * craw,
         dc1394video_frame_t * frame);
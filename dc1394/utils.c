@@ -233,6 +233,10 @@ dc1394_is_color(dc1394color_coding_t color_coding, dc1394bool_t *is_color)
     case DC1394_COLOR_CODING_RGB8:
     case DC1394_COLOR_CODING_RGB16:
     case DC1394_COLOR_CODING_RGB16S:
+    case DC1394_COLOR_CODING_I420:
+    case DC1394_COLOR_CODING_NV12:
+    case DC1394_COLOR_CODING_YV16:
+    case DC1394_COLOR_CODING_I422:
         *is_color=DC1394_TRUE;
         return DC1394_SUCCESS;
     }
@@ -249,6 +253,10 @@ dc1394_get_color_coding_data_depth(dc1394color_coding_t color_coding, uint32_t *
     case DC1394_COLOR_CODING_YUV444:
     case DC1394_COLOR_CODING_RGB8:
     case DC1394_COLOR_CODING_RAW8:
+    case DC1394_COLOR_CODING_I420:
+    case DC1394_COLOR_CODING_NV12:
+    case DC1394_COLOR_CODING_YV16:
+    case DC1394_COLOR_CODING_I422:
         *bits = 8;
         return DC1394_SUCCESS;
     case DC1394_COLOR_CODING_MONO16:
@@ -272,12 +280,16 @@ dc1394_get_color_coding_bit_size(dc1394color_coding_t color_coding, uint32_t* bi
         *bits=8;
         return DC1394_SUCCESS;
     case DC1394_COLOR_CODING_YUV411:
+    case DC1394_COLOR_CODING_I420:   // planar codings: on average over the planes
+    case DC1394_COLOR_CODING_NV12:
         *bits=12;
         return DC1394_SUCCESS;
     case DC1394_COLOR_CODING_MONO16:
     case DC1394_COLOR_CODING_RAW16:
     case DC1394_COLOR_CODING_MONO16S:
     case DC1394_COLOR_CODING_YUV422:
+    case DC1394_COLOR_CODING_YV16:
+    case DC1394_COLOR_CODING_I422:
         *bits=16;
         return DC1394_SUCCESS;
     case DC1394_COLOR_CODING_YUV444:
@@ -124,7 +124,12 @@ typedef struct __dc1394_video_frame
     uint32_t                 packet_size;           /* the size of a packet in bytes. (IIDC data) */
     uint32_t                 packets_per_frame;     /* the number of packets per frame. (IIDC data) */
     uint64_t                 timestamp;             /* the unix time [microseconds] at which the frame was captured in
-                                                       the video1394 ringbuffer */
+                                                       the video1394 ringbuffer. With the juju backend, the time of
+                                                       CLOCK_MONOTONIC [microseconds] at which its last packet was
+                                                       received on the bus. With the sim backend, the time of
+                                                       CLOCK_MONOTONIC at which the frame was made. With the usb
+                                                       backend, the time of CLOCK_MONOTONIC at which its last transfer
+                                                       completed. With the replay backend, the recorded timestamp */
     uint32_t                 frames_behind;         /* the number of frames in the ring buffer that are yet to be accessed by the user */
     dc1394camera_t           *camera;               /* the parent camera of this frame */
     uint32_t                 id;                    /* the frame position in the ring buffer */
@@ -133,6 +138,14 @@ typedef struct __dc1394_video_frame
                                                        DC1394_FALSE otherwise */
     dc1394bool_t             data_in_padding;       /* DC1394_TRUE if data is present in the padding bytes in IIDC 1.32 format,
                                                        DC1394_FALSE otherwise */
+    uint32_t                 iso_cycle;             /* the bus cycle in which the last packet of the frame was received,
+                                                       3 bits of seconds and 13 bits of cycle count as in the cycle timer
+                                                       (juju only, 0 otherwise) */
+    uint32_t                 references;            /* the holders of a frame returned by dc1394_capture_dequeue(): see
+                                                       dc1394_capture_frame_ref(). Not to be changed by the user */
+    uint64_t                 sequence;              /* the number of the frame since dc1394_capture_setup(), from 0. It also counts
+                                                       the frames dropped before this one, as counted by
+                                                       dc1394_capture_get_stats() */
 } dc1394video_frame_t;
 
 #ifdef __cplusplus
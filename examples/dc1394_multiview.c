@@ -43,6 +43,9 @@
 #define MAX_PORTS   4
 #define MAX_CAMERAS 8
 #define NUM_BUFFERS 8
+/* frames of a set at most 10ms apart, waiting at most 1s for them */
+#define SET_TOLERANCE 10000
+#define SET_TIMEOUT 1000000
 
 /* ok the following constant should be by right included thru in Xvlib.h */
 #ifndef XV_YV12
@@ -63,6 +66,7 @@ uint32_t numCameras = 0;
 dc1394camera_t *cameras[MAX_CAMERAS];
 dc1394featureset_t features;
 dc1394video_frame_t * frames[MAX_CAMERAS];
+dc1394group_t *group=NULL;
 
 /* declarations for video1394 */
 char *device_name=NULL;
@@ -150,55 +154,6 @@ void get_options(int argc,char *argv[])
 
 }
 
-/* image format conversion functions */
-
-static inline
-void iyu12yuy2 (unsigned char *src, unsigned char *dest, uint32_t NumPixels) {
-    int i=0,j=0;
-    register int y0, y1, y2, y3, u, v;
-    while (i < NumPixels*3/2) {
-        u = src[i++];
-        y0 = src[i++];
-        y1 = src[i++];
-        v = src[i++];
-        y2 = src[i++];
-        y3 = src[i++];
-
-        dest[j++] = y0;
-        dest[j++] = u;
-        dest[j++] = y1;
-        dest[j++] = v;
-
-        dest[j++] = y2;
-        dest[j++] = u;
-        dest[j++] = y3;
-        dest[j++] = v;
-    }
-}
-
-
-static inline
-void rgb2yuy2 (unsigned char *RGB, unsigned char *YUV, uint32_t NumPixels) {
-    int i, j;
-    register int y0, y1, u0, u1, v0, v1 ;
-    register int r, g, b;
-
-    for (i = 0, j = 0; i < 3 * NumPixels; i += 6, j += 4) {
-        r = RGB[i + 0];
-        g = RGB[i + 1];
-        b = RGB[i + 2];
-        RGB2YUV (r, g, b, y0, u0 , v0);
-        r = RGB[i + 3];
-        g = RGB[i + 4];
-        b = RGB[i + 5];
-        RGB2YUV (r, g, b, y1, u1 , v1);
-        YUV[j + 0] = y0;
-        YUV[j + 1] = (u0+u1)/2;
-        YUV[j + 2] = y1;
-        YUV[j + 3] = (v0+v1)/2;
-    }
-}
-
 /* helper functions */
 
 void set_frame_length(unsigned long size, int numCameras)
@@ -219,9 +174,10 @@ void display_frames()
                 continue;
             switch (res) {
             case DC1394_VIDEO_MODE_640x480_YUV411:
-                iyu12yuy2( frames[i]->image,
-                           (unsigned char *)(frame_buffer + (i * frame_length)),
-                           (device_width*device_height) );
+                dc1394_convert_to_YUV422( frames[i]->image,
+                                          (unsigned char *)(frame_buffer + (i * frame_length)),
+                                          device_width, device_height, DC1394_BYTE_ORDER_YUYV,
+                                          DC1394_COLOR_CODING_YUV411, 8);
                 break;
 
             case DC1394_VIDEO_MODE_320x240_YUV422:
@@ -231,9 +187,10 @@ void display_frames()
                 break;
 
             case DC1394_VIDEO_MODE_640x480_RGB8:
-                rgb2yuy2( frames[i]->image,
-                          (unsigned char *) (frame_buffer + (i * frame_length)),
-                          (device_width*device_height) );
+                dc1394_convert_to_YUV422( frames[i]->image,
+                                          (unsigned char *) (frame_buffer + (i * frame_length)),
+                                          device_width, device_height, DC1394_BYTE_ORDER_YUYV,
+                                          DC1394_COLOR_CODING_RGB8, 8);
                 break;
             }
         }
@@ -278,6 +235,8 @@ void QueryXv()
 
 void cleanup(void) {
     int i;
+    if (group != NULL)
+        dc1394_group_free(group);
     for (i=0; i < numCameras; i++) {
         dc1394_video_set_transmission(cameras[i], DC1394_OFF);
         dc1394_capture_stop(cameras[i]);
@@ -304,6 +263,7 @@ int main(int argc,char *argv[])
     XGCValues xgcv;
     long background=0x010203;
     int i, j;
+    uint32_t num_frames;
     dc1394_t * d;
     dc1394camera_list_t * list;
 
@@ -410,6 +370,13 @@ int main(int argc,char *argv[])
         exit(255);
     }
 
+    group=dc1394_group_new(cameras, numCameras, SET_TOLERANCE, 0);
+    if (group == NULL) {
+        dc1394_log_error("Could not capture from the cameras together");
+        cleanup();
+        exit(-1);
+    }
+
     /* make the window */
     display=XOpenDisplay(getenv("DISPLAY"));
     if(display==NULL) {
@@ -441,10 +408,10 @@ int main(int argc,char *argv[])
     /* main event loop */
     while(1){
 
-        for (i = 0; i < numCameras; i++) {
-            if (dc1394_capture_dequeue(cameras[i], DC1394_CAPTURE_POLICY_WAIT, &frames[i])!=DC1394_SUCCESS)
-                dc1394_log_error("Failed to capture from camera %d", i);
-        }
+        if (dc1394_group_dequeue(group, SET_TIMEOUT, frames, &num_frames)!=DC1394_SUCCESS)
+            dc1394_log_error("Failed to capture from the cameras");
+        else if (num_frames < numCameras)
+            dc1394_log_warning("Got frames from %d of the %d cameras", num_frames, numCameras);
 
         display_frames();
         XFlush(display);
@@ -511,10 +478,7 @@ int main(int argc,char *argv[])
             }
         } /* XPending */
 
-        for (i = 0; i < numCameras; i++) {
-            if (frames[i])
-                dc1394_capture_enqueue (cameras[i], frames[i]);
-        }
+        dc1394_group_enqueue(group, frames);
 
     } /* while not interrupted */
 
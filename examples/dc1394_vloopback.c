@@ -250,51 +250,6 @@ void affine_scale( const unsigned char *src, int src_width, int src_height, unsi
     }
 }
 
-inline void
-yuy2_to_yv16( const unsigned char *src, unsigned char *dest, int width, int height)
-{
-    register int total = (width * height) >> 1;
-    register int i;
-    register unsigned char *img_y = dest;
-    register unsigned char *img_cb = img_y + (width * height);
-    register unsigned char *img_cr = img_cb + total;
-
-    for (i = 0; i < total; i++) {
-        *img_y++  = *src++;
-        *img_cb++ = *src++;
-        *img_y++  = *src++;
-        *img_cr++ = *src++;
-    }
-}
-
-inline void
-yuy2_to_yv12( const unsigned char *src, unsigned char *dest, int width, int height)
-{
-    register int stride = width >> 1;
-    register int i, j;
-    register unsigned char *img_y = dest;
-    register unsigned char *img_cb = img_y + (width * height);
-    register unsigned char *img_cr = img_cb + stride * (height >> 1);
-
-    for (i = 0; i < height; i++) {
-        for (j = 0; j < stride; j++) {
-            if (i%2) {
-                *img_y++  = *src++;
-                src++;
-                *img_y++  = *src++;
-                src++;
-            } else {
-                *img_y++  = *src++;
-                *img_cb++ = (src[width << 1] + src[0]) >> 1;
-                src++;
-                *img_y++  = *src++;
-                *img_cr++ = (src[width << 1] + src[0]) >> 1;
-                src++;
-            }
-        }
-    }
-}
-
 /***** IMAGE CAPTURE **********************************************************/
 
 int capture_pipe(int dev, const unsigned char *image_in)
@@ -331,7 +286,8 @@ int capture_pipe(int dev, const unsigned char *image_in)
         unsigned char *buffer = malloc(memsize);
         if (buffer) {
             memcpy( buffer, out_pipe, memsize);
-            yuy2_to_yv16( buffer, out_pipe, g_width, g_height);
+            dc1394_convert_to_planar( buffer, out_pipe, g_width, g_height, DC1394_BYTE_ORDER_YUYV,
+                                      DC1394_COLOR_CODING_YUV422, 8, DC1394_COLOR_CODING_I422);
             free(buffer);
         }
     }
@@ -340,7 +296,8 @@ int capture_pipe(int dev, const unsigned char *image_in)
         unsigned char *buffer = malloc(memsize);
         if (buffer) {
             memcpy( buffer, out_pipe, memsize);
-            yuy2_to_yv12( buffer, out_pipe, g_width, g_height);
+            dc1394_convert_to_planar( buffer, out_pipe, g_width, g_height, DC1394_BYTE_ORDER_YUYV,
+                                      DC1394_COLOR_CODING_YUV422, 8, DC1394_COLOR_CODING_I420);
             free(buffer);
         }
         size = g_width * g_height * 3 / 2;
@@ -389,7 +346,8 @@ int capture_mmap(int frame)
                           ppp * bpp, transform);
             dc1394_capture_enqueue (camera, framebuf);
         }
-        yuy2_to_yv16( out_pipe, out_mmap + (MAX_WIDTH * MAX_HEIGHT * 3 * frame), g_width, g_height);
+        dc1394_convert_to_planar( out_pipe, out_mmap + (MAX_WIDTH * MAX_HEIGHT * 3 * frame), g_width, g_height,
+                                  DC1394_BYTE_ORDER_YUYV, DC1394_COLOR_CODING_YUV422, 8, DC1394_COLOR_CODING_I422);
     }
     else if (g_v4l_fmt == VIDEO_PALETTE_YUV420P && out_pipe != NULL) {
         err = dc1394_capture_dequeue (camera, DC1394_CAPTURE_POLICY_WAIT, &framebuf);
@@ -399,7 +357,8 @@ int capture_mmap(int frame)
                           ppp * bpp, transform);
             dc1394_capture_enqueue (camera, framebuf);
         }
-        yuy2_to_yv12( out_pipe, out_mmap + (MAX_WIDTH * MAX_HEIGHT * 3 * frame), g_width, g_height);
+        dc1394_convert_to_planar( out_pipe, out_mmap + (MAX_WIDTH * MAX_HEIGHT * 3 * frame), g_width, g_height,
+                                  DC1394_BYTE_ORDER_YUYV, DC1394_COLOR_CODING_YUV422, 8, DC1394_COLOR_CODING_I420);
     }
     else {
         err = dc1394_capture_dequeue (camera, DC1394_CAPTURE_POLICY_WAIT, &framebuf);
@@ -30,6 +30,10 @@
  *   frame. This results in 24 images (512x384) being written
  *   for each (future) hemispherical image.
  *
+ * - the raw frames are saved in a recording (see dc1394/record.h)
+ *   written by a thread of its own, so that the disk does not hold
+ *   back the capture. It can be played back with the replay platform.
+ *
  * Easy adaptation include:
  * - using 1394a instead of 1394b
  * - using RAW instead of JPEG
@@ -62,6 +66,7 @@ main(int argn, char **argv)
     dc1394error_t err;
     dc1394camera_t *camera;
     dc1394video_frame_t *frame;
+    dc1394recorder_t *recorder;
     char filename[256];
 
     FILE *fd;
@@ -98,6 +103,13 @@ main(int argn, char **argv)
     err=dc1394_format7_set_roi(camera, VIDEO_MODE, DC1394_COLOR_CODING_MONO8, 2000, 0,0, 512, 2015);
     DC1394_ERR_RTN(err,"Could not set ROI");
 
+    // the recording takes a snapshot of the camera settings
+    recorder=dc1394_recorder_new(camera, BASENAME ".dcr", DC1394_RECORDER_FLAGS_DIRECT);
+    if (!recorder) {
+        dc1394_log_error("Could not create the recording");
+        return 1;
+    }
+
     // setup capture
     err=dc1394_capture_setup(camera, 10, DC1394_CAPTURE_FLAGS_DEFAULT);
     DC1394_ERR_RTN(err,"Could not setup capture");
@@ -133,18 +145,16 @@ main(int argn, char **argv)
                 }
             }
         }
-        sprintf(filename,"%s-%05d.raw",BASENAME,i);
-        fd=fopen(filename,"w");
-        fwrite(frame->image,frame->total_bytes,1,fd);
-        fclose(fd);
-        // release frame
-        err=dc1394_capture_enqueue(camera, frame);
-        DC1394_ERR_RTN(err,"Could not enqueue a frame");
+        // record the frame, which is released once written
+        err=dc1394_recorder_write(recorder, frame);
+        DC1394_ERR_RTN(err,"Could not record a frame");
         fprintf(stderr,"%d\r",i);
         i++;
     }
 
     // stop capture
+    err=dc1394_recorder_free(recorder);
+    DC1394_ERR_RTN(err,"Could not complete the recording");
     err=dc1394_video_set_transmission(camera, DC1394_OFF);
     DC1394_ERR_RTN(err,"Could not stop transmission");
     err=dc1394_capture_stop(camera);